@@ -288,6 +288,7 @@ FORMS += \
     src/ui/QGCUASFileViewMulti.ui \
     src/ui/QGCUDPLinkConfiguration.ui \
     src/ui/QGCTCPLinkConfiguration.ui \
+    src/ui/QGCSharedMemoryLinkConfiguration.ui \
     src/ui/QGCSettingsWidget.ui \
     src/ui/UASControlParameters.ui \
     src/ui/map/QGCMapTool.ui \
@@ -342,12 +343,25 @@ HEADERS += \
     src/uas/UASInterface.h \
     src/uas/UAS.h \
     src/uas/UASManager.h \
+    src/uas/TelemetryKeyRegistry.h \
+    src/uas/TelemetryStore.h \
     src/comm/LinkManager.h \
     src/comm/LinkInterface.h \
+    src/comm/LinkStatistics.h \
     src/comm/SerialLinkInterface.h \
     src/comm/SerialLink.h \
     src/comm/ProtocolInterface.h \
     src/comm/MAVLinkProtocol.h \
+    src/comm/MAVLinkFramer.h \
+    src/comm/MAVLinkMessage.h \
+    src/comm/MAVLinkLogWriter.h \
+    src/comm/MAVLinkDescriptorTable.h \
+    src/comm/MAVLinkParser.h \
+    src/comm/MAVLinkRouter.h \
+    src/comm/MAVLinkTransmitQueue.h \
+    src/comm/MAVLinkRateController.h \
+    src/comm/MAVLinkTimeSync.h \
+    src/comm/LinkReactor.h \
     src/comm/QGCFlightGearLink.h \
     src/comm/QGCJSBSimLink.h \
     src/comm/QGCXPlaneLink.h \
@@ -366,8 +380,11 @@ HEADERS += \
     src/ui/uas/UASView.h \
     src/ui/CameraView.h \
     src/comm/MAVLinkSimulationLink.h \
+    src/comm/MAVLinkLoadGeneratorLink.h \
     src/comm/UDPLink.h \
     src/comm/TCPLink.h \
+    src/comm/SharedMemoryChannel.h \
+    src/comm/SharedMemoryLink.h \
     src/ui/ParameterInterface.h \
     src/ui/WaypointList.h \
     src/Waypoint.h \
@@ -423,6 +440,7 @@ HEADERS += \
     src/ui/QGCUASFileViewMulti.h \
     src/ui/QGCUDPLinkConfiguration.h \
     src/ui/QGCTCPLinkConfiguration.h \
+    src/ui/QGCSharedMemoryLinkConfiguration.h \
     src/ui/QGCSettingsWidget.h \
     src/ui/uas/UASControlParameters.h \
     src/uas/QGCUASParamManager.h \
@@ -498,7 +516,7 @@ HEADERS += \
     src/uas/QGCUASParamManagerInterface.h \
     src/uas/QGCUASFileManager.h \
     src/ui/QGCUASFileView.h \
-    src/uas/QGCUASWorker.h \
+    src/uas/QGCUASScheduler.h \
     src/CmdLineOptParser.h \
     src/uas/QGXPX4UAS.h
 
@@ -507,9 +525,22 @@ SOURCES += \
     src/QGCCore.cc \
     src/uas/UASManager.cc \
     src/uas/UAS.cc \
+    src/uas/TelemetryKeyRegistry.cc \
+    src/uas/TelemetryStore.cc \
     src/comm/LinkManager.cc \
+    src/comm/LinkStatistics.cc \
     src/comm/SerialLink.cc \
     src/comm/MAVLinkProtocol.cc \
+    src/comm/MAVLinkFramer.cc \
+    src/comm/MAVLinkMessage.cc \
+    src/comm/MAVLinkLogWriter.cc \
+    src/comm/MAVLinkDescriptorTable.cc \
+    src/comm/MAVLinkParser.cc \
+    src/comm/MAVLinkRouter.cc \
+    src/comm/MAVLinkTransmitQueue.cc \
+    src/comm/MAVLinkRateController.cc \
+    src/comm/MAVLinkTimeSync.cc \
+    src/comm/LinkReactor.cc \
     src/comm/QGCFlightGearLink.cc \
     src/comm/QGCJSBSimLink.cc \
     src/comm/QGCXPlaneLink.cc \
@@ -527,8 +558,11 @@ SOURCES += \
     src/ui/uas/UASView.cc \
     src/ui/CameraView.cc \
     src/comm/MAVLinkSimulationLink.cc \
+    src/comm/MAVLinkLoadGeneratorLink.cc \
     src/comm/UDPLink.cc \
     src/comm/TCPLink.cc \
+    src/comm/SharedMemoryChannel.cc \
+    src/comm/SharedMemoryLink.cc \
     src/ui/ParameterInterface.cc \
     src/ui/WaypointList.cc \
     src/Waypoint.cc \
@@ -583,6 +617,7 @@ SOURCES += \
     src/ui/QGCUASFileViewMulti.cc \
     src/ui/QGCUDPLinkConfiguration.cc \
     src/ui/QGCTCPLinkConfiguration.cc \
+    src/ui/QGCSharedMemoryLinkConfiguration.cc \
     src/ui/QGCSettingsWidget.cc \
     src/ui/uas/UASControlParameters.cpp \
     src/uas/QGCUASParamManager.cc \
@@ -654,7 +689,7 @@ SOURCES += \
     src/ui/menuactionhelper.cpp \
     src/uas/QGCUASFileManager.cc \
     src/ui/QGCUASFileView.cc \
-    src/uas/QGCUASWorker.cc \
+    src/uas/QGCUASScheduler.cc \
     src/CmdLineOptParser.cc \
     src/uas/QGXPX4UAS.cc
 
@@ -685,7 +720,28 @@ HEADERS += \
 	src/qgcunittest/TCPLinkTest.h \
 	src/qgcunittest/TCPLoopBackServer.h \
 	src/qgcunittest/QGCUASFileManagerTest.h \
-    src/qgcunittest/PX4RCCalibrationTest.h
+    src/qgcunittest/PX4RCCalibrationTest.h \
+    src/qgcunittest/MAVLinkFramerTest.h \
+    src/qgcunittest/MockLink.h \
+    src/qgcunittest/MAVLinkProtocolTest.h \
+    src/qgcunittest/MAVLinkMessageTest.h \
+    src/qgcunittest/MAVLinkLogWriterTest.h \
+    src/qgcunittest/MAVLinkRouterTest.h \
+    src/qgcunittest/MAVLinkTransmitQueueTest.h \
+    src/qgcunittest/MAVLinkRateControllerTest.h \
+    src/qgcunittest/LinkStatisticsTest.h \
+    src/qgcunittest/UDPLinkTest.h \
+    src/qgcunittest/LinkReactorTest.h \
+    src/qgcunittest/SharedMemoryLinkTest.h \
+    src/qgcunittest/LinkManagerTest.h \
+    src/qgcunittest/MAVLinkLoadGeneratorLinkTest.h \
+    src/qgcunittest/MAVLinkSwarmSimulationLinkTest.h \
+    src/qgcunittest/GroundTimeTest.h \
+    src/qgcunittest/MAVLinkTimeSyncTest.h \
+    src/qgcunittest/TelemetryKeyRegistryTest.h \
+    src/qgcunittest/TelemetryStoreTest.h \
+    src/qgcunittest/QGCUASSchedulerTest.h \
+    src/qgcunittest/MAVLinkDecoderTest.h
 
 SOURCES += \
 	src/qgcunittest/UASUnitTest.cc \
@@ -698,6 +754,27 @@ SOURCES += \
 	src/qgcunittest/TCPLinkTest.cc \
 	src/qgcunittest/TCPLoopBackServer.cc \
 	src/qgcunittest/QGCUASFileManagerTest.cc \
-    src/qgcunittest/PX4RCCalibrationTest.cc
+    src/qgcunittest/PX4RCCalibrationTest.cc \
+    src/qgcunittest/MAVLinkFramerTest.cc \
+    src/qgcunittest/MockLink.cc \
+    src/qgcunittest/MAVLinkProtocolTest.cc \
+    src/qgcunittest/MAVLinkMessageTest.cc \
+    src/qgcunittest/MAVLinkLogWriterTest.cc \
+    src/qgcunittest/MAVLinkRouterTest.cc \
+    src/qgcunittest/MAVLinkTransmitQueueTest.cc \
+    src/qgcunittest/MAVLinkRateControllerTest.cc \
+    src/qgcunittest/LinkStatisticsTest.cc \
+    src/qgcunittest/UDPLinkTest.cc \
+    src/qgcunittest/LinkReactorTest.cc \
+    src/qgcunittest/SharedMemoryLinkTest.cc \
+    src/qgcunittest/LinkManagerTest.cc \
+    src/qgcunittest/MAVLinkLoadGeneratorLinkTest.cc \
+    src/qgcunittest/MAVLinkSwarmSimulationLinkTest.cc \
+    src/qgcunittest/GroundTimeTest.cc \
+    src/qgcunittest/MAVLinkTimeSyncTest.cc \
+    src/qgcunittest/TelemetryKeyRegistryTest.cc \
+    src/qgcunittest/TelemetryStoreTest.cc \
+    src/qgcunittest/QGCUASSchedulerTest.cc \
+    src/qgcunittest/MAVLinkDecoderTest.cc
 
 }
@@ -0,0 +1,31 @@
+# Test producer for the shared memory link: attaches to the channel of a SharedMemoryLink
+# and sends MAVLink HIGHRES_IMU messages at a high rate, like a co-located simulator would.
+#
+# Usage: shmproducer [channel name] [IMU rate in Hz] [duration in seconds, 0 runs forever]
+
+QT       -= gui
+
+TEMPLATE = app
+TARGET = shmproducer
+CONFIG += console
+CONFIG -= app_bundle
+
+BASEDIR = .
+
+LANGUAGE = C++
+
+MAVLINKPATH = $$BASEDIR/libs/mavlink/include/mavlink/v1.0
+
+INCLUDEPATH += . \
+    src/comm \
+    $$MAVLINKPATH \
+    $$MAVLINKPATH/common
+
+# Input
+
+HEADERS += \
+    src/comm/SharedMemoryChannel.h
+
+SOURCES += \
+    src/comm/SharedMemoryChannel.cc \
+    src/apps/shmproducer/main.cc
@@ -24,23 +24,52 @@ This file is part of the QGROUNDCONTROL project
 #include "QGC.h"
 #include <qmath.h>
 #include <float.h>
+#include <QElapsedTimer>
+
+/**
+ * The ground clock runs on the monotonic clock of QElapsedTimer, which has
+ * microsecond resolution or better on the supported platforms. It is anchored
+ * to UTC once, when it is used for the first time.
+ */
+class GroundClock
+{
+public:
+    GroundClock()
+    {
+        // The wall clock only has millisecond resolution, start at the edge of
+        // a millisecond to keep the offset to UTC well below that
+        qint64 start = QDateTime::currentMSecsSinceEpoch();
+        qint64 now;
+        while ((now = QDateTime::currentMSecsSinceEpoch()) == start)
+        {
+        }
+        timer.start();
+        anchorUsecs = static_cast<quint64>(now) * 1000;
+    }
+
+    QElapsedTimer timer;
+    quint64 anchorUsecs;
+};
+
+Q_GLOBAL_STATIC(GroundClock, groundClock)
 
 namespace QGC
 {
 
 quint64 groundTimeUsecs()
 {
-    return groundTimeMilliseconds() * 1000;
+    GroundClock* clock = groundClock();
+    return clock->anchorUsecs + static_cast<quint64>(clock->timer.nsecsElapsed() / 1000);
 }
 
 quint64 groundTimeMilliseconds()
 {
-    return static_cast<quint64>(QDateTime::currentMSecsSinceEpoch());
+    return groundTimeUsecs() / 1000;
 }
 
 qreal groundTimeSeconds()
 {
-    return static_cast<qreal>(groundTimeMilliseconds()) / 1000.0f;
+    return static_cast<qreal>(groundTimeUsecs()) / 1000000.0;
 }
 
 float limitAngleToPMPIf(float angle)
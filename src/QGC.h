@@ -78,16 +78,14 @@ const QColor colorBackground("#050508");
 const QColor colorBlack(0, 0, 0);
 
 /**
- * @brief Get the current ground time in microseconds.
- * @note This does not have microsecond precision, it is limited to millisecond precision.
+ * @brief Get the current ground time in microseconds since the epoch.
+ * @note The ground time is monotonic and has microsecond precision. It is anchored
+ * to UTC when it is first used and does not follow later changes of the system clock.
  */
 quint64 groundTimeUsecs();
-/** @brief Get the current ground time in milliseconds */
+/** @brief Get the current ground time in milliseconds, see groundTimeUsecs() */
 quint64 groundTimeMilliseconds();
-/** 
- * @brief Get the current ground time in fractional seconds
- * @note Precision is limited to milliseconds.
- */
+/** @brief Get the current ground time in fractional seconds, see groundTimeUsecs() */
 qreal groundTimeSeconds();
 /** @brief Returns the angle limited to -pi - pi */
 float limitAngleToPMPIf(float angle);
@@ -45,6 +45,7 @@ This file is part of the QGROUNDCONTROL project
 #include "QGC.h"
 #include "QGCCore.h"
 #include "MainWindow.h"
+#include "QGCUASScheduler.h"
 #include "QGCWelcomeMainWindow.h"
 #include "GAudioOutput.h"
 #include "CmdLineOptParser.h"
@@ -244,7 +245,9 @@ QGCCore::~QGCCore()
         //mainWindow->close();
         //mainWindow->deleteLater();
         // Delete singletons
-        // First systems
+        // Stop the vehicle threads first, the links still deliver but no message reaches the vehicles anymore
+        QGCUASScheduler::instance()->shutdown();
+        // then systems
         delete UASManager::instance();
         // then links
         delete LinkManager::instance();
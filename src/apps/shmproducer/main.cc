@@ -0,0 +1,134 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Test producer for SharedMemoryLink, plays a vehicle sending high rate IMU data
+///
+///     Usage: shmproducer [channel name] [IMU rate in Hz] [duration in seconds, 0 runs forever]
+
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <mavlink.h>
+
+#include "SharedMemoryChannel.h"
+
+static const int _systemId = 1;
+static const int _componentId = MAV_COMP_ID_IMU;
+
+static bool _send(SharedMemoryChannel& channel, const mavlink_message_t& message)
+{
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    int length = mavlink_msg_to_send_buffer(buffer, &message);
+    return channel.write((const char*)buffer, length);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    QString name = args.count() > 1 ? args[1] : QString("vehicle");
+    int rate = args.count() > 2 ? args[2].toInt() : 1000;
+    int duration = args.count() > 3 ? args[3].toInt() : 10;
+    if (rate <= 0) {
+        fprintf(stderr, "Invalid rate %d\n", rate);
+        return 1;
+    }
+
+    // Wait for the ground station to create the channel
+    SharedMemoryChannel channel(name, SharedMemoryChannel::VehicleSide);
+    while (!channel.open()) {
+        fprintf(stderr, "Waiting for channel '%s': %s\n", qPrintable(name), qPrintable(channel.errorString()));
+        QThread::sleep(1);
+    }
+    printf("Attached to channel '%s', sending HIGHRES_IMU at %d Hz\n", qPrintable(name), rate);
+
+    quint32 sent = 0;
+    quint32 dropped = 0;
+    quint32 received = 0;
+    quint32 lastSent = 0;
+    mavlink_message_t message;
+    mavlink_status_t status;
+    char readBuffer[4096];
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 periodUsecs = 1000000 / rate;
+    qint64 nextUsecs = 0;
+    qint64 nextHeartbeat = 0;
+    qint64 nextReport = 1000000;
+
+    while (duration == 0 || clock.elapsed() < duration * 1000) {
+        qint64 nowUsecs = clock.nsecsElapsed() / 1000;
+
+        if (nowUsecs >= nextHeartbeat) {
+            mavlink_msg_heartbeat_pack(_systemId, _componentId, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_GENERIC, MAV_MODE_FLAG_HIL_ENABLED, 0, MAV_STATE_ACTIVE);
+            _send(channel, message);
+            nextHeartbeat += 1000000;
+        }
+
+        if (nowUsecs >= nextUsecs) {
+            mavlink_msg_highres_imu_pack(_systemId, _componentId, &message, nowUsecs,
+                                         0.0f, 0.0f, -9.81f,    // acc
+                                         0.0f, 0.0f, 0.0f,      // gyro
+                                         0.2f, 0.0f, 0.4f,      // mag
+                                         1013.25f, 0.0f, 0.0f, 20.0f, 0x1FFF);
+            if (_send(channel, message)) {
+                sent++;
+            } else {
+                dropped++;
+            }
+            nextUsecs += periodUsecs;
+        }
+
+        // Count what the ground station sends back
+        int length;
+        while ((length = channel.read(readBuffer, sizeof(readBuffer))) > 0) {
+            for (int i = 0; i < length; i++) {
+                if (mavlink_parse_char(MAVLINK_COMM_0, readBuffer[i], &message, &status)) {
+                    received++;
+                }
+            }
+        }
+
+        if (nowUsecs >= nextReport) {
+            printf("sent %u/s, dropped %u, received %u\n", sent - lastSent, dropped, received);
+            fflush(stdout);
+            lastSent = sent;
+            nextReport += 1000000;
+        }
+
+        qint64 sleepUsecs = qMin(nextUsecs, nextHeartbeat) - clock.nsecsElapsed() / 1000;
+        if (sleepUsecs > 0) {
+            QThread::usleep(sleepUsecs);
+        }
+    }
+
+    printf("Done: sent %u, dropped %u, received %u\n", sent, dropped, received);
+    return 0;
+}
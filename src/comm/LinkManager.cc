@@ -56,29 +56,76 @@ LinkManager* LinkManager::instance()
  **/
 LinkManager::LinkManager()
 {
-    links = QList<LinkInterface*>();
-    protocolLinks = QMap<ProtocolInterface*, LinkInterface*>();
+    registry.storeRelease(new Registry);
 }
 
 LinkManager::~LinkManager()
 {
     disconnectAll();
-    dataMutex.lock();
-    foreach (LinkInterface* link, links)
+    foreach (LinkInterface* link, getLinks())
     {
         if(link) link->deleteLater();
     }
+
+    dataMutex.lock();
+    delete registry.load();
     dataMutex.unlock();
 }
 
+/**
+ * The reader counts itself in the counter of the current epoch before it loads
+ * the snapshot. If a publish moved the epoch on in between, it retries, so the
+ * publish which replaces the loaded snapshot always waits for this reader.
+ */
+LinkManager::ReadGuard::ReadGuard(LinkManager* manager)
+{
+    forever
+    {
+        int current = manager->epoch.loadAcquire();
+        readers = &manager->readers[current & 1];
+        readers->ref();
+        if (manager->epoch.loadAcquire() == current) break;
+        readers->deref();
+    }
+    snapshot = manager->registry.loadAcquire();
+}
+
+LinkManager::ReadGuard::~ReadGuard()
+{
+    readers->deref();
+}
+
+/**
+ * After the swap new readers only see the new snapshot and, once the epoch is
+ * moved on, count themselves in the other counter. The readers left in the
+ * counter of the previous epoch only copy a list or a value out of the
+ * snapshot, so the wait for them to drain is short.
+ */
+void LinkManager::publish(Registry* newRegistry)
+{
+    const Registry* oldRegistry = registry.fetchAndStoreOrdered(newRegistry);
+    QAtomicInt& oldReaders = readers[epoch.fetchAndAddOrdered(1) & 1];
+    while (oldReaders.loadAcquire() != 0)
+    {
+        QThread::yieldCurrentThread();
+    }
+    delete oldRegistry;
+}
+
 void LinkManager::add(LinkInterface* link)
 {
+    if(!link) return;
+
     dataMutex.lock();
-    if (!links.contains(link))
+    if (!registry.load()->links.contains(link))
     {
-        if(!link) return;
         connect(link, SIGNAL(destroyed(QObject*)), this, SLOT(removeObj(QObject*)));
-        links.append(link);
+
+        Registry* newRegistry = new Registry(*registry.load());
+        newRegistry->links.append(link);
+        newRegistry->linksById.insert(link->getId(), link);
+        publish(newRegistry);
+
         dataMutex.unlock();
         emit newLink(link);
     } else {
@@ -93,54 +140,64 @@ void LinkManager::addProtocol(LinkInterface* link, ProtocolInterface* protocol)
     if (!link || !protocol) return;
 
     dataMutex.lock();
-    QList<LinkInterface*> linkList = protocolLinks.values(protocol);
+    const Registry* current = registry.load();
 
     // If protocol has not been added before (list length == 0)
     // OR if link has not been added to protocol, add
-    if (!linkList.contains(link))
+    if (!current->protocolLinks.value(protocol).contains(link))
     {
-        // Protocol is new, add
-        connect(link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)), protocol, SLOT(receiveBytes(LinkInterface*, QByteArray)));
+        // Protocol is new, add. The bytes are handed over on the thread which read them, the
+        // protocol takes their receive time right away and queues them for its parsers
+        connect(link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)), protocol, SLOT(receiveBytes(LinkInterface*, QByteArray)), Qt::DirectConnection);
         // Add status
         connect(link, SIGNAL(connected(bool)), protocol, SLOT(linkStatusChanged(bool)));
+
         // Store the connection information in the protocol links map
-        protocolLinks.insertMulti(protocol, link);
+        Registry* newRegistry = new Registry(*current);
+        if (!newRegistry->protocols.contains(protocol))
+        {
+            newRegistry->protocols.append(protocol);
+        }
+        newRegistry->protocolLinks[protocol].append(link);
+        newRegistry->linkProtocols.insert(link, protocol);
+        publish(newRegistry);
+
         dataMutex.unlock();
         // Make sure the protocol clears its metadata for this link.
         protocol->resetMetadataForLink(link);
     } else {
         dataMutex.unlock();
     }
-    //qDebug() << __FILE__ << __LINE__ << "ADDED LINK TO PROTOCOL" << link->getName() << protocol->getName() << "NEW SIZE OF LINK LIST:" << protocolLinks.size();
+    //qDebug() << __FILE__ << __LINE__ << "ADDED LINK TO PROTOCOL" << link->getName() << protocol->getName();
 }
 
 QList<LinkInterface*> LinkManager::getLinksForProtocol(ProtocolInterface* protocol)
 {
-    dataMutex.lock();
-    QList<LinkInterface*> links = protocolLinks.values(protocol);
-    dataMutex.unlock();
-    return links;
+    ReadGuard snapshot(this);
+    return snapshot->protocolLinks.value(protocol);
 }
 
 ProtocolInterface* LinkManager::getProtocolForLink(LinkInterface* link)
 {
-    dataMutex.lock();
-    ProtocolInterface* interface = protocolLinks.key(link);
-    dataMutex.unlock();
-    return interface;
+    ReadGuard snapshot(this);
+    return snapshot->linkProtocols.value(link, NULL);
+}
+
+const QList<ProtocolInterface*> LinkManager::getProtocols()
+{
+    ReadGuard snapshot(this);
+    return snapshot->protocols;
 }
 
 bool LinkManager::connectAll()
 {
     bool allConnected = true;
 
-    dataMutex.lock();
-    foreach (LinkInterface* link, links)
+    foreach (LinkInterface* link, getLinks())
     {
         if(!link) {}
         else if(!link->connect()) allConnected = false;
     }
-    dataMutex.unlock();
 
     return allConnected;
 }
@@ -149,14 +206,12 @@ bool LinkManager::disconnectAll()
 {
     bool allDisconnected = true;
 
-    dataMutex.lock();
-    foreach (LinkInterface* link, links)
+    foreach (LinkInterface* link, getLinks())
     {
         //static int i=0;
         if(!link) {}
         else if(!link->disconnect()) allDisconnected = false;
     }
-    dataMutex.unlock();
 
     return allDisconnected;
 }
@@ -187,19 +242,33 @@ bool LinkManager::removeLink(LinkInterface* link)
     if(link)
     {
         dataMutex.lock();
-        for (int i=0; i < QList<LinkInterface*>(links).size(); i++)
+        Registry* newRegistry = new Registry(*registry.load());
+        newRegistry->links.removeAll(link); //remove from link list
+        QHash<int, LinkInterface*>::iterator i = newRegistry->linksById.begin();
+        while (i != newRegistry->linksById.end())
         {
-            if(link==links.at(i))
+            if (i.value() == link)
+            {
+                i = newRegistry->linksById.erase(i);
+            }
+            else
             {
-                links.removeAt(i); //remove from link list
+                ++i;
             }
         }
         // Remove link from protocol map
-        QList<ProtocolInterface* > protocols = protocolLinks.keys(link);
-        foreach (ProtocolInterface* proto, protocols)
+        ProtocolInterface* protocol = newRegistry->linkProtocols.take(link);
+        if (protocol)
         {
-            protocolLinks.remove(proto, link);
+            QList<LinkInterface*>& protocolLinks = newRegistry->protocolLinks[protocol];
+            protocolLinks.removeAll(link);
+            if (protocolLinks.isEmpty())
+            {
+                newRegistry->protocolLinks.remove(protocol);
+                newRegistry->protocols.removeAll(protocol);
+            }
         }
+        publish(newRegistry);
         dataMutex.unlock();
 
         // Emit removal of link
@@ -211,24 +280,13 @@ bool LinkManager::removeLink(LinkInterface* link)
 }
 
 /**
- * The access time is linear in the number of links.
- *
  * @param id link identifier to search for
  * @return A pointer to the link or NULL if not found
  */
 LinkInterface* LinkManager::getLinkForId(int id)
 {
-    dataMutex.lock();
-    LinkInterface* linkret = NULL;
-    foreach (LinkInterface* link, links)
-    {
-        if (link->getId() == id)
-        {
-            linkret = link;
-        }
-    }
-    dataMutex.unlock();
-    return linkret;
+    ReadGuard snapshot(this);
+    return snapshot->linksById.value(id, NULL);
 }
 
 /**
@@ -236,25 +294,21 @@ LinkInterface* LinkManager::getLinkForId(int id)
  */
 const QList<LinkInterface*> LinkManager::getLinks()
 {
-    dataMutex.lock();
-    QList<LinkInterface*> ret(links);
-    dataMutex.unlock();
-    return ret;
+    ReadGuard snapshot(this);
+    return snapshot->links;
 }
 
 const QList<SerialLink*> LinkManager::getSerialLinks()
 {
-    dataMutex.lock();
     QList<SerialLink*> s;
 
-    foreach (LinkInterface* i, links)
+    foreach (LinkInterface* i, getLinks())
     {
         SerialLink* link = qobject_cast<SerialLink*>(i);
 
         if (link)
             s.append(link);
     }
-    dataMutex.unlock();
 
     return s;
 }
@@ -34,8 +34,10 @@ This file is part of the PIXHAWK project
 
 #include <QThread>
 #include <QList>
-#include <QMultiMap>
+#include <QHash>
 #include <QMutex>
+#include <QAtomicPointer>
+#include <QAtomicInt>
 #include <LinkInterface.h>
 #include <SerialLink.h>
 #include <ProtocolInterface.h>
@@ -45,6 +47,11 @@ This file is part of the PIXHAWK project
  * links and takes care of connecting them as well assigning the correct
  * protocol instance to transport the link data into the application.
  *
+ * The links are published as an immutable snapshot which is replaced as a whole
+ * when a link or protocol is added or removed. The getters read the current
+ * snapshot without locking, so the protocol thread can look up the links on
+ * every message it sends.
+ *
  **/
 class LinkManager : public QObject
 {
@@ -70,9 +77,7 @@ public:
     const QList<SerialLink*> getSerialLinks();
 
     /** @brief Get a list of all protocols */
-    const QList<ProtocolInterface*> getProtocols() {
-        return protocolLinks.uniqueKeys();
-    }
+    const QList<ProtocolInterface*> getProtocols();
 
 public slots:
 
@@ -90,9 +95,35 @@ public slots:
 
 protected:
     LinkManager();
-    QList<LinkInterface*> links;
-    QMultiMap<ProtocolInterface*,LinkInterface*> protocolLinks;
-    QMutex dataMutex;
+
+    /** @brief Snapshot of the links, never changed once published */
+    struct Registry {
+        QList<LinkInterface*> links;
+        QList<ProtocolInterface*> protocols;
+        QHash<ProtocolInterface*, QList<LinkInterface*> > protocolLinks;
+        QHash<LinkInterface*, ProtocolInterface*> linkProtocols;
+        QHash<int, LinkInterface*> linksById;
+    };
+
+    /** @brief Holds the current snapshot for the lifetime of the guard, the getters read through it */
+    class ReadGuard {
+    public:
+        ReadGuard(LinkManager* manager);
+        ~ReadGuard();
+        const Registry* operator->() const { return snapshot; }
+    private:
+        QAtomicInt* readers;
+        const Registry* snapshot;
+    };
+    friend class ReadGuard;
+
+    /** @brief Publishes a new snapshot and deletes the old one once no reader holds it, dataMutex has to be held */
+    void publish(Registry* registry);
+
+    QAtomicPointer<const Registry> registry; ///< Current snapshot
+    QAtomicInt epoch; ///< Incremented on every publish, selects the reader counter
+    QAtomicInt readers[2]; ///< Active readers by epoch parity
+    QMutex dataMutex; ///< Serializes the writers, readers don't lock
 
 private:
     static LinkManager* _instance;
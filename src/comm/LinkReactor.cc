@@ -0,0 +1,198 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Shared I/O threads for the sockets of network links
+
+#include <QApplication>
+#include <QAbstractEventDispatcher>
+#include <QSettings>
+#include <QDebug>
+
+#include "LinkReactor.h"
+
+LinkReactorThread::LinkReactorThread(void)
+{
+    // Slots of the thread object run in the thread itself
+    moveToThread(this);
+}
+
+void LinkReactorThread::run(void)
+{
+    QAbstractEventDispatcher* dispatcher = QAbstractEventDispatcher::instance();
+    Q_ASSERT(dispatcher);
+    connect(dispatcher, SIGNAL(awake()), this, SLOT(_awake()), Qt::DirectConnection);
+
+    exec();
+}
+
+void LinkReactorThread::_awake(void)
+{
+    _wakeups.fetchAndAddRelaxed(1);
+}
+
+void LinkReactorThread::deleteObject(QObject* object)
+{
+    if (QThread::currentThread() == this) {
+        delete object;
+    } else {
+        QMetaObject::invokeMethod(this, "_deleteObject", Qt::BlockingQueuedConnection, Q_ARG(QObject*, object));
+    }
+}
+
+void LinkReactorThread::_deleteObject(QObject* object)
+{
+    delete object;
+}
+
+LinkReactor* LinkReactor::instance(void)
+{
+    static LinkReactor* _instance = NULL;
+    if (_instance == NULL) {
+        _instance = new LinkReactor();
+
+        // Set the application as parent to ensure that this object will be destroyed when the main application exits
+        _instance->setParent(qApp);
+    }
+    return _instance;
+}
+
+LinkReactor::LinkReactor(void) :
+    _enabled(false),
+    _maxThreadCount(defaultMaxThreadCount)
+{
+    _loadSettings();
+}
+
+LinkReactor::~LinkReactor()
+{
+    if (!_objectThreads.isEmpty()) {
+        qWarning() << "LinkReactor: still" << _objectThreads.count() << "objects attached";
+    }
+
+    foreach (LinkReactorThread* thread, _threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+}
+
+void LinkReactor::_loadSettings(void)
+{
+    QSettings settings;
+    settings.beginGroup("LINK_REACTOR");
+    _enabled = settings.value("ENABLED", _enabled).toBool();
+    _maxThreadCount = qMax(1, settings.value("MAX_THREAD_COUNT", _maxThreadCount).toInt());
+    settings.endGroup();
+}
+
+void LinkReactor::_storeSettings(void)
+{
+    QSettings settings;
+    settings.beginGroup("LINK_REACTOR");
+    settings.setValue("ENABLED", _enabled);
+    settings.setValue("MAX_THREAD_COUNT", _maxThreadCount);
+    settings.endGroup();
+}
+
+void LinkReactor::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+    _storeSettings();
+}
+
+void LinkReactor::setMaxThreadCount(int count)
+{
+    QMutexLocker locker(&_mutex);
+    // Threads already started keep running until the application exits, new objects only go to
+    // the first count threads.
+    _maxThreadCount = qMax(1, count);
+    _storeSettings();
+}
+
+void LinkReactor::attach(QObject* object)
+{
+    Q_ASSERT(object);
+    Q_ASSERT(object->thread() == QThread::currentThread());
+
+    QMutexLocker locker(&_mutex);
+    Q_ASSERT(!_objectThreads.contains(object));
+
+    // Pick the least loaded thread, start another one while below the maximum and all threads are busy
+    int index = -1;
+    int usable = qMin(_threads.count(), _maxThreadCount);
+    for (int i = 0; i < usable; i++) {
+        if (index == -1 || _loads[i] < _loads[index]) {
+            index = i;
+        }
+    }
+    if (_threads.count() < _maxThreadCount && (index == -1 || _loads[index] > 0)) {
+        LinkReactorThread* thread = new LinkReactorThread();
+        thread->start(QThread::HighPriority);
+        _threads.append(thread);
+        _loads.append(0);
+        index = _threads.count() - 1;
+    }
+
+    _loads[index]++;
+    _objectThreads.insert(object, index);
+    object->moveToThread(_threads[index]);
+}
+
+void LinkReactor::detach(QObject* object)
+{
+    Q_ASSERT(object);
+
+    LinkReactorThread* thread;
+    {
+        QMutexLocker locker(&_mutex);
+        Q_ASSERT(_objectThreads.contains(object));
+        int index = _objectThreads.take(object);
+        _loads[index]--;
+        thread = _threads[index];
+    }
+
+    thread->deleteObject(object);
+}
+
+int LinkReactor::threadCount(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _threads.count();
+}
+
+int LinkReactor::attachedCount(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _objectThreads.count();
+}
+
+quint32 LinkReactor::wakeups(void) const
+{
+    QMutexLocker locker(&_mutex);
+    quint32 wakeups = 0;
+    foreach (LinkReactorThread* thread, _threads) {
+        wakeups += thread->wakeups();
+    }
+    return wakeups;
+}
@@ -0,0 +1,127 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Shared I/O threads for the sockets of network links
+
+#ifndef LINKREACTOR_H
+#define LINKREACTOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+
+/// @brief One I/O thread of the LinkReactor
+class LinkReactorThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    LinkReactorThread(void);
+
+    /// @brief Number of times the thread woke up to handle events
+    quint32 wakeups(void) const { return _wakeups.load(); }
+
+    /// @brief Deletes the object in this thread, returns once it is deleted
+    void deleteObject(QObject* object);
+
+protected:
+    virtual void run(void);
+
+private slots:
+    void _awake(void);
+    void _deleteObject(QObject* object);
+
+private:
+    QAtomicInt  _wakeups;
+};
+
+/// @brief Runs the sockets of many network links in a small pool of threads.
+///
+/// Each UDPLink and TCPLink runs its own thread by default, with a lot of SITL vehicles connected
+/// that is a lot of mostly idle threads. If the reactor is enabled, the links move their sockets to
+/// one of the reactor threads instead and read them from there. The event loop of a reactor thread
+/// waits on all its sockets at once and bytes received are handed straight to the protocol parsers.
+///
+/// The HIL simulator links, QGCXPlaneLink, QGCFlightGearLink and QGCJSBSimLink, keep their own thread.
+/// There is at most one of them per vehicle, not one per SITL vehicle, and they wait in exec() without
+/// polling. The link object itself needs an event loop, not just its socket: the HIL controls of the
+/// vehicle arrive as queued slot calls on the link, and FlightGear and JSBSim run as a QProcess owned
+/// by the link thread.
+///
+/// Enabling or disabling the reactor only affects links connected afterwards.
+class LinkReactor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static LinkReactor* instance(void);
+    ~LinkReactor();
+
+    bool isEnabled(void) const { return _enabled; }
+    void setEnabled(bool enabled);
+
+    /// @brief Maximum number of reactor threads, the objects are spread evenly across them
+    int maxThreadCount(void) const { return _maxThreadCount; }
+    void setMaxThreadCount(int count);
+
+    /// @brief Moves the object, together with its children, to the reactor thread with the least objects.
+    ///
+    /// The object must live in the calling thread. Signals of the object delivered to slots of a link
+    /// have to be connected with Qt::DirectConnection, since the link thread is not running.
+    void attach(QObject* object);
+
+    /// @brief Deletes an attached object in its reactor thread, returns once it is deleted.
+    ///
+    /// No slot connected to the object will be called after this returns.
+    void detach(QObject* object);
+
+    /// @brief Number of reactor threads running
+    int threadCount(void) const;
+
+    /// @brief Number of objects attached
+    int attachedCount(void) const;
+
+    /// @brief Number of times the reactor threads woke up to handle events, summed over all threads
+    quint32 wakeups(void) const;
+
+    static const int defaultMaxThreadCount = 1;
+
+private:
+    LinkReactor(void);
+
+    void _loadSettings(void);
+    void _storeSettings(void);
+
+    bool                        _enabled;
+    int                         _maxThreadCount;
+    QList<LinkReactorThread*>   _threads;
+    QList<int>                  _loads;         ///< Objects attached to each thread
+    QHash<QObject*, int>        _objectThreads; ///< Index of the thread each object is attached to
+    mutable QMutex              _mutex;
+};
+
+#endif
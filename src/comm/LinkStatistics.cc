@@ -0,0 +1,159 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Lock-free counters, data rates and histograms of a link
+
+#include "LinkStatistics.h"
+
+LinkHistogram::LinkHistogram(void)
+{
+    reset();
+}
+
+void LinkHistogram::add(quint32 value)
+{
+    int index = 0;
+    while (value && index < bucketCount - 1) {
+        value >>= 1;
+        index++;
+    }
+    _buckets[index].fetchAndAddRelaxed(1);
+}
+
+void LinkHistogram::reset(void)
+{
+    for (int i=0; i<bucketCount; i++) {
+        _buckets[i].store(0);
+    }
+}
+
+quint32 LinkHistogram::bucket(int index) const
+{
+    Q_ASSERT(index >= 0 && index < bucketCount);
+    return _buckets[index].load();
+}
+
+quint32 LinkHistogram::bucketMinimum(int index)
+{
+    Q_ASSERT(index >= 0 && index < bucketCount);
+    return index == 0 ? 0 : 1u << (index - 1);
+}
+
+LinkDataRate::LinkDataRate(void)
+{
+    for (int i=0; i<slotCount; i++) {
+        _slotIndex[i].store(-1);
+        _slotBytes[i].store(0);
+    }
+    _clock.start();
+}
+
+void LinkDataRate::add(int bytes)
+{
+    int slotIndex = (int)(_clock.elapsed() / slotMsecs);
+    int slot = slotIndex % slotCount;
+
+    int previousIndex = _slotIndex[slot].load();
+    if (previousIndex != slotIndex && _slotIndex[slot].testAndSetOrdered(previousIndex, slotIndex)) {
+        // First bytes of a new time slot, the bytes of the old one are gone
+        _slotBytes[slot].fetchAndStoreOrdered(bytes);
+    } else {
+        _slotBytes[slot].fetchAndAddOrdered(bytes);
+    }
+}
+
+qint64 LinkDataRate::rate(void) const
+{
+    qint64 now = _clock.elapsed();
+    int currentIndex = (int)(now / slotMsecs);
+
+    // The current slot is only partially filled
+    qint64 totalMsecs = (slotCount - 1) * slotMsecs + now % slotMsecs;
+    if (totalMsecs == 0) {
+        return 0;
+    }
+
+    qint64 totalBytes = 0;
+    for (int slot=0; slot<slotCount; slot++) {
+        int slotIndex = _slotIndex[slot].load();
+        if (slotIndex > currentIndex - slotCount && slotIndex <= currentIndex) {
+            totalBytes += _slotBytes[slot].load();
+        }
+    }
+
+    return totalBytes * 8 * 1000 / totalMsecs;
+}
+
+LinkStatistics::LinkStatistics(void)
+{
+    reset();
+}
+
+void LinkStatistics::logBytesReceived(int bytes)
+{
+    _bytesReceived.fetchAndAddRelaxed(bytes);
+    _inDataRate.add(bytes);
+}
+
+void LinkStatistics::logBytesSent(int bytes)
+{
+    _bytesSent.fetchAndAddRelaxed(bytes);
+    _outDataRate.add(bytes);
+}
+
+void LinkStatistics::reset(void)
+{
+    _bytesReceived.store(0);
+    _bytesSent.store(0);
+    _framesReceived.store(0);
+    _framesSent.store(0);
+    _crcErrors.store(0);
+    _droppedFrames.store(0);
+    _sequenceGaps.store(0);
+    _frameSizes.reset();
+    _latencies.reset();
+    _receiveLatencies.reset();
+}
+
+LinkStatistics::Snapshot LinkStatistics::snapshot(void) const
+{
+    Snapshot snapshot;
+
+    snapshot.bytesReceived = bytesReceived();
+    snapshot.bytesSent = bytesSent();
+    snapshot.framesReceived = framesReceived();
+    snapshot.framesSent = framesSent();
+    snapshot.crcErrors = crcErrors();
+    snapshot.droppedFrames = droppedFrames();
+    snapshot.sequenceGaps = sequenceGaps();
+    snapshot.inDataRate = inDataRate();
+    snapshot.outDataRate = outDataRate();
+    for (int i=0; i<LinkHistogram::bucketCount; i++) {
+        snapshot.frameSizes[i] = _frameSizes.bucket(i);
+        snapshot.latencies[i] = _latencies.bucket(i);
+        snapshot.receiveLatencies[i] = _receiveLatencies.bucket(i);
+    }
+
+    return snapshot;
+}
@@ -0,0 +1,151 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Lock-free counters, data rates and histograms of a link
+
+#ifndef LINKSTATISTICS_H
+#define LINKSTATISTICS_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+/// @brief Histogram with power of two buckets which can be updated from any thread without locking.
+///
+/// Bucket 0 counts the value 0, bucket n the values from 2^(n-1) to 2^n - 1. The last bucket also counts
+/// all larger values.
+class LinkHistogram
+{
+public:
+    LinkHistogram(void);
+
+    static const int bucketCount = 16;
+
+    void add(quint32 value);
+    void reset(void);
+
+    /// @brief Number of values counted in a bucket
+    quint32 bucket(int index) const;
+
+    /// @brief Smallest value counted in a bucket
+    static quint32 bucketMinimum(int index);
+
+private:
+    QAtomicInt _buckets[bucketCount];
+};
+
+/// @brief Data rate over the recent past which can be updated from any thread without locking.
+///
+/// The bytes are added up in a ring of time slots. A slot is reused once its time has passed, the rate is
+/// calculated from the slots of the last windowMsecs. Two threads adding to a slot which is just being
+/// reused may lose a few bytes, which is fine for a statistic.
+class LinkDataRate
+{
+public:
+    LinkDataRate(void);
+
+    static const int slotMsecs = 50;
+    static const int slotCount = 10;
+    static const int windowMsecs = slotMsecs * slotCount;
+
+    void add(int bytes);
+
+    /// @brief Returns the data rate in bits per second
+    qint64 rate(void) const;
+
+private:
+    QElapsedTimer   _clock;
+    QAtomicInt      _slotIndex[slotCount];  ///< Number of the time slot the bytes belong to, -1 if unused
+    QAtomicInt      _slotBytes[slotCount];
+};
+
+/// @brief Statistics of one link.
+///
+/// The link updates the byte counters, data rates and the receive latency, the protocol the frame counters and
+/// the transmit queue the transmit latency. Everything is updated and read without locking, so the statistics can be polled from the user
+/// interface at any rate without slowing down the I/O path. The counters wrap around at 2^32.
+class LinkStatistics
+{
+public:
+    LinkStatistics(void);
+
+    /// @brief All values at one point in time
+    struct Snapshot {
+        quint32 bytesReceived;
+        quint32 bytesSent;
+        quint32 framesReceived;
+        quint32 framesSent;
+        quint32 crcErrors;          ///< Frames which failed the checksum check
+        quint32 droppedFrames;      ///< Frames which were not sent because the transmit queue was full or the link disconnected
+        quint32 sequenceGaps;       ///< Frames lost on the way, according to the sequence numbers
+        qint64  inDataRate;         ///< Bits per second
+        qint64  outDataRate;        ///< Bits per second
+        quint32 frameSizes[LinkHistogram::bucketCount];     ///< Histogram of the received frame sizes in bytes
+        quint32 latencies[LinkHistogram::bucketCount];      ///< Histogram of the time sent frames spent in the transmit queue in microseconds
+        quint32 receiveLatencies[LinkHistogram::bucketCount];   ///< Histogram of the time from the arrival of bytes to their delivery by the link in microseconds
+    };
+
+    void logBytesReceived(int bytes);
+    void logBytesSent(int bytes);
+    void logFrameReceived(int length) { _framesReceived.fetchAndAddRelaxed(1); _frameSizes.add(length); }
+    void logFrameSent(qint64 queueUsecs) { _framesSent.fetchAndAddRelaxed(1); _latencies.add((quint32)qMin(queueUsecs, (qint64)0xFFFFFFFF)); }
+    void logCrcErrors(int count) { _crcErrors.fetchAndAddRelaxed(count); }
+    void logDroppedFrame(void) { _droppedFrames.fetchAndAddRelaxed(1); }
+    void logSequenceGap(int lostFrames) { _sequenceGaps.fetchAndAddRelaxed(lostFrames); }
+    void logReceiveLatency(qint64 usecs) { _receiveLatencies.add((quint32)qMin(usecs, (qint64)0xFFFFFFFF)); }
+
+    /// @brief Resets the counters and histograms, the data rates are not affected
+    void reset(void);
+
+    quint32 bytesReceived(void) const   { return _bytesReceived.load(); }
+    quint32 bytesSent(void) const       { return _bytesSent.load(); }
+    quint32 framesReceived(void) const  { return _framesReceived.load(); }
+    quint32 framesSent(void) const      { return _framesSent.load(); }
+    quint32 crcErrors(void) const       { return _crcErrors.load(); }
+    quint32 droppedFrames(void) const   { return _droppedFrames.load(); }
+    quint32 sequenceGaps(void) const    { return _sequenceGaps.load(); }
+    qint64 inDataRate(void) const       { return _inDataRate.rate(); }
+    qint64 outDataRate(void) const      { return _outDataRate.rate(); }
+    const LinkHistogram& frameSizes(void) const { return _frameSizes; }
+    const LinkHistogram& latencies(void) const  { return _latencies; }
+    const LinkHistogram& receiveLatencies(void) const { return _receiveLatencies; }
+
+    /// @brief Returns all values, each value is read atomically but not all at once
+    Snapshot snapshot(void) const;
+
+private:
+    QAtomicInt      _bytesReceived;
+    QAtomicInt      _bytesSent;
+    QAtomicInt      _framesReceived;
+    QAtomicInt      _framesSent;
+    QAtomicInt      _crcErrors;
+    QAtomicInt      _droppedFrames;
+    QAtomicInt      _sequenceGaps;
+    LinkDataRate    _inDataRate;
+    LinkDataRate    _outDataRate;
+    LinkHistogram   _frameSizes;
+    LinkHistogram   _latencies;
+    LinkHistogram   _receiveLatencies;
+};
+
+#endif
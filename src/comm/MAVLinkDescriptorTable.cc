@@ -0,0 +1,207 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Precomputed descriptions of the MAVLink messages for decoding them without string work
+
+#include <string.h>
+#include <QDebug>
+
+#include "MAVLinkDescriptorTable.h"
+
+Q_GLOBAL_STATIC(MAVLinkDescriptorTable, mavlinkDescriptorTable)
+
+const MAVLinkDescriptorTable* MAVLinkDescriptorTable::instance(void)
+{
+    return mavlinkDescriptorTable();
+}
+
+/// Reads a T from the unaligned payload and converts it to V, the type the decoder handed to QVariant
+template <typename T, typename V>
+static QVariant _extract(const uint8_t* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return QVariant((V)value);
+}
+
+/// Fills in the type dependent parts of a value description
+///     @return false for types the decoder doesn't know
+static bool _describeType(uint8_t type, MAVLinkDescriptorTable::Value* value, int* size, const char** typeName)
+{
+    switch (type) {
+        case MAVLINK_TYPE_CHAR:
+            value->extract = _extract<char, int>;
+            *size = sizeof(char);
+            *typeName = "char";
+            break;
+        case MAVLINK_TYPE_UINT8_T:
+            value->extract = _extract<uint8_t, int>;
+            *size = sizeof(uint8_t);
+            *typeName = "uint8_t";
+            break;
+        case MAVLINK_TYPE_INT8_T:
+            value->extract = _extract<int8_t, int>;
+            *size = sizeof(int8_t);
+            *typeName = "int8_t";
+            break;
+        case MAVLINK_TYPE_UINT16_T:
+            value->extract = _extract<uint16_t, int>;
+            *size = sizeof(uint16_t);
+            *typeName = "uint16_t";
+            break;
+        case MAVLINK_TYPE_INT16_T:
+            value->extract = _extract<int16_t, int>;
+            *size = sizeof(int16_t);
+            *typeName = "int16_t";
+            break;
+        case MAVLINK_TYPE_UINT32_T:
+            value->extract = _extract<uint32_t, uint>;
+            *size = sizeof(uint32_t);
+            *typeName = "uint32_t";
+            break;
+        case MAVLINK_TYPE_INT32_T:
+            value->extract = _extract<int32_t, int>;
+            *size = sizeof(int32_t);
+            *typeName = "int32_t";
+            break;
+        case MAVLINK_TYPE_UINT64_T:
+            value->extract = _extract<uint64_t, quint64>;
+            *size = sizeof(uint64_t);
+            *typeName = "uint64_t";
+            break;
+        case MAVLINK_TYPE_INT64_T:
+            value->extract = _extract<int64_t, qint64>;
+            *size = sizeof(int64_t);
+            *typeName = "int64_t";
+            break;
+        case MAVLINK_TYPE_FLOAT:
+            value->extract = _extract<float, float>;
+            *size = sizeof(float);
+            *typeName = "float";
+            break;
+        case MAVLINK_TYPE_DOUBLE:
+            value->extract = _extract<double, double>;
+            *size = sizeof(double);
+            *typeName = "double";
+            break;
+        default:
+            return false;
+    }
+
+    value->integer = type != MAVLINK_TYPE_FLOAT && type != MAVLINK_TYPE_DOUBLE;
+    return true;
+}
+
+MAVLinkDescriptorTable::MAVLinkDescriptorTable(void)
+{
+    // Static, the infos of all messages don't fit on the stack of every platform
+    static const mavlink_message_info_t messageInfo[256] = MAVLINK_MESSAGE_INFO;
+
+    for (int msgid = 0; msgid < 256; msgid++) {
+        const mavlink_message_info_t& info = messageInfo[msgid];
+        Message& message = _messages[msgid];
+        if (info.num_fields == 0) {
+            continue;
+        }
+        message.name = info.name;
+
+        for (unsigned int fieldid = 0; fieldid < info.num_fields; fieldid++) {
+            const mavlink_field_info_t& field = info.fields[fieldid];
+
+            if (field.type == MAVLINK_TYPE_CHAR && field.array_length > 0) {
+                Text text;
+                text.fieldName = field.name;
+                text.offset = field.wire_offset;
+                text.length = field.array_length;
+                message.texts.append(text);
+                continue;
+            }
+
+            Value value;
+            int size;
+            const char* typeName;
+            if (!_describeType(field.type, &value, &size, &typeName)) {
+                qWarning() << "MAVLinkDescriptorTable: unknown type" << field.type << "of" << info.name << field.name;
+                continue;
+            }
+            value.fieldName = field.name;
+
+            if (field.type == MAVLINK_TYPE_CHAR) {
+                // A single char has always been shown as an array of no chars
+                value.name = QString("%1.%2").arg(info.name).arg(field.name);
+                value.element = -1;
+                value.unit = "char[0]";
+                value.offset = field.wire_offset;
+                message.values.append(value);
+            } else if (field.array_length > 0) {
+                value.unit = QString("%1[%2]").arg(typeName).arg(field.array_length);
+                for (unsigned int j = 0; j < field.array_length; j++) {
+                    value.name = QString("%1.%2.%3").arg(info.name).arg(field.name).arg(j);
+                    value.element = j;
+                    value.offset = field.wire_offset + j * size;
+                    message.values.append(value);
+                }
+            } else {
+                value.name = QString("%1.%2").arg(info.name).arg(field.name);
+                value.element = -1;
+                value.unit = typeName;
+                value.offset = field.wire_offset;
+                message.values.append(value);
+            }
+        }
+
+        // A timestamp is only looked for in the first field
+        const mavlink_field_info_t& first = info.fields[0];
+        if (first.type == MAVLINK_TYPE_UINT32_T && strcmp(first.name, "time_boot_ms") == 0) {
+            message.timeUnit = TIME_MSECS;
+            message.timeOffset = first.wire_offset;
+        } else if (first.type == MAVLINK_TYPE_UINT64_T && strstr(first.name, "usec") != NULL) {
+            message.timeUnit = TIME_USECS;
+            message.timeOffset = first.wire_offset;
+        }
+    }
+}
+
+quint64 MAVLinkDescriptorTable::onboardUsecs(const mavlink_message_t& message) const
+{
+    const Message& descriptor = _messages[message.msgid];
+    const char* payload = _MAV_PAYLOAD(&message);
+
+    switch (descriptor.timeUnit) {
+        case TIME_MSECS:
+        {
+            quint32 msecs;
+            memcpy(&msecs, payload + descriptor.timeOffset, sizeof(msecs));
+            return (quint64)msecs * 1000;
+        }
+        case TIME_USECS:
+        {
+            quint64 usecs;
+            memcpy(&usecs, payload + descriptor.timeOffset, sizeof(usecs));
+            return usecs;
+        }
+        default:
+            return 0;
+    }
+}
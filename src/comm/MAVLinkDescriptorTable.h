@@ -0,0 +1,95 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Precomputed descriptions of the MAVLink messages for decoding them without string work
+
+#ifndef MAVLINKDESCRIPTORTABLE_H
+#define MAVLINKDESCRIPTORTABLE_H
+
+#include <QString>
+#include <QVector>
+#include <QVariant>
+
+#include "QGCMAVLink.h"
+
+/// @brief Describes every field of every MAVLink message, built once from MAVLINK_MESSAGE_INFO.
+///
+/// Decoding a message used to look up its fields by name, compare the name of the first field to find
+/// the timestamp and format the name and type of every field on every packet. The table does all of
+/// that once: it knows where the time field of each message is, which extractor reads each value with
+/// its QVariant type, and holds the names and type names of all values ready to be shared.
+class MAVLinkDescriptorTable
+{
+public:
+    /// @brief Reads one value from the payload with the QVariant type it has always been emitted with
+    typedef QVariant (*Extractor)(const uint8_t* data);
+
+    /// @brief A scalar field, or one element of an array field
+    struct Value {
+        QString     name;       ///< Message and field name, array elements with their index: "ATTITUDE.roll", "HIL_CONTROLS.q.2"
+        QString     fieldName;  ///< Field name alone
+        int         element;    ///< Index in the array, -1 for scalar fields
+        QString     unit;       ///< C type of the field: "float", "uint16_t[8]"
+        int         offset;     ///< Of the value in the payload
+        bool        integer;
+        Extractor   extract;
+    };
+
+    /// @brief A char array field, decoded as text
+    struct Text {
+        QString     fieldName;
+        int         offset;
+        int         length;
+    };
+
+    enum TimeUnit {
+        TIME_NONE,
+        TIME_MSECS,             ///< The first field is time_boot_ms
+        TIME_USECS              ///< The first field is a 64 bit microsecond timestamp
+    };
+
+    struct Message {
+        Message(void) : timeUnit(TIME_NONE), timeOffset(0) {}
+
+        QString         name;       ///< Empty for unknown messages
+        QVector<Value>  values;
+        QVector<Text>   texts;
+        TimeUnit        timeUnit;
+        int             timeOffset;
+    };
+
+    MAVLinkDescriptorTable(void);
+
+    static const MAVLinkDescriptorTable* instance(void);
+
+    const Message& message(uint8_t msgid) const { return _messages[msgid]; }
+
+    /// @brief Returns the onboard time a message was sent at in microseconds, 0 if it has no time field
+    quint64 onboardUsecs(const mavlink_message_t& message) const;
+
+private:
+    Message _messages[256];
+};
+
+#endif
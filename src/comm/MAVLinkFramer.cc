@@ -0,0 +1,223 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Chunk oriented MAVLink frame parser
+
+#include <string.h>
+
+#include "MAVLinkFramer.h"
+
+#if MAVLINK_CRC_EXTRA
+static const uint8_t _crcExtra[256] = MAVLINK_MESSAGE_CRCS;
+#endif
+
+MAVLinkFramer::MAVLinkFramer(void) :
+    _input(NULL),
+    _inputLength(0),
+    _inputPos(0),
+    _partialLength(0),
+    _messageCount(0),
+    _parseErrorCount(0),
+    _skippedByteCount(0)
+{
+
+}
+
+void MAVLinkFramer::reset(void)
+{
+    _input = NULL;
+    _inputLength = 0;
+    _inputPos = 0;
+    _partialLength = 0;
+    _messageCount = 0;
+    _parseErrorCount = 0;
+    _skippedByteCount = 0;
+}
+
+void MAVLinkFramer::setInput(const char* data, int length)
+{
+    _input = (const uint8_t*)data;
+    _inputLength = length;
+    _inputPos = 0;
+}
+
+bool MAVLinkFramer::nextMessage(mavlink_message_t* message)
+{
+    Q_ASSERT(message);
+
+    // A frame split across the previous and this chunk is finished first
+    while (_partialLength > 0) {
+        if (_inputPos == _inputLength && !_partialComplete()) {
+            return false;
+        }
+        if (_nextPartialMessage(message)) {
+            return true;
+        }
+    }
+
+    while (_inputPos < _inputLength) {
+        const uint8_t* start = _input + _inputPos;
+        const uint8_t* stx = (const uint8_t*)memchr(start, MAVLINK_STX, _inputLength - _inputPos);
+
+        if (stx == NULL) {
+            _skippedByteCount += _inputLength - _inputPos;
+            _inputPos = _inputLength;
+            return false;
+        }
+
+        _skippedByteCount += stx - start;
+        _inputPos = stx - _input;
+
+        int remaining = _inputLength - _inputPos;
+        if (remaining < 2 || remaining < stx[1] + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+            // Not a complete frame yet, hold on to it until more data arrives
+            memcpy(_partial, stx, remaining);
+            _partialLength = remaining;
+            _inputPos = _inputLength;
+            return false;
+        }
+
+        int resumeOffset;
+        if (_frameValid(stx, &resumeOffset)) {
+            _decodeFrame(stx, message);
+            _inputPos += stx[1] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+            _messageCount++;
+            return true;
+        }
+
+        _parseErrorCount++;
+        _inputPos += resumeOffset;
+    }
+
+    return false;
+}
+
+/// @brief Tries to complete the frame held in _partial from the current input.
+///     @return true: message returned, false: either more input is needed or the partial frame was invalid
+bool MAVLinkFramer::_nextPartialMessage(mavlink_message_t* message)
+{
+    Q_ASSERT(_partialLength > 0 && _partial[0] == MAVLINK_STX);
+
+    if (_partialLength < 2) {
+        if (_inputPos == _inputLength) {
+            return false;
+        }
+        _partial[_partialLength++] = _input[_inputPos++];
+    }
+
+    int frameLength = _partial[1] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+    int needed = frameLength - _partialLength;
+    if (needed > 0) {
+        int copy = qMin(needed, _inputLength - _inputPos);
+        memcpy(_partial + _partialLength, _input + _inputPos, copy);
+        _partialLength += copy;
+        _inputPos += copy;
+        if (_partialLength < frameLength) {
+            return false;
+        }
+    }
+
+    int consumed = frameLength;
+    bool valid = _frameValid(_partial, &consumed);
+    if (valid) {
+        _decodeFrame(_partial, message);
+        _messageCount++;
+    } else {
+        _parseErrorCount++;
+    }
+
+    // A bad checksum byte may itself be the start of the next frame, keep the buffered bytes
+    // from the next start sign on.
+    const uint8_t* stx = (const uint8_t*)memchr(_partial + consumed, MAVLINK_STX, _partialLength - consumed);
+    int keepFrom = stx ? stx - _partial : _partialLength;
+    _skippedByteCount += keepFrom - consumed;
+    _partialLength -= keepFrom;
+    memmove(_partial, _partial + keepFrom, _partialLength);
+
+    return valid;
+}
+
+/// @brief Checks the CRC of a complete frame.
+///     @param resumeOffset Set to the offset at which the search for the next start sign continues if the
+///                         frame is invalid. Like mavlink_parse_char this is the first mismatching checksum byte.
+bool MAVLinkFramer::_frameValid(const uint8_t* frame, int* resumeOffset) const
+{
+    uint8_t payloadLength = frame[1];
+
+    // The checksum covers the header without the start sign and the payload
+    uint16_t crc = crc_calculate(frame + 1, MAVLINK_CORE_HEADER_LEN + payloadLength);
+#if MAVLINK_CRC_EXTRA
+    crc_accumulate(_crcExtra[frame[5]], &crc);
+#endif
+
+    int ckOffset = MAVLINK_NUM_HEADER_BYTES + payloadLength;
+    if (frame[ckOffset] != (crc & 0xFF)) {
+        *resumeOffset = ckOffset;
+        return false;
+    }
+    if (frame[ckOffset + 1] != (crc >> 8)) {
+        *resumeOffset = ckOffset + 1;
+        return false;
+    }
+    return true;
+}
+
+void MAVLinkFramer::_decodeFrame(const uint8_t* frame, mavlink_message_t* message) const
+{
+    uint8_t payloadLength = frame[1];
+
+    message->magic = MAVLINK_STX;
+    message->len = payloadLength;
+    message->seq = frame[2];
+    message->sysid = frame[3];
+    message->compid = frame[4];
+    message->msgid = frame[5];
+
+    // Same layout as mavlink_parse_char: the checksum bytes directly follow the payload
+    const uint8_t* ck = frame + MAVLINK_NUM_HEADER_BYTES + payloadLength;
+    message->checksum = ck[0] | (ck[1] << 8);
+    memcpy(_MAV_PAYLOAD_NON_CONST(message), frame + MAVLINK_NUM_HEADER_BYTES, payloadLength + MAVLINK_NUM_CHECKSUM_BYTES);
+}
+
+int MAVLinkFramer::packFrame(uint8_t* frame, uint8_t sequence, uint8_t systemId, uint8_t componentId, uint8_t messageId, const void* payload, uint8_t payloadLength)
+{
+    frame[0] = MAVLINK_STX;
+    frame[1] = payloadLength;
+    frame[2] = sequence;
+    frame[3] = systemId;
+    frame[4] = componentId;
+    frame[5] = messageId;
+    if (payload != frame + MAVLINK_NUM_HEADER_BYTES) {
+        memcpy(frame + MAVLINK_NUM_HEADER_BYTES, payload, payloadLength);
+    }
+
+    uint16_t crc = crc_calculate(frame + 1, MAVLINK_CORE_HEADER_LEN + payloadLength);
+#if MAVLINK_CRC_EXTRA
+    crc_accumulate(_crcExtra[messageId], &crc);
+#endif
+    frame[MAVLINK_NUM_HEADER_BYTES + payloadLength] = crc & 0xFF;
+    frame[MAVLINK_NUM_HEADER_BYTES + payloadLength + 1] = crc >> 8;
+
+    return payloadLength + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+}
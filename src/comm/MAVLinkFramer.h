@@ -0,0 +1,93 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Chunk oriented MAVLink frame parser
+
+#ifndef MAVLINKFRAMER_H
+#define MAVLINKFRAMER_H
+
+#include <QtGlobal>
+
+#include "QGCMAVLink.h"
+
+/// @brief Extracts MAVLink messages from a byte stream one whole frame at a time.
+///
+/// Unlike mavlink_parse_char, which runs a state machine for every byte, the framer searches the
+/// input chunk for the start sign, checks length and CRC over the complete frame in place and only
+/// copies bytes when a frame is split across two chunks. One framer holds the parse state for exactly
+/// one link, so there is no limit on the number of links as there is with the MAVLink channel buffers.
+///
+/// Frames which fail the CRC check are skipped the same way mavlink_parse_char skips them, so the
+/// messages returned are identical to those of mavlink_parse_char.
+class MAVLinkFramer
+{
+public:
+    MAVLinkFramer(void);
+
+    /// @brief Sets the next chunk of bytes to parse. The data must stay valid until nextMessage returns false.
+    void setInput(const char* data, int length);
+
+    /// @brief Extracts the next valid message from the current input.
+    ///     @param message Filled in with the message when one was found
+    ///     @return true: message is valid, false: input is exhausted, call setInput with more data
+    bool nextMessage(mavlink_message_t* message);
+
+    /// @brief Discards any partial frame carried over from previous input and clears the counters.
+    void reset(void);
+
+    /// @brief Number of messages which passed the CRC check
+    quint32 messageCount(void) const { return _messageCount; }
+
+    /// @brief Number of frames which failed the CRC check
+    quint32 parseErrorCount(void) const { return _parseErrorCount; }
+
+    /// @brief Number of bytes skipped while searching for a start sign
+    quint32 skippedByteCount(void) const { return _skippedByteCount; }
+
+    /// @brief Builds a complete frame from a payload. Unlike the mavlink pack functions this does not touch
+    /// the sequence numbers of the global MAVLink channels, so any number of senders can build frames in parallel.
+    ///     @param frame Buffer of at least MAVLINK_MAX_PACKET_LEN bytes
+    ///     @param payload Payload in wire layout, the mavlink message structs have that layout
+    ///     @return frame length
+    static int packFrame(uint8_t* frame, uint8_t sequence, uint8_t systemId, uint8_t componentId, uint8_t messageId, const void* payload, uint8_t payloadLength);
+
+private:
+    bool _frameValid(const uint8_t* frame, int* resumeOffset) const;
+    void _decodeFrame(const uint8_t* frame, mavlink_message_t* message) const;
+    bool _nextPartialMessage(mavlink_message_t* message);
+    bool _partialComplete(void) const { return _partialLength >= 2 && _partialLength >= _partial[1] + MAVLINK_NUM_NON_PAYLOAD_BYTES; }
+
+    const uint8_t*  _input;         ///< Current input chunk, not owned
+    int             _inputLength;
+    int             _inputPos;      ///< Next unparsed byte in _input
+
+    uint8_t         _partial[MAVLINK_MAX_PACKET_LEN];   ///< Start of a frame which spans input chunks
+    int             _partialLength;
+
+    quint32         _messageCount;
+    quint32         _parseErrorCount;
+    quint32         _skippedByteCount;
+};
+
+#endif
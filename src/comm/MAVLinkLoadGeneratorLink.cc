@@ -0,0 +1,454 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Link which generates synthetic MAVLink traffic for load testing
+
+#include <string.h>
+#include <algorithm>
+
+#include <qmath.h>
+
+#include "MAVLinkLoadGeneratorLink.h"
+#include "MAVLinkFramer.h"
+
+static const uint8_t _messageLengths[256] = MAVLINK_MESSAGE_LENGTHS;
+
+MAVLinkLoadGeneratorLink::MAVLinkLoadGeneratorLink(void) :
+    _connected(false),
+    _stop(false),
+    _streams(defaultStreams()),
+    _systemCount(1),
+    _rateScale(1.0),
+    _wireSpeed(0),
+    _lossRate(0),
+    _reorderRate(0),
+    _corruptionRate(0),
+    _virtualTime(false),
+    _frameLimit(0),
+    _seed(1),
+    _randomState(1),
+    _generatedFrames(0),
+    _emittedFrames(0),
+    _unaccountedFrames(0),
+    _consumedFrames(0),
+    _consumerCount(0)
+{
+    _linkId = getNextLinkId();
+    _name = tr("Load Generator");
+}
+
+MAVLinkLoadGeneratorLink::~MAVLinkLoadGeneratorLink()
+{
+    disconnect();
+}
+
+QList<MAVLinkLoadGeneratorLink::Stream> MAVLinkLoadGeneratorLink::defaultStreams(void)
+{
+    QList<Stream> streams;
+
+    streams << Stream(MAVLINK_MSG_ID_HEARTBEAT, 1)
+            << Stream(MAVLINK_MSG_ID_SYS_STATUS, 2)
+            << Stream(MAVLINK_MSG_ID_GPS_RAW_INT, 5)
+            << Stream(MAVLINK_MSG_ID_GLOBAL_POSITION_INT, 10)
+            << Stream(MAVLINK_MSG_ID_VFR_HUD, 10)
+            << Stream(MAVLINK_MSG_ID_ATTITUDE, 50)
+            << Stream(MAVLINK_MSG_ID_HIGHRES_IMU, 100);
+
+    return streams;
+}
+
+bool MAVLinkLoadGeneratorLink::connect(void)
+{
+    if (_connected) {
+        return true;
+    }
+
+    // Reset to the same state on every connect, the same settings generate the same bytes
+    _randomState = _seed ? _seed : 0x9E3779B9;
+    _schedules.clear();
+    _sequences.fill(0, _systemCount);
+    _heldFrame.clear();
+    _generatedFrames = 0;
+    _emittedFrames = 0;
+    _unaccountedFrames = 0;
+    _consumedFrames = 0;
+    _consumerCount = _consumerCounter();
+
+    for (int system = 0; system < _systemCount; system++) {
+        for (int stream = 0; stream < _streams.count(); stream++) {
+            double rateHz = _streams[stream].rateHz * _rateScale;
+            if (rateHz <= 0) {
+                continue;
+            }
+
+            _Schedule schedule;
+            schedule.intervalUsecs = qMax((quint64)1, (quint64)(1000000.0 / rateHz));
+            // Spread the systems out within the interval instead of sending in lockstep
+            schedule.dueUsecs = _random() % schedule.intervalUsecs;
+            schedule.systemIndex = system;
+            schedule.streamIndex = stream;
+            _schedules.append(schedule);
+        }
+    }
+
+    if (_schedules.isEmpty()) {
+        emit communicationError(getName(), tr("Error connecting: no stream with a rate above zero"));
+        return false;
+    }
+    std::make_heap(_schedules.begin(), _schedules.end());
+
+    _name = tr("Load Generator (%1 systems)").arg(_systemCount);
+    emit nameChanged(_name);
+
+    _stop = false;
+    _connected = true;
+    start(HighPriority);
+
+    emit connected(true);
+    emit connected();
+
+    return true;
+}
+
+bool MAVLinkLoadGeneratorLink::disconnect(void)
+{
+    if (!_connected) {
+        return true;
+    }
+
+    _stop = true;
+    wait();
+    _connected = false;
+
+    emit disconnected();
+    emit connected(false);
+
+    return true;
+}
+
+void MAVLinkLoadGeneratorLink::run(void)
+{
+    quint64 nowUsecs = 0;
+    quint64 wireFreeUsecs = 0;  ///< Time at which all generated bytes went over the wire
+    QByteArray chunk;
+
+    _clock.start();
+
+    while (!_stop) {
+        if (!_virtualTime) {
+            nowUsecs = _clock.nsecsElapsed() / 1000;
+        } else if (!_waitForConsumer()) {
+            break;
+        }
+
+        chunk.clear();
+        bool limitReached = false;
+        bool chunkFull = false;
+
+        while (_schedules.first().dueUsecs <= nowUsecs) {
+            if (_frameLimit && _generatedFrames >= _frameLimit) {
+                limitReached = true;
+                break;
+            }
+            if (chunk.size() >= _maxChunkSize) {
+                chunkFull = true;
+                break;
+            }
+
+            std::pop_heap(_schedules.begin(), _schedules.end());
+            _Schedule& schedule = _schedules.last();
+            _appendFrame(chunk, schedule);
+            schedule.dueUsecs += schedule.intervalUsecs;
+            std::push_heap(_schedules.begin(), _schedules.end());
+        }
+
+        if (limitReached && !_heldFrame.isEmpty()) {
+            chunk.append(_heldFrame);
+            _heldFrame.clear();
+            _emittedFrames++;
+        }
+
+        if (!chunk.isEmpty()) {
+            emit bytesReceived(this, chunk);
+
+            // Log the amount and time received for future data rate calculations.
+            linkStatistics.logBytesReceived(chunk.size());
+
+            if (_wireSpeed > 0) {
+                wireFreeUsecs = qMax(wireFreeUsecs, nowUsecs) + chunk.size() * 1000000 / _wireSpeed;
+            }
+        }
+
+        if (limitReached) {
+            emit generationFinished();
+            break;
+        }
+
+        // A backlog is sent as soon as the wire allows, otherwise the traffic of the next chunk is collected
+        quint64 nextUsecs = qMax(_schedules.first().dueUsecs, wireFreeUsecs);
+        if (!chunkFull) {
+            nextUsecs = qMax(nextUsecs, nowUsecs + _chunkUsecs);
+        }
+
+        if (_virtualTime) {
+            nowUsecs = nextUsecs;
+        } else {
+            quint64 wallUsecs;
+            while (!_stop && (wallUsecs = _clock.nsecsElapsed() / 1000) < nextUsecs) {
+                // Wake up now and then to check for a stop request
+                QThread::usleep(qMin(nextUsecs - wallUsecs, (quint64)100000));
+            }
+        }
+    }
+}
+
+/// @brief Builds the next frame of a stream and applies the loss, corruption and reordering to it
+void MAVLinkLoadGeneratorLink::_appendFrame(QByteArray& chunk, const _Schedule& schedule)
+{
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    int messageId = _streams[schedule.streamIndex].messageId;
+    int payloadLength = _packPayload(messageId, schedule.dueUsecs, frame + MAVLINK_NUM_HEADER_BYTES);
+
+    int length = MAVLinkFramer::packFrame(frame, _sequences[schedule.systemIndex]++, firstSystemId + schedule.systemIndex,
+                                          _componentId, messageId, frame + MAVLINK_NUM_HEADER_BYTES, payloadLength);
+    _generatedFrames++;
+
+    // A lost frame still used up its sequence number, the consumer sees the gap
+    if (_lossRate > 0 && _randomProbability() < _lossRate) {
+        return;
+    }
+    if (_corruptionRate > 0 && _randomProbability() < _corruptionRate) {
+        frame[_random() % length] ^= 1 + _random() % 255;
+    }
+
+    if (!_heldFrame.isEmpty()) {
+        chunk.append((const char*)frame, length);
+        chunk.append(_heldFrame);
+        _heldFrame.clear();
+        _emittedFrames += 2;
+    } else if (_reorderRate > 0 && _randomProbability() < _reorderRate) {
+        _heldFrame = QByteArray((const char*)frame, length);
+    } else {
+        chunk.append((const char*)frame, length);
+        _emittedFrames++;
+    }
+}
+
+/// @brief Fills in the payload of a message at the given time. The common telemetry messages carry
+///         a vehicle flying a circle, other messages get a random payload of their length.
+///     @return payload length
+int MAVLinkLoadGeneratorLink::_packPayload(int messageId, quint64 nowUsecs, uint8_t* payload)
+{
+    // The message structs have the layout of the payload on the wire, see MAVLinkFramer::packFrame
+    double seconds = nowUsecs / 1000000.0;
+    double angle = seconds * 0.2;
+    uint32_t timeBootMsecs = (uint32_t)(nowUsecs / 1000);
+
+    switch (messageId) {
+        case MAVLINK_MSG_ID_HEARTBEAT:
+        {
+            mavlink_heartbeat_t heartbeat;
+            memset(&heartbeat, 0, sizeof(heartbeat));
+            heartbeat.type = MAV_TYPE_QUADROTOR;
+            heartbeat.autopilot = MAV_AUTOPILOT_GENERIC;
+            heartbeat.base_mode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
+            heartbeat.system_status = MAV_STATE_ACTIVE;
+            heartbeat.mavlink_version = MAVLINK_VERSION;
+            memcpy(payload, &heartbeat, MAVLINK_MSG_ID_HEARTBEAT_LEN);
+            return MAVLINK_MSG_ID_HEARTBEAT_LEN;
+        }
+        case MAVLINK_MSG_ID_SYS_STATUS:
+        {
+            mavlink_sys_status_t status;
+            memset(&status, 0, sizeof(status));
+            status.load = 500;
+            status.voltage_battery = 12000;
+            status.current_battery = 1500;
+            status.battery_remaining = 80;
+            memcpy(payload, &status, MAVLINK_MSG_ID_SYS_STATUS_LEN);
+            return MAVLINK_MSG_ID_SYS_STATUS_LEN;
+        }
+        case MAVLINK_MSG_ID_GPS_RAW_INT:
+        {
+            mavlink_gps_raw_int_t gps;
+            memset(&gps, 0, sizeof(gps));
+            gps.time_usec = nowUsecs;
+            gps.lat = 473977000 + (int32_t)(cos(angle) * 10000);
+            gps.lon = 85456000 + (int32_t)(sin(angle) * 10000);
+            gps.alt = 500000;
+            gps.eph = 100;
+            gps.epv = 150;
+            gps.vel = 500;
+            gps.cog = 65535;
+            gps.fix_type = 3;
+            gps.satellites_visible = 10;
+            memcpy(payload, &gps, MAVLINK_MSG_ID_GPS_RAW_INT_LEN);
+            return MAVLINK_MSG_ID_GPS_RAW_INT_LEN;
+        }
+        case MAVLINK_MSG_ID_GLOBAL_POSITION_INT:
+        {
+            mavlink_global_position_int_t position;
+            memset(&position, 0, sizeof(position));
+            position.time_boot_ms = timeBootMsecs;
+            position.lat = 473977000 + (int32_t)(cos(angle) * 10000);
+            position.lon = 85456000 + (int32_t)(sin(angle) * 10000);
+            position.alt = 500000;
+            position.relative_alt = 20000;
+            position.vx = (int16_t)(-sin(angle) * 500);
+            position.vy = (int16_t)(cos(angle) * 500);
+            memcpy(payload, &position, MAVLINK_MSG_ID_GLOBAL_POSITION_INT_LEN);
+            return MAVLINK_MSG_ID_GLOBAL_POSITION_INT_LEN;
+        }
+        case MAVLINK_MSG_ID_VFR_HUD:
+        {
+            mavlink_vfr_hud_t hud;
+            memset(&hud, 0, sizeof(hud));
+            hud.airspeed = 5.0f;
+            hud.groundspeed = 5.0f;
+            hud.alt = 20.0f;
+            hud.heading = (int16_t)(fmod(angle * 180.0 / M_PI + 90.0, 360.0));
+            hud.throttle = 50;
+            memcpy(payload, &hud, MAVLINK_MSG_ID_VFR_HUD_LEN);
+            return MAVLINK_MSG_ID_VFR_HUD_LEN;
+        }
+        case MAVLINK_MSG_ID_ATTITUDE:
+        {
+            mavlink_attitude_t attitude;
+            memset(&attitude, 0, sizeof(attitude));
+            attitude.time_boot_ms = timeBootMsecs;
+            attitude.roll = (float)(0.1 * sin(seconds));
+            attitude.pitch = (float)(0.05 * cos(seconds));
+            attitude.yaw = (float)(fmod(angle + M_PI / 2, 2 * M_PI) - M_PI);
+            attitude.yawspeed = 0.2f;
+            memcpy(payload, &attitude, MAVLINK_MSG_ID_ATTITUDE_LEN);
+            return MAVLINK_MSG_ID_ATTITUDE_LEN;
+        }
+        case MAVLINK_MSG_ID_HIGHRES_IMU:
+        {
+            mavlink_highres_imu_t imu;
+            memset(&imu, 0, sizeof(imu));
+            imu.time_usec = nowUsecs;
+            imu.xacc = (float)(0.1 * sin(seconds * 7));
+            imu.yacc = (float)(0.1 * cos(seconds * 5));
+            imu.zacc = -9.81f;
+            imu.zgyro = 0.2f;
+            imu.abs_pressure = 950.0f;
+            imu.pressure_alt = 520.0f;
+            imu.temperature = 25.0f;
+            imu.fields_updated = 0x1FFF;
+            memcpy(payload, &imu, MAVLINK_MSG_ID_HIGHRES_IMU_LEN);
+            return MAVLINK_MSG_ID_HIGHRES_IMU_LEN;
+        }
+        default:
+        {
+            int length = _messageLengths[messageId & 0xFF];
+            for (int i = 0; i < length; i++) {
+                payload[i] = (uint8_t)_random();
+            }
+            return length;
+        }
+    }
+}
+
+/// @brief Sum of the frames the consumer decoded or rejected, as counted in the link statistics
+quint32 MAVLinkLoadGeneratorLink::_consumerCounter(void) const
+{
+    return linkStatistics.framesReceived() + linkStatistics.crcErrors();
+}
+
+/// @brief Waits in virtual time until the consumer is close enough behind the generated frames.
+///     @return false: the link is stopping
+bool MAVLinkLoadGeneratorLink::_waitForConsumer(void)
+{
+    QElapsedTimer stallTimer;
+    stallTimer.start();
+
+    forever {
+        quint32 count = _consumerCounter();
+        if (count != _consumerCount) {
+            // The counters wrap around, only their difference is used
+            _consumedFrames += (quint32)(count - _consumerCount);
+            _consumerCount = count;
+            stallTimer.restart();
+        }
+
+        quint64 accountedFrames = _consumedFrames + _unaccountedFrames;
+        quint64 inFlight = _emittedFrames > accountedFrames ? _emittedFrames - accountedFrames : 0;
+        if (inFlight <= (quint64)_maxFramesInFlight) {
+            return true;
+        }
+        if (_stop) {
+            return false;
+        }
+        if (stallTimer.elapsed() > _consumerStallMsecs) {
+            // Either nobody consumes the frames or a corrupted frame swallowed others in the parser
+            _unaccountedFrames += inFlight;
+            return true;
+        }
+
+        QThread::usleep(200);
+    }
+}
+
+quint32 MAVLinkLoadGeneratorLink::_random(void)
+{
+    // xorshift32, the same sequence on every platform unlike qrand
+    _randomState ^= _randomState << 13;
+    _randomState ^= _randomState >> 17;
+    _randomState ^= _randomState << 5;
+    return _randomState;
+}
+
+double MAVLinkLoadGeneratorLink::_randomProbability(void)
+{
+    return _random() / 4294967296.0;
+}
+
+void MAVLinkLoadGeneratorLink::writeBytes(const char* data, qint64 size)
+{
+    Q_UNUSED(data);
+
+    // There is no vehicle behind the link, commands and requests are dropped
+    linkStatistics.logBytesSent(size);
+}
+
+bool MAVLinkLoadGeneratorLink::isConnected(void) const
+{
+    return _connected;
+}
+
+int MAVLinkLoadGeneratorLink::getId(void) const
+{
+    return _linkId;
+}
+
+QString MAVLinkLoadGeneratorLink::getName(void) const
+{
+    return _name;
+}
+
+qint64 MAVLinkLoadGeneratorLink::getConnectionSpeed(void) const
+{
+    return _wireSpeed > 0 ? _wireSpeed * 8 : 1000000000;
+}
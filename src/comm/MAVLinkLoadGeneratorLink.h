@@ -0,0 +1,184 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Link which generates synthetic MAVLink traffic for load testing
+
+#ifndef MAVLINKLOADGENERATORLINK_H
+#define MAVLINKLOADGENERATORLINK_H
+
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include "LinkInterface.h"
+#include "QGCMAVLink.h"
+
+/// @brief Generates a reproducible stream of MAVLink frames from a configurable mix of messages and
+///         systems, without a vehicle, simulator or GUI.
+///
+/// Each system sends each stream at its rate, scaled by the rate scale and capped by the wire speed.
+/// Frames can be lost, reordered or corrupted on the way, all driven by a seeded generator so the
+/// same settings produce the same bytes. In virtual time the clock in the messages advances as
+/// fast as the consumer decodes the frames, which makes it a benchmark of the receive pipeline.
+///
+/// The settings are read when the link connects, change them while the link is disconnected.
+class MAVLinkLoadGeneratorLink : public LinkInterface
+{
+    Q_OBJECT
+
+public:
+    /// @brief One message sent periodically by every system
+    struct Stream {
+        Stream(void) : messageId(0), rateHz(0) {}
+        Stream(int messageId_, double rateHz_) : messageId(messageId_), rateHz(rateHz_) {}
+
+        int     messageId;
+        double  rateHz;
+    };
+
+    MAVLinkLoadGeneratorLink(void);
+    ~MAVLinkLoadGeneratorLink();
+
+    /// @brief The mix of an autopilot streaming telemetry: heartbeat, status, attitude, position and IMU
+    static QList<Stream> defaultStreams(void);
+
+    void setStreams(const QList<Stream>& streams) { _streams = streams; }
+    QList<Stream> getStreams(void) const { return _streams; }
+
+    /// @brief Sets the number of systems, they use the system ids starting at firstSystemId
+    void setSystemCount(int count) { _systemCount = count; }
+    int getSystemCount(void) const { return _systemCount; }
+
+    /// @brief Multiplies the rate of all streams
+    void setRateScale(double scale) { _rateScale = scale; }
+    double getRateScale(void) const { return _rateScale; }
+
+    /// @brief Sets the maximum number of bytes per second, 0 for no limit
+    void setWireSpeed(qint64 bytesPerSecond) { _wireSpeed = bytesPerSecond; }
+
+    /// @brief Sets the probabilities, from 0 to 1, with which a frame is lost, swapped with the next frame or has a byte changed
+    void setLossRate(double probability) { _lossRate = probability; }
+    void setReorderRate(double probability) { _reorderRate = probability; }
+    void setCorruptionRate(double probability) { _corruptionRate = probability; }
+
+    /// @brief In virtual time frames are generated as fast as they are decoded, instead of at their wall clock time
+    void setVirtualTime(bool virtualTime) { _virtualTime = virtualTime; }
+    bool isVirtualTime(void) const { return _virtualTime; }
+
+    /// @brief Stops generating after this many frames, 0 for no limit
+    void setFrameLimit(quint64 frames) { _frameLimit = frames; }
+
+    void setSeed(quint32 seed) { _seed = seed; }
+
+    /// @brief Number of frames generated since the link connected, including the lost ones
+    quint64 getGeneratedFrameCount(void) const { return _generatedFrames; }
+
+    /// @brief Number of frames the consumer had not decoded yet when the generator gave up waiting
+    /// for them, corruption can break a frame in a way the parser does not count.
+    quint64 getUnaccountedFrameCount(void) const { return _unaccountedFrames; }
+
+    // LinkInterface methods
+    virtual int     getId(void) const;
+    virtual QString getName(void) const;
+    virtual bool    isConnected(void) const;
+    virtual bool    connect(void);
+    virtual bool    disconnect(void);
+    virtual qint64  bytesAvailable(void) { return 0; }
+    virtual void    requestReset(void) {};
+    virtual qint64  getConnectionSpeed(void) const;
+
+    static const int firstSystemId = 1;
+
+signals:
+    /// @brief Emitted from the link thread once the frame limit was reached
+    void generationFinished(void);
+
+public slots:
+    // From LinkInterface
+    virtual void writeBytes(const char* data, qint64 length);
+
+protected slots:
+    // From LinkInterface
+    virtual void readBytes(void) {}
+
+protected:
+    // From LinkInterface->QThread
+    virtual void run(void);
+
+private:
+    /// @brief Next frame of one stream of one system
+    struct _Schedule {
+        quint64 dueUsecs;
+        quint64 intervalUsecs;
+        int     systemIndex;
+        int     streamIndex;
+
+        // Makes a min-heap out of std heap functions
+        bool operator<(const _Schedule& other) const { return dueUsecs > other.dueUsecs; }
+    };
+
+    quint32 _random(void);
+    double _randomProbability(void);
+    void _appendFrame(QByteArray& chunk, const _Schedule& schedule);
+    int _packPayload(int messageId, quint64 nowUsecs, uint8_t* payload);
+    quint32 _consumerCounter(void) const;
+    bool _waitForConsumer(void);
+
+    QString         _name;
+    int             _linkId;
+    volatile bool   _connected;
+    volatile bool   _stop;
+
+    QList<Stream>   _streams;
+    int             _systemCount;
+    double          _rateScale;
+    qint64          _wireSpeed;
+    double          _lossRate;
+    double          _reorderRate;
+    double          _corruptionRate;
+    bool            _virtualTime;
+    quint64         _frameLimit;
+    quint32         _seed;
+
+    // Link thread state
+    quint32             _randomState;
+    QVector<_Schedule>  _schedules;
+    QVector<uint8_t>    _sequences;         ///< Next sequence number of each system
+    QByteArray          _heldFrame;         ///< Frame waiting to be sent after the next one
+    QElapsedTimer       _clock;
+    quint64             _generatedFrames;
+    quint64             _emittedFrames;     ///< Frames handed to the consumer, lost frames are not
+    quint64             _unaccountedFrames;
+    quint64             _consumedFrames;    ///< Frames the consumer decoded or rejected since the link connected
+    quint32             _consumerCount;     ///< Last value of the wrapping consumer counters in the link statistics
+
+    static const int    _componentId = 1;
+    static const int    _chunkUsecs = 1000;             ///< Traffic of this much time is emitted at once, like a link driver delivering every millisecond
+    static const int    _maxChunkSize = 65536;
+    static const int    _maxFramesInFlight = 4096;      ///< Virtual time only runs ahead of the consumer by this many frames
+    static const int    _consumerStallMsecs = 50;       ///< Frames not decoded after this long are counted as unaccounted
+};
+
+#endif
@@ -0,0 +1,252 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Background writer for the MAVLink packet log
+
+#include <QtEndian>
+#include <QElapsedTimer>
+#include <string.h>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "MAVLinkLogWriter.h"
+
+MAVLinkLogWriter::MAVLinkLogWriter(int ringSize, QObject* parent) :
+    QThread(parent),
+    _file(NULL),
+    _ring(NULL),
+    _ringMask(0),
+    _head(0),
+    _tail(0),
+    _aboveHighWater(false),
+    _block(NULL),
+    _blockLength(0),
+    _writeFailed(false),
+    _stop(0),
+    _flushInterval(1000),
+    _syncInterval(0),
+    _droppedMessageCount(0),
+    _backpressureCount(0),
+    _blockWriteCount(0)
+{
+    quint32 size = blockSize;
+    while (size < (quint32)ringSize) {
+        size <<= 1;
+    }
+    _ring = new char[size];
+    _ringMask = size - 1;
+
+    // Page aligned so the disk writes don't need to be bounced through another buffer
+    _block = (char*)qMallocAligned(blockSize, 4096);
+}
+
+MAVLinkLogWriter::~MAVLinkLogWriter()
+{
+    stopLogging();
+
+    delete[] _ring;
+    qFreeAligned(_block);
+}
+
+void MAVLinkLogWriter::startLogging(QFile* file)
+{
+    Q_ASSERT(file && file->isOpen());
+
+    stopLogging();
+
+    _file = file;
+    _head.store(0);
+    _tail.store(0);
+    _aboveHighWater = false;
+    _blockLength = 0;
+    _writeFailed = false;
+    _stop.store(0);
+
+    start();
+}
+
+void MAVLinkLogWriter::stopLogging(void)
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    _wakeMutex.lock();
+    _stop.store(1);
+    _wake.wakeOne();
+    _wakeMutex.unlock();
+
+    wait();
+    _file = NULL;
+}
+
+quint32 MAVLinkLogWriter::_fill(void) const
+{
+    return (quint32)_head.loadAcquire() - (quint32)_tail.loadAcquire();
+}
+
+bool MAVLinkLogWriter::logMessage(quint64 timestamp, const mavlink_message_t& message)
+{
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN + sizeof(quint64)];
+
+    // Write the uint64 time in microseconds in big endian format before the message.
+    qToBigEndian(timestamp, buf);
+    quint32 length = sizeof(quint64) + mavlink_msg_to_send_buffer(buf + sizeof(quint64), &message);
+
+    quint32 head = (quint32)_head.load();
+    quint32 fill = head - (quint32)_tail.loadAcquire();
+
+    if (fill + length > _ringMask + 1) {
+        _droppedMessageCount.ref();
+        return false;
+    }
+
+    // Copy into the ring, wrapping around its end
+    quint32 offset = head & _ringMask;
+    quint32 first = qMin(length, _ringMask + 1 - offset);
+    memcpy(_ring + offset, buf, first);
+    memcpy(_ring, buf + first, length - first);
+
+    _head.storeRelease((int)(head + length));
+
+    // The writer fell behind if the ring is more than three quarters full
+    quint32 highWater = (_ringMask + 1) / 4 * 3;
+    if (fill + length > highWater && !_aboveHighWater) {
+        _backpressureCount.ref();
+    }
+    _aboveHighWater = fill + length > highWater;
+
+    // Wake up the writer once a whole block is ready. Locking here only happens once per block, the
+    // lock makes sure the wake up can't get lost between the writer checking the fill and waiting.
+    if (fill < (quint32)blockSize && fill + length >= (quint32)blockSize) {
+        _wakeMutex.lock();
+        _wake.wakeOne();
+        _wakeMutex.unlock();
+    }
+
+    return true;
+}
+
+void MAVLinkLogWriter::run(void)
+{
+    QElapsedTimer flushTimer;
+    QElapsedTimer syncTimer;
+    flushTimer.start();
+    syncTimer.start();
+
+    forever {
+        bool stopping = _stop.loadAcquire();
+
+        _drain();
+
+        if (stopping) {
+            break;
+        }
+
+        if (flushTimer.elapsed() >= _flushInterval) {
+            _writeBlock();
+            _file->flush();
+            flushTimer.restart();
+        }
+
+        if (_syncInterval > 0 && syncTimer.elapsed() >= _syncInterval) {
+            _sync();
+            syncTimer.restart();
+        }
+
+        _wakeMutex.lock();
+        if (!_stop.load() && _fill() < (quint32)blockSize) {
+            qint64 timeout = _flushInterval - flushTimer.elapsed();
+            if (_syncInterval > 0) {
+                timeout = qMin(timeout, _syncInterval - syncTimer.elapsed());
+            }
+            _wake.wait(&_wakeMutex, (unsigned long)qMax(timeout, (qint64)1));
+        }
+        _wakeMutex.unlock();
+    }
+
+    _writeBlock();
+    _file->flush();
+    _sync();
+}
+
+/// @brief Moves the ring contents into blocks, writing each block as it fills up
+void MAVLinkLogWriter::_drain(void)
+{
+    quint32 tail = (quint32)_tail.load();
+    quint32 available = (quint32)_head.loadAcquire() - tail;
+
+    while (available > 0) {
+        quint32 offset = tail & _ringMask;
+        quint32 length = qMin(available, (quint32)(blockSize - _blockLength));
+        length = qMin(length, _ringMask + 1 - offset);
+
+        memcpy(_block + _blockLength, _ring + offset, length);
+        _blockLength += length;
+        tail += length;
+        available -= length;
+
+        // Hand the space back to the receiving thread right away
+        _tail.storeRelease((int)tail);
+
+        if (_blockLength == blockSize) {
+            _writeBlock();
+        }
+    }
+}
+
+void MAVLinkLogWriter::_writeBlock(void)
+{
+    if (_blockLength == 0) {
+        return;
+    }
+
+    if (!_writeFailed) {
+        if (_file->write(_block, _blockLength) != _blockLength) {
+            _writeFailed = true;
+            emit writeFailed(_file->fileName());
+        } else {
+            _blockWriteCount.ref();
+        }
+    }
+
+    _blockLength = 0;
+}
+
+void MAVLinkLogWriter::_sync(void)
+{
+    if (_writeFailed) {
+        return;
+    }
+
+#ifdef Q_OS_WIN
+    _commit(_file->handle());
+#else
+    fsync(_file->handle());
+#endif
+}
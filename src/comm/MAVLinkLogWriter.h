@@ -0,0 +1,126 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Background writer for the MAVLink packet log
+
+#ifndef MAVLINKLOGWRITER_H
+#define MAVLINKLOGWRITER_H
+
+#include <QThread>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+#include "QGCMAVLink.h"
+
+/// @brief Writes the MAVLink packet log from its own thread.
+///
+/// The receiving thread serializes each message together with its big endian timestamp into a lock free
+/// single producer / single consumer ring and never touches the file. The writer thread collects the
+/// ring contents into large, page aligned blocks and writes them in one call each, so a slow disk can't
+/// stall message parsing. If the disk falls so far behind that the ring fills up, messages are dropped
+/// and counted instead of blocking the receiver.
+///
+/// The log format is unchanged: a quint64 big endian timestamp in microseconds followed by the MAVLink frame.
+class MAVLinkLogWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    /// @param ringSize Size of the ring in bytes, rounded up to a power of two
+    MAVLinkLogWriter(int ringSize = defaultRingSize, QObject* parent = NULL);
+    ~MAVLinkLogWriter();
+
+    /// @brief Starts writing to the file, which must be open for writing. The file is not owned.
+    ///         Call from the receiving thread, or while nothing calls logMessage.
+    void startLogging(QFile* file);
+
+    /// @brief Writes all queued messages, syncs the file and stops the thread. The file is left open.
+    ///         Call from the receiving thread, or while nothing calls logMessage.
+    void stopLogging(void);
+
+    /// @brief Queues a message for writing, called from the receiving thread.
+    ///     @param timestamp Receive time in microseconds since epoch
+    ///     @return false: ring is full, message was dropped
+    bool logMessage(quint64 timestamp, const mavlink_message_t& message);
+
+    /// @brief Sets the interval in which partially filled blocks are written and the file is flushed
+    void setFlushInterval(int msecs) { _flushInterval = msecs; }
+    int flushInterval(void) const { return _flushInterval; }
+
+    /// @brief Sets the interval in which the file is synced to disk, 0 to only sync on stop
+    void setSyncInterval(int msecs) { _syncInterval = msecs; }
+    int syncInterval(void) const { return _syncInterval; }
+
+    /// @brief Number of messages dropped because the ring was full
+    int droppedMessageCount(void) const { return _droppedMessageCount.load(); }
+
+    /// @brief Number of times the ring filled beyond its high water mark because the writer fell behind
+    int backpressureCount(void) const { return _backpressureCount.load(); }
+
+    /// @brief Number of blocks written to the file
+    int blockWriteCount(void) const { return _blockWriteCount.load(); }
+
+    static const int defaultRingSize = 1024 * 1024;
+    static const int blockSize = 64 * 1024;
+
+signals:
+    /// @brief Emitted from the writer thread if writing to the file failed. Further messages are discarded.
+    void writeFailed(const QString& fileName);
+
+protected:
+    void run(void);
+
+private:
+    void _drain(void);
+    void _writeBlock(void);
+    void _sync(void);
+    quint32 _fill(void) const;
+
+    QFile*          _file;
+
+    char*           _ring;
+    quint32         _ringMask;          ///< Ring size - 1
+    QAtomicInt      _head;              ///< Total bytes queued, written by the receiving thread only
+    QAtomicInt      _tail;              ///< Total bytes taken from the ring, written by the writer thread only
+    bool            _aboveHighWater;    ///< Receiving thread only
+
+    char*           _block;             ///< Block being collected for the next write, writer thread only
+    int             _blockLength;
+    bool            _writeFailed;
+
+    QMutex          _wakeMutex;
+    QWaitCondition  _wake;              ///< Signalled when a block is ready or the thread should stop
+    QAtomicInt      _stop;
+
+    int             _flushInterval;
+    int             _syncInterval;
+
+    QAtomicInt      _droppedMessageCount;
+    QAtomicInt      _backpressureCount;
+    QAtomicInt      _blockWriteCount;
+};
+
+#endif
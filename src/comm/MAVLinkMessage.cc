@@ -0,0 +1,179 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Reference counted MAVLink messages shared between threads
+
+#include <QThread>
+
+#include "MAVLinkMessage.h"
+#include "LinkInterface.h"
+
+MAVLinkMessage::MAVLinkMessage(void) :
+    _node(NULL)
+{
+
+}
+
+MAVLinkMessage::MAVLinkMessage(Node* node) :
+    _node(node)
+{
+    // The pool hands out nodes with a reference count of one
+}
+
+MAVLinkMessage::MAVLinkMessage(const MAVLinkMessage& other) :
+    _node(other._node)
+{
+    if (_node) {
+        _node->ref.ref();
+    }
+}
+
+MAVLinkMessage::~MAVLinkMessage()
+{
+    if (_node && !_node->ref.deref()) {
+        _node->pool->_free(_node);
+    }
+}
+
+MAVLinkMessage& MAVLinkMessage::operator=(const MAVLinkMessage& other)
+{
+    if (other._node) {
+        other._node->ref.ref();
+    }
+    if (_node && !_node->ref.deref()) {
+        _node->pool->_free(_node);
+    }
+    _node = other._node;
+    return *this;
+}
+
+mavlink_message_t* MAVLinkMessage::writableMessage(void)
+{
+    Q_ASSERT(_node);
+    Q_ASSERT(_node->ref.load() == 1);
+    return &_node->message;
+}
+
+void MAVLinkMessage::setReceiveUsecs(quint64 usecs)
+{
+    Q_ASSERT(_node);
+    Q_ASSERT(_node->ref.load() == 1);
+    _node->receiveUsecs = usecs;
+}
+
+MAVLinkMessagePool::MAVLinkMessagePool(void) :
+    _freeList(NULL),
+    _messagesInUse(0),
+    _ref(1)
+{
+
+}
+
+MAVLinkMessagePool::~MAVLinkMessagePool()
+{
+    Q_ASSERT(_messagesInUse == 0);
+    foreach (MAVLinkMessage::Node* slab, _slabs) {
+        delete[] slab;
+    }
+}
+
+MAVLinkMessage MAVLinkMessagePool::allocate(void)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_freeList == NULL) {
+        MAVLinkMessage::Node* slab = new MAVLinkMessage::Node[messagesPerSlab];
+        for (int i = 0; i < messagesPerSlab; i++) {
+            slab[i].pool = this;
+            slab[i].next = (i + 1 < messagesPerSlab) ? &slab[i + 1] : NULL;
+        }
+        _slabs.append(slab);
+        _freeList = slab;
+    }
+
+    MAVLinkMessage::Node* node = _freeList;
+    _freeList = node->next;
+    _messagesInUse++;
+
+    locker.unlock();
+
+    node->ref.store(1);
+    node->receiveUsecs = 0;
+    _ref.ref();
+
+    return MAVLinkMessage(node);
+}
+
+void MAVLinkMessagePool::_free(MAVLinkMessage::Node* node)
+{
+    _mutex.lock();
+    node->next = _freeList;
+    _freeList = node;
+    _messagesInUse--;
+    _mutex.unlock();
+
+    _deref();
+}
+
+void MAVLinkMessagePool::release(void)
+{
+    _deref();
+}
+
+void MAVLinkMessagePool::_deref(void)
+{
+    if (!_ref.deref()) {
+        delete this;
+    }
+}
+
+int MAVLinkMessagePool::slabCount(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _slabs.count();
+}
+
+int MAVLinkMessagePool::messagesInUse(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _messagesInUse;
+}
+
+MAVLinkMessageAdapter::MAVLinkMessageAdapter(QObject* receiver, const QMetaMethod& method) :
+    _receiver(receiver),
+    _method(method)
+{
+    moveToThread(receiver->thread());
+}
+
+void MAVLinkMessageAdapter::receiveMessage(LinkInterface* link, MAVLinkMessage message)
+{
+    if (_receiver.isNull()) {
+        return;
+    }
+
+    // The receiver may have been moved to another thread after it subscribed
+    Qt::ConnectionType type = (_receiver->thread() == QThread::currentThread()) ? Qt::DirectConnection : Qt::QueuedConnection;
+    _method.invoke(_receiver, type, Q_ARG(LinkInterface*, link), Q_ARG(mavlink_message_t, *message));
+}
@@ -0,0 +1,150 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Reference counted MAVLink messages shared between threads
+
+#ifndef MAVLINKMESSAGE_H
+#define MAVLINKMESSAGE_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QList>
+#include <QMetaMethod>
+#include <QMetaType>
+#include <QPointer>
+
+#include "QGCMAVLink.h"
+
+class LinkInterface;
+class MAVLinkMessagePool;
+
+/// @brief Immutable, reference counted handle to a received MAVLink message.
+///
+/// Copying a handle, also through a queued signal, only increments a reference count. The message
+/// itself is stored in a MAVLinkMessagePool and returned to it when the last handle goes away, so
+/// any number of threads can read the same message without copying or allocating it.
+class MAVLinkMessage
+{
+public:
+    /// @brief Creates a null handle
+    MAVLinkMessage(void);
+    MAVLinkMessage(const MAVLinkMessage& other);
+    ~MAVLinkMessage();
+
+    MAVLinkMessage& operator=(const MAVLinkMessage& other);
+
+    bool isNull(void) const { return _node == NULL; }
+
+    const mavlink_message_t& message(void) const { Q_ASSERT(_node); return _node->message; }
+    const mavlink_message_t& operator*(void) const { return message(); }
+    const mavlink_message_t* operator->(void) const { return &message(); }
+
+    /// @brief Returns the message for filling it in. Only allowed as long as the handle was not copied.
+    mavlink_message_t* writableMessage(void);
+
+    /// @brief Ground time in microseconds at which the bytes completing the message were received
+    quint64 receiveUsecs(void) const { Q_ASSERT(_node); return _node->receiveUsecs; }
+
+    /// @brief Sets the receive time, like writableMessage only allowed before the handle was copied
+    void setReceiveUsecs(quint64 usecs);
+
+private:
+    struct Node {
+        QAtomicInt          ref;
+        MAVLinkMessagePool* pool;
+        Node*               next;       ///< Next free node while in the pool
+        quint64             receiveUsecs;
+        mavlink_message_t   message;
+    };
+
+    explicit MAVLinkMessage(Node* node);
+
+    Node* _node;
+
+    friend class MAVLinkMessagePool;
+};
+
+Q_DECLARE_METATYPE(MAVLinkMessage)
+
+/// @brief Slab allocator for MAVLinkMessage.
+///
+/// Messages are allocated in slabs which are never freed while the pool is alive, so once the pool
+/// has grown to the number of messages in flight receiving a message does not allocate any memory.
+/// Handles may outlive the owner of the pool, the owner calls release() instead of deleting the pool
+/// and the pool is deleted together with the last message.
+class MAVLinkMessagePool
+{
+public:
+    MAVLinkMessagePool(void);
+
+    /// @brief Returns a new message. Fill it in through writableMessage() before sharing the handle.
+    MAVLinkMessage allocate(void);
+
+    /// @brief Called by the owner in place of delete
+    void release(void);
+
+    /// @brief Number of slabs allocated so far
+    int slabCount(void) const;
+
+    /// @brief Number of messages currently in use
+    int messagesInUse(void) const;
+
+    static const int messagesPerSlab = 64;
+
+private:
+    ~MAVLinkMessagePool();
+
+    void _free(MAVLinkMessage::Node* node);
+    void _deref(void);
+
+    mutable QMutex              _mutex;         ///< Protects the free list and slab list
+    MAVLinkMessage::Node*       _freeList;
+    QList<MAVLinkMessage::Node*> _slabs;
+    int                         _messagesInUse;
+    QAtomicInt                  _ref;           ///< One for the owner plus one for each message in use
+
+    friend class MAVLinkMessage;
+};
+
+/// @brief Delivers shared messages to a slot which takes mavlink_message_t by value.
+///
+/// The adapter lives in the thread of the receiver. Messages are queued to it as handles and only copied
+/// once, when the adapter calls the slot directly.
+class MAVLinkMessageAdapter : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkMessageAdapter(QObject* receiver, const QMetaMethod& method);
+
+public slots:
+    void receiveMessage(LinkInterface* link, MAVLinkMessage message);
+
+private:
+    QPointer<QObject>   _receiver;  ///< Messages may still be queued when the receiver is destroyed
+    QMetaMethod _method;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Parses the bytes of one link on a thread pool
+
+#include "MAVLinkParser.h"
+#include "LinkInterface.h"
+#include "QGC.h"
+
+MAVLinkParser::MAVLinkParser(LinkInterface* link, QObject* receiver, MAVLinkMessagePool* messagePool, QThreadPool* threadPool) :
+    _link(link),
+    _receiver(receiver),
+    _messagePool(messagePool),
+    _threadPool(threadPool),
+    _scheduled(false),
+    _detached(false)
+{
+    // The parser is reused for all bytes of the link
+    setAutoDelete(false);
+}
+
+void MAVLinkParser::parseBytes(const QByteArray& bytes, quint64 receiveUsecs)
+{
+    _Chunk chunk;
+    chunk.bytes = bytes;
+    chunk.receiveUsecs = receiveUsecs;
+
+    QMutexLocker locker(&_mutex);
+
+    if (_detached) {
+        return;
+    }
+    _pending.enqueue(chunk);
+
+    if (!_scheduled) {
+        _scheduled = true;
+        _threadPool->start(this);
+    }
+}
+
+void MAVLinkParser::detach(void)
+{
+    QMutexLocker locker(&_mutex);
+
+    _detached = true;
+    _pending.clear();
+    while (_scheduled) {
+        _idle.wait(&_mutex);
+    }
+}
+
+void MAVLinkParser::run(void)
+{
+    forever {
+        // Pick up everything that arrived while the previous batch was parsed
+        _mutex.lock();
+        if (_pending.isEmpty()) {
+            _scheduled = false;
+            _idle.wakeAll();
+            _mutex.unlock();
+            // Nothing may be touched from here on, parseBytes may already run the parser on another thread
+            return;
+        }
+        QQueue<_Chunk> chunks;
+        chunks.swap(_pending);
+        _mutex.unlock();
+
+        QVector<MAVLinkMessage> messages;
+        quint32 parseErrors = _framer.parseErrorCount();
+        MAVLinkMessage message = _messagePool->allocate();
+
+        while (!chunks.isEmpty()) {
+            _Chunk chunk = chunks.dequeue();
+            _framer.setInput(chunk.bytes.constData(), chunk.bytes.size());
+            while (_framer.nextMessage(message.writableMessage())) {
+                message.setReceiveUsecs(chunk.receiveUsecs);
+                messages.append(message);
+                message = _messagePool->allocate();
+            }
+        }
+
+        int newParseErrors = _framer.parseErrorCount() - parseErrors;
+        if (!messages.isEmpty() || newParseErrors != 0) {
+            // Batches of a link are posted one after the other, so they are delivered in order
+            QMetaObject::invokeMethod(_receiver, "receiveMessages", Qt::QueuedConnection,
+                                      Q_ARG(LinkInterface*, _link),
+                                      Q_ARG(QVector<MAVLinkMessage>, messages),
+                                      Q_ARG(int, newParseErrors));
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Parses the bytes of one link on a thread pool
+
+#ifndef MAVLINKPARSER_H
+#define MAVLINKPARSER_H
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
+#include <QByteArray>
+
+#include "MAVLinkFramer.h"
+#include "MAVLinkMessage.h"
+
+class LinkInterface;
+
+/// @brief Frames the bytes received on one link on a thread pool.
+///
+/// Bytes are queued by parseBytes() and framed by at most one pool thread at a time, so the parse state
+/// of the link needs no locking and the messages keep their order. The messages decoded from the queued
+/// bytes are handed to the receiver as one batch by a queued call to its
+/// receiveMessages(LinkInterface*, QVector<MAVLinkMessage>, int) slot. Different links are framed in
+/// parallel.
+class MAVLinkParser : public QRunnable
+{
+public:
+    MAVLinkParser(LinkInterface* link, QObject* receiver, MAVLinkMessagePool* messagePool, QThreadPool* threadPool);
+
+    /// @brief Queues bytes received on the link for framing, called from the receiving thread.
+    ///     @param receiveUsecs Ground time the bytes were read from the link, the receive time of the
+    ///             messages they complete
+    void parseBytes(const QByteArray& bytes, quint64 receiveUsecs);
+
+    /// @brief Drops the bytes not yet framed and waits until no pool thread runs the parser anymore.
+    /// Bytes passed to parseBytes afterwards are dropped, the parser may then be deleted.
+    void detach(void);
+
+    // Overrides from QRunnable
+    void run(void);
+
+private:
+    LinkInterface*      _link;
+    QObject*            _receiver;
+    MAVLinkMessagePool* _messagePool;
+    QThreadPool*        _threadPool;
+
+    MAVLinkFramer       _framer;        ///< Only used by the pool thread currently running the parser
+
+    /// @brief Bytes as received, with their ground time of arrival
+    struct _Chunk {
+        QByteArray  bytes;
+        quint64     receiveUsecs;
+    };
+
+    QMutex              _mutex;         ///< Protects _pending, _scheduled and _detached
+    QQueue<_Chunk>      _pending;       ///< Bytes not yet picked up by the pool thread
+    bool                _scheduled;     ///< Parser is queued or running on the pool
+    bool                _detached;      ///< The link is gone, nothing is parsed anymore
+    QWaitCondition      _idle;          ///< Signalled when the pool thread gives up the parser
+};
+
+#endif
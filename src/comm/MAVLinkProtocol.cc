@@ -16,7 +16,6 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QStandardPaths>
-#include <QtEndian>
 #include <QMetaType>
 
 #include "MAVLinkProtocol.h"
@@ -29,6 +28,7 @@
 #include "LinkManager.h"
 #include "QGCMAVLink.h"
 #include "QGCMAVLinkUASFactory.h"
+#include "MAVLinkParser.h"
 #include "QGC.h"
 
 Q_DECLARE_METATYPE(mavlink_message_t)
@@ -39,39 +39,47 @@ Q_DECLARE_METATYPE(mavlink_message_t)
  */
 MAVLinkProtocol::MAVLinkProtocol() :
     heartbeatTimer(NULL),
+    transmitTimer(NULL),
+    timeSyncTimer(NULL),
     heartbeatRate(MAVLINK_HEARTBEAT_DEFAULT_RATE),
     m_heartbeatsEnabled(true),
     m_multiplexingEnabled(false),
+    m_adaptiveRatesEnabled(false),
     m_authEnabled(false),
     m_loggingEnabled(false),
     m_logfile(NULL),
+    m_logWriter(new MAVLinkLogWriter()),
+    m_timeSync(new MAVLinkTimeSync()),
     m_enable_version_check(true),
     m_paramRetransmissionTimeout(350),
     m_paramRewriteTimeout(500),
     m_paramGuardEnabled(true),
     m_actionGuardEnabled(false),
     m_actionRetransmissionTimeout(100),
+    m_linkStatesLock(QReadWriteLock::Recursive),
+    m_subscriptionMutex(QMutex::Recursive),
+    m_messagePool(new MAVLinkMessagePool()),
+    m_mavlink09Count(0),
+    m_nonmavlinkCount(0),
+    m_decodedFirstPacket(0),
+    m_warnedUser(false),
+    m_checkedUserNonMavlink(false),
+    m_warnedUserNonMavlink(false),
     versionMismatchIgnore(false),
-    systemId(QGC::defaultSystemId),
-    _should_exit(false)
+    systemId(QGC::defaultSystemId)
 {
     qRegisterMetaType<mavlink_message_t>("mavlink_message_t");
+    qRegisterMetaType<MAVLinkMessage>("MAVLinkMessage");
+    qRegisterMetaType<QVector<MAVLinkMessage> >("QVector<MAVLinkMessage>");
 
     m_authKey = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
+    connect(m_logWriter, SIGNAL(writeFailed(QString)), this, SLOT(logWriteFailed(QString)));
+    // Direct, the link is usually deleted right after it was removed
+    connect(LinkManager::instance(), SIGNAL(linkRemoved(LinkInterface*)), this, SLOT(linkRemoved(LinkInterface*)), Qt::DirectConnection);
     loadSettings();
     moveToThread(this);
 
-    // All the *Counter variables are not initialized here, as they should be initialized
-    // on a per-link basis before those links are used. @see resetMetadataForLink().
-
-    // Initialize the list for tracking dropped messages to invalid.
-    for (int i = 0; i < 256; i++)
-    {
-        for (int j = 0; j < 256; j++)
-        {
-            lastIndex[i][j] = -1;
-        }
-    }
+    // The link counters are created with the state of each link. @see linkState().
 
     start(QThread::HighPriority);
 
@@ -87,6 +95,7 @@ void MAVLinkProtocol::loadSettings()
     enableHeartbeats(settings.value("HEARTBEATS_ENABLED", m_heartbeatsEnabled).toBool());
     enableVersionCheck(settings.value("VERSION_CHECK_ENABLED", m_enable_version_check).toBool());
     enableMultiplexing(settings.value("MULTIPLEXING_ENABLED", m_multiplexingEnabled).toBool());
+    enableAdaptiveRates(settings.value("ADAPTIVE_RATES_ENABLED", m_adaptiveRatesEnabled).toBool());
 
     // Only set logfile if there is a name present in settings
     if (settings.contains("LOGFILE_NAME") && m_logfile == NULL)
@@ -97,6 +106,8 @@ void MAVLinkProtocol::loadSettings()
     {
         m_logfile = new QFile(QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/qgroundcontrol_packetlog.mavlink");
     }
+    m_logWriter->setFlushInterval(settings.value("LOGFILE_FLUSH_INTERVAL", m_logWriter->flushInterval()).toInt());
+    m_logWriter->setSyncInterval(settings.value("LOGFILE_SYNC_INTERVAL", m_logWriter->syncInterval()).toInt());
     // Enable logging
     enableLogging(settings.value("LOGGING_ENABLED", m_loggingEnabled).toBool());
 
@@ -130,6 +141,7 @@ void MAVLinkProtocol::storeSettings()
     settings.setValue("LOGGING_ENABLED", m_loggingEnabled);
     settings.setValue("VERSION_CHECK_ENABLED", m_enable_version_check);
     settings.setValue("MULTIPLEXING_ENABLED", m_multiplexingEnabled);
+    settings.setValue("ADAPTIVE_RATES_ENABLED", m_adaptiveRatesEnabled);
     settings.setValue("GCS_SYSTEM_ID", systemId);
     settings.setValue("GCS_AUTH_KEY", m_authKey);
     settings.setValue("GCS_AUTH_ENABLED", m_authEnabled);
@@ -138,6 +150,8 @@ void MAVLinkProtocol::storeSettings()
         // Logfile exists, store the name
         settings.setValue("LOGFILE_NAME", m_logfile->fileName());
     }
+    settings.setValue("LOGFILE_FLUSH_INTERVAL", m_logWriter->flushInterval());
+    settings.setValue("LOGFILE_SYNC_INTERVAL", m_logWriter->syncInterval());
     // Parameter interface settings
     settings.setValue("PARAMETER_RETRANSMISSION_TIMEOUT", m_paramRetransmissionTimeout);
     settings.setValue("PARAMETER_REWRITE_TIMEOUT", m_paramRewriteTimeout);
@@ -150,6 +164,17 @@ void MAVLinkProtocol::storeSettings()
 MAVLinkProtocol::~MAVLinkProtocol()
 {
     storeSettings();
+
+    // Tell the event loop to exit
+    quit();
+    // Wait for it to exit, nothing is queued for the log anymore after this
+    wait();
+
+    // Write out what is still queued before closing the file
+    m_logWriter->stopLogging();
+    delete m_logWriter;
+    m_logWriter = NULL;
+
     if (m_logfile)
     {
         if (m_logfile->isOpen())
@@ -161,35 +186,69 @@ MAVLinkProtocol::~MAVLinkProtocol()
         m_logfile = NULL;
     }
 
-    // Tell the thread to exit
-    _should_exit = true;
-    // Wait for it to exit
-    wait();
+    // The parsers must not post any more messages
+    m_parserThreadPool.waitForDone();
+    foreach (LinkState* state, m_linkStates.values() + m_retiredLinkStates)
+    {
+        delete state->parser;
+        delete state->transmitQueue;
+        delete state;
+    }
+    m_linkStates.clear();
+    m_retiredLinkStates.clear();
+
+    // Nothing is received anymore
+    delete m_timeSync;
+    m_timeSync = NULL;
+
+    for (int sysid = 0; sysid < 256; sysid++)
+    {
+        foreach (const MessageSubscription& subscription, m_subscriptions[sysid])
+        {
+            if (subscription.target != subscription.receiver)
+            {
+                subscription.target->deleteLater();
+            }
+        }
+    }
+
+    // Messages still queued to receivers keep the pool alive
+    m_messagePool->release();
 }
 
 /**
  * @brief Runs the thread
  *
+ * The protocol is driven by its event loop: received bytes and all other
+ * queued slot calls are dispatched as soon as they arrive, while the thread
+ * sleeps when there is nothing to do.
  **/
 void MAVLinkProtocol::run()
 {
+    // Created here so the timer lives in and fires on the protocol thread
     heartbeatTimer = new QTimer();
-    heartbeatTimer->moveToThread(this);
     // Start heartbeat timer, emitting a heartbeat at the configured rate
     connect(heartbeatTimer, SIGNAL(timeout()), this, SLOT(sendHeartbeat()));
-    heartbeatTimer->start(1000/heartbeatRate);
-
-    while(!_should_exit) {
-
-        if (isFinished()) {
-            delete heartbeatTimer;
-            qDebug() << "MAVLINK WORKER DONE!";
-            return;
-        }
-
-        QCoreApplication::processEvents();
-        QGC::SLEEP::msleep(2);
-    }
+    heartbeatTimer->start(1000/heartbeatRate.load());
+
+    transmitTimer = new QTimer();
+    transmitTimer->setSingleShot(true);
+    connect(transmitTimer, SIGNAL(timeout()), this, SLOT(transmitQueuedMessages()));
+
+    // One request a second keeps the offset fresh and gives the filter enough round trips to choose from
+    timeSyncTimer = new QTimer();
+    connect(timeSyncTimer, SIGNAL(timeout()), this, SLOT(sendTimeSync()));
+    timeSyncTimer->start(1000);
+
+    exec();
+
+    delete heartbeatTimer;
+    heartbeatTimer = NULL;
+    delete transmitTimer;
+    transmitTimer = NULL;
+    delete timeSyncTimer;
+    timeSyncTimer = NULL;
+    qDebug() << "MAVLINK WORKER DONE!";
 }
 
 QString MAVLinkProtocol::getLogfileName()
@@ -206,12 +265,92 @@ QString MAVLinkProtocol::getLogfileName()
 
 void MAVLinkProtocol::resetMetadataForLink(const LinkInterface *link)
 {
-    int linkId = link->getId();
-    totalReceiveCounter[linkId] = 0;
-    totalLossCounter[linkId] = 0;
-    totalErrorCounter[linkId] = 0;
-    currReceiveCounter[linkId] = 0;
-    currLossCounter[linkId] = 0;
+    // The link was added to the protocol, multiplexing forwards to it from now on.
+    // The router is only used on the protocol thread.
+    QMetaObject::invokeMethod(this, "routerAddLink", Qt::QueuedConnection, Q_ARG(LinkInterface*, const_cast<LinkInterface*>(link)));
+
+    {
+        // A link removed before may be added again
+        QWriteLocker locker(&m_linkStatesLock);
+        m_removedLinks.remove(link);
+    }
+    LinkState* state = linkState(link);
+    const_cast<LinkInterface*>(link)->getStatistics().reset();
+    state->currReceiveCounter = 0;
+    state->currLossCounter = 0;
+}
+
+/**
+ * The state is created on first use and kept until the link is removed. It
+ * is deleted on the protocol thread, so there the returned pointer stays
+ * valid without holding the lock.
+ * @param link The link to get the receive state for
+ **/
+MAVLinkProtocol::LinkState* MAVLinkProtocol::linkState(const LinkInterface* link)
+{
+    {
+        QReadLocker locker(&m_linkStatesLock);
+        LinkState* state = m_linkStates.value(link);
+        if (state)
+        {
+            return state;
+        }
+    }
+
+    QWriteLocker locker(&m_linkStatesLock);
+    if (m_removedLinks.contains(link))
+    {
+        return NULL;
+    }
+
+    LinkState*& state = m_linkStates[link];
+    if (!state)
+    {
+        state = new LinkState;
+        state->parser = new MAVLinkParser(const_cast<LinkInterface*>(link), this, m_messagePool, &m_parserThreadPool);
+        state->transmitQueue = new MAVLinkTransmitQueue(const_cast<LinkInterface*>(link));
+        state->currReceiveCounter = 0;
+        state->currLossCounter = 0;
+    }
+    return state;
+}
+
+/**
+ * @param link The link to get the receive state for
+ * @param locker Holds the lock for reading on entry and on return
+ **/
+MAVLinkProtocol::LinkState* MAVLinkProtocol::lockedLinkState(const LinkInterface* link, QReadLocker& locker)
+{
+    LinkState* state = m_linkStates.value(link);
+    if (!state)
+    {
+        locker.unlock();
+        linkState(link);
+        locker.relock();
+        state = m_linkStates.value(link);
+    }
+    return state;
+}
+
+qint32 MAVLinkProtocol::getReceivedPacketCount(const LinkInterface *link) const
+{
+    return link->getStatistics().framesReceived();
+}
+
+qint32 MAVLinkProtocol::getParsingErrorCount(const LinkInterface *link) const
+{
+    return link->getStatistics().crcErrors();
+}
+
+qint32 MAVLinkProtocol::getDroppedPacketCount(const LinkInterface *link) const
+{
+    return link->getStatistics().sequenceGaps();
+}
+
+MAVLinkTransmitQueue* MAVLinkProtocol::getTransmitQueue(const LinkInterface *link)
+{
+    LinkState* state = linkState(link);
+    return state ? state->transmitQueue : NULL;
 }
 
 void MAVLinkProtocol::linkStatusChanged(bool connected)
@@ -233,230 +372,494 @@ void MAVLinkProtocol::linkStatusChanged(bool connected)
 }
 
 /**
- * This method parses all incoming bytes and constructs a MAVLink packet.
- * It can handle multiple links in parallel, as each link has it's own buffer/
- * parsing state machine.
+ * This method hands all incoming bytes to the parser of the link. The links
+ * are parsed in parallel on the parser thread pool, each parser holds a
+ * partially received frame between calls. The decoded messages come back
+ * in order through receiveMessages().
+ *
+ * The links call this directly from their read path, so the receive time
+ * of the messages is taken when the bytes come off the link and not after
+ * a hop through the event queue of the protocol thread.
  * @param link The interface to read from
  * @see LinkInterface
  **/
 void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
 {
-//    receiveMutex.lock();
-    mavlink_message_t message;
-    mavlink_status_t status;
-
-    // Cache the link ID for common use.
-    int linkId = link->getId();
-
-    static int mavlink09Count = 0;
-    static int nonmavlinkCount = 0;
-    static bool decodedFirstPacket = false;
-    static bool warnedUser = false;
-    static bool checkedUserNonMavlink = false;
-    static bool warnedUserNonMavlink = false;
+    quint64 receiveUsecs = QGC::groundTimeUsecs();
+    {
+        QReadLocker locker(&m_linkStatesLock);
+        LinkState* state = lockedLinkState(link, locker);
+        if (!state)
+        {
+            // Removed, the link is about to be deleted
+            return;
+        }
+        state->parser->parseBytes(b, receiveUsecs);
+    }
 
-    // FIXME: Add check for if link->getId() >= MAVLINK_COMM_NUM_BUFFERS
-    for (int position = 0; position < b.size(); position++) {
-        unsigned int decodeState = mavlink_parse_char(linkId, (uint8_t)(b[position]), &message, &status);
+    // The non-MAVLink heuristics are only of interest until the first packet was decoded
+    if (!m_decodedFirstPacket.load())
+    {
+        QMetaObject::invokeMethod(this, "checkNonMAVLinkBytes", Qt::QueuedConnection, Q_ARG(LinkInterface*, link), Q_ARG(QByteArray, b));
+    }
+}
 
-        if ((uint8_t)b[position] == 0x55) mavlink09Count++;
-        if ((mavlink09Count > 100) && !decodedFirstPacket && !warnedUser)
+/**
+ * Runs on the protocol thread.
+ * @param link The interface the bytes were read from
+ * @param b The bytes as handed to the parser
+ **/
+void MAVLinkProtocol::checkNonMAVLinkBytes(LinkInterface* link, QByteArray b)
+{
+    if (!m_decodedFirstPacket.load())
+    {
+        m_mavlink09Count += b.count((char)0x55);
+        if ((m_mavlink09Count > 100) && !m_warnedUser)
         {
-            warnedUser = true;
+            m_warnedUser = true;
             // Obviously the user tries to use a 0.9 autopilot
             // with QGroundControl built for version 1.0
             emit protocolStatusMessage("MAVLink Version or Baud Rate Mismatch", "Your MAVLink device seems to use the deprecated version 0.9, while QGroundControl only supports version 1.0+. Please upgrade the MAVLink version of your autopilot. If your autopilot is using version 1.0, check if the baud rates of QGroundControl and your autopilot are the same.");
         }
+    }
 
-        if (decodeState == 0 && !decodedFirstPacket)
+    if (!m_decodedFirstPacket.load())
+    {
+        m_nonmavlinkCount += b.size();
+        if (m_nonmavlinkCount > 2000 && !m_warnedUserNonMavlink)
         {
-            nonmavlinkCount++;
-            if (nonmavlinkCount > 2000 && !warnedUserNonMavlink)
+            //2000 bytes with no mavlink message. Are we connected to a mavlink capable device?
+            if (!m_checkedUserNonMavlink)
             {
-                //2000 bytes with no mavlink message. Are we connected to a mavlink capable device?
-                if (!checkedUserNonMavlink)
-                {
-                    link->requestReset();
-                    checkedUserNonMavlink = true;
-                }
-                else
-                {
-                    warnedUserNonMavlink = true;
-                    emit protocolStatusMessage("MAVLink Baud Rate Mismatch", "Please check if the baud rates of QGroundControl and your autopilot are the same.");
-                }
+                link->requestReset();
+                m_checkedUserNonMavlink = true;
+            }
+            else
+            {
+                m_warnedUserNonMavlink = true;
+                emit protocolStatusMessage("MAVLink Baud Rate Mismatch", "Please check if the baud rates of QGroundControl and your autopilot are the same.");
             }
         }
-        if (decodeState == 1)
+    }
+}
+
+/**
+ * Receives the messages a parser decoded from the link, in the order they
+ * were received.
+ * @param link The interface the messages were received on
+ * @param messages The decoded messages
+ * @param parseErrors The number of frames which failed the CRC check
+ **/
+void MAVLinkProtocol::receiveMessages(LinkInterface* link, QVector<MAVLinkMessage> messages, int parseErrors)
+{
+    LinkState* state = linkState(link);
+    if (!state)
+    {
+        // Posted before the link was removed, it may be deleted already
+        return;
+    }
+    link->getStatistics().logCrcErrors(parseErrors);
+
+    if (!messages.isEmpty())
+    {
+        m_decodedFirstPacket.store(1);
+    }
+
+    for (int i = 0; i < messages.size(); i++)
+    {
+        handleMessage(link, state, messages[i]);
+    }
+}
+
+/**
+ * Processes a single message which passed the CRC check: answers pings, logs
+ * the packet, creates the UAS on its first heartbeat, tracks sequence loss
+ * and finally emits the message to the rest of the application.
+ * @param link The interface the message was received on
+ * @param state The receive state of the link
+ * @param messageRef The decoded message
+ **/
+void MAVLinkProtocol::handleMessage(LinkInterface* link, LinkState* state, const MAVLinkMessage& messageRef)
+{
+    const mavlink_message_t& message = *messageRef;
+
+    if(message.msgid == MAVLINK_MSG_ID_PING)
+    {
+        // process ping requests (tgt_system and tgt_comp must be zero)
+        mavlink_ping_t ping;
+        mavlink_msg_ping_decode(&message, &ping);
+        if(!ping.target_system && !ping.target_component)
+        {
+            mavlink_message_t msg;
+            mavlink_msg_ping_pack(getSystemId(), getComponentId(), &msg, ping.time_usec, ping.seq, message.sysid, message.compid);
+            sendMessage(msg);
+        }
+    }
+
+#ifdef MAVLINK_MSG_ID_TIMESYNC
+    if (message.msgid == MAVLINK_MSG_ID_TIMESYNC)
+    {
+        mavlink_timesync_t timesync;
+        mavlink_msg_timesync_decode(&message, &timesync);
+        if (timesync.tc1 == 0)
         {
-            decodedFirstPacket = true;
+            // Request from the vehicle, answered right away on the link it came from
+            mavlink_message_t msg;
+            mavlink_msg_timesync_pack(getSystemId(), getComponentId(), &msg, QGC::groundTimeUsecs() * 1000, timesync.ts1);
+            sendMessage(link, msg);
+        }
+        else if (m_timeSyncRequests.contains((quint64)timesync.ts1))
+        {
+            // Reply to our request, ts1 is the ground time we sent it at. Replies to other
+            // ground stations seen through the router echo timestamps we never sent.
+            quint64 receiveUsecs = messageRef.receiveUsecs() ? messageRef.receiveUsecs() : QGC::groundTimeUsecs();
+            m_timeSync->addRoundTrip(message.sysid, timesync.ts1 / 1000, timesync.tc1 / 1000, receiveUsecs);
+        }
+    }
+#endif
+
+    if (message.msgid == MAVLINK_MSG_ID_SYSTEM_TIME)
+    {
+        // Synchronizes the vehicles which don't answer TIMESYNC
+        quint64 receiveUsecs = messageRef.receiveUsecs() ? messageRef.receiveUsecs() : QGC::groundTimeUsecs();
+        m_timeSync->addOneWay(message.sysid, (quint64)mavlink_msg_system_time_get_time_boot_ms(&message) * 1000, receiveUsecs);
+    }
+
+    if(message.msgid == MAVLINK_MSG_ID_RADIO_STATUS)
+    {
+        // process telemetry status message
+        mavlink_radio_status_t rstatus;
+        mavlink_msg_radio_status_decode(&message, &rstatus);
 
-            if(message.msgid == MAVLINK_MSG_ID_PING)
+        emit radioStatusChanged(link, rstatus.rxerrors, rstatus.fixed, rstatus.rssi, rstatus.remrssi,
+            rstatus.txbuf, rstatus.noise, rstatus.remnoise);
+
+        // Keep the radio buffer from filling up, which would delay everything by seconds
+        if (m_adaptiveRatesEnabled)
+        {
+            QList<mavlink_message_t> requests = m_rateController.updateRadioStatus(link, rstatus.txbuf, getSystemId(), getComponentId());
+            foreach (const mavlink_message_t& request, requests)
             {
-                // process ping requests (tgt_system and tgt_comp must be zero)
-                mavlink_ping_t ping;
-                mavlink_msg_ping_decode(&message, &ping);
-                if(!ping.target_system && !ping.target_component)
-                {
-                    mavlink_message_t msg;
-                    mavlink_msg_ping_pack(getSystemId(), getComponentId(), &msg, ping.time_usec, ping.seq, message.sysid, message.compid);
-                    sendMessage(msg);
-                }
+                transmitMessage(link, request);
             }
+        }
+    }
 
-            if(message.msgid == MAVLINK_MSG_ID_RADIO_STATUS)
-            {
-                // process telemetry status message
-                mavlink_radio_status_t rstatus;
-                mavlink_msg_radio_status_decode(&message, &rstatus);
+    if (message.msgid == MAVLINK_MSG_ID_DATA_STREAM)
+    {
+        mavlink_data_stream_t stream;
+        mavlink_msg_data_stream_decode(&message, &stream);
+        m_rateController.updateStreamRate(message.sysid, stream.stream_id, stream.on_off ? stream.message_rate : 0);
+    }
 
-                emit radioStatusChanged(link, rstatus.rxerrors, rstatus.fixed, rstatus.rssi, rstatus.remrssi,
-                    rstatus.txbuf, rstatus.noise, rstatus.remnoise);
-            }
+    // Vehicles heard on a link get their stream rates adapted to its capacity
+    if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT && mavlink_msg_heartbeat_get_type(&message) != MAV_TYPE_GCS)
+    {
+        m_rateController.addSystem(link, state->transmitQueue, message.sysid);
+    }
+
+    // Log data
+    if (m_loggingEnabled && m_logWriter->isRunning())
+    {
+        // The timestamp is the UTC ground time at which the message arrived, in microseconds.
+        // Only queued here, the log writer thread does the disk access
+        m_logWriter->logMessage(messageRef.receiveUsecs(), message);
+    }
+
+    // ORDER MATTERS HERE!
+    // If the matching UAS object does not yet exist, it has to be created
+    // before emitting the packetReceived signal
+
+    UASInterface* uas = UASManager::instance()->getUASForId(message.sysid);
+
+    // Check and (if necessary) create UAS object
+    if (uas == NULL && message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
+    {
+        // ORDER MATTERS HERE!
+        // The UAS object has first to be created and connected,
+        // only then the rest of the application can be made aware
+        // of its existence, as it only then can send and receive
+        // it's first messages.
+
+        // Check if the UAS has the same id like this system
+        if (message.sysid == getSystemId())
+        {
+            emit protocolStatusMessage(tr("SYSTEM ID CONFLICT!"), tr("Warning: A second system is using the same system id (%1)").arg(getSystemId()));
+        }
+
+        // Create a new UAS based on the heartbeat received
+        // Todo dynamically load plugin at run-time for MAV
+        // WIKISEARCH:AUTOPILOT_TYPE_INSTANTIATION
 
-            // Log data
-            if (m_loggingEnabled && m_logfile)
+        // First create new UAS object
+        // Decode heartbeat message
+        mavlink_heartbeat_t heartbeat;
+        // Reset version field to 0
+        heartbeat.mavlink_version = 0;
+        mavlink_msg_heartbeat_decode(&message, &heartbeat);
+
+        // Check if the UAS has a different protocol version
+        if (m_enable_version_check && (heartbeat.mavlink_version != MAVLINK_VERSION))
+        {
+            // Bring up dialog to inform user
+            if (!versionMismatchIgnore)
             {
-                uint8_t buf[MAVLINK_MAX_PACKET_LEN+sizeof(quint64)];
-
-                // Write the uint64 time in microseconds in big endian format before the message.
-                // This timestamp is saved in UTC time. We are only saving in ms precision because
-                // getting more than this isn't possible with Qt without a ton of extra code.
-                quint64 time = (quint64)QDateTime::currentMSecsSinceEpoch() * 1000;
-                qToBigEndian(time, buf);
-
-                // Then write the message to the buffer
-                int len = mavlink_msg_to_send_buffer(buf + sizeof(quint64), &message);
-
-                // Determine how many bytes were written by adding the timestamp size to the message size
-                len += sizeof(quint64);
-
-                // Now write this timestamp/message pair to the log.
-                QByteArray b((const char*)buf, len);
-                if(m_logfile->write(b) != len)
-                {
-                    // If there's an error logging data, raise an alert and stop logging.
-                    emit protocolStatusMessage(tr("MAVLink Logging failed"), tr("Could not write to file %1, disabling logging.").arg(m_logfile->fileName()));
-                    enableLogging(false);
-                }
+                emit protocolStatusMessage(tr("The MAVLink protocol version on the MAV and QGroundControl mismatch!"),
+                                           tr("It is unsafe to use different MAVLink versions. QGroundControl therefore refuses to connect to system %1, which sends MAVLink version %2 (QGroundControl uses version %3).").arg(message.sysid).arg(heartbeat.mavlink_version).arg(MAVLINK_VERSION));
+                versionMismatchIgnore = true;
             }
 
-            // ORDER MATTERS HERE!
-            // If the matching UAS object does not yet exist, it has to be created
-            // before emitting the packetReceived signal
+            // Ignore this message and continue gracefully
+            return;
+        }
 
-            UASInterface* uas = UASManager::instance()->getUASForId(message.sysid);
+        // Create a new UAS object
+        uas = QGCMAVLinkUASFactory::createUAS(this, link, message.sysid, &heartbeat);
 
-            // Check and (if necessary) create UAS object
-            if (uas == NULL && message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
-            {
-                // ORDER MATTERS HERE!
-                // The UAS object has first to be created and connected,
-                // only then the rest of the application can be made aware
-                // of its existence, as it only then can send and receive
-                // it's first messages.
-
-                // Check if the UAS has the same id like this system
-                if (message.sysid == getSystemId())
-                {
-                    emit protocolStatusMessage(tr("SYSTEM ID CONFLICT!"), tr("Warning: A second system is using the same system id (%1)").arg(getSystemId()));
-                }
-
-                // Create a new UAS based on the heartbeat received
-                // Todo dynamically load plugin at run-time for MAV
-                // WIKISEARCH:AUTOPILOT_TYPE_INSTANTIATION
-
-                // First create new UAS object
-                // Decode heartbeat message
-                mavlink_heartbeat_t heartbeat;
-                // Reset version field to 0
-                heartbeat.mavlink_version = 0;
-                mavlink_msg_heartbeat_decode(&message, &heartbeat);
-
-                // Check if the UAS has a different protocol version
-                if (m_enable_version_check && (heartbeat.mavlink_version != MAVLINK_VERSION))
-                {
-                    // Bring up dialog to inform user
-                    if (!versionMismatchIgnore)
-                    {
-                        emit protocolStatusMessage(tr("The MAVLink protocol version on the MAV and QGroundControl mismatch!"),
-                                                   tr("It is unsafe to use different MAVLink versions. QGroundControl therefore refuses to connect to system %1, which sends MAVLink version %2 (QGroundControl uses version %3).").arg(message.sysid).arg(heartbeat.mavlink_version).arg(MAVLINK_VERSION));
-                        versionMismatchIgnore = true;
-                    }
-
-                    // Ignore this message and continue gracefully
-                    continue;
-                }
-
-                // Create a new UAS object
-                uas = QGCMAVLinkUASFactory::createUAS(this, link, message.sysid, &heartbeat);
+    }
 
-            }
+    // Increase receive counter
+    link->getStatistics().logFrameReceived(message.len + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+    state->currReceiveCounter++;
 
-            // Increase receive counter
-            totalReceiveCounter[linkId]++;
-            currReceiveCounter[linkId]++;
+    // Sequence numbers are tracked per link, the same system may be received
+    // over several links, e.g. redundant radios, which would look like loss.
+    int seqKey = (message.sysid << 8) | message.compid;
+    QHash<int, int>::iterator lastSeq = state->lastSequence.find(seqKey);
 
-            // Determine what the next expected sequence number is, accounting for
-            // never having seen a message for this system/component pair.
-            int lastSeq = lastIndex[message.sysid][message.compid];
-            int expectedSeq = (lastSeq == -1) ? message.seq : (lastSeq + 1);
+    if (lastSeq != state->lastSequence.end())
+    {
+        // Determine how many messages were skipped, the sequence number wraps around after 255
+        int lostMessages = (message.seq - *lastSeq - 1) & 0xFF;
 
-            // And if we didn't encounter that sequence number, record the error
-            if (message.seq != expectedSeq)
-            {
+        // A gap of more than half the sequence range is a duplicate or out of order message
+        if (lostMessages < 128)
+        {
+            // And log how many were lost for all time and just this timestep
+            link->getStatistics().logSequenceGap(lostMessages);
+            state->currLossCounter += lostMessages;
+        }
 
-                // Determine how many messages were skipped
-                int lostMessages = message.seq - expectedSeq;
+        *lastSeq = message.seq;
+    }
+    else
+    {
+        // First message of this system/component pair on this link
+        state->lastSequence.insert(seqKey, message.seq);
+    }
 
-                // Out of order messages or wraparound can cause this, but we just ignore these conditions for simplicity
-                if (lostMessages < 0)
-                {
-                    lostMessages = 0;
-                }
+    // Update on every 32th packet
+    if (state->currReceiveCounter == 32)
+    {
+        // Calculate new loss ratio
+        // Receive loss
+        float receiveLoss = (double)state->currLossCounter/(double)(state->currReceiveCounter+state->currLossCounter);
+        receiveLoss *= 100.0f;
+        state->currLossCounter = 0;
+        state->currReceiveCounter = 0;
+        m_rateController.updateLoss(link, receiveLoss);
+        emit receiveLossChanged(message.sysid, receiveLoss);
+    }
 
-                // And log how many were lost for all time and just this timestep
-                totalLossCounter[linkId] += lostMessages;
-                currLossCounter[linkId] += lostMessages;
-            }
+    // Deliver to the receivers of this system first, this includes the UAS object
+    dispatchMessage(link, messageRef);
 
-            // And update the last sequence number for this system/component pair
-            lastIndex[message.sysid][message.compid] = expectedSeq;
+    // Receivers of all messages share the message, only the handle is copied
+    emit sharedMessageReceived(link, messageRef);
 
-            // Update on every 32th packet
-            if ((totalReceiveCounter[linkId] & 0x1F) == 0)
-            {
-                // Calculate new loss ratio
-                // Receive loss
-                float receiveLoss = (double)currLossCounter[linkId]/(double)(currReceiveCounter[linkId]+currLossCounter[linkId]);
-                receiveLoss *= 100.0f;
-                currLossCounter[linkId] = 0;
-                currReceiveCounter[linkId] = 0;
-                emit receiveLossChanged(message.sysid, receiveLoss);
-            }
+    // The by value signal copies the message for each receiver, only emit it if anybody listens
+    static const QMetaMethod messageReceivedSignal = QMetaMethod::fromSignal(&MAVLinkProtocol::messageReceived);
+    if (isSignalConnected(messageReceivedSignal))
+    {
+        emit messageReceived(link, message);
+    }
+
+    // Multiplex message if enabled, only to the links its target lives behind
+    if (m_multiplexingEnabled)
+    {
+        forwardMessage(link, message);
+    }
+}
+
+/**
+ * Queues the message on the links the router picks. The original frame,
+ * sequence number and checksum are kept as received, the transmit queue of
+ * each link shapes it like the messages of this station.
+ * @param link Link the message was received on
+ * @param message Message to forward
+ */
+void MAVLinkProtocol::forwardMessage(LinkInterface* link, const mavlink_message_t& message)
+{
+    QList<LinkInterface*> targets = m_router.routeMessage(link, message, getSystemId());
+    if (targets.isEmpty())
+    {
+        return;
+    }
+
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    int length = mavlink_msg_to_send_buffer(buffer, &message);
+
+    int nextMsecs = -1;
+    foreach (LinkInterface* target, targets)
+    {
+        LinkState* state = linkState(target);
+        if (!state || !target->isConnected())
+        {
+            continue;
+        }
+        int waitMsecs = state->transmitQueue->enqueueFrame(buffer, length);
+        if (waitMsecs >= 0 && (nextMsecs < 0 || waitMsecs < nextMsecs))
+        {
+            nextMsecs = waitMsecs;
+        }
+    }
+
+    if (nextMsecs >= 0)
+    {
+        scheduleTransmit(nextMsecs);
+    }
+}
+
+/** @param link Link which was added to the protocol */
+void MAVLinkProtocol::routerAddLink(LinkInterface* link)
+{
+    m_router.addLink(link);
+}
+
+/**
+ * Called on the thread which removed the link. Once this returns nothing
+ * writes to the link or posts messages received on it anymore, so the link
+ * may be deleted.
+ * @param link Link which was removed from the link manager
+ */
+void MAVLinkProtocol::linkRemoved(LinkInterface* link)
+{
+    LinkState* state;
+    {
+        QWriteLocker locker(&m_linkStatesLock);
+        m_removedLinks.insert(link);
+        state = m_linkStates.take(link);
+    }
+
+    // Threads which still use the state outside the protocol thread hold the lock for reading, they are done
+    if (state)
+    {
+        state->transmitQueue->detachLink();
+        state->parser->detach();
+
+        QWriteLocker locker(&m_linkStatesLock);
+        m_retiredLinkStates.append(state);
+    }
+
+    QMetaObject::invokeMethod(this, "forgetLink", Qt::QueuedConnection, Q_ARG(LinkInterface*, link));
+}
+
+/** @param link Link which was removed from the link manager, only used as a key */
+void MAVLinkProtocol::forgetLink(LinkInterface* link)
+{
+    m_router.removeLink(link);
+    m_rateController.removeLink(link);
+
+    // The protocol thread is the only one which may still hold a pointer to a retired state
+    QList<LinkState*> states;
+    {
+        QWriteLocker locker(&m_linkStatesLock);
+        states.swap(m_retiredLinkStates);
+    }
+    foreach (LinkState* state, states)
+    {
+        delete state->parser;
+        delete state->transmitQueue;
+        delete state;
+    }
+}
+
+/**
+ * Dispatch cost only depends on the number of receivers subscribed to the
+ * system the message originates from, not on the number of systems.
+ * @param link The interface the message was received on
+ * @param message The message to deliver
+ **/
+void MAVLinkProtocol::dispatchMessage(LinkInterface* link, const MAVLinkMessage& message)
+{
+    QMutexLocker locker(&m_subscriptionMutex);
+
+    // Iterate a (shallow) copy, a receiver invoked directly may change its subscriptions
+    const QVector<MessageSubscription> subscriptions = m_subscriptions[message.sysid];
+    for (int i = 0; i < subscriptions.size(); i++)
+    {
+        const MessageSubscription& subscription = subscriptions[i];
+        if (subscription.msgid == -1 || subscription.msgid == message->msgid)
+        {
+            subscription.method.invoke(subscription.target, subscription.type, Q_ARG(LinkInterface*, link), Q_ARG(MAVLinkMessage, message));
+        }
+    }
+}
 
-            // The packet is emitted as a whole, as it is only 255 - 261 bytes short
-            // kind of inefficient, but no issue for a groundstation pc.
-            // It buys as reentrancy for the whole code over all threads
-            emit messageReceived(link, message);
+void MAVLinkProtocol::subscribeSystem(int sysid, QObject* receiver, const char* member, int msgid, Qt::ConnectionType type)
+{
+    Q_ASSERT(sysid >= 0 && sysid < 256);
+    Q_ASSERT(receiver && member);
 
-            // Multiplex message if enabled
-            if (m_multiplexingEnabled)
+    // Skip the method type code the SLOT() macro prepends
+    QByteArray signature = QMetaObject::normalizedSignature(member + 1);
+    int methodIndex = receiver->metaObject()->indexOfMethod(signature.constData());
+    if (methodIndex == -1)
+    {
+        qWarning() << "MAVLinkProtocol::subscribeSystem: no such slot" << receiver->metaObject()->className() << "::" << signature;
+        return;
+    }
+
+    MessageSubscription subscription;
+    subscription.receiver = receiver;
+    subscription.target = receiver;
+    subscription.method = receiver->metaObject()->method(methodIndex);
+    subscription.msgid = msgid;
+    subscription.type = type;
+
+    if (subscription.method.parameterType(1) != qMetaTypeId<MAVLinkMessage>())
+    {
+        // Existing slot taking the message by value, call it through an adapter
+        MAVLinkMessageAdapter* adapter = new MAVLinkMessageAdapter(receiver, subscription.method);
+        subscription.target = adapter;
+        subscription.method = adapter->metaObject()->method(adapter->metaObject()->indexOfSlot("receiveMessage(LinkInterface*,MAVLinkMessage)"));
+    }
+
+    // Remove the subscription before the receiver is gone, the direct connection
+    // makes this happen in the thread which destroys the receiver
+    connect(receiver, SIGNAL(destroyed(QObject*)), this, SLOT(subscriberDestroyed(QObject*)), (Qt::ConnectionType)(Qt::DirectConnection | Qt::UniqueConnection));
+
+    QMutexLocker locker(&m_subscriptionMutex);
+    m_subscriptions[sysid].append(subscription);
+}
+
+void MAVLinkProtocol::unsubscribeSystem(int sysid, QObject* receiver)
+{
+    Q_ASSERT(sysid >= 0 && sysid < 256);
+
+    QMutexLocker locker(&m_subscriptionMutex);
+    QVector<MessageSubscription>& subscriptions = m_subscriptions[sysid];
+    for (int i = subscriptions.size() - 1; i >= 0; i--)
+    {
+        if (subscriptions[i].receiver == receiver)
+        {
+            if (subscriptions[i].target != receiver)
             {
-                // Get all links connected to this unit
-                QList<LinkInterface*> links = LinkManager::instance()->getLinksForProtocol(this);
-
-                // Emit message on all links that are currently connected
-                foreach (LinkInterface* currLink, links)
-                {
-                    // Only forward this message to the other links,
-                    // not the link the message was received on
-                    if (currLink != link) sendMessage(currLink, message, message.sysid, message.compid);
-                }
+                subscriptions[i].target->deleteLater();
             }
+            subscriptions.remove(i);
         }
     }
 }
 
+void MAVLinkProtocol::subscriberDestroyed(QObject* receiver)
+{
+    for (int sysid = 0; sysid < 256; sysid++)
+    {
+        unsubscribeSystem(sysid, receiver);
+    }
+}
+
 /**
  * @return The name of this protocol
  **/
@@ -505,19 +908,7 @@ void MAVLinkProtocol::sendMessage(mavlink_message_t message)
  */
 void MAVLinkProtocol::sendMessage(LinkInterface* link, mavlink_message_t message)
 {
-    // Create buffer
-    static uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
-    // Rewriting header to ensure correct link ID is set
-    static uint8_t messageKeys[256] = MAVLINK_MESSAGE_CRCS;
-    if (link->getId() != 0) mavlink_finalize_message_chan(&message, this->getSystemId(), this->getComponentId(), link->getId(), message.len, messageKeys[message.msgid]);
-    // Write message into buffer, prepending start sign
-    int len = mavlink_msg_to_send_buffer(buffer, &message);
-    // If link is connected
-    if (link->isConnected())
-    {
-        // Send the portion of the buffer now occupied by the message
-        link->writeBytes((const char*)buffer, len);
-    }
+    sendMessage(link, message, this->getSystemId(), this->getComponentId());
 }
 
 /**
@@ -528,18 +919,82 @@ void MAVLinkProtocol::sendMessage(LinkInterface* link, mavlink_message_t message
  */
 void MAVLinkProtocol::sendMessage(LinkInterface* link, mavlink_message_t message, quint8 systemid, quint8 componentid)
 {
-    // Create buffer
-    static uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
-    // Rewriting header to ensure correct link ID is set
-    static uint8_t messageKeys[256] = MAVLINK_MESSAGE_CRCS;
-    if (link->getId() != 0) mavlink_finalize_message_chan(&message, systemid, componentid, link->getId(), message.len, messageKeys[message.msgid]);
-    // Write message into buffer, prepending start sign
-    int len = mavlink_msg_to_send_buffer(buffer, &message);
-    // If link is connected
-    if (link->isConnected())
+    // The sequence number and checksum are assigned by the transmit queue when the
+    // message goes out on the link, messages may overtake each other by priority.
+    message.sysid = systemid;
+    message.compid = componentid;
+
+    // The rate controller scales the streams relative to the rates the user asked for
+    if (message.msgid == MAVLINK_MSG_ID_REQUEST_DATA_STREAM)
+    {
+        mavlink_request_data_stream_t request;
+        mavlink_msg_request_data_stream_decode(&message, &request);
+        int rate = !request.start_stop ? 0 : (request.req_message_rate ? request.req_message_rate : -1);
+        QMetaObject::invokeMethod(this, "setStreamRate", Qt::QueuedConnection,
+                                  Q_ARG(int, request.target_system), Q_ARG(int, request.req_stream_id), Q_ARG(int, rate));
+    }
+
+    transmitMessage(link, message);
+}
+
+/**
+ * May be called from any thread. Whatever the shaper of the link allows is
+ * written right away, the rest is sent from the protocol thread.
+ * @param link the link to send the message over
+ * @param message message to send
+ */
+void MAVLinkProtocol::transmitMessage(LinkInterface* link, const mavlink_message_t& message)
+{
+    int waitMsecs;
+    {
+        QReadLocker locker(&m_linkStatesLock);
+        LinkState* state = lockedLinkState(link, locker);
+        if (!state)
+        {
+            // Removed, the link is about to be deleted
+            return;
+        }
+        waitMsecs = state->transmitQueue->enqueue(message);
+    }
+    if (waitMsecs >= 0)
     {
-        // Send the portion of the buffer now occupied by the message
-        link->writeBytes((const char*)buffer, len);
+        QMetaObject::invokeMethod(this, "scheduleTransmit", Qt::QueuedConnection, Q_ARG(int, waitMsecs));
+    }
+}
+
+/**
+ * @param msecs time after which the first link can send again
+ */
+void MAVLinkProtocol::scheduleTransmit(int msecs)
+{
+    if (!transmitTimer->isActive() || transmitTimer->remainingTime() > msecs)
+    {
+        transmitTimer->start(msecs);
+    }
+}
+
+void MAVLinkProtocol::transmitQueuedMessages()
+{
+    // States removed meanwhile are only deleted on this thread, their queues are detached and empty
+    QList<LinkState*> states;
+    {
+        QReadLocker locker(&m_linkStatesLock);
+        states = m_linkStates.values();
+    }
+
+    int nextMsecs = -1;
+    foreach (LinkState* state, states)
+    {
+        int waitMsecs = state->transmitQueue->transmitPending();
+        if (waitMsecs >= 0 && (nextMsecs < 0 || waitMsecs < nextMsecs))
+        {
+            nextMsecs = waitMsecs;
+        }
+    }
+
+    if (nextMsecs >= 0)
+    {
+        transmitTimer->start(nextMsecs);
     }
 }
 
@@ -567,6 +1022,27 @@ void MAVLinkProtocol::sendHeartbeat()
     }
 }
 
+/**
+ * The vehicles answer with their onboard time, the round trip goes into the time sync.
+ * Not sent with a MAVLink version which does not know TIMESYNC.
+ */
+void MAVLinkProtocol::sendTimeSync()
+{
+#ifdef MAVLINK_MSG_ID_TIMESYNC
+    // Every vehicle answers the same request, so it stays valid until it falls out of the window
+    quint64 requestNsecs = QGC::groundTimeUsecs() * 1000;
+    m_timeSyncRequests.append(requestNsecs);
+    if (m_timeSyncRequests.count() > timeSyncRequestWindow)
+    {
+        m_timeSyncRequests.remove(0);
+    }
+
+    mavlink_message_t msg;
+    mavlink_msg_timesync_pack(getSystemId(), getComponentId(), &msg, 0, requestNsecs);
+    sendMessage(msg);
+#endif
+}
+
 /** @param enabled true to enable heartbeats emission at heartbeatRate, false to disable */
 void MAVLinkProtocol::enableHeartbeats(bool enabled)
 {
@@ -583,6 +1059,15 @@ void MAVLinkProtocol::enableMultiplexing(bool enabled)
     if (changed) emit multiplexingChanged(m_multiplexingEnabled);
 }
 
+void MAVLinkProtocol::enableAdaptiveRates(bool enabled)
+{
+    bool changed = false;
+    if (enabled != m_adaptiveRatesEnabled) changed = true;
+
+    m_adaptiveRatesEnabled = enabled;
+    if (changed) emit adaptiveRatesChanged(m_adaptiveRatesEnabled);
+}
+
 void MAVLinkProtocol::enableAuth(bool enable)
 {
     bool changed = false;
@@ -635,9 +1120,20 @@ void MAVLinkProtocol::setActionRetransmissionTimeout(int ms)
 
 void MAVLinkProtocol::enableLogging(bool enabled)
 {
+    // The log writer's ring has a single producer, the protocol thread. Start and stop it there,
+    // so its indices are never reset while a message is being queued.
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "enableLogging", Qt::QueuedConnection, Q_ARG(bool, enabled));
+        return;
+    }
+
     bool changed = false;
     if (enabled != m_loggingEnabled) changed = true;
 
+    // Writes out everything still queued for the current file
+    m_logWriter->stopLogging();
+
     if (enabled)
     {
         if (m_logfile && m_logfile->isOpen())
@@ -648,11 +1144,16 @@ void MAVLinkProtocol::enableLogging(bool enabled)
 
         if (m_logfile)
         {
-            if (!m_logfile->open(QIODevice::WriteOnly | QIODevice::Append))
+            // Unbuffered, the log writer already writes whole blocks
+            if (!m_logfile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered))
             {
                 emit protocolStatusMessage(tr("Opening MAVLink logfile for writing failed"), tr("MAVLink cannot log to the file %1, please choose a different file. Stopping logging.").arg(m_logfile->fileName()));
                 m_loggingEnabled = false;
             }
+            else
+            {
+                m_logWriter->startLogging(m_logfile);
+            }
         }
         else
         {
@@ -676,12 +1177,20 @@ void MAVLinkProtocol::enableLogging(bool enabled)
 
 void MAVLinkProtocol::setLogfileName(const QString& filename)
 {
+    // Restarts the log writer, see enableLogging()
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "setLogfileName", Qt::QueuedConnection, Q_ARG(QString, filename));
+        return;
+    }
+
     if (!m_logfile)
     {
         m_logfile = new QFile(filename);
     }
     else
     {
+        m_logWriter->stopLogging();
         m_logfile->flush();
         m_logfile->close();
     }
@@ -689,6 +1198,23 @@ void MAVLinkProtocol::setLogfileName(const QString& filename)
     enableLogging(m_loggingEnabled);
 }
 
+void MAVLinkProtocol::logWriteFailed(const QString& fileName)
+{
+    // If there's an error logging data, raise an alert and stop logging.
+    emit protocolStatusMessage(tr("MAVLink Logging failed"), tr("Could not write to file %1, disabling logging.").arg(fileName));
+    enableLogging(false);
+}
+
+void MAVLinkProtocol::setLogFlushInterval(int ms)
+{
+    m_logWriter->setFlushInterval(ms);
+}
+
+void MAVLinkProtocol::setLogSyncInterval(int ms)
+{
+    m_logWriter->setSyncInterval(ms);
+}
+
 void MAVLinkProtocol::enableVersionCheck(bool enabled)
 {
     m_enable_version_check = enabled;
@@ -702,12 +1228,27 @@ void MAVLinkProtocol::enableVersionCheck(bool enabled)
  */
 void MAVLinkProtocol::setHeartbeatRate(int rate)
 {
-    heartbeatRate = rate;
-    heartbeatTimer->setInterval(1000/heartbeatRate);
+    heartbeatRate.store(rate);
+
+    // The timer belongs to the protocol thread and is created there, only touch it there
+    QMetaObject::invokeMethod(this, "restartHeartbeatTimer", Qt::QueuedConnection);
+}
+
+void MAVLinkProtocol::restartHeartbeatTimer()
+{
+    if (heartbeatTimer)
+    {
+        heartbeatTimer->start(1000/heartbeatRate.load());
+    }
+}
+
+void MAVLinkProtocol::setStreamRate(int sysid, int stream, int rate)
+{
+    m_rateController.setStreamRate(sysid, stream, rate);
 }
 
 /** @return heartbeat rate in Hertz */
 int MAVLinkProtocol::getHeartbeatRate()
 {
-    return heartbeatRate;
+    return heartbeatRate.load();
 }
@@ -36,12 +36,27 @@ This file is part of the QGROUNDCONTROL project
 #include <QTimer>
 #include <QFile>
 #include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QMetaMethod>
+#include <QThreadPool>
 #include <QByteArray>
+#include <QAtomicInt>
+#include <QReadWriteLock>
+#include <QSet>
 #include "ProtocolInterface.h"
 #include "LinkInterface.h"
 #include "QGCMAVLink.h"
+#include "MAVLinkMessage.h"
+#include "MAVLinkLogWriter.h"
+#include "MAVLinkRouter.h"
+#include "MAVLinkTransmitQueue.h"
+#include "MAVLinkRateController.h"
+#include "MAVLinkTimeSync.h"
 #include "QGC.h"
 
+class MAVLinkParser;
+
 /**
  * @brief MAVLink micro air vehicle protocol reference implementation.
  *
@@ -73,6 +88,14 @@ public:
     bool loggingEnabled() const {
         return m_loggingEnabled;
     }
+    /** @brief Get the log writer, e.g. for its drop and backpressure counters */
+    const MAVLinkLogWriter* getLogWriter() const {
+        return m_logWriter;
+    }
+    /** @brief Get the clock synchronization of the vehicles, shared by everything converting onboard timestamps */
+    MAVLinkTimeSync* getTimeSync() const {
+        return m_timeSync;
+    }
     /** @brief Get protocol version check state */
     bool versionCheckEnabled() const {
         return m_enable_version_check;
@@ -81,6 +104,10 @@ public:
     bool multiplexingEnabled() const {
         return m_multiplexingEnabled;
     }
+    /** @brief Get the state of the radio status based stream rate adaption */
+    bool adaptiveRatesEnabled() const {
+        return m_adaptiveRatesEnabled;
+    }
     /** @brief Get the authentication state */
     bool getAuthEnabled() {
         return m_authEnabled;
@@ -119,32 +146,58 @@ public:
      * Retrieve a total of all successfully parsed packets for the specified link.
      * @returns -1 if this is not available for this protocol, # of packets otherwise.
      */
-    qint32 getReceivedPacketCount(const LinkInterface *link) const {
-        return totalReceiveCounter[link->getId()];
-    }
+    qint32 getReceivedPacketCount(const LinkInterface *link) const;
     /**
      * Retrieve a total of all parsing errors for the specified link.
      * @returns -1 if this is not available for this protocol, # of errors otherwise.
      */
-    qint32 getParsingErrorCount(const LinkInterface *link) const {
-        return totalErrorCounter[link->getId()];
-    }
+    qint32 getParsingErrorCount(const LinkInterface *link) const;
     /**
      * Retrieve a total of all dropped packets for the specified link.
      * @returns -1 if this is not available for this protocol, # of packets otherwise.
      */
-    qint32 getDroppedPacketCount(const LinkInterface *link) const {
-        return totalLossCounter[link->getId()];
-    }
+    qint32 getDroppedPacketCount(const LinkInterface *link) const;
+    /**
+     * @brief Get the transmit queue of a link, e.g. for its queue depth and time in queue counters
+     *
+     * The queue is created with the state of the link and deleted on the protocol thread
+     * once the link was removed from the link manager. NULL for a removed link.
+     */
+    MAVLinkTransmitQueue* getTransmitQueue(const LinkInterface *link);
     /**
      * Reset the counters for all metadata for this link.
      */
     virtual void resetMetadataForLink(const LinkInterface *link);
 
+    /**
+     * @brief Deliver the messages of a single system to a receiver.
+     *
+     * Unlike the messageReceived signal, which carries every message of every
+     * system to every connected object, a subscribed receiver is only invoked
+     * for the messages it asked for. The member needs the signature of
+     * messageReceived and is invoked like a connected slot, queued if the
+     * receiver lives in another thread. Subscriptions are dropped automatically
+     * when the receiver is destroyed.
+     *
+     * A member taking a MAVLinkMessage instead of a mavlink_message_t receives
+     * the shared message itself. Members taking mavlink_message_t are served
+     * through a MAVLinkMessageAdapter, which copies the message once.
+     *
+     * @param sysid The system whose messages are delivered
+     * @param receiver The object to deliver the messages to
+     * @param member The slot to invoke, specified with the SLOT() macro
+     * @param msgid Only deliver messages with this id, -1 for all messages of the system
+     * @param type How the member is invoked. A receiver which does its own queueing asks for
+     *        Qt::DirectConnection, its member is then called on the receiving thread.
+     */
+    void subscribeSystem(int sysid, QObject* receiver, const char* member, int msgid = -1, Qt::ConnectionType type = Qt::AutoConnection);
+    /** @brief Remove all subscriptions of a receiver to a system */
+    void unsubscribeSystem(int sysid, QObject* receiver);
+
     void run();
 
 public slots:
-    /** @brief Receive bytes from a communication interface */
+    /** @brief Receive bytes from a communication interface, called directly on the thread which read them */
     void receiveBytes(LinkInterface* link, QByteArray b);
     void linkStatusChanged(bool connected);
     /** @brief Send MAVLink message through serial interface */
@@ -167,6 +220,9 @@ public slots:
     /** @brief Enabled/disable packet multiplexing */
     void enableMultiplexing(bool enabled);
 
+    /** @brief Enable/disable adapting the stream rates of the vehicles to the radio link capacity */
+    void enableAdaptiveRates(bool enabled);
+
     /** @brief Enable / disable parameter retransmission */
     void enableParamGuard(bool enabled);
 
@@ -185,6 +241,12 @@ public slots:
     /** @brief Set log file name */
     void setLogfileName(const QString& filename);
 
+    /** @brief Set the interval in which the log file is flushed */
+    void setLogFlushInterval(int ms);
+
+    /** @brief Set the interval in which the log file is synced to disk, 0 to only sync when logging stops */
+    void setLogSyncInterval(int ms);
+
     /** @brief Enable / disable version check */
     void enableVersionCheck(bool enabled);
 
@@ -204,41 +266,117 @@ public slots:
     /** @brief Store protocol settings */
     void storeSettings();
 
+protected slots:
+    /** @brief Warn about devices which don't speak MAVLink 1.0, until the first packet was decoded */
+    void checkNonMAVLinkBytes(LinkInterface* link, QByteArray b);
+    /** @brief Receive the messages decoded by the parser of a link */
+    void receiveMessages(LinkInterface* link, QVector<MAVLinkMessage> messages, int parseErrors);
+    /** @brief Report a failed log write and stop logging */
+    void logWriteFailed(const QString& fileName);
+    /** @brief Forward multiplexed messages to this link */
+    void routerAddLink(LinkInterface* link);
+    /** @brief Stop using a link which is about to be deleted, called directly by the link manager */
+    void linkRemoved(LinkInterface* link);
+    /** @brief Stop forwarding to and adapting the rates of a removed link and delete its state, runs on the protocol thread */
+    void forgetLink(LinkInterface* link);
+    /** @brief Send the messages held back by the transmit queues in msecs milliseconds at the latest */
+    void scheduleTransmit(int msecs);
+    /** @brief Send the messages held back by the transmit queues of all links */
+    void transmitQueuedMessages();
+    /** @brief Send a clock synchronization request to all vehicles */
+    void sendTimeSync();
+    /** @brief Restart the heartbeat timer at the current heartbeat rate, runs on the protocol thread */
+    void restartHeartbeatTimer();
+    /** @brief Remember a stream rate requested by the user as the unthrottled rate of the stream */
+    void setStreamRate(int sysid, int stream, int rate);
+    /** @brief Drop all subscriptions of a receiver which is being destroyed */
+    void subscriberDestroyed(QObject* receiver);
+
 protected:
+    /** @brief Receive state of one link, only used by the protocol thread except for the parser and the transmit queue. The totals are kept in the LinkStatistics of the link. */
+    struct LinkState {
+        MAVLinkParser*  parser;                 ///< Frames the bytes of the link on the parser thread pool
+        MAVLinkTransmitQueue* transmitQueue;    ///< Prioritizes and shapes the messages sent on the link, thread safe
+        QHash<int, int> lastSequence;           ///< Last received sequence number, keyed by system id << 8 | component id
+        int currReceiveCounter;     ///< Received messages during this sample time window. Used for calculating loss %.
+        int currLossCounter;        ///< Lost messages during this sample time window. Used for calculating loss %.
+    };
+
+    /** @brief Get the receive state of a link, creating it if needed. NULL if the link was removed. Only valid on the protocol thread */
+    LinkState* linkState(const LinkInterface* link);
+    /** @brief Like linkState(), for use outside the protocol thread. The state is valid while the locker holds the lock */
+    LinkState* lockedLinkState(const LinkInterface* link, QReadLocker& locker);
+    /** @brief Queue a message on a link and arrange for the messages held back by the shaper to be sent */
+    void transmitMessage(LinkInterface* link, const mavlink_message_t& message);
+    /** @brief Queue a received message on the links its target lives behind, protocol thread only */
+    void forwardMessage(LinkInterface* link, const mavlink_message_t& message);
+    /** @brief Process a single message which was decoded from a link */
+    void handleMessage(LinkInterface* link, LinkState* state, const MAVLinkMessage& messageRef);
+    /** @brief Invoke the receivers subscribed to the system and id of the message */
+    void dispatchMessage(LinkInterface* link, const MAVLinkMessage& message);
+
+    /** @brief A receiver subscribed to the messages of one system */
+    struct MessageSubscription {
+        QObject*    receiver;
+        QObject*    target;     ///< The receiver itself or the adapter which calls it
+        QMetaMethod method;     ///< Method of target, takes a MAVLinkMessage
+        int         msgid;      ///< Message id to deliver, -1 for all messages
+        Qt::ConnectionType type;
+    };
+
     QTimer *heartbeatTimer;    ///< Timer to emit heartbeats
-    int heartbeatRate;         ///< Heartbeat rate, controls the timer interval
+    QTimer *transmitTimer;     ///< Single shot timer to send the messages held back by the transmit queues
+    QTimer *timeSyncTimer;     ///< Timer to send the clock synchronization requests
+    QAtomicInt heartbeatRate;  ///< Heartbeat rate, controls the timer interval. Set from any thread
     bool m_heartbeatsEnabled;  ///< Enabled/disable heartbeat emission
     bool m_multiplexingEnabled; ///< Enable/disable packet multiplexing
+    MAVLinkRouter m_router;     ///< Forwards multiplexed messages along learned routes, protocol thread only
+    bool m_adaptiveRatesEnabled; ///< Enable/disable adapting the stream rates to the radio status
+    MAVLinkRateController m_rateController; ///< Adapts the stream rates to the radio status, protocol thread only
     bool m_authEnabled;        ///< Enable authentication token broadcast
     QString m_authKey;         ///< Authentication key
     bool m_loggingEnabled;     ///< Enable/disable packet logging
     QFile* m_logfile;           ///< Logfile
+    MAVLinkLogWriter* m_logWriter; ///< Writes the logfile from its own thread
+    MAVLinkTimeSync* m_timeSync;    ///< Onboard to ground clock offsets, thread safe
+    QVector<quint64> m_timeSyncRequests;    ///< Timestamps of the last TIMESYNC requests sent, oldest first, protocol thread only
+    static const int timeSyncRequestWindow = 16;    ///< Requests replies are accepted to, covers the longest round trip accepted
     bool m_enable_version_check; ///< Enable checking of version match of MAV and QGC
     int m_paramRetransmissionTimeout; ///< Timeout for parameter retransmission
     int m_paramRewriteTimeout;    ///< Timeout for sending re-write request
     bool m_paramGuardEnabled;       ///< Parameter retransmission/rewrite enabled
     bool m_actionGuardEnabled;       ///< Action request retransmission enabled
     int m_actionRetransmissionTimeout; ///< Timeout for parameter retransmission
-    QMutex receiveMutex;        ///< Mutex to protect receiveBytes function
-    int lastIndex[256][256];    ///< Store the last received sequence ID for each system/componenet pair
-    int totalReceiveCounter[MAVLINK_COMM_NUM_BUFFERS];    ///< The total number of successfully received messages
-    int totalLossCounter[MAVLINK_COMM_NUM_BUFFERS];       ///< Total messages lost during transmission.
-    int totalErrorCounter[MAVLINK_COMM_NUM_BUFFERS];      ///< Total count of all parsing errors. Generally <= totalLossCounter.
-    int currReceiveCounter[MAVLINK_COMM_NUM_BUFFERS];     ///< Received messages during this sample time window. Used for calculating loss %.
-    int currLossCounter[MAVLINK_COMM_NUM_BUFFERS];        ///< Lost messages during this sample time window. Used for calculating loss %.
+    QHash<const LinkInterface*, LinkState*> m_linkStates;  ///< State of each link from its first use until it is removed
+    QSet<const LinkInterface*> m_removedLinks;  ///< No state is created for these until they are added to the protocol again
+    QList<LinkState*> m_retiredLinkStates;  ///< States of removed links, deleted on the protocol thread
+    mutable QReadWriteLock m_linkStatesLock;    ///< Protects the above. Held for reading while a state is used outside the protocol thread. Recursive, writing to a link may loop back to receiveBytes
+    QThreadPool m_parserThreadPool;         ///< Runs the parsers, links are parsed in parallel
+    QVector<MessageSubscription> m_subscriptions[256];  ///< Message subscriptions, indexed by system id
+    QMutex m_subscriptionMutex;     ///< Protects m_subscriptions, held while dispatching so receivers can't vanish. Recursive, receivers may be invoked directly
+    MAVLinkMessagePool* m_messagePool;  ///< Storage of the received messages, shared with all receivers
+    int m_mavlink09Count;           ///< Number of 0x55 (MAVLink 0.9 start sign) bytes received before the first packet
+    int m_nonmavlinkCount;          ///< Number of bytes received before the first packet
+    QAtomicInt m_decodedFirstPacket;    ///< Any packet has been decoded, the non-MAVLink heuristics are done. Read by the link threads
+    bool m_warnedUser;              ///< User was warned about a MAVLink 0.9 device
+    bool m_checkedUserNonMavlink;   ///< Link was reset because only non-MAVLink data was received
+    bool m_warnedUserNonMavlink;    ///< User was warned about a baud rate mismatch
     bool versionMismatchIgnore;
     int systemId;
-    bool _should_exit;
 
 signals:
     /** @brief Message received and directly copied via signal */
     void messageReceived(LinkInterface* link, mavlink_message_t message);
+    /** @brief Message received, shared with all receivers without copying it */
+    void sharedMessageReceived(LinkInterface* link, MAVLinkMessage message);
     /** @brief Emitted if heartbeat emission mode is changed */
     void heartbeatChanged(bool heartbeats);
     /** @brief Emitted if logging is started / stopped */
     void loggingChanged(bool enabled);
     /** @brief Emitted if multiplexing is started / stopped */
     void multiplexingChanged(bool enabled);
+    /** @brief Emitted if the stream rate adaption is enabled / disabled */
+    void adaptiveRatesChanged(bool enabled);
     /** @brief Emitted if authentication support is enabled / disabled */
     void authKeyChanged(QString key);
     /** @brief Authentication changed */
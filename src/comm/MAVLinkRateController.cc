@@ -0,0 +1,196 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Adapts the telemetry stream rates and the uplink rate to the capacity of a radio link
+
+#include <math.h>
+
+#include "MAVLinkRateController.h"
+
+const double MAVLinkRateController::minimumScale = 0.1;
+
+/// Below this much free transmit buffer the rates are lowered
+static const unsigned _txbufLow = 20;
+/// Above this much free transmit buffer the rates may be raised again
+static const unsigned _txbufHigh = 90;
+/// Above this receive loss in percent the rates are lowered
+static const float _lossHigh = 10.0f;
+/// Below this receive loss in percent the rates may be raised again
+static const float _lossLow = 2.0f;
+
+/// Lower quickly to empty the radio buffer, raise slowly to find the capacity of the link
+static const double _decreaseFactor = 0.7;
+static const double _increaseStep = 0.1;
+
+/// The streams set by a request for MAV_DATA_STREAM_ALL
+static const int _streams[] = {
+    MAV_DATA_STREAM_RAW_SENSORS,
+    MAV_DATA_STREAM_EXTENDED_STATUS,
+    MAV_DATA_STREAM_RC_CHANNELS,
+    MAV_DATA_STREAM_POSITION,
+    MAV_DATA_STREAM_EXTRA1,
+    MAV_DATA_STREAM_EXTRA2,
+    MAV_DATA_STREAM_EXTRA3
+};
+
+MAVLinkRateController::MAVLinkRateController(void) :
+    _adjustInterval(1000)
+{
+
+}
+
+void MAVLinkRateController::addSystem(LinkInterface* link, MAVLinkTransmitQueue* queue, int sysid)
+{
+    Q_ASSERT(link && queue);
+
+    QHash<LinkInterface*, LinkRates>::iterator rates = _links.find(link);
+    if (rates == _links.end()) {
+        LinkRates newRates;
+        newRates.queue = queue;
+        newRates.scale = 1.0;
+        newRates.loss = 0.0f;
+        newRates.lastAdjust.invalidate();
+        rates = _links.insert(link, newRates);
+    }
+
+    if (!rates->systems.contains(sysid)) {
+        rates->systems.append(sysid);
+    }
+}
+
+void MAVLinkRateController::removeLink(LinkInterface* link)
+{
+    _links.remove(link);
+}
+
+void MAVLinkRateController::updateLoss(LinkInterface* link, float loss)
+{
+    QHash<LinkInterface*, LinkRates>::iterator rates = _links.find(link);
+    if (rates != _links.end()) {
+        rates->loss = loss;
+    }
+}
+
+void MAVLinkRateController::setStreamRate(int sysid, int stream, int rate)
+{
+    QHash<int, int>& rates = _streamRates[sysid];
+
+    if (stream == MAV_DATA_STREAM_ALL) {
+        for (size_t i=0; i<sizeof(_streams)/sizeof(_streams[0]); i++) {
+            setStreamRate(sysid, _streams[i], rate);
+        }
+    } else if (rate < 0) {
+        // The vehicle falls back to a default we don't know
+        rates.remove(stream);
+    } else {
+        rates.insert(stream, rate);
+    }
+}
+
+void MAVLinkRateController::updateStreamRate(int sysid, int stream, int rate)
+{
+    if (!_isThrottled(sysid)) {
+        setStreamRate(sysid, stream, rate);
+    }
+}
+
+int MAVLinkRateController::streamRate(int sysid, int stream) const
+{
+    return _streamRates.value(sysid).value(stream, -1);
+}
+
+double MAVLinkRateController::scale(LinkInterface* link) const
+{
+    QHash<LinkInterface*, LinkRates>::const_iterator rates = _links.find(link);
+    return rates != _links.end() ? rates->scale : 1.0;
+}
+
+QList<mavlink_message_t> MAVLinkRateController::updateRadioStatus(LinkInterface* link, unsigned txbuf, int systemId, int componentId)
+{
+    QHash<LinkInterface*, LinkRates>::iterator rates = _links.find(link);
+    if (rates == _links.end()) {
+        // No vehicle heard yet, nothing to adapt
+        return QList<mavlink_message_t>();
+    }
+
+    // Give the vehicles time to react to the last adjustment
+    if (rates->lastAdjust.isValid() && rates->lastAdjust.elapsed() < _adjustInterval) {
+        return QList<mavlink_message_t>();
+    }
+
+    double scale = rates->scale;
+    if (txbuf < _txbufLow || rates->loss > _lossHigh) {
+        scale = qMax(minimumScale, scale * _decreaseFactor);
+    } else if (txbuf > _txbufHigh && rates->loss < _lossLow) {
+        scale = qMin(1.0, scale + _increaseStep);
+    }
+
+    if (scale == rates->scale) {
+        return QList<mavlink_message_t>();
+    }
+
+    rates->scale = scale;
+    rates->lastAdjust.start();
+    return _applyScale(link, &rates.value(), systemId, componentId);
+}
+
+/// @brief Requests the scaled stream rates from all vehicles on the link and shapes the uplink
+QList<mavlink_message_t> MAVLinkRateController::_applyScale(LinkInterface* link, LinkRates* rates, int systemId, int componentId)
+{
+    // Parameter and mission transfers share the uplink of the radio with everything else
+    qint64 linkRate = link->getConnectionSpeed() / 10;
+    if (rates->scale < 1.0 && linkRate > 0) {
+        rates->queue->setRate(qMax((qint64)1, (qint64)(linkRate * rates->scale)));
+    } else {
+        rates->queue->setRate(0);
+    }
+
+    // Streams with an unknown rate are left alone, stopped streams stay stopped
+    QList<mavlink_message_t> requests;
+    foreach (int sysid, rates->systems) {
+        const QHash<int, int> streamRates = _streamRates.value(sysid);
+        for (QHash<int, int>::const_iterator stream = streamRates.constBegin(); stream != streamRates.constEnd(); ++stream) {
+            if (stream.value() <= 0) {
+                continue;
+            }
+            int rate = qMax(1, (int)floor(stream.value() * rates->scale + 0.5));
+
+            mavlink_message_t message;
+            mavlink_msg_request_data_stream_pack(systemId, componentId, &message, sysid, 0, stream.key(), rate, 1);
+            requests.append(message);
+        }
+    }
+    return requests;
+}
+
+/// @brief Returns true if a link the vehicle was heard on is throttled
+bool MAVLinkRateController::_isThrottled(int sysid) const
+{
+    for (QHash<LinkInterface*, LinkRates>::const_iterator rates = _links.constBegin(); rates != _links.constEnd(); ++rates) {
+        if (rates->scale < 1.0 && rates->systems.contains(sysid)) {
+            return true;
+        }
+    }
+    return false;
+}
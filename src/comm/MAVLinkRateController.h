@@ -0,0 +1,111 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Adapts the telemetry stream rates and the uplink rate to the capacity of a radio link
+
+#ifndef MAVLINKRATECONTROLLER_H
+#define MAVLINKRATECONTROLLER_H
+
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
+
+#include "LinkInterface.h"
+#include "MAVLinkTransmitQueue.h"
+#include "QGCMAVLink.h"
+
+/// @brief Keeps telemetry radios from saturating.
+///
+/// Radios like the SiK 3DR radios report the fill level of their transmit buffer in RADIO_STATUS. Once
+/// the buffer fills up, messages queue in the radio and the latency of the link climbs to seconds. The
+/// controller keeps a rate scale for every link which is lowered quickly when the buffer runs full or
+/// messages get lost, and raised slowly again once the buffer has room. The stream rates requested from
+/// the vehicles on the link and the rate the transmit queue of the link is shaped to follow the scale.
+///
+/// The stream rates are scaled relative to the rates the vehicle runs at on its own, as configured on the
+/// vehicle or requested by the user. Only streams whose rate is known are touched, the rest are left to
+/// the vehicle. Going back to a scale of 1.0 restores the known rates.
+///
+/// The controller is not thread safe, it is used from the MAVLinkProtocol thread only.
+class MAVLinkRateController
+{
+public:
+    MAVLinkRateController(void);
+
+    /// @brief Remembers a vehicle heard on a link, its stream rates are adapted from now on
+    void addSystem(LinkInterface* link, MAVLinkTransmitQueue* queue, int sysid);
+
+    /// @brief Forgets a link and all vehicles on it
+    void removeLink(LinkInterface* link);
+
+    /// @brief Adapts the rates of a link to a RADIO_STATUS report.
+    ///     @param txbuf Free space in the radio transmit buffer in percent
+    ///     @param systemId System id of this ground station, stream requests are sent from it
+    ///     @param componentId Component id of this ground station
+    ///     @return Stream requests to send on the link, empty if the rates did not change
+    QList<mavlink_message_t> updateRadioStatus(LinkInterface* link, unsigned txbuf, int systemId, int componentId);
+
+    /// @brief Sets the measured receive loss of a link in percent, used with the next radio status
+    void updateLoss(LinkInterface* link, float loss);
+
+    /// @brief Records a stream rate requested from a vehicle by the user, the new unthrottled rate of the stream
+    ///     @param stream Stream id, MAV_DATA_STREAM_ALL for all streams
+    ///     @param rate Rate in Hz, 0 if the stream was stopped, -1 if the vehicle picks its default rate
+    void setStreamRate(int sysid, int stream, int rate);
+
+    /// @brief Records a stream rate reported by a vehicle in DATA_STREAM.
+    ///
+    /// Ignored while a link the vehicle was heard on is throttled, the vehicle then reports the rate
+    /// requested by the controller and not its own.
+    void updateStreamRate(int sysid, int stream, int rate);
+
+    /// @brief Returns the unthrottled rate of a stream of a vehicle, -1 if not known
+    int streamRate(int sysid, int stream) const;
+
+    /// @brief Returns the current rate scale of a link, 1.0 if the link is not throttled
+    double scale(LinkInterface* link) const;
+
+    /// @brief Sets the minimum time between two adjustments of the scale of a link
+    void setAdjustInterval(int msecs) { _adjustInterval = msecs; }
+
+    static const double minimumScale;
+
+private:
+    struct LinkRates {
+        MAVLinkTransmitQueue*   queue;
+        QList<int>              systems;        ///< Vehicles heard on the link
+        double                  scale;          ///< Current rate scale, minimumScale to 1.0
+        float                   loss;           ///< Last measured receive loss in percent
+        QElapsedTimer           lastAdjust;     ///< Invalid until the first adjustment
+    };
+
+    QList<mavlink_message_t> _applyScale(LinkInterface* link, LinkRates* rates, int systemId, int componentId);
+    bool _isThrottled(int sysid) const;
+
+    QHash<LinkInterface*, LinkRates>    _links;
+    QHash<int, QHash<int, int> >        _streamRates;   ///< Unthrottled rate by stream by vehicle, unknown streams are missing
+    int                                 _adjustInterval;
+};
+
+#endif
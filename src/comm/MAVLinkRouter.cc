@@ -0,0 +1,162 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Forwards MAVLink messages between links along learned routes
+
+#include <string.h>
+
+#include "MAVLinkRouter.h"
+
+MAVLinkRouter::MAVLinkRouter(void) :
+    _duplicateCount(0)
+{
+    // Find the target fields of all messages once, so routing a message is a table lookup
+    static const mavlink_message_info_t messageInfo[256] = MAVLINK_MESSAGE_INFO;
+
+    for (int msgid = 0; msgid < 256; msgid++) {
+        _targetSystemOffset[msgid] = -1;
+        _targetComponentOffset[msgid] = -1;
+
+        const mavlink_message_info_t& info = messageInfo[msgid];
+        for (unsigned int i = 0; i < info.num_fields; i++) {
+            if (strcmp(info.fields[i].name, "target_system") == 0) {
+                _targetSystemOffset[msgid] = info.fields[i].wire_offset;
+            } else if (strcmp(info.fields[i].name, "target_component") == 0) {
+                _targetComponentOffset[msgid] = info.fields[i].wire_offset;
+            }
+        }
+    }
+}
+
+void MAVLinkRouter::addLink(LinkInterface* link)
+{
+    Q_ASSERT(link);
+
+    if (!_links.contains(link)) {
+        _links.append(link);
+    }
+}
+
+void MAVLinkRouter::removeLink(LinkInterface* link)
+{
+    _links.removeAll(link);
+
+    QHash<int, LinkInterface*>::iterator i = _routes.begin();
+    while (i != _routes.end()) {
+        if (i.value() == link) {
+            i = _routes.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+LinkInterface* MAVLinkRouter::routeFor(int sysid, int compid) const
+{
+    return _routes.value((sysid << 8) | compid, NULL);
+}
+
+QList<LinkInterface*> MAVLinkRouter::routeMessage(LinkInterface* source, const mavlink_message_t& message, int localSystemId)
+{
+    QList<LinkInterface*> targets;
+
+    // Learn where the sender lives
+    addLink(source);
+    _routes.insert((message.sysid << 8) | message.compid, source);
+    _routes.insert(message.sysid << 8, source);
+
+    if (_isDuplicate(message)) {
+        _duplicateCount++;
+        return targets;
+    }
+
+    int targetSystem;
+    int targetComponent;
+    _targetOf(message, &targetSystem, &targetComponent);
+
+    if (targetSystem == localSystemId) {
+        // For us only
+        return targets;
+    }
+
+    if (targetSystem != 0) {
+        LinkInterface* route = routeFor(targetSystem, targetComponent);
+        if (route == NULL && targetComponent != 0) {
+            route = routeFor(targetSystem, 0);
+        }
+        if (route) {
+            if (route != source) {
+                targets.append(route);
+            }
+            return targets;
+        }
+        // Target not heard of yet, it may be behind any of the links
+    }
+
+    for (int i = 0; i < _links.count(); i++) {
+        LinkInterface* link = _links[i];
+        if (link && link != source) {
+            targets.append(link);
+        }
+    }
+    return targets;
+}
+
+/// @brief Returns the system and component a message is targeted at, 0 for broadcasts
+void MAVLinkRouter::_targetOf(const mavlink_message_t& message, int* sysid, int* compid) const
+{
+    const char* payload = _MAV_PAYLOAD(&message);
+
+    *sysid = 0;
+    *compid = 0;
+    if (_targetSystemOffset[message.msgid] >= 0) {
+        *sysid = (uint8_t)payload[_targetSystemOffset[message.msgid]];
+    }
+    if (_targetComponentOffset[message.msgid] >= 0) {
+        *compid = (uint8_t)payload[_targetComponentOffset[message.msgid]];
+    }
+}
+
+/// @brief Checks whether the message is one of the last messages of its sender and remembers it if not
+bool MAVLinkRouter::_isDuplicate(const mavlink_message_t& message)
+{
+    quint64 id = message.seq | (message.msgid << 8) | ((quint64)message.checksum << 16) | Q_UINT64_C(0x100000000);
+
+    QHash<int, RecentMessages>::iterator recent = _recent.find((message.sysid << 8) | message.compid);
+    if (recent == _recent.end()) {
+        RecentMessages messages;
+        memset(&messages, 0, sizeof(messages));
+        recent = _recent.insert((message.sysid << 8) | message.compid, messages);
+    } else {
+        for (int i = 0; i < 8; i++) {
+            if (recent->ids[i] == id) {
+                return true;
+            }
+        }
+    }
+
+    recent->ids[recent->next] = id;
+    recent->next = (recent->next + 1) & 7;
+    return false;
+}
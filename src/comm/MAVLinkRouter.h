@@ -0,0 +1,88 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Forwards MAVLink messages between links along learned routes
+
+#ifndef MAVLINKROUTER_H
+#define MAVLINKROUTER_H
+
+#include <QHash>
+#include <QList>
+#include <QPointer>
+
+#include "LinkInterface.h"
+#include "QGCMAVLink.h"
+
+/// @brief Decides which links received MAVLink messages are forwarded to, like a MAVLink router.
+///
+/// The router learns which system and component lives behind which link from the messages it sees.
+/// Messages targeted at a known system or component are only forwarded to the link it lives behind,
+/// broadcasts and messages for unknown targets go to all other links. A message which arrives more than
+/// once, e.g. over redundant radios, is only forwarded the first time. The router does not write to the
+/// links itself, the caller queues the original frame on the transmit queue of each link returned.
+///
+/// The router is not thread safe, it is used from the MAVLinkProtocol thread only.
+class MAVLinkRouter
+{
+public:
+    MAVLinkRouter(void);
+
+    /// @brief Adds a link messages are forwarded to
+    void addLink(LinkInterface* link);
+
+    /// @brief Removes a link and all routes through it
+    void removeLink(LinkInterface* link);
+
+    /// @brief Learns the route to the sender of the message and returns the links to forward it to.
+    ///     @param source Link the message was received on
+    ///     @param localSystemId System id of this ground station, messages targeted at it are not forwarded
+    ///     @return Links the message has to be forwarded to, empty if none
+    QList<LinkInterface*> routeMessage(LinkInterface* source, const mavlink_message_t& message, int localSystemId);
+
+    /// @brief Returns the link a component was last heard on, NULL if unknown.
+    ///     @param compid Component id, 0 for any component of the system
+    LinkInterface* routeFor(int sysid, int compid) const;
+
+    /// @brief Number of messages not forwarded because they were already forwarded before
+    quint32 duplicateCount(void) const { return _duplicateCount; }
+
+private:
+    /// @brief Identifies the last few messages forwarded for a system/component pair
+    struct RecentMessages {
+        quint64 ids[8];     ///< Sequence number, message id and checksum, bit 32 marks a used entry
+        int     next;
+    };
+
+    bool _isDuplicate(const mavlink_message_t& message);
+    void _targetOf(const mavlink_message_t& message, int* sysid, int* compid) const;
+
+    QList< QPointer<LinkInterface> >    _links;
+    QHash<int, LinkInterface*>          _routes;    ///< Keyed by system id << 8 | component id, component 0 for the whole system
+    QHash<int, RecentMessages>          _recent;    ///< Keyed like _routes
+    qint16                              _targetSystemOffset[256];       ///< Payload offset of target_system, -1 if none
+    qint16                              _targetComponentOffset[256];    ///< Payload offset of target_component, -1 if none
+    quint32                             _duplicateCount;
+};
+
+#endif
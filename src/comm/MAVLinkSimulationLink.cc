@@ -818,8 +818,7 @@ void MAVLinkSimulationLink::writeBytes(const char* data, qint64 size)
     // Log the amount and time written out for future data rate calculations.
     // While this interface doesn't actually write any data to external systems,
     // this data "transmit" here should still count towards the outgoing data rate.
-    QMutexLocker dataRateLocker(&dataRateMutex);
-    logDataRateToBuffer(outDataWriteAmounts, outDataWriteTimes, &outDataIndex, size, QDateTime::currentMSecsSinceEpoch());
+    linkStatistics.logBytesSent(size);
 
     readyBufferMutex.lock();
     for (int i = 0; i < streampointer; i++)
@@ -851,8 +850,7 @@ void MAVLinkSimulationLink::readBytes()
     readyBufferMutex.unlock();
 
     // Log the amount and time received for future data rate calculations.
-    QMutexLocker dataRateLocker(&dataRateMutex);
-    logDataRateToBuffer(inDataWriteAmounts, inDataWriteTimes, &inDataIndex, len, QDateTime::currentMSecsSinceEpoch());
+    linkStatistics.logBytesReceived(len);
 
 }
 
@@ -1,12 +1,384 @@
+#include <string.h>
+
+#include <qmath.h>
+#include <QtConcurrent/QtConcurrentMap>
+
 #include "MAVLinkSwarmSimulationLink.h"
+#include "QGC.h"
+
+/// Home of the swarm, the vehicles loiter on a grid around it
+static const double _homeLatitude = 47.3977419;
+static const double _homeLongitude = 8.5455938;
+static const double _gridSpacing = 100.0;   ///< Meters between the loiter centers
+static const double _metersPerDegree = 111320.0;
+
+/// Steps one vehicle, the function object handed to QtConcurrent
+struct _StepVehicle
+{
+    _StepVehicle(quint64 tick, int tickMsecs) : _tick(tick), _tickMsecs(tickMsecs) {}
+
+    typedef void result_type;
+
+    void operator()(MAVLinkSwarmVehicle* vehicle) const
+    {
+        vehicle->step(_tick, _tickMsecs);
+    }
+
+    quint64 _tick;
+    int     _tickMsecs;
+};
+
+/// @return The system a command is sent to, 0 for all systems, -1 for messages the vehicles ignore
+static int _targetSystem(const mavlink_message_t& message)
+{
+    switch (message.msgid) {
+    case MAVLINK_MSG_ID_COMMAND_LONG:
+        return mavlink_msg_command_long_get_target_system(&message);
+    case MAVLINK_MSG_ID_SET_MODE:
+        return mavlink_msg_set_mode_get_target_system(&message);
+    default:
+        return -1;
+    }
+}
+
+MAVLinkSwarmSimulationLink::MAVLinkSwarmSimulationLink(int vehicleCount, int tickMsecs) :
+    MAVLinkSimulationLink("", "", tickMsecs),
+    _vehicleCount(0),
+    _tickMsecs(qMax(1, tickMsecs)),
+    _stop(false),
+    _tickCount(0),
+    _lastTickUsecs(0)
+{
+    setVehicleCount(vehicleCount);
+}
+
+MAVLinkSwarmSimulationLink::~MAVLinkSwarmSimulationLink()
+{
+    disconnect();
+    qDeleteAll(_vehicles);
+}
 
-MAVLinkSwarmSimulationLink::MAVLinkSwarmSimulationLink(QString readFile, QString writeFile, int rate) :
-    MAVLinkSimulationLink(readFile, writeFile, rate)
+void MAVLinkSwarmSimulationLink::setVehicleCount(int vehicleCount)
 {
+    // The system ids of MAVLink 1.0 limit the swarm, leave the upper ids to ground stations
+    _vehicleCount = qBound(1, vehicleCount, 250);
+    name = tr("MAVLink swarm simulation (%1 vehicles)").arg(_vehicleCount);
+    emit nameChanged(name);
 }
 
+bool MAVLinkSwarmSimulationLink::connect()
+{
+    if (_isConnected) {
+        return true;
+    }
+
+    qDeleteAll(_vehicles);
+    _vehicles.clear();
+
+    int gridSize = (int)ceil(sqrt((double)_vehicleCount));
+    for (int i = 0; i < _vehicleCount; i++) {
+        double north = (i / gridSize - gridSize / 2) * _gridSpacing;
+        double east = (i % gridSize - gridSize / 2) * _gridSpacing;
+        double latitude = _homeLatitude + north / _metersPerDegree;
+        double longitude = _homeLongitude + east / (_metersPerDegree * cos(_homeLatitude * M_PI / 180.0));
+        _vehicles.append(new MAVLinkSwarmVehicle(firstSystemId + i, latitude, longitude));
+    }
 
+    _inboxFramer.reset();
+    _inbox.clear();
+    _tickCount = 0;
+    _lastTickUsecs = 0;
+    _stop = false;
+    _isConnected = true;
+
+    emit connected();
+    emit connected(true);
+
+    start();
+    return true;
+}
+
+bool MAVLinkSwarmSimulationLink::disconnect()
+{
+    if (!_isConnected) {
+        return true;
+    }
+
+    _stop = true;
+    wait();
+    _isConnected = false;
+
+    emit disconnected();
+    emit connected(false);
+
+    return true;
+}
+
+void MAVLinkSwarmSimulationLink::run()
+{
+    QElapsedTimer clock;
+    clock.start();
+    qint64 nextTickMsecs = 0;
+
+    while (!_stop) {
+        mainloop();
+
+        nextTickMsecs += _tickMsecs;
+        qint64 nowMsecs = clock.elapsed();
+        if (nowMsecs > nextTickMsecs + 10 * _tickMsecs) {
+            // Too far behind to catch up, the simulation runs slower than real time
+            nextTickMsecs = nowMsecs;
+        } else if (nowMsecs < nextTickMsecs) {
+            QGC::SLEEP::msleep(nextTickMsecs - nowMsecs);
+        }
+    }
+}
+
+/// @brief Simulates one tick of all vehicles and emits their merged output
 void MAVLinkSwarmSimulationLink::mainloop()
 {
+    QElapsedTimer tickTimer;
+    tickTimer.start();
+
+    // Hand the commands received since the last tick to the vehicles they target
+    QList<mavlink_message_t> inbox;
+    _inboxMutex.lock();
+    inbox.swap(_inbox);
+    _inboxMutex.unlock();
+
+    foreach (const mavlink_message_t& message, inbox) {
+        int target = _targetSystem(message);
+        if (target == 0) {
+            foreach (MAVLinkSwarmVehicle* vehicle, _vehicles) {
+                vehicle->inbox.append(message);
+            }
+        } else if (target >= firstSystemId && target < firstSystemId + _vehicles.count()) {
+            _vehicles[target - firstSystemId]->inbox.append(message);
+        }
+    }
+
+    // The vehicles are independent, idle pool threads keep taking the next block of vehicles
+    QtConcurrent::blockingMap(_vehicles, _StepVehicle(_tickCount, _tickMsecs));
+
+    int size = 0;
+    foreach (MAVLinkSwarmVehicle* vehicle, _vehicles) {
+        size += vehicle->output.size();
+    }
+
+    QByteArray chunk;
+    chunk.reserve(size);
+    foreach (MAVLinkSwarmVehicle* vehicle, _vehicles) {
+        chunk.append(vehicle->output);
+    }
+
+    if (!chunk.isEmpty()) {
+        emit bytesReceived(this, chunk);
+
+        // Log the amount and time received for future data rate calculations.
+        linkStatistics.logBytesReceived(chunk.size());
+    }
+
+    _tickCount++;
+    _lastTickUsecs = tickTimer.nsecsElapsed() / 1000;
+}
+
+void MAVLinkSwarmSimulationLink::writeBytes(const char* data, qint64 size)
+{
+    QMutexLocker locker(&_inboxMutex);
+
+    mavlink_message_t message;
+    _inboxFramer.setInput(data, (int)size);
+    while (_inboxFramer.nextMessage(&message)) {
+        if (_targetSystem(message) >= 0) {
+            _inbox.append(message);
+        }
+    }
+
+    // Log the amount and time written out for future data rate calculations.
+    linkStatistics.logBytesSent(size);
+}
+
+MAVLinkSwarmVehicle::MAVLinkSwarmVehicle(int systemId, double latitude, double longitude) :
+    _systemId(systemId),
+    _sequence(0),
+    _timeSecs(0),
+    _centerLatitude(latitude),
+    _centerLongitude(longitude),
+    _angle(systemId * 0.5),
+    _altitude(_cruiseAltitude),
+    _targetAltitude(_cruiseAltitude),
+    _battery(1.0),
+    _baseMode(MAV_MODE_FLAG_CUSTOM_MODE_ENABLED | MAV_MODE_FLAG_GUIDED_ENABLED | MAV_MODE_FLAG_STABILIZE_ENABLED),
+    _customMode(0),
+    _armed(true)
+{
+
+}
+
+bool MAVLinkSwarmVehicle::_due(quint64 tick, int tickMsecs, int rateHz) const
+{
+    quint64 period = qMax(1, 1000 / (rateHz * tickMsecs));
+
+    // Spread the vehicles over the period instead of sending in lockstep
+    return (tick + _systemId) % period == 0;
+}
+
+void MAVLinkSwarmVehicle::_send(uint8_t messageId, const void* payload, uint8_t payloadLength)
+{
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+
+    int length = MAVLinkFramer::packFrame(frame, _sequence++, _systemId, _componentId, messageId, payload, payloadLength);
+    output.append((const char*)frame, length);
+}
+
+void MAVLinkSwarmVehicle::_handleMessage(const mavlink_message_t& message)
+{
+    if (message.msgid == MAVLINK_MSG_ID_SET_MODE) {
+        mavlink_set_mode_t mode;
+        mavlink_msg_set_mode_decode(&message, &mode);
+        _baseMode = mode.base_mode & ~MAV_MODE_FLAG_SAFETY_ARMED;
+        _customMode = mode.custom_mode;
+        _armed = (mode.base_mode & MAV_MODE_FLAG_SAFETY_ARMED) != 0;
+    } else if (message.msgid == MAVLINK_MSG_ID_COMMAND_LONG) {
+        mavlink_command_long_t command;
+        mavlink_msg_command_long_decode(&message, &command);
+
+        mavlink_command_ack_t ack;
+        memset(&ack, 0, sizeof(ack));
+        ack.command = command.command;
+        ack.result = MAV_RESULT_ACCEPTED;
+
+        switch (command.command) {
+        case MAV_CMD_COMPONENT_ARM_DISARM:
+            _armed = command.param1 > 0.5f;
+            break;
+        case MAV_CMD_NAV_TAKEOFF:
+            _armed = true;
+            _targetAltitude = command.param7 > 0 ? command.param7 : _cruiseAltitude;
+            break;
+        case MAV_CMD_NAV_LAND:
+        case MAV_CMD_NAV_RETURN_TO_LAUNCH:
+            _targetAltitude = 0;
+            break;
+        default:
+            ack.result = MAV_RESULT_UNSUPPORTED;
+            break;
+        }
+
+        _send(MAVLINK_MSG_ID_COMMAND_ACK, &ack, MAVLINK_MSG_ID_COMMAND_ACK_LEN);
+    }
+}
+
+void MAVLinkSwarmVehicle::step(quint64 tick, int tickMsecs)
+{
+    // The message structs have the layout of the payload on the wire, see MAVLinkFramer::packFrame
+    double dt = tickMsecs / 1000.0;
+    output.clear();
+
+    foreach (const mavlink_message_t& message, inbox) {
+        _handleMessage(message);
+    }
+    inbox.clear();
+
+    // Climb or descend to the target altitude, loiter while in the air and disarm after landing
+    double climb = 0;
+    if (_armed) {
+        double altitudeError = _targetAltitude - _altitude;
+        climb = qBound(-(double)_climbRate, altitudeError / dt, (double)_climbRate);
+        _altitude += climb * dt;
+        if (_altitude > 1.0) {
+            _angle = fmod(_angle + _speed * dt / _loiterRadius, 2 * M_PI);
+        } else if (_targetAltitude <= 0) {
+            _altitude = 0;
+            _armed = false;
+        }
+        _battery = qMax(0.0, _battery - dt / 1800.0);
+    }
+    _timeSecs += dt;
+
+    bool flying = _armed && _altitude > 1.0;
+    double groundSpeed = flying ? _speed : 0;
+    double yaw = fmod(_angle + M_PI / 2, 2 * M_PI);
+    double latitude = _centerLatitude + _loiterRadius * cos(_angle) / _metersPerDegree;
+    double longitude = _centerLongitude + _loiterRadius * sin(_angle) / (_metersPerDegree * cos(_centerLatitude * M_PI / 180.0));
+    uint32_t timeBootMsecs = (uint32_t)(_timeSecs * 1000);
+
+    if (_due(tick, tickMsecs, 1)) {
+        mavlink_heartbeat_t heartbeat;
+        memset(&heartbeat, 0, sizeof(heartbeat));
+        heartbeat.type = MAV_TYPE_QUADROTOR;
+        heartbeat.autopilot = MAV_AUTOPILOT_GENERIC;
+        heartbeat.base_mode = _baseMode | (_armed ? MAV_MODE_FLAG_SAFETY_ARMED : 0);
+        heartbeat.custom_mode = _customMode;
+        heartbeat.system_status = _armed ? MAV_STATE_ACTIVE : MAV_STATE_STANDBY;
+        heartbeat.mavlink_version = MAVLINK_VERSION;
+        _send(MAVLINK_MSG_ID_HEARTBEAT, &heartbeat, MAVLINK_MSG_ID_HEARTBEAT_LEN);
+    }
+
+    if (_due(tick, tickMsecs, 2)) {
+        mavlink_sys_status_t status;
+        memset(&status, 0, sizeof(status));
+        status.onboard_control_sensors_present = MAV_SYS_STATUS_SENSOR_3D_GYRO | MAV_SYS_STATUS_SENSOR_3D_ACCEL |
+                                                 MAV_SYS_STATUS_SENSOR_3D_MAG | MAV_SYS_STATUS_SENSOR_ABSOLUTE_PRESSURE |
+                                                 MAV_SYS_STATUS_SENSOR_GPS;
+        status.onboard_control_sensors_enabled = status.onboard_control_sensors_present;
+        status.onboard_control_sensors_health = status.onboard_control_sensors_present;
+        status.load = 300;
+        status.voltage_battery = (uint16_t)(10500 + 2100 * _battery);
+        status.current_battery = flying ? 1500 : 50;
+        status.battery_remaining = (int8_t)(_battery * 100);
+        _send(MAVLINK_MSG_ID_SYS_STATUS, &status, MAVLINK_MSG_ID_SYS_STATUS_LEN);
+    }
+
+    if (_due(tick, tickMsecs, 5)) {
+        mavlink_gps_raw_int_t gps;
+        memset(&gps, 0, sizeof(gps));
+        gps.time_usec = (uint64_t)(_timeSecs * 1000000);
+        gps.lat = (int32_t)(latitude * 1E7);
+        gps.lon = (int32_t)(longitude * 1E7);
+        gps.alt = (int32_t)((488.0 + _altitude) * 1000);
+        gps.eph = 100;
+        gps.epv = 150;
+        gps.vel = (uint16_t)(groundSpeed * 100);
+        gps.cog = (uint16_t)(yaw * 18000 / M_PI);
+        gps.fix_type = 3;
+        gps.satellites_visible = 10;
+        _send(MAVLINK_MSG_ID_GPS_RAW_INT, &gps, MAVLINK_MSG_ID_GPS_RAW_INT_LEN);
+    }
+
+    if (_due(tick, tickMsecs, 10)) {
+        mavlink_global_position_int_t position;
+        memset(&position, 0, sizeof(position));
+        position.time_boot_ms = timeBootMsecs;
+        position.lat = (int32_t)(latitude * 1E7);
+        position.lon = (int32_t)(longitude * 1E7);
+        position.alt = (int32_t)((488.0 + _altitude) * 1000);
+        position.relative_alt = (int32_t)(_altitude * 1000);
+        position.vx = (int16_t)(groundSpeed * cos(yaw) * 100);
+        position.vy = (int16_t)(groundSpeed * sin(yaw) * 100);
+        position.vz = (int16_t)(-climb * 100);
+        position.hdg = (uint16_t)(yaw * 18000 / M_PI);
+        _send(MAVLINK_MSG_ID_GLOBAL_POSITION_INT, &position, MAVLINK_MSG_ID_GLOBAL_POSITION_INT_LEN);
+
+        mavlink_vfr_hud_t hud;
+        memset(&hud, 0, sizeof(hud));
+        hud.airspeed = (float)groundSpeed;
+        hud.groundspeed = (float)groundSpeed;
+        hud.alt = (float)(488.0 + _altitude);
+        hud.climb = (float)climb;
+        hud.heading = (int16_t)(yaw * 180 / M_PI);
+        hud.throttle = flying ? 50 : 0;
+        _send(MAVLINK_MSG_ID_VFR_HUD, &hud, MAVLINK_MSG_ID_VFR_HUD_LEN);
+    }
 
+    if (_due(tick, tickMsecs, 25)) {
+        mavlink_attitude_t attitude;
+        memset(&attitude, 0, sizeof(attitude));
+        attitude.time_boot_ms = timeBootMsecs;
+        // Banked into the turn around the loiter center
+        attitude.roll = flying ? (float)atan(_speed * _speed / (9.81 * _loiterRadius)) : 0.0f;
+        attitude.yaw = (float)(yaw > M_PI ? yaw - 2 * M_PI : yaw);
+        attitude.yawspeed = flying ? (float)_speed / _loiterRadius : 0.0f;
+        _send(MAVLINK_MSG_ID_ATTITUDE, &attitude, MAVLINK_MSG_ID_ATTITUDE_LEN);
+    }
 }
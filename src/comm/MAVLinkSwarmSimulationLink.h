@@ -1,19 +1,108 @@
 #ifndef MAVLINKSWARMSIMULATIONLINK_H
 #define MAVLINKSWARMSIMULATIONLINK_H
 
+#include <QVector>
+#include <QList>
+#include <QMutex>
+#include <QElapsedTimer>
+
 #include "MAVLinkSimulationLink.h"
+#include "MAVLinkFramer.h"
+
+class MAVLinkSwarmVehicle;
 
+/// @brief Simulates a swarm of vehicles on one link, to test the ground station at fleet sizes.
+///
+/// All vehicles are stepped once per tick. The steps run in parallel on the global thread pool,
+/// each vehicle packs its messages into its own buffer with its own sequence numbers. The buffers
+/// are then merged in vehicle order into one chunk per tick, so the stream of each vehicle is
+/// correctly sequenced. Commands sent to the link are handed to the vehicle they target at the
+/// start of the next tick.
 class MAVLinkSwarmSimulationLink : public MAVLinkSimulationLink
 {
     Q_OBJECT
 public:
-    MAVLinkSwarmSimulationLink(QString readFile="", QString writeFile="", int rate=5);
+    MAVLinkSwarmSimulationLink(int vehicleCount = defaultVehicleCount, int tickMsecs = defaultTickMsecs);
+    ~MAVLinkSwarmSimulationLink();
+
+    int getVehicleCount(void) const { return _vehicleCount; }
+
+    /// @brief Sets the number of vehicles, takes effect on the next connect
+    void setVehicleCount(int vehicleCount);
+
+    /// @brief Number of ticks simulated since the link connected
+    quint64 getTickCount(void) const { return _tickCount; }
 
-signals:
+    /// @brief Time the last tick took to step all vehicles and merge their output, in microseconds
+    qint64 getLastTickUsecs(void) const { return _lastTickUsecs; }
+
+    // LinkInterface methods
+    bool connect();
+    bool disconnect();
+
+    static const int defaultVehicleCount = 100;
+    static const int defaultTickMsecs = 20;
+    static const int firstSystemId = 1;
 
 public slots:
     void mainloop();
+    void writeBytes(const char* data, qint64 size);
+
+protected:
+    void run();
+
+private:
+    int                             _vehicleCount;
+    int                             _tickMsecs;
+    QVector<MAVLinkSwarmVehicle*>   _vehicles;
+    volatile bool                   _stop;
+    quint64                         _tickCount;
+    qint64                          _lastTickUsecs;
+
+    QMutex                          _inboxMutex;    ///< Protects the inbox, commands arrive on the sending thread
+    MAVLinkFramer                   _inboxFramer;
+    QList<mavlink_message_t>        _inbox;
+};
+
+/// @brief State and behavior of one vehicle in the swarm. Plain data without timers or signals,
+///         stepped by the swarm link on any thread of the pool.
+class MAVLinkSwarmVehicle
+{
+public:
+    MAVLinkSwarmVehicle(int systemId, double latitude, double longitude);
+
+    /// @brief Handles the commands received since the last tick, advances the vehicle by one tick and
+    ///         packs the messages due in this tick into output.
+    void step(quint64 tick, int tickMsecs);
+
+    int systemId(void) const { return _systemId; }
+
+    QList<mavlink_message_t>    inbox;      ///< Filled by the link before the step
+    QByteArray                  output;     ///< Frames packed in the last step
+
+private:
+    void _handleMessage(const mavlink_message_t& message);
+    bool _due(quint64 tick, int tickMsecs, int rateHz) const;
+    void _send(uint8_t messageId, const void* payload, uint8_t payloadLength);
+
+    int         _systemId;
+    uint8_t     _sequence;
+    double      _timeSecs;
+    double      _centerLatitude;
+    double      _centerLongitude;
+    double      _angle;         ///< Position on the loiter circle in radians
+    double      _altitude;      ///< Above the center, in meters
+    double      _targetAltitude;
+    double      _battery;       ///< Remaining, 0 to 1
+    uint8_t     _baseMode;
+    uint32_t    _customMode;
+    bool        _armed;
 
+    static const int    _componentId = MAV_COMP_ID_IMU;
+    static const int    _loiterRadius = 40;         ///< Meters
+    static const int    _cruiseAltitude = 50;       ///< Meters
+    static const int    _climbRate = 3;             ///< Meters per second
+    static const int    _speed = 10;                ///< Meters per second
 };
 
 #endif // MAVLINKSWARMSIMULATIONLINK_H
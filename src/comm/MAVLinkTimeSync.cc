@@ -0,0 +1,331 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Estimates the offset between the onboard clocks of the vehicles and the ground time
+
+#include <math.h>
+
+#include "MAVLinkTimeSync.h"
+#include "QGC.h"
+
+const double MAVLinkTimeSync::_maximumDrift = 0.0002;
+
+MAVLinkTimeSync::MAVLinkTimeSync(QObject* parent) :
+    QObject(parent),
+    _latencyThresholdUsecs(defaultLatencyThresholdUsecs)
+{
+    for (int sysid = 0; sysid < 256; sysid++) {
+        _resetSystem(&_systems[sysid]);
+    }
+}
+
+void MAVLinkTimeSync::addRoundTrip(int sysid, quint64 requestUsecs, quint64 onboardUsecs, quint64 receiveUsecs)
+{
+    if (sysid < 0 || sysid > 255 || receiveUsecs < requestUsecs) {
+        return;
+    }
+    qint64 rttUsecs = receiveUsecs - requestUsecs;
+    if (rttUsecs > _maximumRoundTripUsecs) {
+        return;
+    }
+
+    // The vehicle replied somewhere within the round trip, the middle is the best guess
+    Sample sample;
+    sample.groundUsecs = requestUsecs + rttUsecs / 2;
+    sample.offsetUsecs = (qint64)(onboardUsecs - sample.groundUsecs);
+    sample.rttUsecs = rttUsecs;
+
+    QMutexLocker locker(&_mutex);
+    SystemSync* sync = &_systems[sysid];
+    if (!sync->roundTrip) {
+        // Round trips beat any one way samples taken so far
+        _resetSystem(sync);
+        sync->roundTrip = true;
+    }
+    _addSample(sync, sample, onboardUsecs);
+}
+
+void MAVLinkTimeSync::addOneWay(int sysid, quint64 onboardUsecs, quint64 receiveUsecs)
+{
+    if (sysid < 0 || sysid > 255) {
+        return;
+    }
+
+    Sample sample;
+    sample.groundUsecs = receiveUsecs;
+    sample.offsetUsecs = (qint64)(onboardUsecs - receiveUsecs);
+    sample.rttUsecs = 0;
+
+    QMutexLocker locker(&_mutex);
+    SystemSync* sync = &_systems[sysid];
+    if (!sync->roundTrip) {
+        _addSample(sync, sample, onboardUsecs);
+    }
+}
+
+bool MAVLinkTimeSync::toGroundUsecs(int sysid, quint64 onboardUsecs, quint64* groundUsecs) const
+{
+    if (sysid < 0 || sysid > 255) {
+        return false;
+    }
+
+    QMutexLocker locker(&_mutex);
+    const SystemSync* sync = &_systems[sysid];
+    if (!sync->synchronized || _isUnixTime(onboardUsecs) != sync->unixTime) {
+        return false;
+    }
+
+    // The offset depends on the ground time, which is what we are looking for. The drift is tiny, one
+    // step from the offset at the anchor is exact to well below a microsecond.
+    double estimate = (double)onboardUsecs - sync->baseOffsetUsecs;
+    double ground = (double)onboardUsecs - _offsetAt(sync, estimate);
+    *groundUsecs = ground > 0 ? (quint64)(ground + 0.5) : 0;
+    return true;
+}
+
+bool MAVLinkTimeSync::logLatency(int sysid, quint64 onboardUsecs, quint64 receiveUsecs, quint64* groundUsecs)
+{
+    if (!toGroundUsecs(sysid, onboardUsecs, groundUsecs)) {
+        return false;
+    }
+    qint64 latencyUsecs = (qint64)(receiveUsecs - *groundUsecs);
+
+    bool exceeded = false;
+    qint64 smoothedUsecs;
+    {
+        QMutexLocker locker(&_mutex);
+        SystemSync* sync = &_systems[sysid];
+        if (sync->latencyValid) {
+            sync->latencyUsecs += (latencyUsecs - sync->latencyUsecs) / 8.0;
+        } else {
+            sync->latencyUsecs = latencyUsecs;
+            sync->latencyValid = true;
+        }
+        smoothedUsecs = (qint64)sync->latencyUsecs;
+
+        if (smoothedUsecs > _latencyThresholdUsecs) {
+            exceeded = !sync->latencyAlarm;
+            sync->latencyAlarm = true;
+        } else {
+            sync->latencyAlarm = false;
+        }
+    }
+
+    // Emitted without the lock held, receivers may query the service
+    if (exceeded) {
+        emit latencyExceeded(sysid, smoothedUsecs);
+    }
+    return true;
+}
+
+bool MAVLinkTimeSync::isSynchronized(int sysid) const
+{
+    if (sysid < 0 || sysid > 255) {
+        return false;
+    }
+    QMutexLocker locker(&_mutex);
+    return _systems[sysid].synchronized;
+}
+
+bool MAVLinkTimeSync::hasRoundTrip(int sysid) const
+{
+    if (sysid < 0 || sysid > 255) {
+        return false;
+    }
+    QMutexLocker locker(&_mutex);
+    return _systems[sysid].synchronized && _systems[sysid].roundTrip;
+}
+
+qint64 MAVLinkTimeSync::getOffsetUsecs(int sysid) const
+{
+    if (sysid < 0 || sysid > 255) {
+        return 0;
+    }
+    QMutexLocker locker(&_mutex);
+    const SystemSync* sync = &_systems[sysid];
+    if (!sync->synchronized) {
+        return 0;
+    }
+    return (qint64)floor(_offsetAt(sync, (double)QGC::groundTimeUsecs()) + 0.5);
+}
+
+double MAVLinkTimeSync::getDriftPpm(int sysid) const
+{
+    if (sysid < 0 || sysid > 255) {
+        return 0;
+    }
+    QMutexLocker locker(&_mutex);
+    return _systems[sysid].drift * 1e6;
+}
+
+qint64 MAVLinkTimeSync::getRoundTripUsecs(int sysid) const
+{
+    if (sysid < 0 || sysid > 255) {
+        return 0;
+    }
+    QMutexLocker locker(&_mutex);
+    return _systems[sysid].rttUsecs;
+}
+
+qint64 MAVLinkTimeSync::getLatencyUsecs(int sysid) const
+{
+    if (sysid < 0 || sysid > 255) {
+        return 0;
+    }
+    QMutexLocker locker(&_mutex);
+    return (qint64)_systems[sysid].latencyUsecs;
+}
+
+void MAVLinkTimeSync::setLatencyThreshold(qint64 usecs)
+{
+    QMutexLocker locker(&_mutex);
+    _latencyThresholdUsecs = usecs;
+}
+
+void MAVLinkTimeSync::reset(int sysid)
+{
+    if (sysid < 0 || sysid > 255) {
+        return;
+    }
+    QMutexLocker locker(&_mutex);
+    _resetSystem(&_systems[sysid]);
+}
+
+void MAVLinkTimeSync::_resetSystem(SystemSync* sync)
+{
+    sync->samples.clear();
+    sync->roundTrip = false;
+    sync->unixTime = false;
+    sync->lastOnboardUsecs = 0;
+    sync->synchronized = false;
+    sync->baseGroundUsecs = 0;
+    sync->baseOffsetUsecs = 0;
+    sync->drift = 0;
+    sync->rttUsecs = 0;
+    sync->latencyUsecs = 0;
+    sync->latencyValid = false;
+    sync->latencyAlarm = false;
+}
+
+/// Must be called with the mutex held.
+void MAVLinkTimeSync::_addSample(SystemSync* sync, const Sample& sample, quint64 onboardUsecs)
+{
+    // A clock jumping back or changing its time base means the vehicle rebooted or got a GPS fix,
+    // the old samples describe another clock
+    bool unixTime = _isUnixTime(onboardUsecs);
+    if (!sync->samples.isEmpty() &&
+            (unixTime != sync->unixTime || onboardUsecs + _rebootToleranceUsecs < sync->lastOnboardUsecs)) {
+        bool roundTrip = sync->roundTrip;
+        _resetSystem(sync);
+        sync->roundTrip = roundTrip;
+    }
+    sync->unixTime = unixTime;
+    sync->lastOnboardUsecs = onboardUsecs;
+
+    sync->samples.append(sample);
+    if (sync->samples.count() > sampleWindow) {
+        sync->samples.remove(0);
+    }
+    _fit(sync);
+}
+
+/// Must be called with the mutex held.
+void MAVLinkTimeSync::_fit(SystemSync* sync)
+{
+    const QVector<Sample>& samples = sync->samples;
+
+    // The delay of a sample is its round trip. One way samples only show how much later than the
+    // fastest message they arrived, which lowers their offset by the same amount.
+    QVector<qint64> delays(samples.count());
+    qint64 maxOffset = samples[0].offsetUsecs;
+    for (int i = 1; i < samples.count(); i++) {
+        maxOffset = qMax(maxOffset, samples[i].offsetUsecs);
+    }
+    qint64 minDelay = -1;
+    for (int i = 0; i < samples.count(); i++) {
+        delays[i] = sync->roundTrip ? samples[i].rttUsecs : maxOffset - samples[i].offsetUsecs;
+        if (minDelay < 0 || delays[i] < minDelay) {
+            minDelay = delays[i];
+        }
+    }
+    qint64 tolerance = minDelay / 2;
+    if (tolerance < _minimumRoundTripToleranceUsecs) {
+        tolerance = _minimumRoundTripToleranceUsecs;
+    }
+    qint64 maxDelay = minDelay + tolerance;
+
+    // Least squares line through the fast samples, relative to the newest sample to keep the precision
+    double reference = (double)samples.last().groundUsecs;
+    qint64 referenceOffset = samples.last().offsetUsecs;
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    double minX = 0, maxX = 0;
+    int n = 0;
+    for (int i = 0; i < samples.count(); i++) {
+        if (delays[i] > maxDelay) {
+            continue;
+        }
+        double x = (double)samples[i].groundUsecs - reference;
+        double y = (double)(samples[i].offsetUsecs - referenceOffset);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+        minX = n == 0 ? x : qMin(minX, x);
+        maxX = n == 0 ? x : qMax(maxX, x);
+        n++;
+    }
+
+    double meanX = sumX / n;
+    double meanY = sumY / n;
+    double drift = 0;
+    double varX = sumXX / n - meanX * meanX;
+    if (n >= 3 && maxX - minX >= minimumFitSpanUsecs && varX > 0) {
+        drift = (sumXY / n - meanX * meanY) / varX;
+        // Crystals are good for some ten ppm, anything far beyond is noise in a short window
+        drift = qBound(-_maximumDrift, drift, _maximumDrift);
+    }
+
+    sync->baseGroundUsecs = reference + meanX;
+    sync->baseOffsetUsecs = (double)referenceOffset + meanY;
+    sync->drift = drift;
+    sync->rttUsecs = sync->roundTrip ? minDelay : 0;
+    sync->synchronized = true;
+}
+
+/// Must be called with the mutex held.
+double MAVLinkTimeSync::_offsetAt(const SystemSync* sync, double groundUsecs) const
+{
+    return sync->baseOffsetUsecs + sync->drift * (groundUsecs - sync->baseGroundUsecs);
+}
+
+/// A timestamp beyond 40 years can't be the time since boot, it has to be Unix time.
+bool MAVLinkTimeSync::_isUnixTime(quint64 usecs)
+{
+    // 40 years * 365 days * 24 hours * 60 minutes * 60 seconds * 1000 milliseconds * 1000 microseconds
+#ifndef _MSC_VER
+    return usecs >= 1261440000000000LLU;
+#else
+    return usecs >= 1261440000000000;
+#endif
+}
@@ -0,0 +1,151 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Estimates the offset between the onboard clocks of the vehicles and the ground time
+
+#ifndef MAVLINKTIMESYNC_H
+#define MAVLINKTIMESYNC_H
+
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+
+/// @brief Maps the onboard time of every vehicle to the ground time.
+///
+/// The protocol sends a TIMESYNC request once a second and feeds the replies in. Each reply gives an
+/// offset sample and the round trip time it was measured with. Only the samples with a round trip close
+/// to the shortest one in the window are used, a long round trip means the request or the reply waited
+/// in a queue and the sample is skewed by an unknown amount. The offset is fitted as a line over the
+/// ground time, so a drifting onboard oscillator is followed between the samples.
+///
+/// Vehicles without TIMESYNC support are synchronized from SYSTEM_TIME instead. That is a one way
+/// measurement, the offset includes the shortest transport delay seen and latencies measured with it
+/// are relative to that delay.
+///
+/// All methods are thread safe. The protocol thread feeds the samples, the UAS objects and the decoder
+/// convert timestamps from their own threads.
+class MAVLinkTimeSync : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkTimeSync(QObject* parent = NULL);
+
+    /// @brief Adds a TIMESYNC round trip.
+    ///     @param sysid System which replied
+    ///     @param requestUsecs Ground time the request was sent at, echoed by the vehicle
+    ///     @param onboardUsecs Onboard time the vehicle replied at
+    ///     @param receiveUsecs Ground time the reply was received at
+    void addRoundTrip(int sysid, quint64 requestUsecs, quint64 onboardUsecs, quint64 receiveUsecs);
+
+    /// @brief Adds a one way sample from a SYSTEM_TIME message, ignored once TIMESYNC replies arrive
+    ///     @param onboardUsecs Onboard time since boot the message was sent at
+    ///     @param receiveUsecs Ground time the message was received at
+    void addOneWay(int sysid, quint64 onboardUsecs, quint64 receiveUsecs);
+
+    /// @brief Converts an onboard timestamp of a system to ground time.
+    ///     @param[out] groundUsecs Ground time in microseconds since the epoch
+    ///     @return false if the system is not synchronized or the timestamp is not in the synchronized time base
+    bool toGroundUsecs(int sysid, quint64 onboardUsecs, quint64* groundUsecs) const;
+
+    /// @brief Converts a message timestamp of a system and measures the latency of the message.
+    ///     @param onboardUsecs Onboard time the message was sent at
+    ///     @param receiveUsecs Ground time the message was received at
+    ///     @param[out] groundUsecs Ground time the message was sent at
+    ///     @return false if the system is not synchronized, no latency is measured then
+    bool logLatency(int sysid, quint64 onboardUsecs, quint64 receiveUsecs, quint64* groundUsecs);
+
+    /// @brief Returns true if the onboard time of the system can be converted
+    bool isSynchronized(int sysid) const;
+
+    /// @brief Returns true if the synchronization of the system was measured with TIMESYNC round trips
+    bool hasRoundTrip(int sysid) const;
+
+    /// @brief Returns the offset of the onboard time to the ground time at the current ground time
+    qint64 getOffsetUsecs(int sysid) const;
+
+    /// @brief Returns the drift of the onboard clock against the ground clock in parts per million
+    double getDriftPpm(int sysid) const;
+
+    /// @brief Returns the shortest round trip time in the sample window, 0 without round trips
+    qint64 getRoundTripUsecs(int sysid) const;
+
+    /// @brief Returns the smoothed one way latency of the messages of the system
+    qint64 getLatencyUsecs(int sysid) const;
+
+    /// @brief Sets the latency above which latencyExceeded is emitted
+    void setLatencyThreshold(qint64 usecs);
+    qint64 getLatencyThreshold(void) const { return _latencyThresholdUsecs; }
+
+    /// @brief Forgets everything about a system, e.g. after it rebooted
+    void reset(int sysid);
+
+    static const int        sampleWindow = 32;                  ///< Round trips kept per system
+    static const qint64     minimumFitSpanUsecs = 10000000;     ///< Samples must span this long to fit a drift
+    static const qint64     defaultLatencyThresholdUsecs = 500000;
+
+signals:
+    /// @brief Emitted when the smoothed latency of a system rises above the threshold. Emitted again only
+    ///         after the latency dropped below the threshold.
+    void latencyExceeded(int sysid, qint64 latencyUsecs);
+
+private:
+    struct Sample {
+        quint64 groundUsecs;    ///< Ground time the sample is valid at
+        qint64  offsetUsecs;    ///< Onboard minus ground time
+        qint64  rttUsecs;       ///< Round trip time, 0 for one way samples
+    };
+
+    struct SystemSync {
+        QVector<Sample> samples;            ///< Oldest first, at most sampleWindow
+        bool            roundTrip;          ///< Samples are TIMESYNC round trips
+        bool            unixTime;           ///< The onboard clock runs on Unix time, not time since boot
+        quint64         lastOnboardUsecs;   ///< Onboard time of the last sample, to detect reboots
+        bool            synchronized;
+        double          baseGroundUsecs;    ///< Ground time the fit is anchored at
+        double          baseOffsetUsecs;    ///< Fitted offset at baseGroundUsecs
+        double          drift;              ///< Fitted change of the offset per microsecond of ground time
+        qint64          rttUsecs;           ///< Shortest round trip in the window
+        double          latencyUsecs;       ///< Smoothed one way latency
+        bool            latencyValid;
+        bool            latencyAlarm;       ///< latencyExceeded was emitted and not yet re-armed
+    };
+
+    void _resetSystem(SystemSync* sync);
+    void _addSample(SystemSync* sync, const Sample& sample, quint64 onboardUsecs);
+    void _fit(SystemSync* sync);
+    double _offsetAt(const SystemSync* sync, double groundUsecs) const;
+    static bool _isUnixTime(quint64 usecs);
+
+    static const qint64     _maximumRoundTripUsecs = 10000000;  ///< Longer round trips are replies to someone else
+    static const qint64     _minimumRoundTripToleranceUsecs = 1000;
+    static const qint64     _rebootToleranceUsecs = 1000000;
+    static const double     _maximumDrift;                      ///< Bound of the fitted drift, 200 ppm
+
+    mutable QMutex  _mutex;
+    SystemSync      _systems[256];
+    qint64          _latencyThresholdUsecs;
+};
+
+#endif
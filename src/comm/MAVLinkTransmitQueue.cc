@@ -0,0 +1,255 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Prioritized, rate shaped transmit queue of one link
+
+#include <string.h>
+
+#include "MAVLinkTransmitQueue.h"
+#include "LinkInterface.h"
+
+#if MAVLINK_CRC_EXTRA
+static const uint8_t _crcExtra[256] = MAVLINK_MESSAGE_CRCS;
+#endif
+
+/// Burst size of the token bucket, in milliseconds of link bandwidth
+static const qint64 _burstMsecs = 50;
+
+MAVLinkTransmitQueue::MAVLinkTransmitQueue(LinkInterface* link) :
+    _link(link),
+    _rate(0),
+    _tokens(MAVLINK_MAX_PACKET_LEN),
+    _lastRefillUsecs(0),
+    _waiting(false),
+    _sequence(0)
+{
+    memset(_statistics, 0, sizeof(_statistics));
+    _clock.start();
+}
+
+MAVLinkTransmitQueue::Priority MAVLinkTransmitQueue::priorityForMessage(int msgid)
+{
+    switch (msgid) {
+        case MAVLINK_MSG_ID_MANUAL_CONTROL:
+        case MAVLINK_MSG_ID_RC_CHANNELS_OVERRIDE:
+            return PriorityControl;
+
+        case MAVLINK_MSG_ID_HEARTBEAT:
+        case MAVLINK_MSG_ID_PING:
+            return PriorityHeartbeat;
+
+        case MAVLINK_MSG_ID_PARAM_REQUEST_READ:
+        case MAVLINK_MSG_ID_PARAM_REQUEST_LIST:
+        case MAVLINK_MSG_ID_PARAM_VALUE:
+        case MAVLINK_MSG_ID_PARAM_SET:
+        case MAVLINK_MSG_ID_MISSION_ITEM:
+        case MAVLINK_MSG_ID_MISSION_REQUEST:
+        case MAVLINK_MSG_ID_MISSION_REQUEST_LIST:
+        case MAVLINK_MSG_ID_MISSION_COUNT:
+        case MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+        case MAVLINK_MSG_ID_LOG_REQUEST_DATA:
+        case MAVLINK_MSG_ID_LOG_REQUEST_LIST:
+            return PriorityBulk;
+
+        default:
+            return PriorityCommand;
+    }
+}
+
+void MAVLinkTransmitQueue::setRate(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&_mutex);
+    _rate = bytesPerSecond;
+}
+
+qint64 MAVLinkTransmitQueue::rate(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _effectiveRate();
+}
+
+qint64 MAVLinkTransmitQueue::_effectiveRate(void) const
+{
+    if (_rate > 0 || !_link) {
+        return _rate;
+    }
+    // A start and a stop bit per byte on serial links
+    return _link->getConnectionSpeed() / 10;
+}
+
+int MAVLinkTransmitQueue::enqueue(const mavlink_message_t& message)
+{
+    Frame frame;
+    frame.length = mavlink_msg_to_send_buffer(frame.data, &message);
+    frame.forwarded = false;
+
+    QMutexLocker locker(&_mutex);
+    return _enqueue(frame);
+}
+
+int MAVLinkTransmitQueue::enqueueFrame(const uint8_t* frame, int length)
+{
+    Q_ASSERT(length > MAVLINK_NUM_NON_PAYLOAD_BYTES && length <= MAVLINK_MAX_PACKET_LEN);
+
+    Frame forwardedFrame;
+    memcpy(forwardedFrame.data, frame, length);
+    forwardedFrame.length = length;
+    forwardedFrame.forwarded = true;
+
+    QMutexLocker locker(&_mutex);
+    return _enqueue(forwardedFrame);
+}
+
+/// @brief Queues a frame and sends what the shaper allows, the mutex has to be held
+int MAVLinkTransmitQueue::_enqueue(const Frame& frame)
+{
+    Priority priority = priorityForMessage(frame.data[5]);
+    QQueue<Frame>& queue = _queues[priority];
+    Statistics& statistics = _statistics[priority];
+
+    if (!_link) {
+        statistics.droppedCount++;
+        return -1;
+    }
+
+    if (queue.count() >= maxDepth) {
+        statistics.droppedCount++;
+        _link->getStatistics().logDroppedFrame();
+    } else {
+        queue.enqueue(frame);
+        queue.last().queuedUsecs = _clock.nsecsElapsed() / 1000;
+
+        statistics.depth = queue.count();
+        statistics.maxDepth = qMax(statistics.maxDepth, statistics.depth);
+    }
+
+    // Control messages go out right away, even if the rest waits for tokens
+    int waitMsecs = _transmit();
+    if (_waiting) {
+        // The rest is sent by the outstanding transmitPending() call
+        return -1;
+    }
+    _waiting = waitMsecs >= 0;
+    return waitMsecs;
+}
+
+int MAVLinkTransmitQueue::transmitPending(void)
+{
+    QMutexLocker locker(&_mutex);
+
+    int waitMsecs = _transmit();
+    _waiting = waitMsecs >= 0;
+    return waitMsecs;
+}
+
+void MAVLinkTransmitQueue::detachLink(void)
+{
+    QMutexLocker locker(&_mutex);
+
+    for (int priority = 0; priority < PriorityCount; priority++) {
+        _statistics[priority].droppedCount += _queues[priority].count();
+        _statistics[priority].depth = 0;
+        _queues[priority].clear();
+    }
+    _link = NULL;
+    _waiting = false;
+}
+
+MAVLinkTransmitQueue::Statistics MAVLinkTransmitQueue::statistics(Priority priority) const
+{
+    QMutexLocker locker(&_mutex);
+    return _statistics[priority];
+}
+
+/// @brief Writes queued frames in priority order as long as there are tokens
+///     @return Milliseconds until the next frame can be written, -1 if all queues are empty
+int MAVLinkTransmitQueue::_transmit(void)
+{
+    if (!_link) {
+        return -1;
+    }
+
+    qint64 nowUsecs = _clock.nsecsElapsed() / 1000;
+    qint64 rate = _effectiveRate();
+
+    // Refill the bucket. Only the time worth of whole tokens is used up, frequent calls must not lose the fractions.
+    qint64 capacity = qMax(rate * _burstMsecs / 1000, (qint64)MAVLINK_MAX_PACKET_LEN);
+    qint64 refill = rate > 0 ? rate * (nowUsecs - _lastRefillUsecs) / 1000000 : 0;
+    if (rate <= 0 || _tokens + refill >= capacity) {
+        _tokens = qMin(capacity, _tokens + refill);
+        _lastRefillUsecs = nowUsecs;
+    } else {
+        _tokens += refill;
+        _lastRefillUsecs += refill * 1000000 / rate;
+    }
+
+    bool connected = _link->isConnected();
+
+    for (int priority = 0; priority < PriorityCount; priority++) {
+        QQueue<Frame>& queue = _queues[priority];
+        Statistics& statistics = _statistics[priority];
+
+        while (!queue.isEmpty()) {
+            Frame& frame = queue.head();
+
+            if (connected) {
+                if (rate > 0 && priority != PriorityControl && _tokens < frame.length) {
+                    // Lower priorities wait as well, they must not overtake
+                    return (int)((frame.length - _tokens) * 1000 / rate) + 1;
+                }
+
+                if (!frame.forwarded) {
+                    // Assign the sequence number on the wire and checksum the frame
+                    frame.data[2] = _sequence++;
+                    uint16_t crc = crc_calculate(frame.data + 1, MAVLINK_CORE_HEADER_LEN + frame.data[1]);
+#if MAVLINK_CRC_EXTRA
+                    crc_accumulate(_crcExtra[frame.data[5]], &crc);
+#endif
+                    frame.data[frame.length - 2] = crc & 0xFF;
+                    frame.data[frame.length - 1] = crc >> 8;
+                }
+
+                _link->writeBytes((const char*)frame.data, frame.length);
+
+                if (rate > 0) {
+                    _tokens -= frame.length;
+                }
+
+                qint64 queueUsecs = nowUsecs - frame.queuedUsecs;
+                statistics.sentCount++;
+                statistics.totalQueueUsecs += queueUsecs;
+                statistics.maxQueueUsecs = qMax(statistics.maxQueueUsecs, queueUsecs);
+                _link->getStatistics().logFrameSent(queueUsecs);
+            } else {
+                statistics.droppedCount++;
+                _link->getStatistics().logDroppedFrame();
+            }
+
+            queue.dequeue();
+            statistics.depth = queue.count();
+        }
+    }
+
+    return -1;
+}
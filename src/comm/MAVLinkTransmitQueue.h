@@ -0,0 +1,131 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Prioritized, rate shaped transmit queue of one link
+
+#ifndef MAVLINKTRANSMITQUEUE_H
+#define MAVLINKTRANSMITQUEUE_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QElapsedTimer>
+
+#include "QGCMAVLink.h"
+
+class LinkInterface;
+
+/// @brief Queues the messages sent on one link by priority and shapes them to the link bandwidth.
+///
+/// Messages are queued in one of four priority classes and always sent highest priority first. A token
+/// bucket limits the bytes written to the bandwidth of the link, so bulk transfers like parameter or
+/// mission uploads can't fill up the buffers of a slow radio. Control messages are never held back by
+/// the shaper, they borrow the tokens from the messages queued behind them.
+///
+/// The sequence number and checksum are assigned when a message is written to the link, so sequence
+/// numbers are consecutive on the wire regardless of the reordering by priority.
+///
+/// All methods are thread safe.
+class MAVLinkTransmitQueue
+{
+public:
+    enum Priority {
+        PriorityControl,    ///< Manual control, RC override
+        PriorityHeartbeat,  ///< Heartbeat, ping
+        PriorityCommand,    ///< Commands, mode changes and everything not listed elsewhere
+        PriorityBulk,       ///< Parameter, mission and file transfers
+        PriorityCount
+    };
+
+    /// @brief Counters of one priority class
+    struct Statistics {
+        int     depth;              ///< Messages currently queued
+        int     maxDepth;           ///< Maximum number of messages queued at once
+        quint32 sentCount;          ///< Messages written to the link
+        quint32 droppedCount;       ///< Messages dropped because the queue was full or the link disconnected
+        qint64  totalQueueUsecs;    ///< Sum of the time the sent messages spent in the queue
+        qint64  maxQueueUsecs;      ///< Longest time a sent message spent in the queue
+    };
+
+    MAVLinkTransmitQueue(LinkInterface* link);
+
+    /// @brief Returns the priority class of a message id
+    static Priority priorityForMessage(int msgid);
+
+    /// @brief Sets the bandwidth the link is shaped to in bytes per second.
+    ///     @param bytesPerSecond 0: derive from the connection speed of the link, 8N1 framing
+    void setRate(qint64 bytesPerSecond);
+    qint64 rate(void) const;
+
+    /// @brief Queues a message and sends what the shaper allows right away.
+    ///     @param message Packed message, its system and component id are sent as is
+    ///     @return Milliseconds after which transmitPending() has to be called, -1 if no call is needed
+    int enqueue(const mavlink_message_t& message);
+
+    /// @brief Queues a complete frame received on another link. It is sent with its original sequence number
+    /// and checksum, like a router forwards it, but shaped and prioritized like the messages of this station.
+    ///     @param frame Frame as received, header to checksum
+    ///     @param length Length of the frame in bytes
+    ///     @return Milliseconds after which transmitPending() has to be called, -1 if no call is needed
+    int enqueueFrame(const uint8_t* frame, int length);
+
+    /// @brief Sends the messages which were held back by the shaper.
+    ///     @return Milliseconds after which this has to be called again, -1 if the queue is empty
+    int transmitPending(void);
+
+    /// @brief Returns the counters of a priority class
+    Statistics statistics(Priority priority) const;
+
+    /// @brief Drops the queued messages and stops using the link, call before the link is destroyed.
+    /// Returns once no other thread writes to the link anymore, messages queued afterwards are dropped.
+    void detachLink(void);
+
+    /// @brief Maximum number of messages queued per priority class, further messages are dropped
+    static const int maxDepth = 1024;
+
+private:
+    struct Frame {
+        uint8_t data[MAVLINK_MAX_PACKET_LEN];
+        int     length;
+        qint64  queuedUsecs;    ///< Time the frame was queued
+        bool    forwarded;      ///< Sent as is, the sequence number and checksum are those of the original sender
+    };
+
+    int _enqueue(const Frame& frame);
+    int _transmit(void);
+    qint64 _effectiveRate(void) const;
+
+    LinkInterface*  _link;          ///< NULL once detached
+    mutable QMutex  _mutex;
+    QQueue<Frame>   _queues[PriorityCount];
+    Statistics      _statistics[PriorityCount];
+    QElapsedTimer   _clock;
+
+    qint64          _rate;          ///< Configured rate, 0 for automatic
+    qint64          _tokens;        ///< Bytes which may be sent right now, negative when control messages borrowed
+    qint64          _lastRefillUsecs;
+    bool            _waiting;       ///< A call to transmitPending() is outstanding
+    uint8_t         _sequence;      ///< Next sequence number on the wire
+};
+
+#endif
@@ -256,8 +256,7 @@ void OpalLink::writeBytes(const char *bytes, qint64 length)
     }
 
     // Log the amount and time written out for future data rate calculations.
-    QMutexLocker dataRateLocker(&dataRateMutex);
-    logDataRateToBuffer(outDataWriteAmounts, outDataWriteTimes, &outDataIndex, size, QDateTime::currentMSecsSinceEpoch());
+    linkStatistics.logBytesSent(size);
 }
 
 
@@ -268,8 +267,7 @@ void OpalLink::readBytes()
     receiveDataMutex.unlock();
 
     // Log the amount and time received for future data rate calculations.
-    QMutexLocker dataRateLocker(&dataRateMutex);
-    logDataRateToBuffer(inDataWriteAmounts, inDataWriteTimes, &inDataIndex, s, QDateTime::currentMSecsSinceEpoch());
+    linkStatistics.logBytesReceived(s);
 }
 
 void OpalLink::receiveMessage(mavlink_message_t message)
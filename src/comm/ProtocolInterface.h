@@ -78,6 +78,7 @@ public:
     virtual void resetMetadataForLink(const LinkInterface *link) = 0;
 
 public slots:
+    /** @brief Called directly on the thread of the link which read the bytes, must be thread safe */
     virtual void receiveBytes(LinkInterface *link, QByteArray b) = 0;
     virtual void linkStatusChanged(bool connected) = 0;
 
@@ -80,6 +80,7 @@ QGCXPlaneLink::~QGCXPlaneLink()
     storeSettings();
     // Tell the thread to exit
     _should_exit = true;
+    quit();
     // Wait for it to exit
     wait();
 
@@ -234,10 +235,8 @@ void QGCXPlaneLink::run()
 
     _should_exit = false;
 
-    while(!_should_exit) {
-        QCoreApplication::processEvents();
-        QGC::SLEEP::msleep(5);
-    }
+    // Sleeps until the socket or a queued call needs attention, quit() by disconnectSimulation()
+    exec();
 
     if (mav)
     {
@@ -882,6 +881,7 @@ bool QGCXPlaneLink::disconnectSimulation()
     if (connectState)
     {
         _should_exit = true;
+        quit();
         wait();
     } else {
         emit simulationDisconnected();
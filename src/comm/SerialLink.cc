@@ -26,7 +26,16 @@ SerialLink::SerialLink(QString portname, int baudRate, bool hardwareFlowControl,
     type(""),
     m_is_cdc(true),
     m_stopp(false),
-    m_reqReset(false)
+    m_reqReset(false),
+    m_transmitStart(0),
+    m_transmitCount(0),
+    m_receiveStart(0),
+    m_lastReceive(0),
+    m_coalesceTimer(NULL),
+    m_reconnectTimer(NULL),
+    m_reconnectTries(0),
+    m_readCoalescing(0),
+    m_linkErrorCount(0)
 {
     // We're doing it wrong - because the Qt folks got the API wrong:
     // http://blog.qt.digia.com/blog/2010/06/17/youre-doing-it-wrong/
@@ -152,6 +161,7 @@ void SerialLink::loadSettings()
         m_dataBits = settings.value("SERIALLINK_COMM_DATABITS").toInt();
         m_flowControl = settings.value("SERIALLINK_COMM_FLOW_CONTROL").toInt();
     }
+    m_readCoalescing = settings.value("SERIALLINK_READ_COALESCING", m_readCoalescing).toInt();
 }
 
 void SerialLink::writeSettings()
@@ -164,6 +174,7 @@ void SerialLink::writeSettings()
     settings.setValue("SERIALLINK_COMM_STOPBITS", getStopBits());
     settings.setValue("SERIALLINK_COMM_DATABITS", getDataBits());
     settings.setValue("SERIALLINK_COMM_FLOW_CONTROL", getFlowType());
+    settings.setValue("SERIALLINK_READ_COALESCING", m_readCoalescing);
     settings.sync();
 }
 
@@ -202,6 +213,9 @@ void SerialLink::checkIfCDC()
 /**
  * @brief Runs the thread
  *
+ * The event loop of the thread is driven by the port: readyRead delivers the
+ * received bytes, bytesWritten hands more of the transmit ring buffer to the
+ * port. A timer checks for disconnect requests and link timeouts.
  **/
 void SerialLink::run()
 {
@@ -218,146 +232,204 @@ void SerialLink::run()
         return;
     }
 
-    qint64 msecs = QDateTime::currentMSecsSinceEpoch();
-    qint64 initialmsecs = QDateTime::currentMSecsSinceEpoch();
-    quint64 bytes = 0;
-    qint64 timeout = 5000;
-    int linkErrorCount = 0;
+    m_clock.start();
+    m_lastReceive = 0;
+    m_linkErrorCount = 0;
 
-    // Qt way to make clear what a while(1) loop does
-    forever {
-        {
-            QMutexLocker locker(&this->m_stoppMutex);
-            if (m_stopp) {
-                m_stopp = false;
-                break; // exit the thread
-            }
-        }
+    QTimer coalesceTimer;
+    coalesceTimer.setSingleShot(true);
+    QObject::connect(&coalesceTimer, SIGNAL(timeout()), this, SLOT(emitReceivedBytes()));
+    m_coalesceTimer = &coalesceTimer;
 
-        // If there are too many errors on this link, disconnect.
-        if (isConnected() && (linkErrorCount > 150)) {
-            qDebug() << "linkErrorCount too high: re-connecting!";
-            linkErrorCount = 0;
-            emit communicationUpdate(getName(), tr("Link timeout, not receiving any data, attempting reconnect"));
+    QTimer reconnectTimer;
+    reconnectTimer.setSingleShot(true);
+    QObject::connect(&reconnectTimer, SIGNAL(timeout()), this, SLOT(reconnect()));
+    m_reconnectTimer = &reconnectTimer;
 
-            if (m_port) {
-                m_port->close();
-                delete m_port;
-                m_port = NULL;
+    QTimer linkTimer;
+    QObject::connect(&linkTimer, SIGNAL(timeout()), this, SLOT(checkLink()));
+    linkTimer.start(100);
 
-                emit disconnected();
-                emit connected(false);
-            }
+    // Bytes written before the port was open
+    transmitBufferedBytes();
 
-            QGC::SLEEP::msleep(500);
+    exec();
 
-            unsigned tries = 0;
-            const unsigned tries_max = 15;
-            while (!hardwareConnect(type) && tries < tries_max) {
-                tries++;
-                QGC::SLEEP::msleep(500);
-            }
+    m_coalesceTimer = NULL;
+    m_reconnectTimer = NULL;
+    m_receiveBuffer.clear();
+    {
+        QMutexLocker locker(&this->m_stoppMutex);
+        m_stopp = false;
+    }
 
-            // Give up
-            if (tries == tries_max) {
-                break;
-            }
+    if (m_port) {
+        qDebug() << "Closing Port #"<< __LINE__ << m_port->portName();
+        m_port->close();
+        delete m_port;
+        m_port = NULL;
 
-        }
+        emit disconnected();
+        emit connected(false);
+    }
+}
 
-        // Write all our buffered data out the serial port.
-        if (m_transmitBuffer.count() > 0) {
-            m_writeMutex.lock();
-            int numWritten = m_port->write(m_transmitBuffer);
-            bool txSuccess = m_port->flush();
-            txSuccess |= m_port->waitForBytesWritten(10);
-            if (!txSuccess || (numWritten != m_transmitBuffer.count())) {
-                linkErrorCount++;
-                qDebug() << "TX Error! written:" << txSuccess << "wrote" << numWritten << ", asked for " << m_transmitBuffer.count() << "bytes";
-            }
-            else {
+void SerialLink::receiveReadyBytes()
+{
+    if (!m_port) {
+        return;
+    }
 
-                // Since we were successful, reset out error counter.
-                linkErrorCount = 0;
-            }
+    m_dataMutex.lock();
+    if (m_receiveBuffer.isEmpty()) {
+        m_receiveStart = m_clock.nsecsElapsed() / 1000;
+    }
+    m_receiveBuffer += m_port->readAll();
+    m_dataMutex.unlock();
 
-            // Now that we transmit all of the data in the transmit buffer, flush it.
-            m_transmitBuffer = m_transmitBuffer.remove(0, numWritten);
-            m_writeMutex.unlock();
+    if (m_readCoalescing <= 0 || m_receiveBuffer.size() >= maxCoalescedBytes) {
+        emitReceivedBytes();
+    } else if (m_coalesceTimer && !m_coalesceTimer->isActive()) {
+        m_coalesceTimer->start(m_readCoalescing);
+    }
+}
 
-            // Log this written data for this timestep. If this value ends up being 0 due to
-            // write() failing, that's what we want as well.
-            QMutexLocker dataRateLocker(&dataRateMutex);
-            logDataRateToBuffer(outDataWriteAmounts, outDataWriteTimes, &outDataIndex, numWritten, QDateTime::currentMSecsSinceEpoch());
-        }
+void SerialLink::emitReceivedBytes()
+{
+    if (m_coalesceTimer) {
+        m_coalesceTimer->stop();
+    }
+    if (m_receiveBuffer.isEmpty()) {
+        return;
+    }
 
-        //wait n msecs for data to be ready
-        //[TODO][BB] lower to SerialLink::poll_interval?
-        m_dataMutex.lock();
-        bool success = m_port->waitForReadyRead(20);
-
-        if (success) {
-            QByteArray readData = m_port->readAll();
-            while (m_port->waitForReadyRead(10))
-                readData += m_port->readAll();
-            m_dataMutex.unlock();
-            if (readData.length() > 0) {
-                emit bytesReceived(this, readData);
-
-                // Log this data reception for this timestep
-                QMutexLocker dataRateLocker(&dataRateMutex);
-                logDataRateToBuffer(inDataWriteAmounts, inDataWriteTimes, &inDataIndex, readData.length(), QDateTime::currentMSecsSinceEpoch());
-
-                // Track the total amount of data read.
-                m_bytesRead += readData.length();
-                linkErrorCount = 0;
-            }
-        }
-        else {
-            m_dataMutex.unlock();
-            linkErrorCount++;
+    QByteArray readData = m_receiveBuffer;
+    m_receiveBuffer.clear();
+
+    emit bytesReceived(this, readData);
+
+    // Log this data reception and how long the first byte waited for delivery
+    linkStatistics.logBytesReceived(readData.length());
+    linkStatistics.logReceiveLatency(m_clock.nsecsElapsed() / 1000 - m_receiveStart);
+
+    // Track the total amount of data read.
+    m_bytesRead += readData.length();
+    m_lastReceive = m_clock.elapsed();
+    m_linkErrorCount = 0;
+}
+
+void SerialLink::transmitBufferedBytes()
+{
+    QMutexLocker locker(&m_writeMutex);
+
+    // Writes from now on have to schedule another call
+    m_transmitScheduled.store(0);
+
+    if (!m_port || !m_port->isOpen()) {
+        return;
+    }
+
+    // Only hand over what the port can write soon, the rest waits for bytesWritten
+    while (m_transmitCount > 0 && m_port->bytesToWrite() < portWriteLimit) {
+        int length = qMin(m_transmitCount, transmitBufferSize - m_transmitStart);
+        length = qMin(length, portWriteLimit - (int)m_port->bytesToWrite());
+
+        qint64 numWritten = m_port->write(m_transmitBuffer + m_transmitStart, length);
+        if (numWritten <= 0) {
+            m_linkErrorCount++;
+            qDebug() << "TX Error! wrote" << numWritten << ", asked for " << length << "bytes";
+            break;
         }
 
-        if (bytes != m_bytesRead) { // i.e things are good and data is being read.
-            bytes = m_bytesRead;
-            msecs = QDateTime::currentMSecsSinceEpoch();
+        m_transmitStart = (m_transmitStart + numWritten) % transmitBufferSize;
+        m_transmitCount -= numWritten;
+
+        // Log this written data for this timestep.
+        linkStatistics.logBytesSent(numWritten);
+    }
+}
+
+void SerialLink::checkLink()
+{
+    {
+        QMutexLocker locker(&this->m_stoppMutex);
+        if (m_stopp) {
+            quit(); // exit the thread
+            return;
         }
-        else {
-            if (QDateTime::currentMSecsSinceEpoch() - msecs > timeout) {
-                //It's been 10 seconds since the last data came in. Reset and try again
-                msecs = QDateTime::currentMSecsSinceEpoch();
-                if (msecs - initialmsecs > 25000) {
-                    //After initial 25 seconds, timeouts are increased to 30 seconds.
-                    //This prevents temporary silences from things like calibration commands
-                    //from screwing things up. In all reality, timeouts should be enabled/disabled
-                    //for events like that on a case by case basis.
-                    //TODO ^^
-                    timeout = 30000;
-                }
-            }
+    }
+
+    if (m_reconnectTimer->isActive()) {
+        return;
+    }
+
+    // Once the link is up for a while, allow for the long silences of calibrations
+    int timeout = m_clock.elapsed() > receiveTimeoutSettleTime ? settledReceiveTimeout : receiveTimeout;
+
+    // If the link is silent or there are too many errors on this link, reconnect.
+    if (isConnected() && (m_clock.elapsed() - m_lastReceive > timeout || m_linkErrorCount > 150)) {
+        qDebug() << "link timeout or linkErrorCount too high: re-connecting!";
+        m_linkErrorCount = 0;
+        emit communicationUpdate(getName(), tr("Link timeout, not receiving any data, attempting reconnect"));
+
+        if (m_port) {
+            m_port->close();
+            delete m_port;
+            m_port = NULL;
+
+            emit disconnected();
+            emit connected(false);
         }
-        QGC::SLEEP::msleep(SerialLink::poll_interval);
-    } // end of forever
-    
-    if (m_port) {
-        qDebug() << "Closing Port #"<< __LINE__ << m_port->portName();
-        m_port->close();
-        delete m_port;
-        m_port = NULL;
 
-        emit disconnected();
-        emit connected(false);
+        // The event loop keeps running between the attempts, so a disconnect request is handled right away
+        m_reconnectTries = 0;
+        m_reconnectTimer->start(reconnectInterval);
     }
 }
 
+void SerialLink::reconnect()
+{
+    if (hardwareConnect(type)) {
+        m_lastReceive = m_clock.elapsed();
+        transmitBufferedBytes();
+        return;
+    }
+
+    // Give up
+    if (++m_reconnectTries > reconnectTries) {
+        quit();
+        return;
+    }
+
+    m_reconnectTimer->start(reconnectInterval);
+}
+
+/**
+ * Queues the bytes in the transmit ring buffer, the link thread writes them
+ * to the port. Never blocks on the port, bytes which don't fit into the ring
+ * buffer are dropped.
+ **/
 void SerialLink::writeBytes(const char* data, qint64 size)
 {
     if(m_port && m_port->isOpen()) {
-
-        QByteArray byteArray(data, size);
         m_writeMutex.lock();
-        m_transmitBuffer.append(byteArray);
+        if (size > transmitBufferSize - m_transmitCount) {
+            m_writeMutex.unlock();
+            linkStatistics.logDroppedFrame();
+            return;
+        }
+
+        // Copy in up to two pieces, wrapping around at the end of the ring
+        int end = (m_transmitStart + m_transmitCount) % transmitBufferSize;
+        int first = qMin((int)size, transmitBufferSize - end);
+        memcpy(m_transmitBuffer + end, data, first);
+        memcpy(m_transmitBuffer, data + first, size - first);
+        m_transmitCount += size;
         m_writeMutex.unlock();
+
+        if (m_transmitScheduled.testAndSetOrdered(0, 1)) {
+            QMetaObject::invokeMethod(this, "transmitBufferedBytes", Qt::QueuedConnection);
+        }
     } else {
         // Error occured
         emit communicationError(getName(), tr("Could not send data - link %1 is disconnected!").arg(getName()));
@@ -418,6 +490,7 @@ bool SerialLink::disconnect()
             QMutexLocker locker(&m_stoppMutex);
             m_stopp = true;
         }
+        quit();
         wait(); // This will terminate the thread and close the serial port
 
         emit connected(false);
@@ -425,7 +498,11 @@ bool SerialLink::disconnect()
         return true;
     }
 
-    m_transmitBuffer.clear(); //clear the output buffer to avoid sending garbage at next connect
+    //clear the output buffer to avoid sending garbage at next connect
+    m_writeMutex.lock();
+    m_transmitStart = 0;
+    m_transmitCount = 0;
+    m_writeMutex.unlock();
 
     qDebug() << "already disconnected";
     return true;
@@ -501,6 +578,8 @@ bool SerialLink::hardwareConnect(QString &type)
 
     QObject::connect(m_port,SIGNAL(aboutToClose()),this,SIGNAL(disconnected()));
     QObject::connect(m_port, SIGNAL(error(QSerialPort::SerialPortError)), this, SLOT(linkError(QSerialPort::SerialPortError)));
+    QObject::connect(m_port, SIGNAL(readyRead()), this, SLOT(receiveReadyBytes()));
+    QObject::connect(m_port, SIGNAL(bytesWritten(qint64)), this, SLOT(transmitBufferedBytes()));
 
     checkIfCDC();
 
@@ -573,6 +652,20 @@ int SerialLink::getId() const
     return m_id;
 }
 
+int SerialLink::getReadCoalescing() const
+{
+    return m_readCoalescing;
+}
+
+/**
+ * @param msecs Time the first received byte may wait for more, 0 to deliver
+ *              every chunk of bytes as soon as the port reports it
+ **/
+void SerialLink::setReadCoalescing(int msecs)
+{
+    m_readCoalescing = qMax(0, msecs);
+}
+
 QString SerialLink::getName() const
 {
     return m_portName;
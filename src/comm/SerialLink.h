@@ -36,6 +36,9 @@ This file is part of the QGROUNDCONTROL project
 #include <QThread>
 #include <QMutex>
 #include <QString>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QAtomicInt>
 #include "QGCConfig.h"
 #include "SerialLinkInterface.h"
 
@@ -51,6 +54,9 @@ Q_DECLARE_METATYPE(QSerialPort::SerialPortError)
  * that handles the serial communication. All methods have therefore to be thread-
  * safe.
  *
+ * The thread runs an event loop which is woken up by the port as soon as data
+ * arrives or was written, nothing is polled. Bytes to send are queued in a ring
+ * buffer of fixed size and written without blocking.
  */
 class SerialLink : public SerialLinkInterface
 {
@@ -67,7 +73,14 @@ public:
                int stopBits=1);
     ~SerialLink();
 
-    static const int poll_interval = SERIAL_POLL_INTERVAL; ///< Polling interval, defined in QGCConfig.h
+    static const int transmitBufferSize = 16384;    ///< Capacity of the transmit ring buffer in bytes
+    static const int portWriteLimit = 1024;         ///< Bytes handed to the port at once, the rest stays in the ring
+    static const int maxCoalescedBytes = 1024;      ///< Received bytes are delivered once this many are collected
+    static const int receiveTimeout = 5000;         ///< Reconnect after this many ms without any received data
+    static const int settledReceiveTimeout = 30000; ///< Receive timeout once the link was up for receiveTimeoutSettleTime ms, calibrations keep the vehicle silent for long
+    static const int receiveTimeoutSettleTime = 25000;
+    static const int reconnectInterval = 500;       ///< Time between the attempts to reopen the port in ms
+    static const int reconnectTries = 15;           ///< Failed attempts to reopen the port before the link gives up
 
     /** @brief Get a list of the currently available ports */
     QList<QString> getCurrentPorts();
@@ -103,6 +116,9 @@ public:
     qint64 getCurrentInDataRate() const;
     qint64 getCurrentOutDataRate() const;
 
+    /** @brief Time received bytes are collected before they are delivered, 0 delivers them right away */
+    int getReadCoalescing() const;
+
     void loadSettings();
     void writeSettings();
 
@@ -125,6 +141,9 @@ public slots:
     // Set string rate
     bool setBaudRateString(const QString& rate);
 
+    /** @brief Collect received bytes for up to msecs before delivering them, trades latency for fewer deliveries */
+    void setReadCoalescing(int msecs);
+
     // Set ENUM values
     bool setBaudRateType(int rateIndex);
     bool setFlowType(int flow);
@@ -145,6 +164,18 @@ public slots:
 
     void linkError(QSerialPort::SerialPortError error);
 
+private slots:
+    /** @brief Reads the bytes the port received */
+    void receiveReadyBytes();
+    /** @brief Delivers the collected received bytes */
+    void emitReceivedBytes();
+    /** @brief Hands the bytes of the transmit ring buffer to the port, as much as it takes without blocking */
+    void transmitBufferedBytes();
+    /** @brief Handles disconnect requests and reconnects a silent or failing port */
+    void checkLink();
+    /** @brief Attempts to reopen the port after a link timeout, retried by the reconnect timer */
+    void reconnect();
+
 protected:
     quint64 m_bytesRead;
     QSerialPort* m_port;
@@ -157,7 +188,7 @@ protected:
     int m_timeout;
     int m_id;
     QMutex m_dataMutex;       // Mutex for reading data from m_port
-    QMutex m_writeMutex;      // Mutex for accessing the m_transmitBuffer.
+    QMutex m_writeMutex;      // Mutex for accessing the transmit ring buffer.
     QString type;
     bool m_is_cdc;
 
@@ -165,7 +196,19 @@ private:
     volatile bool m_stopp;
     volatile bool m_reqReset;
     QMutex m_stoppMutex; // Mutex for accessing m_stopp
-    QByteArray m_transmitBuffer; // An internal buffer for receiving data from member functions and actually transmitting them via the serial port.
+    char m_transmitBuffer[transmitBufferSize]; // Ring buffer of the bytes written by other threads which are not yet handed to the port
+    int m_transmitStart;        // Index of the oldest byte in m_transmitBuffer
+    int m_transmitCount;        // Number of bytes in m_transmitBuffer
+    QAtomicInt m_transmitScheduled; // A call to transmitBufferedBytes() is queued
+    QByteArray m_receiveBuffer; // Received bytes collected for delivery
+    qint64 m_receiveStart;      // Time the first byte in m_receiveBuffer arrived, in usecs of m_clock
+    qint64 m_lastReceive;       // Time any data was last received, in msecs of m_clock
+    QElapsedTimer m_clock;
+    QTimer* m_coalesceTimer;    // Delivers the collected bytes, lives in the link thread
+    QTimer* m_reconnectTimer;   // Schedules the attempts to reopen the port, lives in the link thread
+    int m_reconnectTries;       // Failed attempts to reopen the port since the link timed out
+    int m_readCoalescing;
+    int m_linkErrorCount;
 
     bool hardwareConnect(QString &type);
 
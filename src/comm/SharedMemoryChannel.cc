@@ -0,0 +1,239 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Byte rings in shared memory between the ground station and a local process
+
+#include <string.h>
+
+#include <QThread>
+#include <QElapsedTimer>
+
+#ifdef Q_OS_LINUX
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "SharedMemoryChannel.h"
+
+Q_STATIC_ASSERT(sizeof(QAtomicInt) == sizeof(int));
+Q_STATIC_ASSERT((SharedMemoryChannel::ringSize & (SharedMemoryChannel::ringSize - 1)) == 0);
+
+/// @brief One direction of the channel. The positions count all bytes ever written and read and
+/// wrap around, the difference is the number of bytes in the ring.
+struct SharedMemoryChannel::Ring {
+    QAtomicInt  writePos;
+    QAtomicInt  readPos;
+    QAtomicInt  sequence;   ///< Incremented after each write, the reader sleeps on it
+    QAtomicInt  waiting;    ///< Readers sleeping on sequence
+    char        data[SharedMemoryChannel::ringSize];
+};
+
+/// @brief Layout of the shared memory segment
+struct SharedMemoryChannel::Header {
+    QAtomicInt  magic;      ///< Set once the segment is initialized
+    qint32      version;
+    qint32      ringSize;
+    qint32      reserved;
+    Ring        toGroundStation;
+    Ring        toVehicle;
+};
+
+static const int _magic = 0x4D41564C;   // "MAVL"
+static const int _version = 1;
+
+SharedMemoryChannel::SharedMemoryChannel(const QString& name, Side side) :
+    _name(name),
+    _side(side),
+    _memory(key(name)),
+    _header(NULL)
+{
+
+}
+
+SharedMemoryChannel::~SharedMemoryChannel()
+{
+    close();
+}
+
+QString SharedMemoryChannel::key(const QString& name)
+{
+    return QString("qgroundcontrol-mavlink-%1").arg(name);
+}
+
+bool SharedMemoryChannel::open(void)
+{
+    if (isOpen()) {
+        return true;
+    }
+
+    if (_side == GroundStationSide) {
+        if (!_memory.create(sizeof(Header))) {
+            // Left over by a crashed ground station, or the vehicle side holds on to it
+            if (_memory.error() != QSharedMemory::AlreadyExists || !_memory.attach()) {
+                _errorString = _memory.errorString();
+                return false;
+            }
+        }
+
+        Header* header = (Header*)_memory.data();
+        header->magic.storeRelease(0);
+        memset((char*)header + sizeof(QAtomicInt), 0, sizeof(Header) - sizeof(QAtomicInt));
+        header->version = _version;
+        header->ringSize = ringSize;
+        header->magic.storeRelease(_magic);
+        _header = header;
+    } else {
+        if (!_memory.attach()) {
+            _errorString = _memory.errorString();
+            return false;
+        }
+
+        Header* header = (Header*)_memory.data();
+        if (_memory.size() < (int)sizeof(Header) || header->magic.loadAcquire() != _magic || header->version != _version || header->ringSize != ringSize) {
+            _errorString = QString("Shared memory segment %1 is not a MAVLink channel").arg(_name);
+            _memory.detach();
+            return false;
+        }
+        _header = header;
+    }
+
+    return true;
+}
+
+void SharedMemoryChannel::close(void)
+{
+    if (_header) {
+        _header = NULL;
+        _memory.detach();
+    }
+}
+
+SharedMemoryChannel::Ring* SharedMemoryChannel::_readRing(void) const
+{
+    Q_ASSERT(_header);
+    return _side == GroundStationSide ? &_header->toGroundStation : &_header->toVehicle;
+}
+
+SharedMemoryChannel::Ring* SharedMemoryChannel::_writeRing(void) const
+{
+    Q_ASSERT(_header);
+    return _side == GroundStationSide ? &_header->toVehicle : &_header->toGroundStation;
+}
+
+bool SharedMemoryChannel::write(const char* data, int length)
+{
+    if (!_header || length < 0 || length > ringSize) {
+        return false;
+    }
+
+    Ring* ring = _writeRing();
+    quint32 writePos = ring->writePos.load();
+    quint32 readPos = ring->readPos.loadAcquire();
+    if ((quint32)ringSize - (writePos - readPos) < (quint32)length) {
+        return false;
+    }
+
+    int offset = writePos & (ringSize - 1);
+    int first = qMin(length, ringSize - offset);
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, data + first, length - first);
+    ring->writePos.storeRelease(writePos + length);
+
+    // Full barrier, orders the position update before checking for a sleeping reader
+    ring->sequence.fetchAndAddOrdered(1);
+    if (ring->waiting.load() > 0) {
+#ifdef Q_OS_LINUX
+        syscall(SYS_futex, (int*)&ring->sequence, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    }
+
+    return true;
+}
+
+int SharedMemoryChannel::read(char* data, int maxLength)
+{
+    if (!_header || maxLength <= 0) {
+        return 0;
+    }
+
+    Ring* ring = _readRing();
+    quint32 readPos = ring->readPos.load();
+    quint32 writePos = ring->writePos.loadAcquire();
+    int length = qMin((quint32)maxLength, writePos - readPos);
+
+    int offset = readPos & (ringSize - 1);
+    int first = qMin(length, ringSize - offset);
+    memcpy(data, ring->data + offset, first);
+    memcpy(data + first, ring->data, length - first);
+    ring->readPos.storeRelease(readPos + length);
+
+    return length;
+}
+
+int SharedMemoryChannel::bytesAvailable(void) const
+{
+    if (!_header) {
+        return 0;
+    }
+
+    Ring* ring = _readRing();
+    return (quint32)ring->writePos.loadAcquire() - (quint32)ring->readPos.load();
+}
+
+bool SharedMemoryChannel::waitForData(int msecs)
+{
+    if (!_header) {
+        return false;
+    }
+    if (bytesAvailable() > 0) {
+        return true;
+    }
+
+    Ring* ring = _readRing();
+
+#ifdef Q_OS_LINUX
+    // The sequence is read before checking the ring: a write after the check changes it and
+    // the futex wait returns right away.
+    int sequence = ring->sequence.loadAcquire();
+    ring->waiting.fetchAndAddOrdered(1);
+    if (bytesAvailable() == 0) {
+        struct timespec timeout;
+        timeout.tv_sec = msecs / 1000;
+        timeout.tv_nsec = (msecs % 1000) * 1000000;
+        syscall(SYS_futex, (int*)&ring->sequence, FUTEX_WAIT, sequence, &timeout, NULL, 0);
+    }
+    ring->waiting.fetchAndAddOrdered(-1);
+#else
+    Q_UNUSED(ring);
+    QElapsedTimer timer;
+    timer.start();
+    while (bytesAvailable() == 0 && timer.elapsed() < msecs) {
+        QThread::msleep(1);
+    }
+#endif
+
+    return bytesAvailable() > 0;
+}
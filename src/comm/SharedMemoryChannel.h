@@ -0,0 +1,96 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Byte rings in shared memory between the ground station and a local process
+
+#ifndef SHAREDMEMORYCHANNEL_H
+#define SHAREDMEMORYCHANNEL_H
+
+#include <QSharedMemory>
+#include <QString>
+#include <QAtomicInt>
+
+/// @brief Two single producer, single consumer byte rings in a shared memory segment.
+///
+/// One ring carries bytes from the vehicle side (a simulator or companion process on the same
+/// machine) to the ground station, the other one the way back. Writes are all or nothing, so a
+/// MAVLink frame written in one call is never split by a full ring. A reader sleeping in
+/// waitForData() is woken through a futex on the ring on Linux, other platforms poll.
+///
+/// The ground station side creates the segment, the vehicle side attaches to it. Each side
+/// must only be used by one writing and one reading thread.
+class SharedMemoryChannel
+{
+public:
+    enum Side {
+        GroundStationSide,  ///< Creates the segment, reads the vehicle ring
+        VehicleSide         ///< Attaches to the segment, reads the ground station ring
+    };
+
+    SharedMemoryChannel(const QString& name, Side side);
+    ~SharedMemoryChannel();
+
+    /// @brief Creates or attaches to the segment
+    ///     @return false: failed, see errorString()
+    bool open(void);
+    void close(void);
+    bool isOpen(void) const { return _header != NULL; }
+    QString errorString(void) const { return _errorString; }
+    QString name(void) const { return _name; }
+
+    /// @brief Writes data to the ring read by the other side
+    ///     @return false: not enough space in the ring, nothing was written
+    bool write(const char* data, int length);
+
+    /// @brief Reads up to maxLength bytes from the ring written by the other side
+    ///     @return Number of bytes read
+    int read(char* data, int maxLength);
+
+    /// @brief Number of bytes which can be read
+    int bytesAvailable(void) const;
+
+    /// @brief Waits until there are bytes to read
+    ///     @return false: timed out
+    bool waitForData(int msecs);
+
+    /// @brief Key of the segment for a channel name
+    static QString key(const QString& name);
+
+    static const int ringSize = 1 << 20;    ///< Bytes in each ring, power of two
+
+private:
+    struct Ring;
+    struct Header;
+
+    Ring* _readRing(void) const;
+    Ring* _writeRing(void) const;
+
+    QString         _name;
+    Side            _side;
+    QSharedMemory   _memory;
+    Header*         _header;
+    QString         _errorString;
+};
+
+#endif
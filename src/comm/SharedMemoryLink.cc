@@ -0,0 +1,176 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Link to a simulator or companion process on the same machine through shared memory
+
+#include <QDebug>
+
+#include "SharedMemoryLink.h"
+
+const char* SharedMemoryLink::defaultChannelName = "vehicle";
+
+SharedMemoryLink::SharedMemoryLink(const QString& channelName) :
+    _channelName(channelName),
+    _channel(NULL),
+    _stop(false)
+{
+    _linkId = getNextLinkId();
+    _resetName();
+}
+
+SharedMemoryLink::~SharedMemoryLink()
+{
+    disconnect();
+}
+
+void SharedMemoryLink::setChannelName(const QString& channelName)
+{
+    bool reconnect = false;
+
+    if (isConnected()) {
+        disconnect();
+        reconnect = true;
+    }
+
+    _channelName = channelName;
+    _resetName();
+
+    if (reconnect) {
+        connect();
+    }
+}
+
+void SharedMemoryLink::_resetName(void)
+{
+    _name = QString("Shared Memory Link (%1)").arg(_channelName);
+    emit nameChanged(_name);
+}
+
+bool SharedMemoryLink::connect(void)
+{
+    if (isConnected()) {
+        return true;
+    }
+
+    SharedMemoryChannel* channel = new SharedMemoryChannel(_channelName, SharedMemoryChannel::GroundStationSide);
+    if (!channel->open()) {
+        emit communicationError(getName(), "Error connecting: " + channel->errorString());
+        delete channel;
+        return false;
+    }
+
+    _channel = channel;
+    _stop = false;
+    start(HighPriority);
+
+    emit connected(true);
+    emit connected();
+
+    return true;
+}
+
+bool SharedMemoryLink::disconnect(void)
+{
+    if (!_channel) {
+        return true;
+    }
+
+    _stop = true;
+    wait();
+
+    {
+        QMutexLocker locker(&_writeMutex);
+        delete _channel;
+        _channel = NULL;
+    }
+
+    emit disconnected();
+    emit connected(false);
+
+    return true;
+}
+
+void SharedMemoryLink::run(void)
+{
+    while (!_stop) {
+        if (_channel->waitForData(_waitTimeout)) {
+            readBytes();
+        }
+    }
+}
+
+void SharedMemoryLink::readBytes(void)
+{
+    char buffer[_readBufferSize];
+
+    int length = _channel->read(buffer, sizeof(buffer));
+    if (length > 0) {
+        emit bytesReceived(this, QByteArray(buffer, length));
+
+        // Log the amount and time received for future data rate calculations.
+        linkStatistics.logBytesReceived(length);
+    }
+}
+
+void SharedMemoryLink::writeBytes(const char* data, qint64 size)
+{
+    QMutexLocker locker(&_writeMutex);
+
+    if (!_channel) {
+        return;
+    }
+
+    if (_channel->write(data, (int)size)) {
+        // Log the amount and time written out for future data rate calculations.
+        linkStatistics.logBytesSent(size);
+    } else {
+        // The other side does not read, drop the bytes rather than blocking the sender
+        linkStatistics.logDroppedFrame();
+    }
+}
+
+qint64 SharedMemoryLink::bytesAvailable(void)
+{
+    return _channel ? _channel->bytesAvailable() : 0;
+}
+
+bool SharedMemoryLink::isConnected(void) const
+{
+    return _channel != NULL;
+}
+
+int SharedMemoryLink::getId(void) const
+{
+    return _linkId;
+}
+
+QString SharedMemoryLink::getName(void) const
+{
+    return _name;
+}
+
+qint64 SharedMemoryLink::getConnectionSpeed(void) const
+{
+    return 1000000000; // Memory bandwidth, 1 Gbit is a conservative guess
+}
@@ -0,0 +1,92 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Link to a simulator or companion process on the same machine through shared memory
+
+#ifndef SHAREDMEMORYLINK_H
+#define SHAREDMEMORYLINK_H
+
+#include <QString>
+#include <QMutex>
+
+#include "LinkInterface.h"
+#include "SharedMemoryChannel.h"
+
+/// @brief Carries MAVLink frames through a SharedMemoryChannel instead of the loopback network.
+///
+/// Made for high rate HIL and SITL on the same machine: no system call and no kernel copy per
+/// frame, the link thread only wakes up when the other side wrote something. The other side
+/// attaches to the channel by its name, see src/apps/shmproducer for an example.
+class SharedMemoryLink : public LinkInterface
+{
+    Q_OBJECT
+
+public:
+    SharedMemoryLink(const QString& channelName = defaultChannelName);
+    ~SharedMemoryLink();
+
+    QString getChannelName(void) const { return _channelName; }
+
+    // LinkInterface methods
+    virtual int     getId(void) const;
+    virtual QString getName(void) const;
+    virtual bool    isConnected(void) const;
+    virtual bool    connect(void);
+    virtual bool    disconnect(void);
+    virtual qint64  bytesAvailable(void);
+    virtual void    requestReset(void) {};
+    virtual qint64  getConnectionSpeed(void) const;
+
+    static const char* defaultChannelName;
+
+public slots:
+    /// @brief Sets the name of the channel, reconnects if connected
+    void setChannelName(const QString& channelName);
+
+    // From LinkInterface
+    virtual void writeBytes(const char* data, qint64 length);
+
+protected slots:
+    // From LinkInterface
+    virtual void readBytes(void);
+
+protected:
+    // From LinkInterface->QThread
+    virtual void run(void);
+
+private:
+    void _resetName(void);
+
+    QString                 _name;
+    QString                 _channelName;
+    int                     _linkId;
+    SharedMemoryChannel*    _channel;
+    QMutex                  _writeMutex;    ///< The channel takes a single writer, writes come from several threads
+    volatile bool           _stop;
+
+    static const int        _waitTimeout = 100;     ///< The link thread checks for a stop request at this interval in ms
+    static const int        _readBufferSize = 65536;
+};
+
+#endif
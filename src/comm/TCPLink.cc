@@ -28,6 +28,7 @@
 #include <iostream>
 #include "TCPLink.h"
 #include "LinkManager.h"
+#include "LinkReactor.h"
 #include "QGC.h"
 #include <QHostInfo>
 #include <QSignalSpy>
@@ -37,11 +38,37 @@
 ///
 ///     @author Don Gagne <don@thegagnes.com>
 
+TCPLinkSocket::TCPLinkSocket(void) :
+    QTcpSocket()
+{
+
+}
+
+void TCPLinkSocket::connectToPeer(const QString& hostName, quint16 port)
+{
+    connectToHost(hostName, port);
+    QTimer::singleShot(connectTimeoutMsecs, this, SLOT(_connectTimeout()));
+}
+
+void TCPLinkSocket::_connectTimeout(void)
+{
+    // A refused connection already reported an error and is unconnected
+    if (state() == HostLookupState || state() == ConnectingState) {
+        abort();
+        emit connectTimedOut();
+    }
+}
+
 TCPLink::TCPLink(QHostAddress hostAddress, quint16 socketPort) :
     _hostAddress(hostAddress),
     _port(socketPort),
     _socket(NULL),
-    _socketIsConnected(false)
+    _socketIsConnected(false),
+    _reactorAttached(false),
+    _mode(ClientMode),
+    _slowClientPolicy(DropSlowClientData),
+    _maxClientQueueBytes(defaultMaxClientQueueBytes),
+    _server(NULL)
 {
     // We're doing it wrong - because the Qt folks got the API wrong:
     // http://blog.qt.digia.com/blog/2010/06/17/youre-doing-it-wrong/
@@ -67,6 +94,14 @@ TCPLink::~TCPLink()
 
 void TCPLink::run()
 {
+    if (_mode == ServerMode) {
+        if (_startServer()) {
+            exec();
+        }
+        _stopServer();
+        return;
+    }
+
     _hardwareConnect();
 
 	exec();
@@ -111,6 +146,41 @@ void TCPLink::setPort(int port)
 	}
 }
 
+void TCPLink::setMode(int mode)
+{
+    bool reconnect = false;
+
+	if (this->isConnected()) {
+		disconnect();
+		reconnect = true;
+	}
+
+    _mode = (Mode)mode;
+    _resetName();
+
+	if (reconnect) {
+		connect();
+	}
+}
+
+void TCPLink::setSlowClientPolicy(int policy)
+{
+    QMutexLocker locker(&_clientsMutex);
+    _slowClientPolicy = (SlowClientPolicy)policy;
+}
+
+void TCPLink::setMaxClientQueueBytes(int bytes)
+{
+    QMutexLocker locker(&_clientsMutex);
+    _maxClientQueueBytes = bytes;
+}
+
+int TCPLink::getClientCount(void) const
+{
+    QMutexLocker locker(&_clientsMutex);
+    return _clients.count();
+}
+
 #ifdef TCPLINK_READWRITE_DEBUG
 void TCPLink::_writeDebugBytes(const char *data, qint16 size)
 {
@@ -140,11 +210,15 @@ void TCPLink::writeBytes(const char* data, qint64 size)
 #ifdef TCPLINK_READWRITE_DEBUG
     _writeDebugBytes(data, size);
 #endif
+    if (_mode == ServerMode) {
+        _queueForClients(data, size);
+        return;
+    }
+
     _socket->write(data, size);
 
     // Log the amount and time written out for future data rate calculations.
-    QMutexLocker dataRateLocker(&dataRateMutex);
-    logDataRateToBuffer(outDataWriteAmounts, outDataWriteTimes, &outDataIndex, size, QDateTime::currentMSecsSinceEpoch());
+    linkStatistics.logBytesSent(size);
 }
 
 /**
@@ -167,8 +241,7 @@ void TCPLink::readBytes()
         emit bytesReceived(this, buffer);
 
         // Log the amount and time received for future data rate calculations.
-        QMutexLocker dataRateLocker(&dataRateMutex);
-        logDataRateToBuffer(inDataWriteAmounts, inDataWriteTimes, &inDataIndex, byteCount, QDateTime::currentMSecsSinceEpoch());
+        linkStatistics.logBytesReceived(byteCount);
 
 #ifdef TCPLINK_READWRITE_DEBUG
         writeDebugBytes(buffer.data(), buffer.size());
@@ -199,12 +272,24 @@ bool TCPLink::disconnect()
     if (_socket)
 	{
         _socketIsConnected = false;
-		_socket->deleteLater(); // Make sure delete happens on correct thread
+        if (_reactorAttached) {
+            // Deletes the socket in the reactor thread, no slot is called afterwards
+            LinkReactor::instance()->detach(_socket);
+            _reactorAttached = false;
+        } else {
+            _socket->deleteLater(); // Make sure delete happens on correct thread
+        }
 		_socket = NULL;
 
         emit disconnected();
         emit connected(false);
-	}
+	} else if (_socketIsConnected) {
+        // Server mode, the link thread closed the server and the clients on exit
+        _socketIsConnected = false;
+
+        emit disconnected();
+        emit connected(false);
+    }
     
     return true;
 }
@@ -222,6 +307,26 @@ bool TCPLink::connect()
 		wait();
 	}
 
+    LinkReactor* reactor = LinkReactor::instance();
+    if (reactor->isEnabled() && _mode == ClientMode) {
+        // No thread of our own, the socket is handed to a reactor thread and connects from there.
+        // The link reports connected() once the other side answered.
+        if (_socket) {
+            disconnect();
+        }
+        TCPLinkSocket* socket = new TCPLinkSocket();
+        QObject::connect(socket, SIGNAL(readyRead()), this, SLOT(readBytes()), Qt::DirectConnection);
+        QObject::connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(_socketError(QAbstractSocket::SocketError)), Qt::DirectConnection);
+        QObject::connect(socket, SIGNAL(connected()), this, SLOT(_socketConnected()), Qt::DirectConnection);
+        QObject::connect(socket, SIGNAL(connectTimedOut()), this, SLOT(_socketConnectTimedOut()), Qt::DirectConnection);
+        _socket = socket;
+
+        reactor->attach(_socket);
+        _reactorAttached = true;
+        QMetaObject::invokeMethod(socket, "connectToPeer", Qt::QueuedConnection, Q_ARG(QString, _hostAddress.toString()), Q_ARG(quint16, _port));
+        return true;
+    }
+
     start(HighPriority);
 
     return true;
@@ -236,8 +341,9 @@ bool TCPLink::_hardwareConnect(void)
     
     _socket->connectToHost(_hostAddress, _port);
     
-    QObject::connect(_socket, SIGNAL(readyRead()), this, SLOT(readBytes()));
-    QObject::connect(_socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(_socketError(QAbstractSocket::SocketError)));
+    // The connections are direct, the link thread is not running if the socket is attached to the LinkReactor
+    QObject::connect(_socket, SIGNAL(readyRead()), this, SLOT(readBytes()), Qt::DirectConnection);
+    QObject::connect(_socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(_socketError(QAbstractSocket::SocketError)), Qt::DirectConnection);
     
     // Give the socket a second to connect to the other side otherwise error out
     if (!_socket->waitForConnected(1000))
@@ -259,12 +365,224 @@ bool TCPLink::_hardwareConnect(void)
     return true;
 }
 
+/// @brief Listens for clients, runs on the link thread
+bool TCPLink::_startServer(void)
+{
+    Q_ASSERT(_server == NULL);
+    _server = new QTcpServer();
+
+    QObject::connect(_server, SIGNAL(newConnection()), this, SLOT(_newClient()));
+
+    if (!_server->listen(_hostAddress, _port)) {
+        emit communicationError(getName(), "Error listening: " + _server->errorString());
+        return false;
+    }
+
+    _socketIsConnected = true;
+    emit connected(true);
+    emit connected();
+
+    return true;
+}
+
+/// @brief Closes the server and all clients, runs on the link thread
+void TCPLink::_stopServer(void)
+{
+    QList<QTcpSocket*> sockets;
+    {
+        QMutexLocker locker(&_clientsMutex);
+        sockets = _clients.keys();
+        qDeleteAll(_clients);
+        _clients.clear();
+    }
+
+    foreach (QTcpSocket* socket, sockets) {
+        socket->disconnect(this);
+        socket->abort();
+        delete socket;
+    }
+
+    delete _server;
+    _server = NULL;
+}
+
+void TCPLink::_newClient(void)
+{
+    while (QTcpSocket* socket = _server->nextPendingConnection()) {
+        // The clients are owned by the link, not by the server
+        socket->setParent(NULL);
+
+        QObject::connect(socket, SIGNAL(readyRead()), this, SLOT(_readClient()));
+        QObject::connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(_flushClients()));
+        QObject::connect(socket, SIGNAL(disconnected()), this, SLOT(_clientDisconnected()));
+
+        _Client* client = new _Client;
+        client->queueOffset = 0;
+        client->disconnectPending = false;
+
+        QMutexLocker locker(&_clientsMutex);
+        _clients.insert(socket, client);
+        qDebug() << "TCP:" << "Client connected" << socket->peerAddress().toString() << ":" << socket->peerPort();
+    }
+}
+
+void TCPLink::_clientDisconnected(void)
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    Q_ASSERT(socket);
+
+    {
+        QMutexLocker locker(&_clientsMutex);
+        delete _clients.take(socket);
+    }
+
+    socket->disconnect(this);
+    socket->deleteLater();
+}
+
+/// @brief Messages sent by clients are handled like messages received from a vehicle
+void TCPLink::_readClient(void)
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    Q_ASSERT(socket);
+
+    QByteArray buffer = socket->readAll();
+    if (buffer.isEmpty()) {
+        return;
+    }
+    linkStatistics.logBytesReceived(buffer.size());
+
+    // Only this thread touches the framers, removing a client happens here as well
+    MAVLinkFramer* framer;
+    {
+        QMutexLocker locker(&_clientsMutex);
+        _Client* client = _clients.value(socket);
+        if (!client) {
+            return;
+        }
+        framer = &client->framer;
+    }
+
+    // A frame split across two reads stays with its client until it is complete, all clients
+    // share the parser of the link which must only ever see whole frames
+    QByteArray frames;
+    mavlink_message_t message;
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    framer->setInput(buffer.constData(), buffer.size());
+    while (framer->nextMessage(&message)) {
+        int length = mavlink_msg_to_send_buffer(frame, &message);
+        frames.append((const char*)frame, length);
+    }
+
+    if (frames.size()) {
+        emit bytesReceived(this, frames);
+    }
+}
+
+/// @brief Queues the bytes for all clients, called from the writing thread
+void TCPLink::_queueForClients(const char* data, qint64 size)
+{
+    {
+        QMutexLocker locker(&_clientsMutex);
+
+        if (_clients.isEmpty()) {
+            return;
+        }
+
+        foreach (_Client* client, _clients) {
+            if (client->disconnectPending) {
+                continue;
+            }
+            if (client->queue.size() - client->queueOffset + size > _maxClientQueueBytes) {
+                // The client does not keep up
+                if (_slowClientPolicy == DisconnectSlowClient) {
+                    client->disconnectPending = true;
+                } else {
+                    linkStatistics.logDroppedFrame();
+                }
+                continue;
+            }
+            if (client->queueOffset && client->queueOffset >= client->queue.size() / 2) {
+                // Move the unsent bytes to the front once the sent ones take up half the buffer,
+                // which keeps the cost per byte constant
+                client->queue.remove(0, client->queueOffset);
+                client->queueOffset = 0;
+            }
+            client->queue.append(data, size);
+        }
+    }
+
+    // One flush handles everything queued up to then
+    if (_flushScheduled.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "_flushClients", Qt::QueuedConnection);
+    }
+}
+
+/// @brief Hands the queued bytes to the client sockets, runs on the link thread
+void TCPLink::_flushClients(void)
+{
+    _flushScheduled.fetchAndStoreOrdered(0);
+
+    QList<QTcpSocket*> slowClients;
+    {
+        QMutexLocker locker(&_clientsMutex);
+
+        QHash<QTcpSocket*, _Client*>::iterator i;
+        for (i = _clients.begin(); i != _clients.end(); ++i) {
+            QTcpSocket* socket = i.key();
+            _Client* client = i.value();
+
+            if (client->disconnectPending) {
+                slowClients.append(socket);
+                continue;
+            }
+
+            // Keep the bytes in our bounded queue rather than in the unbounded socket buffer
+            qint64 room = _socketWriteLimit - socket->bytesToWrite();
+            int pending = client->queue.size() - client->queueOffset;
+            if (room <= 0 || pending == 0) {
+                continue;
+            }
+
+            qint64 written = socket->write(client->queue.constData() + client->queueOffset, qMin(room, (qint64)pending));
+            if (written > 0) {
+                client->queueOffset += (int)written;
+                if (client->queueOffset == client->queue.size()) {
+                    client->queue.clear();
+                    client->queueOffset = 0;
+                }
+                linkStatistics.logBytesSent(written);
+            }
+        }
+    }
+
+    // Outside the lock, abort() emits disconnected() right away
+    foreach (QTcpSocket* socket, slowClients) {
+        qDebug() << "TCP:" << "Disconnecting slow client" << socket->peerAddress().toString() << ":" << socket->peerPort();
+        socket->abort();
+    }
+}
+
 void TCPLink::_socketError(QAbstractSocket::SocketError socketError)
 {
     Q_UNUSED(socketError);
     emit communicationError(getName(), "Error on socket: " + _socket->errorString());
 }
 
+/// @brief The socket connected from a LinkReactor thread
+void TCPLink::_socketConnected(void)
+{
+    _socketIsConnected = true;
+    emit connected(true);
+    emit connected();
+}
+
+/// @brief The socket of a LinkReactor thread got no answer
+void TCPLink::_socketConnectTimedOut(void)
+{
+    emit communicationError(getName(), "Connection failed");
+}
+
 /**
  * @brief Check if connection is active.
  *
@@ -302,7 +620,11 @@ qint64 TCPLink::getCurrentOutDataRate() const
 
 void TCPLink::_resetName(void)
 {
-    _name = QString("TCP Link (host:%1 port:%2)").arg(_hostAddress.toString()).arg(_port);
+    if (_mode == ServerMode) {
+        _name = QString("TCP Server (host:%1 port:%2)").arg(_hostAddress.toString()).arg(_port);
+    } else {
+        _name = QString("TCP Link (host:%1 port:%2)").arg(_hostAddress.toString()).arg(_port);
+    }
     emit nameChanged(_name);
 }
 
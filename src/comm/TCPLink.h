@@ -36,20 +36,65 @@
 #include <QHostAddress>
 #include <LinkInterface.h>
 #include "QGCConfig.h"
+#include "MAVLinkFramer.h"
 
 // Even though QAbstractSocket::SocketError is used in a signal by Qt, Qt doesn't declare it as a meta type.
 // This in turn causes debug output to be kicked out about not being able to queue the signal. We declare it
 // as a meta type to silence that.
 #include <QMetaType>
 #include <QTcpSocket>
+#include <QTcpServer>
+#include <QHash>
+#include <QAtomicInt>
 
 //#define TCPLINK_READWRITE_DEBUG   // Use to debug data reads/writes
 
+/// @brief Client mode socket which connects from the thread it lives in, used with the LinkReactor
+/// so the connect doesn't block the thread which connects the link.
+class TCPLinkSocket : public QTcpSocket
+{
+    Q_OBJECT
+
+public:
+    TCPLinkSocket(void);
+
+    static const int connectTimeoutMsecs = 1000;    ///< Connecting fails if the other side did not answer by then
+
+public slots:
+    /// @brief Starts connecting, queue the call to run it in the thread of the socket
+    void connectToPeer(const QString& hostName, quint16 port);
+
+signals:
+    /// @brief The other side did not answer in time
+    void connectTimedOut(void);
+
+private slots:
+    void _connectTimeout(void);
+};
+
+/// @brief TCP link, either connecting to a vehicle (client mode) or serving many downstream clients
+/// like analysis tools or secondary ground stations (server mode).
+///
+/// In server mode everything written to the link is sent to all clients. Each client has a bounded
+/// queue, a client which does not keep up either loses the messages which do not fit or is
+/// disconnected, so it can't hold up the other clients or the writing thread. The bytes of each
+/// client are framed separately and only whole messages are passed on, so the messages of clients
+/// sending at the same time don't get mixed up in the byte stream of the link.
 class TCPLink : public LinkInterface
 {
     Q_OBJECT
     
 public:
+    enum Mode {
+        ClientMode,     ///< Connect to the host address
+        ServerMode      ///< Listen on the host address and accept clients
+    };
+
+    enum SlowClientPolicy {
+        DropSlowClientData,     ///< Drop the messages which do not fit into the queue of the client
+        DisconnectSlowClient    ///< Disconnect a client once its queue is full
+    };
+
     TCPLink(QHostAddress hostAddress = QHostAddress::LocalHost, quint16 socketPort = 5760);
     ~TCPLink();
     
@@ -58,6 +103,14 @@ public:
     QHostAddress getHostAddress(void) const { return _hostAddress; }
     quint16 getPort(void) const { return _port; }
     QTcpSocket* getSocket(void) { return _socket; }
+
+    Mode getMode(void) const { return _mode; }
+    SlowClientPolicy getSlowClientPolicy(void) const { return _slowClientPolicy; }
+    int getMaxClientQueueBytes(void) const { return _maxClientQueueBytes; }
+    /// @brief Number of clients connected in server mode
+    int getClientCount(void) const;
+
+    static const int defaultMaxClientQueueBytes = 256 * 1024;
     
     void signalBytesWritten(void);
 
@@ -78,6 +131,10 @@ public:
 public slots:
     void setHostAddress(const QString& hostAddress);
     void setPort(int port);
+    /// @brief Switches between client and server mode, reconnects if connected
+    void setMode(int mode);
+    void setSlowClientPolicy(int policy);
+    void setMaxClientQueueBytes(int bytes);
     
     // From LinkInterface
     virtual void writeBytes(const char* data, qint64 length);
@@ -87,6 +144,12 @@ public slots:
 
 protected slots:
     void _socketError(QAbstractSocket::SocketError socketError);
+    void _socketConnected(void);
+    void _socketConnectTimedOut(void);
+    void _newClient(void);
+    void _clientDisconnected(void);
+    void _readClient(void);
+    void _flushClients(void);
 
     // From LinkInterface
     virtual void readBytes(void);
@@ -96,8 +159,19 @@ protected:
     virtual void run(void);
     
 private:
+    /// @brief A client connected in server mode
+    struct _Client {
+        QByteArray      queue;              ///< Bytes waiting to be handed to the socket, from queueOffset on
+        int             queueOffset;        ///< Bytes at the start of queue which were already handed to the socket
+        bool            disconnectPending;  ///< Queue overflowed with DisconnectSlowClient policy
+        MAVLinkFramer   framer;             ///< Holds the partial frame of the client between reads, link thread only
+    };
+
     void _resetName(void);
 	bool _hardwareConnect(void);
+    bool _startServer(void);
+    void _stopServer(void);
+    void _queueForClients(const char* data, qint64 size);
 #ifdef TCPLINK_READWRITE_DEBUG
     void _writeDebugBytes(const char *data, qint16 size);
 #endif
@@ -108,6 +182,17 @@ private:
     int             _linkId;
     QTcpSocket*     _socket;
     bool            _socketIsConnected;
+    bool            _reactorAttached;   ///< The socket lives in a LinkReactor thread instead of the link thread
+
+    Mode                            _mode;
+    SlowClientPolicy                _slowClientPolicy;
+    int                             _maxClientQueueBytes;
+    QTcpServer*                     _server;
+    QHash<QTcpSocket*, _Client*>    _clients;
+    mutable QMutex                  _clientsMutex;      ///< Protects _clients, written to from the protocol thread
+    QAtomicInt                      _flushScheduled;
+
+    static const int _socketWriteLimit = 64 * 1024;     ///< Bytes handed to a client socket beyond those it has not sent yet
     
     quint64 _bitsSentTotal;
     quint64 _bitsSentCurrent;
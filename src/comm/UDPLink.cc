@@ -32,15 +32,28 @@ This file is part of the QGROUNDCONTROL project
 #include <QList>
 #include <QDebug>
 #include <QMutexLocker>
+#include <QVarLengthArray>
 #include <iostream>
 #include "UDPLink.h"
 #include "LinkManager.h"
+#include "LinkReactor.h"
 #include "QGC.h"
 #include <QHostInfo>
+#ifdef Q_OS_LINUX
+#include <QSocketNotifier>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
 //#include <netinet/in.h>
 
 UDPLink::UDPLink(QHostAddress host, quint16 port) :
-    socket(NULL)
+    socket(NULL),
+    reactorAttached(false),
+    peerTimeout(defaultPeerTimeout),
+    receiveBuffers(new char[receiveBatchSize * receiveBufferSize])
 {
     // We're doing it wrong - because the Qt folks got the API wrong:
     // http://blog.qt.digia.com/blog/2010/06/17/youre-doing-it-wrong/
@@ -67,6 +80,8 @@ UDPLink::~UDPLink()
     wait();
 
 	this->deleteLater();
+
+    delete[] receiveBuffers;
 }
 
 /**
@@ -75,6 +90,7 @@ UDPLink::~UDPLink()
  **/
 void UDPLink::run()
 {
+    peerClock.start();
     hardwareConnect();
 
     exec();
@@ -135,10 +151,10 @@ void UDPLink::addHost(const QString& host)
                     address = hostAddresses.at(i);
                 }
             }
-            hosts.append(address);
             //qDebug() << "Address:" << address.toString();
             // Set port according to user input
-            ports.append(host.split(":").last().toInt());
+            QMutexLocker locker(&peersMutex);
+            updatePeer(address, host.split(":").last().toInt(), -1);
         }
     }
     else
@@ -146,10 +162,9 @@ void UDPLink::addHost(const QString& host)
         QHostInfo info = QHostInfo::fromName(host);
         if (info.error() == QHostInfo::NoError)
         {
-            // Add host
-            hosts.append(info.addresses().first());
-            // Set port according to default (this port)
-            ports.append(port);
+            // Add host, set port according to default (this port)
+            QMutexLocker locker(&peersMutex);
+            updatePeer(info.addresses().first(), port, -1);
         }
     }
 }
@@ -170,101 +185,334 @@ void UDPLink::removeHost(const QString& hostname)
             address = hostAddresses.at(i);
         }
     }
-    for (int i = 0; i < hosts.count(); ++i)
+    QMutexLocker locker(&peersMutex);
+    QHash<PeerKey, Peer>::iterator i = peers.begin();
+    while (i != peers.end())
+    {
+        if (i.key().first == address)
+        {
+            i = peers.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    updatePeerList();
+}
+
+QList<QHostAddress> UDPLink::getHosts() const
+{
+    QMutexLocker locker(&peersMutex);
+    QList<QHostAddress> hosts;
+    for (int i = 0; i < peerList.size(); i++)
+    {
+        hosts.append(peerList.at(i).address);
+    }
+    return hosts;
+}
+
+int UDPLink::getPeerCount() const
+{
+    QMutexLocker locker(&peersMutex);
+    return peerList.size();
+}
+
+void UDPLink::updatePeer(const QHostAddress& address, quint16 port, qint64 lastHeard)
+{
+    PeerKey key(address, port);
+    QHash<PeerKey, Peer>::iterator i = peers.find(key);
+    if (i != peers.end())
+    {
+        // Hosts added by the user stay, whether they are heard or not
+        if (i.value().lastHeard >= 0)
+        {
+            i.value().lastHeard = lastHeard;
+        }
+        return;
+    }
+
+    Peer peer;
+    peer.address = address;
+    peer.port = port;
+    peer.lastHeard = lastHeard;
+#ifdef Q_OS_LINUX
+    if (address.protocol() == QAbstractSocket::IPv6Protocol)
+    {
+        struct sockaddr_in6 sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin6_family = AF_INET6;
+        sa.sin6_port = htons(port);
+        Q_IPV6ADDR ip6 = address.toIPv6Address();
+        memcpy(&sa.sin6_addr, &ip6, sizeof(sa.sin6_addr));
+        peer.socketAddress = QByteArray((const char*)&sa, sizeof(sa));
+    }
+    else
+    {
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = htonl(address.toIPv4Address());
+        peer.socketAddress = QByteArray((const char*)&sa, sizeof(sa));
+    }
+#endif
+    peers.insert(key, peer);
+    // Only a new or removed peer changes what is sent to, the times heard are not needed by the writers
+    updatePeerList();
+}
+
+void UDPLink::updatePeerList()
+{
+    peerList = peers.values().toVector();
+}
+
+void UDPLink::removeStalePeers()
+{
+    qint64 now = peerClock.elapsed();
+    QMutexLocker locker(&peersMutex);
+    bool removed = false;
+    QHash<PeerKey, Peer>::iterator i = peers.begin();
+    while (i != peers.end())
     {
-        if (hosts.at(i) == address)
+        if (i.value().lastHeard >= 0 && now - i.value().lastHeard > peerTimeout)
         {
-            hosts.removeAt(i);
-            ports.removeAt(i);
+            qDebug() << "UDP:" << "Dropping silent peer" << i.key().first.toString() << ":" << i.key().second;
+            i = peers.erase(i);
+            removed = true;
         }
+        else
+        {
+            ++i;
+        }
+    }
+    if (removed)
+    {
+        updatePeerList();
     }
 }
 
 void UDPLink::writeBytes(const char* data, qint64 size)
 {
-    // Broadcast to all connected systems
-    for (int h = 0; h < hosts.size(); h++)
+    if (!socket)
     {
-        QHostAddress currentHost = hosts.at(h);
-        quint16 currentPort = ports.at(h);
+        return;
+    }
+
+    // Take a copy of the peers, sending happens without holding the lock
+    QVector<Peer> currentPeers;
+    {
+        QMutexLocker locker(&peersMutex);
+        currentPeers = peerList;
+    }
+    if (currentPeers.isEmpty())
+    {
+        return;
+    }
+
 //#define UDPLINK_DEBUG
 #ifdef UDPLINK_DEBUG
-        QString bytes;
-        QString ascii;
-        for (int i=0; i<size; i++)
+    QString bytes;
+    QString ascii;
+    for (int i=0; i<size; i++)
+    {
+        unsigned char v = data[i];
+        bytes.append(QString().sprintf("%02x ", v));
+        if (data[i] > 31 && data[i] < 127)
         {
-            unsigned char v = data[i];
-            bytes.append(QString().sprintf("%02x ", v));
-            if (data[i] > 31 && data[i] < 127)
-            {
-                ascii.append(data[i]);
-            }
-            else
+            ascii.append(data[i]);
+        }
+        else
+        {
+            ascii.append(219);
+        }
+    }
+    qDebug() << "Sent" << size << "bytes to" << currentPeers.size() << "peers, data:";
+    qDebug() << bytes;
+    qDebug() << "ASCII:" << ascii;
+#endif
+
+    int sent = 0;
+#ifdef Q_OS_LINUX
+    // Broadcast to all connected systems with a single system call
+    struct iovec iov;
+    iov.iov_base = (void*)data;
+    iov.iov_len = size;
+
+    QVarLengthArray<struct mmsghdr, receiveBatchSize> messages(currentPeers.size());
+    memset(messages.data(), 0, sizeof(struct mmsghdr) * messages.size());
+    for (int p = 0; p < currentPeers.size(); p++)
+    {
+        messages[p].msg_hdr.msg_name = (void*)currentPeers.at(p).socketAddress.constData();
+        messages[p].msg_hdr.msg_namelen = currentPeers.at(p).socketAddress.size();
+        messages[p].msg_hdr.msg_iov = &iov;
+        messages[p].msg_hdr.msg_iovlen = 1;
+    }
+
+    int fd = socket->socketDescriptor();
+    int next = 0;
+    while (next < messages.size())
+    {
+        int result = sendmmsg(fd, messages.data() + next, messages.size() - next, 0);
+        if (result < 0)
+        {
+            if (errno == EINTR)
             {
-                ascii.append(219);
+                continue;
             }
+            // A peer which is not reachable does not stop the others
+            next++;
+            continue;
         }
-        qDebug() << "Sent" << size << "bytes to" << currentHost.toString() << ":" << currentPort << "data:";
-        qDebug() << bytes;
-        qDebug() << "ASCII:" << ascii;
+        next += result;
+        sent += result;
+    }
+#else
+    // Broadcast to all connected systems
+    for (int p = 0; p < currentPeers.size(); p++)
+    {
+        if (socket->writeDatagram(data, size, currentPeers.at(p).address, currentPeers.at(p).port) >= 0)
+        {
+            sent++;
+        }
+    }
 #endif
-        socket->writeDatagram(data, size, currentHost, currentPort);
 
-        // Log the amount and time written out for future data rate calculations.
-        QMutexLocker dataRateLocker(&dataRateMutex);
-        logDataRateToBuffer(outDataWriteAmounts, outDataWriteTimes, &outDataIndex, size, QDateTime::currentMSecsSinceEpoch());
-    }
+    // Log the amount and time written out for future data rate calculations.
+    linkStatistics.logBytesSent((int)(size * sent));
 }
 
 /**
- * @brief Read a number of bytes from the interface.
+ * @brief Read the pending datagrams from the interface.
  *
- * @param data Pointer to the data byte array to write the bytes to
- * @param maxLength The maximum number of bytes to write
+ * All datagrams pending are emitted with a single bytesReceived() signal,
+ * the senders are added to the peers or their time heard is refreshed.
  **/
 void UDPLink::readBytes()
 {
-    while (socket->hasPendingDatagrams())
+    if (!socket)
     {
-        QByteArray datagram;
-        datagram.resize(socket->pendingDatagramSize());
+        return;
+    }
 
-        QHostAddress sender;
-        quint16 senderPort;
-        socket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+#ifdef Q_OS_LINUX
+    struct mmsghdr messages[receiveBatchSize];
+    struct iovec iovecs[receiveBatchSize];
+    struct sockaddr_storage senders[receiveBatchSize];
+
+    int fd = socket->socketDescriptor();
+    forever
+    {
+        memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < receiveBatchSize; i++)
+        {
+            iovecs[i].iov_base = receiveBuffers + i * receiveBufferSize;
+            iovecs[i].iov_len = receiveBufferSize;
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = &senders[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+        }
 
-        // FIXME TODO Check if this method is better than retrieving the data by individual processes
-        emit bytesReceived(this, datagram);
+        int count = recvmmsg(fd, messages, receiveBatchSize, MSG_DONTWAIT, NULL);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            // EAGAIN, nothing left to read
+            break;
+        }
+
+        int length = 0;
+        for (int i = 0; i < count; i++)
+        {
+            length += messages[i].msg_len;
+        }
+        QByteArray data;
+        data.reserve(length);
+        for (int i = 0; i < count; i++)
+        {
+            data.append(receiveBuffers + i * receiveBufferSize, messages[i].msg_len);
+        }
+
+        qint64 now = peerClock.elapsed();
+        {
+            QMutexLocker locker(&peersMutex);
+            for (int i = 0; i < count; i++)
+            {
+                const struct sockaddr* sender = (const struct sockaddr*)&senders[i];
+                quint16 senderPort;
+                if (sender->sa_family == AF_INET6)
+                {
+                    senderPort = ntohs(((const struct sockaddr_in6*)sender)->sin6_port);
+                }
+                else
+                {
+                    senderPort = ntohs(((const struct sockaddr_in*)sender)->sin_port);
+                }
+                updatePeer(QHostAddress(sender), senderPort, now);
+            }
+        }
+
+        emit bytesReceived(this, data);
 
         // Log this data reception for this timestep
-        QMutexLocker dataRateLocker(&dataRateMutex);
-        logDataRateToBuffer(inDataWriteAmounts, inDataWriteTimes, &inDataIndex, datagram.length(), QDateTime::currentMSecsSinceEpoch());
+        linkStatistics.logBytesReceived(length);
 
+        if (count < receiveBatchSize)
+        {
+            break;
+        }
+    }
+#else
+    readDatagrams();
+#endif
+}
 
-//        // Echo data for debugging purposes
-//        std::cerr << __FILE__ << __LINE__ << "Received datagram:" << std::endl;
-//        int i;
-//        for (i=0; i<s; i++)
-//        {
-//            unsigned int v=data[i];
-//            fprintf(stderr,"%02x ", v);
-//        }
-//        std::cerr << std::endl;
+void UDPLink::readDatagrams()
+{
+    QByteArray data;
+    QVector<PeerKey> senders;
 
+    while (socket->hasPendingDatagrams())
+    {
+        qint64 size = socket->pendingDatagramSize();
+        if (size > receiveBufferSize)
+        {
+            size = receiveBufferSize;
+        }
 
-        // Add host to broadcast list if not yet present
-        if (!hosts.contains(sender))
+        QHostAddress sender;
+        quint16 senderPort;
+        qint64 length = socket->readDatagram(receiveBuffers, size, &sender, &senderPort);
+        if (length < 0)
         {
-            hosts.append(sender);
-            ports.append(senderPort);
-            //        ports->insert(sender, senderPort);
+            break;
         }
-        else
+        data.append(receiveBuffers, length);
+        senders.append(PeerKey(sender, senderPort));
+    }
+
+    if (senders.isEmpty())
+    {
+        return;
+    }
+
+    qint64 now = peerClock.elapsed();
+    {
+        QMutexLocker locker(&peersMutex);
+        for (int i = 0; i < senders.size(); i++)
         {
-            int index = hosts.indexOf(sender);
-            ports.replace(index, senderPort);
+            updatePeer(senders.at(i).first, senders.at(i).second, now);
         }
     }
+
+    emit bytesReceived(this, data);
+
+    // Log this data reception for this timestep
+    linkStatistics.logBytesReceived(data.length());
 }
 
 
@@ -290,8 +538,17 @@ bool UDPLink::disconnect()
 
         if(socket)
 	{
-		// Make sure delete happen on correct thread
-		socket->deleteLater();
+        if (reactorAttached)
+        {
+            // Deletes the socket in the reactor thread, no slot is called afterwards
+            LinkReactor::instance()->detach(socket);
+            reactorAttached = false;
+        }
+        else
+        {
+            // Make sure delete happen on correct thread
+            socket->deleteLater();
+        }
 		socket = NULL;
 	}
 
@@ -314,6 +571,24 @@ bool UDPLink::connect()
 		this->quit();
 		this->wait();
 	}
+
+    LinkReactor* reactor = LinkReactor::instance();
+    if (reactor->isEnabled())
+    {
+        // No thread of our own, the socket is set up here and then handed to a reactor thread
+        if (socket)
+        {
+            disconnect();
+        }
+        peerClock.start();
+        if (hardwareConnect())
+        {
+            reactor->attach(socket);
+            reactorAttached = true;
+        }
+        return connectState;
+    }
+
     bool connected = true;
     start(HighPriority);
     return connected;
@@ -360,8 +635,23 @@ bool UDPLink::hardwareConnect(void)
     }
     */
 
+    // Everything created here is a child of the socket, so it moves along if the socket is attached
+    // to the LinkReactor. The connections are direct, the link thread may not be running.
     //QObject::connect(socket, SIGNAL(readyRead()), this, SLOT(readPendingDatagrams()));
-    QObject::connect(socket, SIGNAL(readyRead()), this, SLOT(readBytes()));
+#ifdef Q_OS_LINUX
+    // The datagrams are read past QUdpSocket, which only re-arms readyRead() from readDatagram()
+    if (connectState)
+    {
+        QSocketNotifier* notifier = new QSocketNotifier(socket->socketDescriptor(), QSocketNotifier::Read, socket);
+        QObject::connect(notifier, SIGNAL(activated(int)), this, SLOT(readBytes()), Qt::DirectConnection);
+    }
+#else
+    QObject::connect(socket, SIGNAL(readyRead()), this, SLOT(readBytes()), Qt::DirectConnection);
+#endif
+
+    QTimer* peerTimer = new QTimer(socket);
+    QObject::connect(peerTimer, SIGNAL(timeout()), this, SLOT(removeStalePeers()), Qt::DirectConnection);
+    peerTimer->start(1000);
 
     emit connected(connectState);
     if (connectState) {
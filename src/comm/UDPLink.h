@@ -34,11 +34,28 @@ This file is part of the QGROUNDCONTROL project
 #include <QString>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QPair>
+#include <QVector>
 #include <QMutex>
+#include <QElapsedTimer>
 #include <QUdpSocket>
 #include <LinkInterface.h>
 #include "QGCConfig.h"
 
+/**
+ * @brief UDP link to any number of peers.
+ *
+ * Every peer a datagram is received from is added to the peers the link sends to,
+ * peers which were not heard for getPeerTimeout() ms are dropped again. Hosts added with
+ * addHost() are kept until they are removed. The peers are kept in a hash table keyed
+ * by address and port, so SITL instances on the same host are separate peers.
+ *
+ * On Linux datagrams are received and sent in batches with recvmmsg() and sendmmsg(),
+ * into receive buffers which are allocated once.
+ *
+ * If the LinkReactor is enabled the socket is run by a shared reactor thread instead of the link thread.
+ */
 class UDPLink : public LinkInterface
 {
     Q_OBJECT
@@ -67,10 +84,24 @@ public:
     int getParityType() const;
     int getDataBitsType() const;
     int getStopBitsType() const;
-    QList<QHostAddress> getHosts() const {
-        return hosts;
+    /** @brief Get the addresses of all peers */
+    QList<QHostAddress> getHosts() const;
+    /** @brief Get the number of peers messages are sent to */
+    int getPeerCount() const;
+
+    /** @brief Get the time in ms after which peers which were not heard are dropped */
+    int getPeerTimeout() const {
+        return peerTimeout;
+    }
+    /** @brief Set the time in ms after which peers which were not heard are dropped */
+    void setPeerTimeout(int msecs) {
+        peerTimeout = msecs;
     }
 
+    static const int defaultPeerTimeout = 10000;    ///< Peers not heard for this many ms are dropped
+    static const int receiveBatchSize = 32;         ///< Datagrams received with one system call
+    static const int receiveBufferSize = 4096;      ///< Size of each receive buffer, larger datagrams are truncated
+
     // Extensive statistics for scientific purposes
     qint64 getConnectionSpeed() const;
     qint64 getCurrentInDataRate() const;
@@ -88,6 +119,8 @@ public slots:
     /** @brief Remove a host from broadcasting messages to */
     void removeHost(const QString& host);
     //    void readPendingDatagrams();
+    /** @brief Drop the peers which were not heard for getPeerTimeout() ms */
+    void removeStalePeers();
 
     void readBytes();
     /**
@@ -107,8 +140,22 @@ protected:
     int id;
     QUdpSocket* socket;
     bool connectState;
-    QList<QHostAddress> hosts;
-    QList<quint16> ports;
+    bool reactorAttached;           ///< The socket lives in a LinkReactor thread instead of the link thread
+
+    /** @brief A host messages are sent to */
+    struct Peer {
+        QHostAddress address;
+        quint16 port;
+        qint64 lastHeard;           ///< Time the last datagram was received in ms of peerClock, -1 for hosts which never go stale
+        QByteArray socketAddress;   ///< Native sockaddr of the peer for sendmmsg()
+    };
+    typedef QPair<QHostAddress, quint16> PeerKey;
+
+    QHash<PeerKey, Peer> peers;     ///< All peers, keyed by address and port
+    QVector<Peer> peerList;         ///< Copy of the peers for sending, shared with the writing threads
+    mutable QMutex peersMutex;      ///< Protects peers and peerList
+    QElapsedTimer peerClock;
+    int peerTimeout;
 
     QMutex dataMutex;
 
@@ -116,6 +163,14 @@ protected:
 
 private:
 	bool hardwareConnect(void);
+    /** @brief Adds a peer or updates the time it was heard, peersMutex has to be held */
+    void updatePeer(const QHostAddress& address, quint16 port, qint64 lastHeard);
+    /** @brief Rebuilds peerList from peers, peersMutex has to be held */
+    void updatePeerList();
+    /** @brief Reads the pending datagrams through the socket, on platforms without recvmmsg() */
+    void readDatagrams();
+
+    char* receiveBuffers;           ///< receiveBatchSize buffers for recvmmsg(), allocated once
 
 signals:
     //Signals are defined by LinkInterface
@@ -0,0 +1,76 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#include "GroundTimeTest.h"
+#include "QGC.h"
+
+/// @file
+///     @brief QGC ground time unit test
+
+GroundTimeUnitTest::GroundTimeUnitTest(void)
+{
+
+}
+
+void GroundTimeUnitTest::_monotonic_test(void)
+{
+    quint64 last = QGC::groundTimeUsecs();
+
+    for (int i = 0; i < 100000; i++) {
+        quint64 now = QGC::groundTimeUsecs();
+        QVERIFY(now >= last);
+        last = now;
+    }
+}
+
+/// @brief Samples taken 5 ms apart, like 200 Hz IMU data, must get distinct timestamps with sub-millisecond steps
+void GroundTimeUnitTest::_resolution_test(void)
+{
+    QList<quint64> samples;
+
+    for (int i = 0; i < 50; i++) {
+        samples.append(QGC::groundTimeUsecs());
+        QGC::SLEEP::usleep(5000);
+    }
+
+    bool subMillisecond = false;
+    for (int i = 1; i < samples.count(); i++) {
+        quint64 step = samples[i] - samples[i - 1];
+        QVERIFY(step >= 5000);
+        if (step % 1000 != 0) {
+            subMillisecond = true;
+        }
+    }
+    QVERIFY(subMillisecond);
+}
+
+void GroundTimeUnitTest::_utc_test(void)
+{
+    qint64 wallMsecs = QDateTime::currentMSecsSinceEpoch();
+    qint64 groundMsecs = (qint64)QGC::groundTimeMilliseconds();
+
+    // The ground time is anchored to UTC, allow for a coarse wall clock
+    QVERIFY(qAbs(groundMsecs - wallMsecs) < 100);
+    QCOMPARE(QGC::groundTimeUsecs() / 1000 >= (quint64)groundMsecs, true);
+}
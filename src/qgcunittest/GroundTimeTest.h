@@ -0,0 +1,51 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#ifndef GROUNDTIMETEST_H
+#define GROUNDTIMETEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+
+/// @file
+///     @brief QGC ground time unit test
+
+class GroundTimeUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    GroundTimeUnitTest(void);
+
+private slots:
+    void _monotonic_test(void);
+    void _resolution_test(void);
+    void _utc_test(void);
+};
+
+DECLARE_TEST(GroundTimeUnitTest)
+
+#endif
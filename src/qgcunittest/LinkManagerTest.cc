@@ -0,0 +1,145 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "LinkManagerTest.h"
+#include "LinkManager.h"
+
+/// @file
+///     @brief LinkManager unit test
+
+LinkManagerUnitTest::LinkManagerUnitTest(void) :
+    _protocol(NULL)
+{
+
+}
+
+void LinkManagerUnitTest::init(void)
+{
+    Q_ASSERT(_protocol == NULL);
+
+    _protocol = new MAVLinkProtocol();
+    Q_CHECK_PTR(_protocol);
+}
+
+void LinkManagerUnitTest::cleanup(void)
+{
+    Q_ASSERT(_protocol);
+
+    delete _protocol;
+    _protocol = NULL;
+}
+
+void LinkManagerUnitTest::_registry_test(void)
+{
+    LinkManager* manager = LinkManager::instance();
+    int linkCount = manager->getLinks().count();
+
+    MockLink linkA;
+    MockLink linkB;
+    manager->add(&linkA);
+    manager->add(&linkB);
+    manager->add(&linkA);
+    QCOMPARE(manager->getLinks().count(), linkCount + 2);
+
+    manager->addProtocol(&linkA, _protocol);
+    QCOMPARE(manager->getLinksForProtocol(_protocol), QList<LinkInterface*>() << &linkA);
+    QCOMPARE(manager->getProtocolForLink(&linkA), (ProtocolInterface*)_protocol);
+    QVERIFY(manager->getProtocolForLink(&linkB) == NULL);
+    QVERIFY(manager->getProtocols().contains(_protocol));
+    QCOMPARE(manager->getLinkForId(linkA.getId()), (LinkInterface*)&linkA);
+    QCOMPARE(manager->getLinkForId(linkB.getId()), (LinkInterface*)&linkB);
+
+    // A snapshot taken before a change is not affected by it
+    QList<LinkInterface*> links = manager->getLinksForProtocol(_protocol);
+    manager->removeLink(&linkA);
+    QCOMPARE(links.count(), 1);
+
+    QCOMPARE(manager->getLinksForProtocol(_protocol).count(), 0);
+    QVERIFY(manager->getProtocolForLink(&linkA) == NULL);
+    QVERIFY(!manager->getProtocols().contains(_protocol));
+    QVERIFY(manager->getLinkForId(linkA.getId()) == NULL);
+
+    manager->removeLink(&linkB);
+    QCOMPARE(manager->getLinks().count(), linkCount);
+}
+
+static volatile bool _stopReaders;
+
+/// @brief Looks up the links like the protocol thread does on every message sent
+static int _readLinks(ProtocolInterface* protocol)
+{
+    LinkManager* manager = LinkManager::instance();
+    int errors = 0;
+
+    while (!_stopReaders) {
+        foreach (LinkInterface* link, manager->getLinksForProtocol(protocol)) {
+            // A link in a snapshot stays consistent within that snapshot
+            if (link == NULL || link->getId() < 0) {
+                errors++;
+            }
+        }
+        manager->getProtocolForLink(NULL);
+    }
+
+    return errors;
+}
+
+void LinkManagerUnitTest::_concurrentRead_test(void)
+{
+    LinkManager* manager = LinkManager::instance();
+
+    const int linkCount = 32;
+    QList<MockLink*> links;
+    for (int i = 0; i < linkCount; i++) {
+        links.append(new MockLink());
+    }
+
+    _stopReaders = false;
+    QList< QFuture<int> > readers;
+    for (int i = 0; i < 4; i++) {
+        readers.append(QtConcurrent::run(_readLinks, (ProtocolInterface*)_protocol));
+    }
+
+    // Add and remove the links while the readers look them up
+    for (int round = 0; round < 10; round++) {
+        foreach (MockLink* link, links) {
+            manager->add(link);
+            manager->addProtocol(link, _protocol);
+        }
+        QCOMPARE(manager->getLinksForProtocol(_protocol).count(), linkCount);
+        foreach (MockLink* link, links) {
+            manager->removeLink(link);
+        }
+        QCOMPARE(manager->getLinksForProtocol(_protocol).count(), 0);
+    }
+
+    _stopReaders = true;
+    foreach (QFuture<int> reader, readers) {
+        QCOMPARE(reader.result(), 0);
+    }
+
+    qDeleteAll(links);
+}
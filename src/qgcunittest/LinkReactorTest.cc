@@ -0,0 +1,214 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#include <time.h>
+
+#include <QDir>
+#include <QFile>
+
+#include "LinkReactorTest.h"
+#include "UDPLink.h"
+#include "TCPLink.h"
+
+/// @file
+///     @brief LinkReactor unit test
+
+LinkReactorUnitTest::LinkReactorUnitTest(void) :
+    _savedEnabled(false),
+    _savedMaxThreadCount(LinkReactor::defaultMaxThreadCount)
+{
+
+}
+
+void LinkReactorUnitTest::init(void)
+{
+    // The reactor settings are persistent, they are restored after each test
+    LinkReactor* reactor = LinkReactor::instance();
+    _savedEnabled = reactor->isEnabled();
+    _savedMaxThreadCount = reactor->maxThreadCount();
+}
+
+void LinkReactorUnitTest::cleanup(void)
+{
+    LinkReactor* reactor = LinkReactor::instance();
+    reactor->setEnabled(_savedEnabled);
+    reactor->setMaxThreadCount(_savedMaxThreadCount);
+}
+
+void LinkReactorUnitTest::_attach_test(void)
+{
+    LinkReactor* reactor = LinkReactor::instance();
+    reactor->setMaxThreadCount(2);
+
+    QList<QObject*> objects;
+    for (int i = 0; i < 4; i++) {
+        QObject* object = new QObject();
+        new QObject(object);
+        objects.append(object);
+        reactor->attach(object);
+    }
+    QCOMPARE(reactor->attachedCount(), 4);
+    QVERIFY(reactor->threadCount() <= 2);
+
+    // The objects and their children are spread over both threads
+    QSet<QThread*> threads;
+    foreach (QObject* object, objects) {
+        QVERIFY(object->thread() != QThread::currentThread());
+        QCOMPARE(object->children().at(0)->thread(), object->thread());
+        threads.insert(object->thread());
+    }
+    QCOMPARE(threads.count(), 2);
+
+    QSignalSpy destroyedSpy(objects.at(0), SIGNAL(destroyed(QObject*)));
+    foreach (QObject* object, objects) {
+        reactor->detach(object);
+    }
+    QCOMPARE(destroyedSpy.count(), 1);
+    QCOMPARE(reactor->attachedCount(), 0);
+}
+
+/// @brief A TCP link connects from its reactor thread, connect() does not wait for the other side
+void LinkReactorUnitTest::_tcpConnect_test(void)
+{
+    LinkReactor::instance()->setEnabled(true);
+
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    TCPLink* link = new TCPLink(QHostAddress::LocalHost, server.serverPort());
+    QSignalSpy connectedSpy(link, SIGNAL(connected()));
+
+    QVERIFY(link->connect());
+    QVERIFY(link->getSocket()->thread() != QThread::currentThread());
+
+    // The server accepts on this thread, the link reports the connection from the reactor thread
+    QVERIFY(server.waitForNewConnection(5000));
+    for (int i = 0; i < 50 && connectedSpy.count() == 0; i++) {
+        QTest::qWait(100);
+    }
+    QCOMPARE(connectedSpy.count(), 1);
+    QVERIFY(link->isConnected());
+
+    link->disconnect();
+    QVERIFY(!link->isConnected());
+    delete link;
+}
+
+/// @brief Connects a number of UDP links and sends them traffic, like a swarm of SITL vehicles would.
+LinkReactorUnitTest::Load LinkReactorUnitTest::_runUdpLinks(bool reactor)
+{
+    LinkReactor::instance()->setEnabled(reactor);
+
+    QList<UDPLink*> links;
+    for (int i = 0; i < _linkCount; i++) {
+        UDPLink* link = new UDPLink(QHostAddress::LocalHost, _firstPort + i);
+        QSignalSpy connectedSpy(link, SIGNAL(connected()));
+        link->connect();
+        if (connectedSpy.count() == 0) {
+            connectedSpy.wait(1000);
+        }
+        links.append(link);
+    }
+
+    Load load;
+    memset(&load, 0, sizeof(load));
+
+    QUdpSocket sender;
+    QByteArray datagram(40, 'x');
+
+    clock_t cpuStart = clock();
+#ifdef Q_OS_LINUX
+    quint64 switchesStart = 0;
+    QDir tasks("/proc/self/task");
+    foreach (const QString& task, tasks.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QFile status(tasks.filePath(task) + "/status");
+        if (status.open(QIODevice::ReadOnly)) {
+            foreach (const QByteArray& line, status.readAll().split('\n')) {
+                if (line.contains("ctxt_switches:")) {
+                    switchesStart += line.split(':').last().trimmed().toULongLong();
+                }
+            }
+        }
+    }
+#endif
+
+    // 50 Hz telemetry to every link for one second
+    for (int tick = 0; tick < 50; tick++) {
+        for (int i = 0; i < _linkCount; i++) {
+            sender.writeDatagram(datagram, QHostAddress::LocalHost, _firstPort + i);
+        }
+        QTest::qWait(20);
+    }
+
+    load.cpuMsecs = (int)((clock() - cpuStart) * 1000 / CLOCKS_PER_SEC);
+#ifdef Q_OS_LINUX
+    foreach (const QString& task, tasks.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        load.threads++;
+        QFile status(tasks.filePath(task) + "/status");
+        if (status.open(QIODevice::ReadOnly)) {
+            foreach (const QByteArray& line, status.readAll().split('\n')) {
+                if (line.contains("ctxt_switches:")) {
+                    load.contextSwitches += line.split(':').last().trimmed().toULongLong();
+                }
+            }
+        }
+    }
+    load.contextSwitches -= qMin(load.contextSwitches, switchesStart);
+#else
+    load.threads = -1;
+#endif
+
+    // Give the last datagrams time to arrive
+    QTest::qWait(100);
+    load.allReceived = true;
+    for (int i = 0; i < _linkCount; i++) {
+        if (links[i]->getStatistics().bytesReceived() != (quint32)(50 * datagram.size())) {
+            load.allReceived = false;
+        }
+    }
+
+    qDeleteAll(links);
+
+    return load;
+}
+
+void LinkReactorUnitTest::_udpLinks_test(void)
+{
+    Load ownThreads = _runUdpLinks(false);
+    Load reactor = _runUdpLinks(true);
+
+    qDebug() << "LinkReactor:" << _linkCount << "UDP links, own threads: threads" << ownThreads.threads
+             << "cpu ms" << ownThreads.cpuMsecs << "context switches" << ownThreads.contextSwitches;
+    qDebug() << "LinkReactor:" << _linkCount << "UDP links, reactor: threads" << reactor.threads
+             << "cpu ms" << reactor.cpuMsecs << "context switches" << reactor.contextSwitches
+             << "reactor wakeups" << LinkReactor::instance()->wakeups();
+
+    QCOMPARE(ownThreads.allReceived, true);
+    QCOMPARE(reactor.allReceived, true);
+    QCOMPARE(LinkReactor::instance()->attachedCount(), 0);
+#ifdef Q_OS_LINUX
+    // One thread for all links instead of one each
+    QVERIFY(reactor.threads < ownThreads.threads);
+#endif
+}
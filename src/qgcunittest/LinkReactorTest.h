@@ -0,0 +1,72 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#ifndef LINKREACTORTEST_H
+#define LINKREACTORTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "LinkReactor.h"
+
+/// @file
+///     @brief LinkReactor unit test
+
+class LinkReactorUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    LinkReactorUnitTest(void);
+
+private slots:
+    void init(void);
+    void cleanup(void);
+
+    void _attach_test(void);
+    void _udpLinks_test(void);
+    void _tcpConnect_test(void);
+
+private:
+    /// @brief Resources used by a number of UDP links receiving traffic
+    struct Load {
+        int     threads;        ///< Threads of the process
+        int     cpuMsecs;       ///< CPU time used by the process
+        quint64 contextSwitches;///< Context switches of all threads, each one is a thread waking up or being preempted
+        bool    allReceived;    ///< All links received all datagrams
+    };
+
+    Load _runUdpLinks(bool reactor);
+
+    bool    _savedEnabled;
+    int     _savedMaxThreadCount;
+
+    static const int _linkCount = 8;
+    static const quint16 _firstPort = 14600;
+};
+
+DECLARE_TEST(LinkReactorUnitTest)
+
+#endif
@@ -0,0 +1,139 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "LinkStatisticsTest.h"
+
+/// @file
+///     @brief LinkStatistics unit test
+
+LinkStatisticsUnitTest::LinkStatisticsUnitTest(void)
+{
+
+}
+
+void LinkStatisticsUnitTest::_histogram_test(void)
+{
+    LinkHistogram histogram;
+
+    histogram.add(0);
+    histogram.add(1);
+    histogram.add(2);
+    histogram.add(3);
+    histogram.add(263);
+    histogram.add(0xFFFFFFFF);
+
+    QCOMPARE(histogram.bucket(0), (quint32)1);
+    QCOMPARE(histogram.bucket(1), (quint32)1);
+    QCOMPARE(histogram.bucket(2), (quint32)2);
+    QCOMPARE(histogram.bucket(9), (quint32)1);
+    QCOMPARE(histogram.bucket(LinkHistogram::bucketCount - 1), (quint32)1);
+
+    QCOMPARE(LinkHistogram::bucketMinimum(0), (quint32)0);
+    QCOMPARE(LinkHistogram::bucketMinimum(2), (quint32)2);
+    QCOMPARE(LinkHistogram::bucketMinimum(9), (quint32)256);
+
+    histogram.reset();
+    QCOMPARE(histogram.bucket(2), (quint32)0);
+}
+
+void LinkStatisticsUnitTest::_dataRate_test(void)
+{
+    LinkDataRate dataRate;
+    QCOMPARE(dataRate.rate(), (qint64)0);
+
+    // 1000 bytes every 50 msecs are 160 kbit/s
+    for (int i=0; i<LinkDataRate::slotCount * 2; i++) {
+        dataRate.add(1000);
+        QTest::qWait(LinkDataRate::slotMsecs);
+    }
+    qint64 rate = dataRate.rate();
+    QVERIFY2(rate > 100000 && rate < 220000, qPrintable(QString::number(rate)));
+
+    // Old data drops out of the window
+    QTest::qWait(LinkDataRate::windowMsecs + LinkDataRate::slotMsecs);
+    QCOMPARE(dataRate.rate(), (qint64)0);
+}
+
+void LinkStatisticsUnitTest::_counters_test(void)
+{
+    LinkStatistics statistics;
+
+    statistics.logBytesReceived(100);
+    statistics.logBytesSent(40);
+    statistics.logFrameReceived(17);
+    statistics.logFrameReceived(263);
+    statistics.logFrameSent(1000);
+    statistics.logCrcErrors(3);
+    statistics.logDroppedFrame();
+    statistics.logSequenceGap(5);
+    statistics.logReceiveLatency(3);
+
+    LinkStatistics::Snapshot snapshot = statistics.snapshot();
+    QCOMPARE(snapshot.bytesReceived, (quint32)100);
+    QCOMPARE(snapshot.bytesSent, (quint32)40);
+    QCOMPARE(snapshot.framesReceived, (quint32)2);
+    QCOMPARE(snapshot.framesSent, (quint32)1);
+    QCOMPARE(snapshot.crcErrors, (quint32)3);
+    QCOMPARE(snapshot.droppedFrames, (quint32)1);
+    QCOMPARE(snapshot.sequenceGaps, (quint32)5);
+    QCOMPARE(snapshot.frameSizes[5], (quint32)1);
+    QCOMPARE(snapshot.frameSizes[9], (quint32)1);
+    QCOMPARE(snapshot.latencies[10], (quint32)1);
+    QCOMPARE(snapshot.receiveLatencies[2], (quint32)1);
+    QVERIFY(snapshot.inDataRate > 0);
+
+    statistics.reset();
+    snapshot = statistics.snapshot();
+    QCOMPARE(snapshot.bytesReceived, (quint32)0);
+    QCOMPARE(snapshot.framesReceived, (quint32)0);
+    QCOMPARE(snapshot.frameSizes[9], (quint32)0);
+}
+
+static void _logFrames(LinkStatistics* statistics, int count)
+{
+    for (int i=0; i<count; i++) {
+        statistics->logFrameReceived(20);
+    }
+}
+
+void LinkStatisticsUnitTest::_concurrentUpdate_test(void)
+{
+    static const int threadCount = 4;
+    static const int frameCount = 100000;
+
+    LinkStatistics statistics;
+
+    // No update may get lost while the parsers of several threads count frames
+    QList< QFuture<void> > futures;
+    for (int i=0; i<threadCount; i++) {
+        futures.append(QtConcurrent::run(_logFrames, &statistics, frameCount));
+    }
+    foreach (QFuture<void> future, futures) {
+        future.waitForFinished();
+    }
+
+    QCOMPARE(statistics.framesReceived(), (quint32)(threadCount * frameCount));
+    QCOMPARE(statistics.frameSizes().bucket(5), (quint32)(threadCount * frameCount));
+}
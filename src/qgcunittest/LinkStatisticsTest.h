@@ -0,0 +1,52 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef LINKSTATISTICSTEST_H
+#define LINKSTATISTICSTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "LinkStatistics.h"
+
+/// @file
+///     @brief LinkStatistics unit test
+
+class LinkStatisticsUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    LinkStatisticsUnitTest(void);
+
+private slots:
+    void _histogram_test(void);
+    void _dataRate_test(void);
+    void _counters_test(void);
+    void _concurrentUpdate_test(void);
+};
+
+DECLARE_TEST(LinkStatisticsUnitTest)
+
+#endif
@@ -0,0 +1,611 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+
+#include "MAVLinkDecoderTest.h"
+#include "MAVLinkDecoder.h"
+#include "MAVLinkDescriptorTable.h"
+#include "MAVLinkFramer.h"
+#include "MAVLinkLogWriter.h"
+#include "TelemetryKeyRegistry.h"
+
+/// @file
+///     @brief MAVLinkDecoder unit test and decode benchmark. The table driven decoder must emit the same
+///             values with the same names and types as the field by field decoding it replaced, which is
+///             kept here as the reference, and only the subscribed ones. The benchmarks compare both over a
+///             recorded tlog, set QGC_BENCHMARK_TLOG to the path of a flight log to run them over real traffic.
+
+MAVLinkDecoderUnitTest::MAVLinkDecoderUnitTest(void) :
+    _pool(NULL)
+{
+
+}
+
+void MAVLinkDecoderUnitTest::initTestCase(void)
+{
+    // Normally done by LinkInterface and MAVLinkProtocol
+    qRegisterMetaType<LinkInterface*>("LinkInterface*");
+    qRegisterMetaType<mavlink_message_t>("mavlink_message_t");
+    qRegisterMetaType<MAVLinkMessage>("MAVLinkMessage");
+
+    _pool = new MAVLinkMessagePool();
+
+    QByteArray tlog = _recordTlog(_recordedMessageCount);
+    _messages = _readTlog(tlog);
+    QCOMPARE(_messages.count(), _recordedMessageCount);
+
+    _benchmarkMessages = _messages;
+    QByteArray path = qgetenv("QGC_BENCHMARK_TLOG");
+    if (!path.isEmpty()) {
+        QFile file(QString::fromLocal8Bit(path));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        _benchmarkMessages = _readTlog(file.readAll());
+        qDebug() << "Benchmarking" << _benchmarkMessages.count() << "messages of" << file.fileName();
+    }
+}
+
+void MAVLinkDecoderUnitTest::cleanupTestCase(void)
+{
+    _messages.clear();
+    _benchmarkMessages.clear();
+    _pool->release();
+    _pool = NULL;
+}
+
+/// @brief Records a tlog of the telemetry of three vehicles the way the protocol logs it
+QByteArray MAVLinkDecoderUnitTest::_recordTlog(int messageCount)
+{
+    QTemporaryFile file;
+    if (!file.open()) {
+        qWarning() << "Unable to open tlog" << file.fileName();
+        return QByteArray();
+    }
+
+    MAVLinkLogWriter writer;
+    writer.startLogging(&file);
+
+    quint64 timestamp = 1400000000000000ULL;
+    for (int i=0; i<messageCount; i++) {
+        mavlink_message_t message;
+        uint8_t sysid = 1 + (i % 3);
+        uint32_t timeBootMsecs = i * 4;
+
+        switch (i % 8) {
+            case 0:
+            {
+                mavlink_heartbeat_t heartbeat;
+                memset(&heartbeat, 0, sizeof(heartbeat));
+                heartbeat.type = MAV_TYPE_QUADROTOR;
+                heartbeat.autopilot = MAV_AUTOPILOT_PX4;
+                heartbeat.custom_mode = i;
+                mavlink_msg_heartbeat_encode(sysid, MAV_COMP_ID_IMU, &message, &heartbeat);
+                break;
+            }
+            case 1:
+            {
+                mavlink_attitude_t attitude;
+                memset(&attitude, 0, sizeof(attitude));
+                attitude.time_boot_ms = timeBootMsecs;
+                attitude.roll = qrand() / (float)RAND_MAX;
+                attitude.yaw = -qrand() / (float)RAND_MAX;
+                mavlink_msg_attitude_encode(sysid, MAV_COMP_ID_IMU, &message, &attitude);
+                break;
+            }
+            case 2:
+            {
+                mavlink_highres_imu_t imu;
+                memset(&imu, 0, sizeof(imu));
+                imu.time_usec = timeBootMsecs * 1000ULL;
+                imu.zacc = -9.81f;
+                imu.temperature = 25.0f;
+                imu.fields_updated = 0x1FFF;
+                mavlink_msg_highres_imu_encode(sysid, MAV_COMP_ID_IMU, &message, &imu);
+                break;
+            }
+            case 3:
+            {
+                mavlink_global_position_int_t position;
+                memset(&position, 0, sizeof(position));
+                position.time_boot_ms = timeBootMsecs;
+                position.lat = 473977000 + i;
+                position.lon = 85456000 - i;
+                position.vz = -(int16_t)(i % 100);
+                mavlink_msg_global_position_int_encode(sysid, MAV_COMP_ID_IMU, &message, &position);
+                break;
+            }
+            case 4:
+            {
+                mavlink_gps_status_t gps;
+                memset(&gps, 0, sizeof(gps));
+                gps.satellites_visible = 10;
+                for (int j=0; j<20; j++) {
+                    gps.satellite_prn[j] = j + 1;
+                    gps.satellite_snr[j] = qrand() % 50;
+                }
+                mavlink_msg_gps_status_encode(sysid, MAV_COMP_ID_IMU, &message, &gps);
+                break;
+            }
+            case 5:
+            {
+                mavlink_servo_output_raw_t servo;
+                memset(&servo, 0, sizeof(servo));
+                servo.time_usec = timeBootMsecs * 1000;
+                servo.port = i % 2;
+                servo.servo1_raw = 1000 + i % 1000;
+                mavlink_msg_servo_output_raw_encode(sysid, MAV_COMP_ID_IMU, &message, &servo);
+                break;
+            }
+            case 6:
+            {
+                mavlink_named_value_float_t named;
+                memset(&named, 0, sizeof(named));
+                named.time_boot_ms = timeBootMsecs;
+                strncpy(named.name, (i % 16) < 8 ? "airspd" : "rpm", sizeof(named.name));
+                named.value = i * 0.5f;
+                mavlink_msg_named_value_float_encode(sysid, MAV_COMP_ID_IMU, &message, &named);
+                break;
+            }
+            default:
+            {
+                mavlink_debug_t debug;
+                memset(&debug, 0, sizeof(debug));
+                debug.time_boot_ms = timeBootMsecs;
+                debug.ind = i % 4;
+                debug.value = -i * 0.25f;
+                mavlink_msg_debug_encode(sysid, MAV_COMP_ID_IMU, &message, &debug);
+                break;
+            }
+        }
+
+        // Wait for the writer to catch up rather than drop messages from the recording
+        timestamp += 1000;
+        while (!writer.logMessage(timestamp, message)) {
+            QThread::yieldCurrentThread();
+        }
+    }
+
+    writer.stopLogging();
+
+    file.seek(0);
+    return file.readAll();
+}
+
+/// @brief Returns the messages of a tlog. The framer skips the timestamps in front of them like line noise.
+QList<MAVLinkMessage> MAVLinkDecoderUnitTest::_readTlog(const QByteArray& tlog)
+{
+    QList<MAVLinkMessage> messages;
+    MAVLinkFramer framer;
+
+    framer.setInput(tlog.constData(), tlog.size());
+    forever {
+        MAVLinkMessage message = _pool->allocate();
+        if (!framer.nextMessage(message.writableMessage())) {
+            break;
+        }
+        messages.append(message);
+    }
+
+    return messages;
+}
+
+void MAVLinkDecoderUnitTest::_reportRate(const char* name, int messages, qint64 nsecs)
+{
+    if (nsecs > 0) {
+        qDebug() << name << "decoded" << messages << "messages at" << (messages * 1000.0 / nsecs) << "million messages/s";
+    }
+}
+
+void MAVLinkDecoderUnitTest::_descriptors_test(void)
+{
+    const MAVLinkDescriptorTable* table = MAVLinkDescriptorTable::instance();
+
+    const MAVLinkDescriptorTable::Message& attitude = table->message(MAVLINK_MSG_ID_ATTITUDE);
+    QCOMPARE(attitude.name, QString("ATTITUDE"));
+    QCOMPARE(attitude.timeUnit, MAVLinkDescriptorTable::TIME_MSECS);
+    QCOMPARE(attitude.values.count(), 7);
+    QCOMPARE(attitude.values[0].name, QString("ATTITUDE.time_boot_ms"));
+    QCOMPARE(attitude.values[0].unit, QString("uint32_t"));
+    QCOMPARE(attitude.values[1].unit, QString("float"));
+    QVERIFY(attitude.values[0].integer);
+    QVERIFY(!attitude.values[1].integer);
+
+    QCOMPARE(table->message(MAVLINK_MSG_ID_HIGHRES_IMU).timeUnit, MAVLinkDescriptorTable::TIME_USECS);
+    QCOMPARE(table->message(MAVLINK_MSG_ID_HEARTBEAT).timeUnit, MAVLinkDescriptorTable::TIME_NONE);
+
+    // Its time_usec has only 32 bits, it was never taken for a timestamp
+    QCOMPARE(table->message(MAVLINK_MSG_ID_SERVO_OUTPUT_RAW).timeUnit, MAVLinkDescriptorTable::TIME_NONE);
+
+    // Array elements are values of their own
+    const MAVLinkDescriptorTable::Message& gps = table->message(MAVLINK_MSG_ID_GPS_STATUS);
+    QCOMPARE(gps.values.count(), 1 + 5 * 20);
+    QCOMPARE(gps.values[4].name, QString("GPS_STATUS.satellite_prn.3"));
+    QCOMPARE(gps.values[4].fieldName, QString("satellite_prn"));
+    QCOMPARE(gps.values[4].element, 3);
+    QCOMPARE(gps.values[4].unit, QString("uint8_t[20]"));
+
+    // Char arrays are text
+    const MAVLinkDescriptorTable::Message& named = table->message(MAVLINK_MSG_ID_NAMED_VALUE_FLOAT);
+    QCOMPARE(named.values.count(), 2);
+    QCOMPARE(named.texts.count(), 1);
+    QCOMPARE(named.texts[0].fieldName, QString("name"));
+    QCOMPARE(named.texts[0].length, 10);
+
+    // Ids without a message
+    QVERIFY(table->message(255).name.isEmpty());
+    QCOMPARE(table->message(255).values.count(), 0);
+
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(1, MAV_COMP_ID_IMU, &message, 123456, 0, 0, 0, 0, 0, 0);
+    QCOMPARE(table->onboardUsecs(message), (quint64)123456000);
+    mavlink_msg_highres_imu_pack(1, MAV_COMP_ID_IMU, &message, 987654321ULL, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    QCOMPARE(table->onboardUsecs(message), (quint64)987654321ULL);
+}
+
+/// @brief Messages MAVLinkDecoder does not decode
+static bool _legacyFiltered(uint8_t msgid)
+{
+    switch (msgid) {
+        case MAVLINK_MSG_ID_STATUSTEXT:
+        case MAVLINK_MSG_ID_COMMAND_LONG:
+        case MAVLINK_MSG_ID_COMMAND_ACK:
+        case MAVLINK_MSG_ID_PARAM_SET:
+        case MAVLINK_MSG_ID_PARAM_VALUE:
+        case MAVLINK_MSG_ID_MISSION_ITEM:
+        case MAVLINK_MSG_ID_MISSION_COUNT:
+        case MAVLINK_MSG_ID_MISSION_ACK:
+        case MAVLINK_MSG_ID_DATA_STREAM:
+        case MAVLINK_MSG_ID_GPS_STATUS:
+        case MAVLINK_MSG_ID_RC_CHANNELS_RAW:
+#ifdef MAVLINK_MSG_ID_ENCAPSULATED_DATA
+        case MAVLINK_MSG_ID_ENCAPSULATED_DATA:
+#endif
+#ifdef MAVLINK_MSG_ID_DATA_TRANSMISSION_HANDSHAKE
+        case MAVLINK_MSG_ID_DATA_TRANSMISSION_HANDSHAKE:
+#endif
+        case MAVLINK_MSG_ID_EXTENDED_MESSAGE:
+        case MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// @brief Collects a value the way the decoder emitted it before the descriptor table
+template <typename T, typename V>
+static int _legacyValues(const uint8_t* m, const mavlink_field_info_t& field, const char* typeName, int uasId,
+                         const QString& name, QList<MAVLinkDecoderUnitTest::DecodedValue>* values)
+{
+    if (field.array_length > 0) {
+        const T* nums = (const T*)(m + field.wire_offset);
+        QString fieldType = QString("%1[%2]").arg(typeName).arg(field.array_length);
+        for (unsigned int j = 0; j < field.array_length; ++j) {
+            MAVLinkDecoderUnitTest::DecodedValue value;
+            value.uasId = uasId;
+            value.name = QString("%1.%2").arg(name).arg(j);
+            value.unit = fieldType;
+            value.value = QVariant((V)nums[j]);
+            if (values) {
+                values->append(value);
+            }
+        }
+        return field.array_length;
+    }
+
+    MAVLinkDecoderUnitTest::DecodedValue value;
+    value.uasId = uasId;
+    value.name = name;
+    value.unit = QString(typeName);
+    value.value = QVariant((V)*(const T*)(m + field.wire_offset));
+    if (values) {
+        values->append(value);
+    }
+    return 1;
+}
+
+/// @brief The field by field decoding of MAVLinkDecoder before the descriptor table, for messages of a single component
+///     @return Number of values
+int MAVLinkDecoderUnitTest::_legacyDecode(const mavlink_message_t& message, QList<DecodedValue>* values)
+{
+    static const mavlink_message_info_t messageInfo[256] = MAVLINK_MESSAGE_INFO;
+
+    // The decoder kept a copy of the last message of every id
+    mavlink_message_t copy;
+    memcpy(&copy, &message, sizeof(mavlink_message_t));
+    uint8_t msgid = copy.msgid;
+    const mavlink_message_info_t& info = messageInfo[msgid];
+    uint8_t* m = ((uint8_t*)&copy) + 8;
+    if (_legacyFiltered(msgid)) {
+        return 0;
+    }
+
+    // The timestamp was found by the name of the first field
+    quint64 onboardUsecs = 0;
+    if (QString(info.fields[0].name) == QString("time_boot_ms") && info.fields[0].type == MAVLINK_TYPE_UINT32_T) {
+        onboardUsecs = (quint64)*((quint32*)(m + info.fields[0].wire_offset)) * 1000;
+    } else if (QString(info.fields[0].name).contains("usec") && info.fields[0].type == MAVLINK_TYPE_UINT64_T) {
+        onboardUsecs = *((quint64*)(m + info.fields[0].wire_offset));
+    }
+    Q_UNUSED(onboardUsecs);
+
+    int count = 0;
+    for (unsigned int fieldid = 0; fieldid < info.num_fields; ++fieldid) {
+        const mavlink_field_info_t& field = info.fields[fieldid];
+        QString fieldName(field.name);
+        QString name("%1.%2");
+        char buf[11];
+
+        if (msgid == MAVLINK_MSG_ID_DEBUG_VECT) {
+            mavlink_debug_vect_t debug;
+            mavlink_msg_debug_vect_decode(&copy, &debug);
+            strncpy(buf, debug.name, 10);
+            buf[10] = '\0';
+            name = QString("%1.%2").arg(buf).arg(fieldName);
+        } else if (msgid == MAVLINK_MSG_ID_DEBUG) {
+            mavlink_debug_t debug;
+            mavlink_msg_debug_decode(&copy, &debug);
+            name = name.arg(QString("debug")).arg(debug.ind);
+        } else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT) {
+            mavlink_named_value_float_t debug;
+            mavlink_msg_named_value_float_decode(&copy, &debug);
+            strncpy(buf, debug.name, 10);
+            buf[10] = '\0';
+            name = QString(buf);
+        } else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_INT) {
+            mavlink_named_value_int_t debug;
+            mavlink_msg_named_value_int_decode(&copy, &debug);
+            strncpy(buf, debug.name, 10);
+            buf[10] = '\0';
+            name = QString(buf);
+        } else if (msgid == MAVLINK_MSG_ID_RC_CHANNELS_SCALED) {
+            mavlink_rc_channels_scaled_t scaled;
+            mavlink_msg_rc_channels_scaled_decode(&copy, &scaled);
+            name = name.arg(info.name).arg(fieldName);
+            name.prepend(QString("port%1_").arg(scaled.port));
+        } else if (msgid == MAVLINK_MSG_ID_SERVO_OUTPUT_RAW) {
+            mavlink_servo_output_raw_t servo;
+            mavlink_msg_servo_output_raw_decode(&copy, &servo);
+            name = name.arg(info.name).arg(fieldName);
+            name.prepend(QString("port%1_").arg(servo.port));
+        } else {
+            name = name.arg(info.name).arg(fieldName);
+        }
+        name = name.prepend(QString("M%1:").arg(copy.sysid));
+
+        switch (field.type) {
+            case MAVLINK_TYPE_CHAR:
+                if (field.array_length > 0) {
+                    char* str = (char*)(m + field.wire_offset);
+                    str[field.array_length - 1] = '\0';
+                    QString string(name + ": " + str);
+                } else {
+                    DecodedValue value;
+                    value.uasId = copy.sysid;
+                    value.name = name;
+                    value.unit = QString("char[%1]").arg(field.array_length);
+                    value.value = QVariant((int)*((char*)(m + field.wire_offset)));
+                    if (values) {
+                        values->append(value);
+                    }
+                    count++;
+                }
+                break;
+            case MAVLINK_TYPE_UINT8_T:
+                count += _legacyValues<uint8_t, int>(m, field, "uint8_t", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_INT8_T:
+                count += _legacyValues<int8_t, int>(m, field, "int8_t", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_UINT16_T:
+                count += _legacyValues<uint16_t, int>(m, field, "uint16_t", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_INT16_T:
+                count += _legacyValues<int16_t, int>(m, field, "int16_t", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_UINT32_T:
+                count += _legacyValues<uint32_t, uint>(m, field, "uint32_t", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_INT32_T:
+                count += _legacyValues<int32_t, int>(m, field, "int32_t", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_FLOAT:
+                count += _legacyValues<float, float>(m, field, "float", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_DOUBLE:
+                count += _legacyValues<double, double>(m, field, "double", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_UINT64_T:
+                count += _legacyValues<uint64_t, quint64>(m, field, "uint64_t", copy.sysid, name, values);
+                break;
+            case MAVLINK_TYPE_INT64_T:
+                count += _legacyValues<int64_t, qint64>(m, field, "int64_t", copy.sysid, name, values);
+                break;
+        }
+    }
+
+    return count;
+}
+
+/// @brief The decoder emits exactly what the field by field decoding emitted
+void MAVLinkDecoderUnitTest::_decode_test(void)
+{
+    MAVLinkProtocol* protocol = new MAVLinkProtocol();
+    MAVLinkDecoder* decoder = new MAVLinkDecoder(protocol);
+    QSignalSpy spy(decoder, SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)));
+    decoder->subscribe(0, -1);
+
+    QList<DecodedValue> expected;
+    for (int i=0; i<_messages.count(); i++) {
+        _legacyDecode(*_messages[i], &expected);
+        decoder->receiveMessage(NULL, _messages[i]);
+    }
+
+    QCOMPARE(spy.count(), expected.count());
+    for (int i=0; i<expected.count(); i++) {
+        QList<QVariant> arguments = spy.at(i);
+        QCOMPARE(arguments.at(0).toInt(), expected[i].uasId);
+        QCOMPARE(arguments.at(1).toString(), expected[i].name);
+        QCOMPARE(arguments.at(2).toString(), expected[i].unit);
+        QVariant value = arguments.at(3).value<QVariant>();
+        QCOMPARE(value.type(), expected[i].value.type());
+        QCOMPARE(value, expected[i].value);
+    }
+
+    decoder->quit();
+    decoder->wait();
+    delete decoder;
+    delete protocol;
+}
+
+/// @brief Benchmarks the field by field decoding MAVLinkDecoder used before the descriptor table
+void MAVLinkDecoderUnitTest::_legacyDecode_benchmark(void)
+{
+    int messages = 0;
+    int values = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    QBENCHMARK {
+        for (int i=0; i<_benchmarkMessages.count(); i++) {
+            values += _legacyDecode(*_benchmarkMessages[i], NULL);
+        }
+        messages += _benchmarkMessages.count();
+    }
+    _reportRate("Field by field", messages, timer.nsecsElapsed());
+
+    QVERIFY(values > 0);
+}
+
+void MAVLinkDecoderUnitTest::_tableDecode_benchmark(void)
+{
+    MAVLinkProtocol* protocol = new MAVLinkProtocol();
+    MAVLinkDecoder* decoder = new MAVLinkDecoder(protocol);
+    int messages = 0;
+    QElapsedTimer timer;
+    decoder->subscribe(0, -1);
+
+    timer.start();
+    QBENCHMARK {
+        for (int i=0; i<_benchmarkMessages.count(); i++) {
+            decoder->receiveMessage(NULL, _benchmarkMessages[i]);
+        }
+        messages += _benchmarkMessages.count();
+    }
+    // Unlike the reference this includes emitting the values and appending them to the telemetry store
+    _reportRate("MAVLinkDecoder", messages, timer.nsecsElapsed());
+
+    decoder->quit();
+    decoder->wait();
+    delete decoder;
+    delete protocol;
+
+    QVERIFY(messages > 0);
+}
+
+/// @brief Only subscribed fields are decoded
+void MAVLinkDecoderUnitTest::_subscription_test(void)
+{
+    MAVLinkProtocol* protocol = new MAVLinkProtocol();
+    MAVLinkDecoder* decoder = new MAVLinkDecoder(protocol);
+    QSignalSpy spy(decoder, SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)));
+
+    // Nothing is subscribed, nothing is emitted but the names are known
+    for (int i=0; i<_messages.count(); i++) {
+        decoder->receiveMessage(NULL, _messages[i]);
+    }
+    QCOMPARE(spy.count(), 0);
+    int rollKey = TelemetryKeyRegistry::instance()->intern(2, "M2:ATTITUDE.roll", "float");
+    int lonKey = TelemetryKeyRegistry::instance()->intern(3, "M3:GLOBAL_POSITION_INT.lon", "int32_t", true);
+
+    // One field of one system
+    decoder->subscribe(2, MAVLINK_MSG_ID_ATTITUDE, "roll");
+    for (int i=0; i<_messages.count(); i++) {
+        decoder->receiveMessage(NULL, _messages[i]);
+    }
+    QVERIFY(spy.count() > 0);
+    for (int i=0; i<spy.count(); i++) {
+        QCOMPARE(spy.at(i).at(1).toString(), QString("M2:ATTITUDE.roll"));
+    }
+    spy.clear();
+
+    // Counted, and a field of all systems through its key
+    decoder->subscribe(2, MAVLINK_MSG_ID_ATTITUDE, "roll");
+    decoder->unsubscribe(2, MAVLINK_MSG_ID_ATTITUDE, "roll");
+    QVERIFY(decoder->subscribeKey(lonKey));
+    QVERIFY(!decoder->subscribeKey(-1));
+    for (int i=0; i<_messages.count(); i++) {
+        decoder->receiveMessage(NULL, _messages[i]);
+    }
+    QSet<QString> names;
+    for (int i=0; i<spy.count(); i++) {
+        names.insert(spy.at(i).at(1).toString());
+    }
+    QCOMPARE(names.count(), 2);
+    QVERIFY(names.contains("M2:ATTITUDE.roll"));
+    QVERIFY(names.contains("M3:GLOBAL_POSITION_INT.lon"));
+    spy.clear();
+
+    // Everything unsubscribed
+    decoder->unsubscribe(2, MAVLINK_MSG_ID_ATTITUDE, "roll");
+    QVERIFY(decoder->unsubscribeKey(lonKey));
+    QVERIFY(decoder->subscribeKey(rollKey));
+    QVERIFY(decoder->unsubscribeKey(rollKey));
+    for (int i=0; i<_messages.count(); i++) {
+        decoder->receiveMessage(NULL, _messages[i]);
+    }
+    QCOMPARE(spy.count(), 0);
+
+    decoder->quit();
+    decoder->wait();
+    delete decoder;
+    delete protocol;
+}
+
+/// @brief Benchmarks a link where a single field is plotted, the other messages are skipped before they are decoded
+void MAVLinkDecoderUnitTest::_subscribedDecode_benchmark(void)
+{
+    MAVLinkProtocol* protocol = new MAVLinkProtocol();
+    MAVLinkDecoder* decoder = new MAVLinkDecoder(protocol);
+    int messages = 0;
+    QElapsedTimer timer;
+    decoder->subscribe(1, MAVLINK_MSG_ID_ATTITUDE, "roll");
+
+    timer.start();
+    QBENCHMARK {
+        for (int i=0; i<_benchmarkMessages.count(); i++) {
+            decoder->receiveMessage(NULL, _benchmarkMessages[i]);
+        }
+        messages += _benchmarkMessages.count();
+    }
+    _reportRate("MAVLinkDecoder, one field subscribed", messages, timer.nsecsElapsed());
+
+    decoder->quit();
+    decoder->wait();
+    delete decoder;
+    delete protocol;
+
+    QVERIFY(messages > 0);
+}
@@ -0,0 +1,82 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#ifndef MAVLINKDECODERTEST_H
+#define MAVLINKDECODERTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QList>
+#include <QVariant>
+
+#include "AutoTest.h"
+#include "MAVLinkMessage.h"
+
+/// @file
+///     @brief MAVLinkDecoder unit test and decode benchmark
+
+class MAVLinkDecoderUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkDecoderUnitTest(void);
+
+    /// @brief A value as the decoder emits it
+    struct DecodedValue {
+        int         uasId;
+        QString     name;
+        QString     unit;
+        QVariant    value;
+    };
+
+private slots:
+    void initTestCase(void);
+    void cleanupTestCase(void);
+
+    void _descriptors_test(void);
+    void _decode_test(void);
+    void _subscription_test(void);
+
+    void _legacyDecode_benchmark(void);
+    void _tableDecode_benchmark(void);
+    void _subscribedDecode_benchmark(void);
+
+private:
+    QByteArray _recordTlog(int messageCount);
+    QList<MAVLinkMessage> _readTlog(const QByteArray& tlog);
+    int _legacyDecode(const mavlink_message_t& message, QList<DecodedValue>* values);
+    void _reportRate(const char* name, int messages, qint64 nsecs);
+
+    static const int _recordedMessageCount = 20000;
+
+    MAVLinkMessagePool*     _pool;
+    QList<MAVLinkMessage>   _messages;      ///< Of the recorded tlog
+    QList<MAVLinkMessage>   _benchmarkMessages; ///< Of the tlog in QGC_BENCHMARK_TLOG if set, else the recorded one
+};
+
+DECLARE_TEST(MAVLinkDecoderUnitTest)
+
+#endif
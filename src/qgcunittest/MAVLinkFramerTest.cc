@@ -0,0 +1,225 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include <QElapsedTimer>
+
+#include "MAVLinkFramerTest.h"
+
+/// @file
+///     @brief MAVLinkFramer unit test and receive path benchmark. The framer must return exactly the
+///             same messages as mavlink_parse_char for any input and any split of the input into chunks.
+///             The benchmarks compare the throughput of both parsers over the same stream.
+
+MAVLinkFramerUnitTest::MAVLinkFramerUnitTest(void)
+{
+
+}
+
+// Called once before all test cases are run
+void MAVLinkFramerUnitTest::initTestCase(void)
+{
+    qsrand(0x4d41564c);
+    _benchmarkStream = _buildStream(_benchmarkMessageCount, false);
+}
+
+/// @brief Builds a stream of mixed messages with noise between them
+///     @param corrupt true: corrupt every seventh message and put start signs into the noise
+QByteArray MAVLinkFramerUnitTest::_buildStream(int messageCount, bool corrupt)
+{
+    QByteArray stream;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+
+    for (int i=0; i<messageCount; i++) {
+        mavlink_message_t message;
+
+        switch (i % 3) {
+            case 0:
+                mavlink_msg_heartbeat_pack(1 + (i % 5), MAV_COMP_ID_IMU, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_PX4, MAV_MODE_MANUAL_ARMED, i, MAV_STATE_ACTIVE);
+                break;
+            case 1:
+                mavlink_msg_attitude_pack(1 + (i % 5), MAV_COMP_ID_IMU, &message, i * 10, qrand() / (float)RAND_MAX, qrand() / (float)RAND_MAX, qrand() / (float)RAND_MAX, 0, 0, 0);
+                break;
+            default:
+                mavlink_msg_ping_pack(1 + (i % 5), MAV_COMP_ID_IMU, &message, (quint64)qrand() << 24, i, 0, 0);
+                break;
+        }
+
+        int length = mavlink_msg_to_send_buffer(buffer, &message);
+        if (corrupt && (i % 7) == 3) {
+            buffer[qrand() % length] ^= 1 << (qrand() % 8);
+        }
+        stream.append((const char*)buffer, length);
+
+        // Occasional line noise between messages
+        int noise = qrand() % 4;
+        for (int j=0; j<noise; j++) {
+            char byte = qrand();
+            if (corrupt && (qrand() % 4) == 0) {
+                byte = (char)MAVLINK_STX;
+            } else if ((uint8_t)byte == MAVLINK_STX) {
+                byte = 0;
+            }
+            stream.append(byte);
+        }
+    }
+
+    return stream;
+}
+
+QList<mavlink_message_t> MAVLinkFramerUnitTest::_parseCharMessages(const QByteArray& stream)
+{
+    QList<mavlink_message_t> messages;
+    mavlink_message_t message;
+    mavlink_status_t status;
+
+    memset(mavlink_get_channel_status(_parseChannel), 0, sizeof(mavlink_status_t));
+    for (int i=0; i<stream.size(); i++) {
+        if (mavlink_parse_char(_parseChannel, (uint8_t)stream[i], &message, &status)) {
+            messages.append(message);
+        }
+    }
+
+    return messages;
+}
+
+/// @brief Feeds the stream to a framer in randomly sized chunks
+QList<mavlink_message_t> MAVLinkFramerUnitTest::_framerMessages(const QByteArray& stream, int maxChunkSize)
+{
+    QList<mavlink_message_t> messages;
+    mavlink_message_t message;
+    MAVLinkFramer framer;
+
+    int pos = 0;
+    while (pos < stream.size()) {
+        int chunkSize = qMin(1 + (qrand() % maxChunkSize), stream.size() - pos);
+        framer.setInput(stream.constData() + pos, chunkSize);
+        pos += chunkSize;
+
+        while (framer.nextMessage(&message)) {
+            messages.append(message);
+        }
+    }
+
+    return messages;
+}
+
+void MAVLinkFramerUnitTest::_compareMessages(const QList<mavlink_message_t>& expected, const QList<mavlink_message_t>& actual)
+{
+    QCOMPARE(actual.count(), expected.count());
+
+    for (int i=0; i<expected.count(); i++) {
+        const mavlink_message_t& e = expected[i];
+        const mavlink_message_t& a = actual[i];
+
+        QCOMPARE(a.len, e.len);
+        QCOMPARE(a.seq, e.seq);
+        QCOMPARE(a.sysid, e.sysid);
+        QCOMPARE(a.compid, e.compid);
+        QCOMPARE(a.msgid, e.msgid);
+        QCOMPARE(a.checksum, e.checksum);
+        QVERIFY(memcmp(_MAV_PAYLOAD(&a), _MAV_PAYLOAD(&e), e.len + MAVLINK_NUM_CHECKSUM_BYTES) == 0);
+    }
+}
+
+void MAVLinkFramerUnitTest::_cleanStream_test(void)
+{
+    QByteArray stream = _buildStream(500, false);
+    QList<mavlink_message_t> expected = _parseCharMessages(stream);
+
+    QCOMPARE(expected.count(), 500);
+    _compareMessages(expected, _framerMessages(stream, 300));
+    _compareMessages(expected, _framerMessages(stream, 20));
+}
+
+void MAVLinkFramerUnitTest::_corruptStream_test(void)
+{
+    QByteArray stream = _buildStream(500, true);
+    QList<mavlink_message_t> expected = _parseCharMessages(stream);
+
+    QVERIFY(expected.count() < 500);
+    _compareMessages(expected, _framerMessages(stream, 300));
+    _compareMessages(expected, _framerMessages(stream, 20));
+}
+
+void MAVLinkFramerUnitTest::_byteByByte_test(void)
+{
+    QByteArray stream = _buildStream(100, true);
+
+    _compareMessages(_parseCharMessages(stream), _framerMessages(stream, 1));
+}
+
+void MAVLinkFramerUnitTest::_reportRate(const char* name, qint64 bytes, qint64 nsecs)
+{
+    if (nsecs > 0) {
+        qDebug() << name << "parsed" << bytes << "bytes at" << (bytes * 1000.0 / nsecs) << "MB/s";
+    }
+}
+
+/// @brief Benchmarks the byte at a time parser MAVLinkProtocol used before MAVLinkFramer
+void MAVLinkFramerUnitTest::_parseChar_benchmark(void)
+{
+    qint64 bytes = 0;
+    int messages = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    QBENCHMARK {
+        mavlink_message_t message;
+        mavlink_status_t status;
+
+        memset(mavlink_get_channel_status(_parseChannel), 0, sizeof(mavlink_status_t));
+        for (int pos=0; pos<_benchmarkStream.size(); pos++) {
+            if (mavlink_parse_char(_parseChannel, (uint8_t)_benchmarkStream[pos], &message, &status)) {
+                messages++;
+            }
+        }
+        bytes += _benchmarkStream.size();
+    }
+    _reportRate("mavlink_parse_char", bytes, timer.nsecsElapsed());
+
+    QVERIFY(messages > 0);
+}
+
+void MAVLinkFramerUnitTest::_framer_benchmark(void)
+{
+    qint64 bytes = 0;
+    int messages = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    QBENCHMARK {
+        MAVLinkFramer framer;
+        mavlink_message_t message;
+
+        for (int pos=0; pos<_benchmarkStream.size(); pos+=_benchmarkChunkSize) {
+            framer.setInput(_benchmarkStream.constData() + pos, qMin(_benchmarkChunkSize, _benchmarkStream.size() - pos));
+            while (framer.nextMessage(&message)) {
+                messages++;
+            }
+        }
+        bytes += _benchmarkStream.size();
+    }
+    _reportRate("MAVLinkFramer", bytes, timer.nsecsElapsed());
+
+    QVERIFY(messages > 0);
+}
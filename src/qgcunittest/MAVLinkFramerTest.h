@@ -0,0 +1,70 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MAVLINKFRAMERTEST_H
+#define MAVLINKFRAMERTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QList>
+
+#include "AutoTest.h"
+#include "MAVLinkFramer.h"
+
+/// @file
+///     @brief MAVLinkFramer unit test and receive path benchmark
+
+class MAVLinkFramerUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkFramerUnitTest(void);
+
+private slots:
+    void initTestCase(void);
+
+    void _cleanStream_test(void);
+    void _corruptStream_test(void);
+    void _byteByByte_test(void);
+
+    void _parseChar_benchmark(void);
+    void _framer_benchmark(void);
+
+private:
+    QByteArray _buildStream(int messageCount, bool corrupt);
+    QList<mavlink_message_t> _parseCharMessages(const QByteArray& stream);
+    QList<mavlink_message_t> _framerMessages(const QByteArray& stream, int maxChunkSize);
+    void _compareMessages(const QList<mavlink_message_t>& expected, const QList<mavlink_message_t>& actual);
+    void _reportRate(const char* name, qint64 bytes, qint64 nsecs);
+
+    static const int        _benchmarkMessageCount = 20000;
+    static const int        _benchmarkChunkSize = 512;  ///< Typical read size of a high baud rate serial link
+    static const uint8_t    _parseChannel = MAVLINK_COMM_0;
+
+    QByteArray _benchmarkStream;
+};
+
+DECLARE_TEST(MAVLinkFramerUnitTest)
+
+#endif
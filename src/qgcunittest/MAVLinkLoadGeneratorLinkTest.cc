@@ -0,0 +1,238 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#include "MAVLinkLoadGeneratorLinkTest.h"
+#include "MAVLinkFramer.h"
+#include "MAVLinkProtocol.h"
+#include "LinkManager.h"
+
+/// @file
+///     @brief MAVLinkLoadGeneratorLink unit test. The pipeline benchmark feeds MAVLinkProtocol in
+///             virtual time and reports the frames per second the receive path decodes.
+
+MAVLinkLoadGeneratorLinkUnitTest::MAVLinkLoadGeneratorLinkUnitTest(void)
+{
+
+}
+
+/// @brief Runs the link up to its frame limit without a consumer and returns all bytes it emitted
+QByteArray MAVLinkLoadGeneratorLinkUnitTest::_generate(MAVLinkLoadGeneratorLink* link)
+{
+    QSignalSpy bytesSpy(link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)));
+
+    link->setVirtualTime(true);
+    if (!link->connect()) {
+        return QByteArray();
+    }
+
+    // The thread ends at the frame limit, after which the spy is no longer written to
+    link->wait(10000);
+    link->disconnect();
+
+    QByteArray bytes;
+    for (int i = 0; i < bytesSpy.count(); i++) {
+        bytes.append(bytesSpy[i][1].toByteArray());
+    }
+    return bytes;
+}
+
+void MAVLinkLoadGeneratorLinkUnitTest::_mix_test(void)
+{
+    const int systemCount = 3;
+    const int frameLimit = 2000;
+
+    MAVLinkLoadGeneratorLink link;
+    link.setSystemCount(systemCount);
+    link.setStreams(QList<MAVLinkLoadGeneratorLink::Stream>() << MAVLinkLoadGeneratorLink::Stream(MAVLINK_MSG_ID_HEARTBEAT, 10)
+                                                              << MAVLinkLoadGeneratorLink::Stream(MAVLINK_MSG_ID_ATTITUDE, 100)
+                                                              << MAVLinkLoadGeneratorLink::Stream(MAVLINK_MSG_ID_PARAM_VALUE, 10));
+    link.setFrameLimit(frameLimit);
+
+    QByteArray bytes = _generate(&link);
+    QCOMPARE(link.getGeneratedFrameCount(), (quint64)frameLimit);
+
+    MAVLinkFramer framer;
+    mavlink_message_t message;
+    QMap<int, int> messageCounts;
+    QMap<int, int> systemCounts;
+    QMap<int, int> nextSequences;
+    quint32 lastAttitudeTime = 0;
+
+    framer.setInput(bytes.constData(), bytes.size());
+    while (framer.nextMessage(&message)) {
+        messageCounts[message.msgid]++;
+        systemCounts[message.sysid]++;
+
+        if (nextSequences.contains(message.sysid)) {
+            QCOMPARE((int)message.seq, nextSequences[message.sysid]);
+        }
+        nextSequences[message.sysid] = (message.seq + 1) & 0xFF;
+
+        if (message.msgid == MAVLINK_MSG_ID_ATTITUDE && message.sysid == MAVLinkLoadGeneratorLink::firstSystemId) {
+            // Virtual time advances by the interval of the stream
+            quint32 time = mavlink_msg_attitude_get_time_boot_ms(&message);
+            if (lastAttitudeTime) {
+                QCOMPARE(time - lastAttitudeTime, (quint32)10);
+            }
+            lastAttitudeTime = time;
+        }
+        if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+            QCOMPARE((int)mavlink_msg_heartbeat_get_mavlink_version(&message), MAVLINK_VERSION);
+        }
+    }
+
+    QCOMPARE(framer.parseErrorCount(), (quint32)0);
+    QCOMPARE(framer.messageCount(), (quint32)frameLimit);
+    QCOMPARE(systemCounts.count(), systemCount);
+    QCOMPARE(messageCounts.count(), 3);
+
+    // The attitude stream runs at ten times the rate of the others
+    QVERIFY(qAbs(messageCounts[MAVLINK_MSG_ID_ATTITUDE] - 10 * messageCounts[MAVLINK_MSG_ID_HEARTBEAT]) <= 11 * systemCount);
+}
+
+void MAVLinkLoadGeneratorLinkUnitTest::_reproducible_test(void)
+{
+    QByteArray runs[3];
+
+    for (int i = 0; i < 3; i++) {
+        MAVLinkLoadGeneratorLink link;
+        link.setSystemCount(5);
+        link.setFrameLimit(5000);
+        link.setLossRate(0.05);
+        link.setReorderRate(0.05);
+        link.setCorruptionRate(0.05);
+        link.setSeed(i < 2 ? 42 : 43);
+        runs[i] = _generate(&link);
+    }
+
+    QVERIFY(!runs[0].isEmpty());
+    QVERIFY(runs[0] == runs[1]);
+    QVERIFY(runs[0] != runs[2]);
+}
+
+void MAVLinkLoadGeneratorLinkUnitTest::_impairments_test(void)
+{
+    const int frameLimit = 10000;
+
+    // Loss
+    {
+        MAVLinkLoadGeneratorLink link;
+        link.setFrameLimit(frameLimit);
+        link.setLossRate(0.1);
+        QByteArray bytes = _generate(&link);
+
+        MAVLinkFramer framer;
+        mavlink_message_t message;
+        framer.setInput(bytes.constData(), bytes.size());
+        while (framer.nextMessage(&message)) {
+        }
+        QCOMPARE(framer.parseErrorCount(), (quint32)0);
+        QVERIFY((int)framer.messageCount() > frameLimit * 85 / 100 && (int)framer.messageCount() < frameLimit * 95 / 100);
+    }
+
+    // Reordering
+    {
+        MAVLinkLoadGeneratorLink link;
+        link.setFrameLimit(frameLimit);
+        link.setReorderRate(0.1);
+        QByteArray bytes = _generate(&link);
+
+        MAVLinkFramer framer;
+        mavlink_message_t message;
+        int outOfOrder = 0;
+        int lastSequence = -1;
+        framer.setInput(bytes.constData(), bytes.size());
+        while (framer.nextMessage(&message)) {
+            if (lastSequence >= 0 && message.seq != ((lastSequence + 1) & 0xFF)) {
+                outOfOrder++;
+            }
+            lastSequence = message.seq;
+        }
+        QCOMPARE(framer.messageCount(), (quint32)frameLimit);
+        QVERIFY(outOfOrder > 0);
+    }
+
+    // Corruption
+    {
+        MAVLinkLoadGeneratorLink link;
+        link.setFrameLimit(frameLimit);
+        link.setCorruptionRate(0.1);
+        QByteArray bytes = _generate(&link);
+
+        MAVLinkFramer framer;
+        mavlink_message_t message;
+        framer.setInput(bytes.constData(), bytes.size());
+        while (framer.nextMessage(&message)) {
+        }
+        QVERIFY(framer.parseErrorCount() > 0);
+        QVERIFY((int)framer.messageCount() > frameLimit * 80 / 100 && (int)framer.messageCount() < frameLimit);
+    }
+}
+
+/// @brief Drives the receive pipeline of MAVLinkProtocol as fast as it decodes. The heartbeat is
+///         left out of the mix so no UAS is created, add it to include the UAS in the measurement.
+void MAVLinkLoadGeneratorLinkUnitTest::_pipelineBenchmark_test(void)
+{
+    const int frameLimit = 200000;
+
+    MAVLinkProtocol* protocol = new MAVLinkProtocol();
+    protocol->enableLogging(false);
+
+    QList<MAVLinkLoadGeneratorLink::Stream> streams = MAVLinkLoadGeneratorLink::defaultStreams();
+    streams.removeFirst();
+    QCOMPARE(streams.count(), MAVLinkLoadGeneratorLink::defaultStreams().count() - 1);
+
+    MAVLinkLoadGeneratorLink* link = new MAVLinkLoadGeneratorLink();
+    link->setStreams(streams);
+    link->setSystemCount(20);
+    link->setVirtualTime(true);
+    link->setFrameLimit(frameLimit);
+
+    LinkManager::instance()->add(link);
+    LinkManager::instance()->addProtocol(link, protocol);
+
+    QSignalSpy finishedSpy(link, SIGNAL(generationFinished()));
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(link->connect());
+
+    while (link->getStatistics().framesReceived() < (quint32)frameLimit && timer.elapsed() < 60000) {
+        QTest::qWait(10);
+    }
+    qint64 elapsedMsecs = timer.elapsed();
+
+    // The link thread may still be on its way out after emitting the last frames
+    link->wait(1000);
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(link->getStatistics().framesReceived(), (quint32)frameLimit);
+    QCOMPARE(link->getStatistics().sequenceGaps(), (quint32)0);
+    QCOMPARE(link->getUnaccountedFrameCount(), (quint64)0);
+    qDebug() << "Receive pipeline:" << frameLimit * 1000 / qMax(elapsedMsecs, (qint64)1) << "frames per second,"
+             << link->getStatistics().bytesReceived() * 1000 / qMax(elapsedMsecs, (qint64)1) << "bytes per second";
+
+    LinkManager::instance()->removeLink(link);
+    link->disconnect();
+    delete link;
+    delete protocol;
+}
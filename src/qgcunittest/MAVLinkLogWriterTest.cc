@@ -0,0 +1,100 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include <QTemporaryFile>
+#include <QtEndian>
+
+#include "MAVLinkLogWriterTest.h"
+
+/// @file
+///     @brief MAVLinkLogWriter unit test. The log written from the writer thread must have the same format
+///             as the log written synchronously before: big endian timestamp followed by the frame.
+
+MAVLinkLogWriterUnitTest::MAVLinkLogWriterUnitTest(void)
+{
+
+}
+
+void MAVLinkLogWriterUnitTest::_packPing(uint32_t seq, mavlink_message_t* message)
+{
+    mavlink_msg_ping_pack(1, 1, message, seq * 1000, seq, 0, 0);
+}
+
+void MAVLinkLogWriterUnitTest::_logFormat_test(void)
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+
+    MAVLinkLogWriter writer;
+    writer.setSyncInterval(10);
+    writer.startLogging(&file);
+
+    // Enough messages for several whole blocks and a partial one which is written on stop
+    const int messageCount = 10000;
+    for (int i = 0; i < messageCount; i++) {
+        mavlink_message_t message;
+        _packPing(i, &message);
+        QVERIFY(writer.logMessage(1000000 + i, message));
+    }
+
+    writer.stopLogging();
+    QVERIFY(writer.blockWriteCount() > 1);
+    QCOMPARE(writer.droppedMessageCount(), 0);
+
+    file.seek(0);
+    QByteArray log = file.readAll();
+
+    QByteArray expected;
+    for (int i = 0; i < messageCount; i++) {
+        uint8_t buf[MAVLINK_MAX_PACKET_LEN + sizeof(quint64)];
+        mavlink_message_t message;
+        _packPing(i, &message);
+        qToBigEndian((quint64)(1000000 + i), buf);
+        int len = sizeof(quint64) + mavlink_msg_to_send_buffer(buf + sizeof(quint64), &message);
+        expected.append((const char*)buf, len);
+    }
+
+    QCOMPARE(log.size(), expected.size());
+    QVERIFY(log == expected);
+}
+
+void MAVLinkLogWriterUnitTest::_ringFull_test(void)
+{
+    // The writer thread is not started, so nothing is taken out of the ring
+    MAVLinkLogWriter writer(MAVLinkLogWriter::blockSize);
+
+    mavlink_message_t message;
+    _packPing(0, &message);
+    const int recordLength = sizeof(quint64) + MAVLINK_NUM_NON_PAYLOAD_BYTES + message.len;
+
+    int logged = 0;
+    while (writer.logMessage(0, message)) {
+        logged++;
+    }
+    QCOMPARE(logged, MAVLinkLogWriter::blockSize / recordLength);
+    QCOMPARE(writer.droppedMessageCount(), 1);
+    QCOMPARE(writer.backpressureCount(), 1);
+
+    QVERIFY(!writer.logMessage(0, message));
+    QCOMPARE(writer.droppedMessageCount(), 2);
+}
@@ -0,0 +1,53 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MAVLINKLOGWRITERTEST_H
+#define MAVLINKLOGWRITERTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "MAVLinkLogWriter.h"
+
+/// @file
+///     @brief MAVLinkLogWriter unit test
+
+class MAVLinkLogWriterUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkLogWriterUnitTest(void);
+
+private slots:
+    void _logFormat_test(void);
+    void _ringFull_test(void);
+
+private:
+    void _packPing(uint32_t seq, mavlink_message_t* message);
+};
+
+DECLARE_TEST(MAVLinkLogWriterUnitTest)
+
+#endif
@@ -0,0 +1,152 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include "MAVLinkMessageTest.h"
+#include "LinkInterface.h"
+
+/// @file
+///     @brief MAVLinkMessage and MAVLinkMessagePool unit test
+
+MAVLinkMessageUnitTest::MAVLinkMessageUnitTest(void) :
+    _pool(NULL)
+{
+
+}
+
+void MAVLinkMessageUnitTest::initTestCase(void)
+{
+    // Normally done by LinkInterface and MAVLinkProtocol
+    qRegisterMetaType<LinkInterface*>("LinkInterface*");
+    qRegisterMetaType<mavlink_message_t>("mavlink_message_t");
+    qRegisterMetaType<MAVLinkMessage>("MAVLinkMessage");
+}
+
+void MAVLinkMessageUnitTest::init(void)
+{
+    Q_ASSERT(_pool == NULL);
+    _pool = new MAVLinkMessagePool();
+    _legacyMessages.clear();
+}
+
+void MAVLinkMessageUnitTest::cleanup(void)
+{
+    Q_ASSERT(_pool);
+    _pool->release();
+    _pool = NULL;
+}
+
+MAVLinkMessage MAVLinkMessageUnitTest::_allocatePing(uint32_t seq)
+{
+    MAVLinkMessage message = _pool->allocate();
+    mavlink_msg_ping_pack(1, 1, message.writableMessage(), 0, seq, 0, 0);
+    return message;
+}
+
+void MAVLinkMessageUnitTest::legacyReceiveMessage(LinkInterface* link, mavlink_message_t message)
+{
+    Q_UNUSED(link);
+    _legacyMessages.append(message);
+}
+
+void MAVLinkMessageUnitTest::_share_test(void)
+{
+    MAVLinkMessage message = _allocatePing(42);
+    QCOMPARE(_pool->messagesInUse(), 1);
+
+    // Copies refer to the same message
+    MAVLinkMessage copy = message;
+    QCOMPARE(&copy.message(), &message.message());
+    QCOMPARE(mavlink_msg_ping_get_seq(&*copy), (uint32_t)42);
+    QCOMPARE(_pool->messagesInUse(), 1);
+
+    // So do copies through a QVariant, which is how queued signals copy their arguments
+    QVariant variant = QVariant::fromValue(message);
+    QCOMPARE(&variant.value<MAVLinkMessage>().message(), &message.message());
+
+    message = MAVLinkMessage();
+    QVERIFY(message.isNull());
+    copy = MAVLinkMessage();
+    QCOMPARE(_pool->messagesInUse(), 1);
+    variant.clear();
+    QCOMPARE(_pool->messagesInUse(), 0);
+}
+
+void MAVLinkMessageUnitTest::_poolReuse_test(void)
+{
+    // Keep a window of messages in flight, the pool must not grow after the first slab
+    QList<MAVLinkMessage> inFlight;
+    for (uint32_t i = 0; i < 10000; i++) {
+        inFlight.append(_allocatePing(i));
+        if (inFlight.count() > MAVLinkMessagePool::messagesPerSlab / 2) {
+            QCOMPARE(mavlink_msg_ping_get_seq(&*inFlight.first()), i - MAVLinkMessagePool::messagesPerSlab / 2);
+            inFlight.removeFirst();
+        }
+    }
+    QCOMPARE(_pool->slabCount(), 1);
+
+    // More messages in flight than fit in a slab grow the pool
+    for (int i = 0; i < MAVLinkMessagePool::messagesPerSlab; i++) {
+        inFlight.append(_allocatePing(i));
+    }
+    QCOMPARE(_pool->slabCount(), 2);
+
+    inFlight.clear();
+    QCOMPARE(_pool->messagesInUse(), 0);
+}
+
+void MAVLinkMessageUnitTest::_poolOutlivesOwner_test(void)
+{
+    MAVLinkMessagePool* pool = new MAVLinkMessagePool();
+    MAVLinkMessage message = pool->allocate();
+    mavlink_msg_ping_pack(1, 1, message.writableMessage(), 0, 7, 0, 0);
+
+    // The message stays valid after the owner let go of the pool, the pool goes away with the message
+    pool->release();
+    QCOMPARE(mavlink_msg_ping_get_seq(&*message), (uint32_t)7);
+    message = MAVLinkMessage();
+}
+
+void MAVLinkMessageUnitTest::_adapter_test(void)
+{
+    int methodIndex = metaObject()->indexOfMethod("legacyReceiveMessage(LinkInterface*,mavlink_message_t)");
+    QVERIFY(methodIndex != -1);
+
+    MAVLinkMessage message = _allocatePing(3);
+
+    MAVLinkMessageAdapter* adapter = new MAVLinkMessageAdapter(this, metaObject()->method(methodIndex));
+    adapter->receiveMessage(NULL, message);
+    QCOMPARE(_legacyMessages.count(), 1);
+    QCOMPARE(memcmp(&_legacyMessages[0], &*message, sizeof(mavlink_message_t)), 0);
+
+    // Queued deliveries hold the message until the adapter runs
+    LinkInterface* link = NULL;
+    QVERIFY(QMetaObject::invokeMethod(adapter, "receiveMessage", Qt::QueuedConnection, Q_ARG(LinkInterface*, link), Q_ARG(MAVLinkMessage, message)));
+    message = MAVLinkMessage();
+    QCOMPARE(_pool->messagesInUse(), 1);
+    QCoreApplication::sendPostedEvents(adapter);
+    QCOMPARE(_legacyMessages.count(), 2);
+    QCOMPARE(mavlink_msg_ping_get_seq(&_legacyMessages[1]), (uint32_t)3);
+    QCOMPARE(_pool->messagesInUse(), 0);
+
+    delete adapter;
+}
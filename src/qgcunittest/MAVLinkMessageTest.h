@@ -0,0 +1,67 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MAVLINKMESSAGETEST_H
+#define MAVLINKMESSAGETEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "MAVLinkMessage.h"
+
+/// @file
+///     @brief MAVLinkMessage and MAVLinkMessagePool unit test
+
+class MAVLinkMessageUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkMessageUnitTest(void);
+
+public slots:
+    // Not a test, the slot the adapter delivers to
+    void legacyReceiveMessage(LinkInterface* link, mavlink_message_t message);
+
+private slots:
+    void initTestCase(void);
+    void init(void);
+    void cleanup(void);
+
+    void _share_test(void);
+    void _poolReuse_test(void);
+    void _poolOutlivesOwner_test(void);
+    void _adapter_test(void);
+
+private:
+    MAVLinkMessage _allocatePing(uint32_t seq);
+
+    MAVLinkMessagePool* _pool;
+
+    QList<mavlink_message_t> _legacyMessages;
+};
+
+DECLARE_TEST(MAVLinkMessageUnitTest)
+
+#endif
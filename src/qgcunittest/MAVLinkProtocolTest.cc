@@ -0,0 +1,375 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include "MAVLinkProtocolTest.h"
+#include "MAVLinkFramer.h"
+#include "LinkManager.h"
+#include "QGCConfig.h"
+
+/// @file
+///     @brief MAVLinkProtocol unit test. The latency test measures the time from a link emitting
+///             bytesReceived to the protocol emitting messageReceived for the decoded message.
+///             Links are parsed in parallel, the messages of each link must still arrive in order.
+
+MAVLinkProtocolUnitTest::MAVLinkProtocolUnitTest(void) :
+    _protocol(NULL),
+    _link(NULL)
+{
+
+}
+
+// Called before every test
+void MAVLinkProtocolUnitTest::init(void)
+{
+    Q_ASSERT(_protocol == NULL);
+    Q_ASSERT(_link == NULL);
+
+    _protocol = new MAVLinkProtocol();
+    Q_CHECK_PTR(_protocol);
+    _protocol->enableHeartbeats(true);
+    _protocol->enableLogging(false);
+    _protocol->enableMultiplexing(false);
+
+    _link = new MockLink();
+    Q_CHECK_PTR(_link);
+    _link->connect();
+
+    LinkManager::instance()->add(_link);
+    LinkManager::instance()->addProtocol(_link, _protocol);
+
+    _latencyNsecs.clear();
+    _pingSeqs.clear();
+    _pingCount = 0;
+}
+
+// Called after every test
+void MAVLinkProtocolUnitTest::cleanup(void)
+{
+    Q_ASSERT(_protocol);
+    Q_ASSERT(_link);
+
+    LinkManager::instance()->removeLink(_link);
+    delete _protocol;
+    delete _link;
+
+    _protocol = NULL;
+    _link = NULL;
+}
+
+/// @brief The heartbeat timer must keep firing on the protocol thread's event loop
+void MAVLinkProtocolUnitTest::_heartbeat_test(void)
+{
+    _link->clearWrittenBytes();
+    QTest::qWait(2500 / MAVLINK_HEARTBEAT_DEFAULT_RATE);
+
+    QByteArray bytes = _link->writtenBytes();
+    MAVLinkFramer framer;
+    mavlink_message_t message;
+    int heartbeatCount = 0;
+
+    framer.setInput(bytes.constData(), bytes.size());
+    while (framer.nextMessage(&message)) {
+        if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT && message.sysid == _protocol->getSystemId()) {
+            heartbeatCount++;
+        }
+    }
+    QVERIFY(heartbeatCount >= 1);
+}
+
+/// @brief The rate is applied to the timer on the protocol thread, but reads back right away
+void MAVLinkProtocolUnitTest::_heartbeatRate_test(void)
+{
+    int rate = _protocol->getHeartbeatRate();
+    _protocol->setHeartbeatRate(rate + 4);
+    QCOMPARE(_protocol->getHeartbeatRate(), rate + 4);
+    _protocol->setHeartbeatRate(rate);
+    QCOMPARE(_protocol->getHeartbeatRate(), rate);
+}
+
+void MAVLinkProtocolUnitTest::_messageReceived(LinkInterface* link, mavlink_message_t message)
+{
+    Q_UNUSED(link);
+
+    if (message.msgid == MAVLINK_MSG_ID_PING && message.sysid == _systemIdSender) {
+        // The ping timestamp carries the time at which the bytes were emitted
+        qint64 latency = _latencyTimer.nsecsElapsed() - (qint64)mavlink_msg_ping_get_time_usec(&message);
+
+        QMutexLocker locker(&_latencyMutex);
+        _latencyNsecs.append(latency);
+    }
+}
+
+void MAVLinkProtocolUnitTest::_receiveLatency_test(void)
+{
+    connect(_protocol, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)),
+            this, SLOT(_messageReceived(LinkInterface*, mavlink_message_t)), Qt::DirectConnection);
+
+    _latencyTimer.start();
+    for (int i=0; i<_latencyMessageCount; i++) {
+        uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+        mavlink_message_t message;
+
+        // Target a system other than us so the protocol does not answer the ping
+        mavlink_msg_ping_pack(_systemIdSender, 0, &message, _latencyTimer.nsecsElapsed(), i, _systemIdSender, 1);
+        int length = mavlink_msg_to_send_buffer(buffer, &message);
+        _link->emitBytesReceived(QByteArray((const char*)buffer, length));
+
+        // Space the packets out like a telemetry stream, an idle protocol thread has to wake up for each one
+        QTest::qWait(2);
+    }
+
+    int waitMsecs = 0;
+    while (waitMsecs < 1000) {
+        QMutexLocker locker(&_latencyMutex);
+        if (_latencyNsecs.count() == _latencyMessageCount) {
+            break;
+        }
+        locker.unlock();
+        QTest::qWait(10);
+        waitMsecs += 10;
+    }
+
+    disconnect(_protocol, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)),
+               this, SLOT(_messageReceived(LinkInterface*, mavlink_message_t)));
+
+    QMutexLocker locker(&_latencyMutex);
+    QCOMPARE(_latencyNsecs.count(), _latencyMessageCount);
+
+    qSort(_latencyNsecs);
+    qint64 total = 0;
+    foreach (qint64 latency, _latencyNsecs) {
+        total += latency;
+    }
+    qDebug() << "bytesReceived to messageReceived latency usecs: mean" << total / _latencyNsecs.count() / 1000
+             << "median" << _latencyNsecs[_latencyNsecs.count() / 2] / 1000
+             << "max" << _latencyNsecs.last() / 1000;
+
+    // With the old processEvents/msleep(2) loop the median was about one millisecond
+    QVERIFY(_latencyNsecs[_latencyNsecs.count() / 2] < 1000000);
+}
+
+/// @brief Packs a ping, targeted at a system other than us so the protocol does not answer it
+///     @param seq Ping sequence field, used to check the order of delivery
+///     @param sequenceNumber MAVLink packet sequence number
+QByteArray MAVLinkProtocolUnitTest::_packPing(uint32_t seq, uint8_t sequenceNumber)
+{
+    static const uint8_t crcExtra[256] = MAVLINK_MESSAGE_CRCS;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    mavlink_message_t message;
+
+    mavlink_msg_ping_pack(_systemIdSender, 0, &message, 0, seq, _systemIdSender, 1);
+    int length = mavlink_msg_to_send_buffer(buffer, &message);
+
+    // Packing assigns the next sequence number of the channel, replace it and fix up the checksum
+    buffer[2] = sequenceNumber;
+    uint16_t crc = crc_calculate(buffer + 1, MAVLINK_CORE_HEADER_LEN + message.len);
+    crc_accumulate(crcExtra[message.msgid], &crc);
+    buffer[length - 2] = crc & 0xFF;
+    buffer[length - 1] = crc >> 8;
+
+    return QByteArray((const char*)buffer, length);
+}
+
+void MAVLinkProtocolUnitTest::_timedMessageReceived(LinkInterface* link, MAVLinkMessage message)
+{
+    Q_UNUSED(link);
+
+    QMutexLocker locker(&_pingMutex);
+    _receiveUsecs.append(message.receiveUsecs());
+}
+
+/// @brief The receive time is taken when the link hands the bytes over, not once the protocol thread gets to them
+void MAVLinkProtocolUnitTest::_receiveTime_test(void)
+{
+    _receiveUsecs.clear();
+    _protocol->subscribeSystem(_systemIdSender, this, SLOT(_timedMessageReceived(LinkInterface*, MAVLinkMessage)), -1, Qt::DirectConnection);
+
+    quint64 beforeUsecs = QGC::groundTimeUsecs();
+    _link->emitBytesReceived(_packPing(0, 0));
+    quint64 afterUsecs = QGC::groundTimeUsecs();
+
+    for (int waitMsecs = 0; waitMsecs < 1000; waitMsecs += 10) {
+        QMutexLocker locker(&_pingMutex);
+        if (!_receiveUsecs.isEmpty()) {
+            break;
+        }
+        locker.unlock();
+        QTest::qWait(10);
+    }
+
+    _protocol->unsubscribeSystem(_systemIdSender, this);
+
+    QMutexLocker locker(&_pingMutex);
+    QCOMPARE(_receiveUsecs.count(), 1);
+    QVERIFY(_receiveUsecs[0] >= beforeUsecs);
+    QVERIFY(_receiveUsecs[0] <= afterUsecs);
+}
+
+/// @brief A removed link is deleted right away, the protocol must not touch it anymore
+void MAVLinkProtocolUnitTest::_linkRemoved_test(void)
+{
+    MockLink* link2 = new MockLink();
+    link2->connect();
+    LinkManager::instance()->add(link2);
+    LinkManager::instance()->addProtocol(link2, _protocol);
+
+    // Hold back messages in the shaper, they are still queued when the link goes away
+    MAVLinkTransmitQueue* queue = _protocol->getTransmitQueue(link2);
+    QVERIFY(queue != NULL);
+    queue->setRate(100);
+    mavlink_message_t message;
+    for (int i=0; i<20; i++) {
+        mavlink_msg_ping_pack(_protocol->getSystemId(), _protocol->getComponentId(), &message, 0, i, _systemIdSender, 1);
+        _protocol->sendMessage(link2, message);
+    }
+    link2->emitBytesReceived(_packPing(0, 0));
+
+    LinkManager::instance()->removeLink(link2);
+    QVERIFY(_protocol->getTransmitQueue(link2) == NULL);
+    link2->clearWrittenBytes();
+
+    // Sending to the removed link is dropped and the link is not written to anymore
+    _protocol->sendMessage(link2, message);
+    QTest::qWait(200);
+    QCOMPARE(link2->writtenBytes().size(), 0);
+
+    delete link2;
+
+    // Keep shaping and receiving on the other link after the delete
+    _protocol->sendMessage(_link, message);
+    QTest::qWait(200);
+}
+
+void MAVLinkProtocolUnitTest::_pingReceived(LinkInterface* link, mavlink_message_t message)
+{
+    if (message.msgid == MAVLINK_MSG_ID_PING && message.sysid == _systemIdSender) {
+        QMutexLocker locker(&_pingMutex);
+        _pingSeqs[link].append(mavlink_msg_ping_get_seq(&message));
+        _pingCount++;
+    }
+}
+
+bool MAVLinkProtocolUnitTest::_waitForPings(int count)
+{
+    for (int waitMsecs = 0; waitMsecs < 5000; waitMsecs += 10) {
+        QMutexLocker locker(&_pingMutex);
+        if (_pingCount >= count) {
+            return true;
+        }
+        locker.unlock();
+        QTest::qWait(10);
+    }
+    return false;
+}
+
+/// @brief Bytes of several links are parsed in parallel, each link must still deliver its messages in order
+void MAVLinkProtocolUnitTest::_linkOrder_test(void)
+{
+    MockLink* link2 = new MockLink();
+    link2->connect();
+    LinkManager::instance()->add(link2);
+    LinkManager::instance()->addProtocol(link2, _protocol);
+
+    connect(_protocol, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)),
+            this, SLOT(_pingReceived(LinkInterface*, mavlink_message_t)), Qt::DirectConnection);
+
+    // Interleave both links, splitting packets across chunks at different offsets
+    const int pingCount = 2000;
+    QByteArray stream1;
+    QByteArray stream2;
+    for (int i=0; i<pingCount; i++) {
+        stream1.append(_packPing(i, i));
+        stream2.append(_packPing(i, i));
+    }
+    int offset1 = 0;
+    int offset2 = 0;
+    while (offset1 < stream1.size() || offset2 < stream2.size()) {
+        if (offset1 < stream1.size()) {
+            _link->emitBytesReceived(stream1.mid(offset1, 97));
+            offset1 += 97;
+        }
+        if (offset2 < stream2.size()) {
+            link2->emitBytesReceived(stream2.mid(offset2, 61));
+            offset2 += 61;
+        }
+    }
+
+    QVERIFY(_waitForPings(2 * pingCount));
+
+    disconnect(_protocol, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)),
+               this, SLOT(_pingReceived(LinkInterface*, mavlink_message_t)));
+
+    QMutexLocker locker(&_pingMutex);
+    QCOMPARE(_pingSeqs[_link].count(), pingCount);
+    QCOMPARE(_pingSeqs[link2].count(), pingCount);
+    for (int i=0; i<pingCount; i++) {
+        QCOMPARE(_pingSeqs[_link][i], i);
+        QCOMPARE(_pingSeqs[link2][i], i);
+    }
+    QCOMPARE(_protocol->getReceivedPacketCount(_link), pingCount);
+    QCOMPARE(_protocol->getReceivedPacketCount(link2), pingCount);
+    QCOMPARE(_protocol->getDroppedPacketCount(_link), 0);
+    QCOMPARE(_protocol->getDroppedPacketCount(link2), 0);
+    locker.unlock();
+
+    LinkManager::instance()->removeLink(link2);
+    delete link2;
+}
+
+/// @brief Lost packets are counted across sequence number wrap around, on the link they were lost on
+void MAVLinkProtocolUnitTest::_sequenceLoss_test(void)
+{
+    MockLink* link2 = new MockLink();
+    link2->connect();
+    LinkManager::instance()->add(link2);
+    LinkManager::instance()->addProtocol(link2, _protocol);
+
+    connect(_protocol, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)),
+            this, SLOT(_pingReceived(LinkInterface*, mavlink_message_t)), Qt::DirectConnection);
+
+    // Skip every tenth packet on the first link over more than two wrap arounds of the sequence number.
+    // The second link carries the same system without loss, like a redundant radio.
+    const int packetCount = 600;
+    int sentCount = 0;
+    int lostCount = 0;
+    for (int i=0; i<packetCount; i++) {
+        if (i % 10 == 5) {
+            lostCount++;
+        } else {
+            _link->emitBytesReceived(_packPing(i, i & 0xFF));
+            sentCount++;
+        }
+        link2->emitBytesReceived(_packPing(i, i & 0xFF));
+    }
+
+    QVERIFY(_waitForPings(sentCount + packetCount));
+
+    disconnect(_protocol, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)),
+               this, SLOT(_pingReceived(LinkInterface*, mavlink_message_t)));
+
+    QCOMPARE(_protocol->getDroppedPacketCount(_link), lostCount);
+    QCOMPARE(_protocol->getDroppedPacketCount(link2), 0);
+
+    LinkManager::instance()->removeLink(link2);
+    delete link2;
+}
@@ -0,0 +1,89 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MAVLINKPROTOCOLTEST_H
+#define MAVLINKPROTOCOLTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QList>
+#include <QMap>
+
+#include "AutoTest.h"
+#include "MAVLinkProtocol.h"
+#include "MockLink.h"
+
+/// @file
+///     @brief MAVLinkProtocol unit test
+
+class MAVLinkProtocolUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkProtocolUnitTest(void);
+
+private slots:
+    void init(void);
+    void cleanup(void);
+
+    void _heartbeat_test(void);
+    void _heartbeatRate_test(void);
+    void _receiveLatency_test(void);
+    void _linkOrder_test(void);
+    void _sequenceLoss_test(void);
+    void _receiveTime_test(void);
+    void _linkRemoved_test(void);
+
+    // Connected directly to MAVLinkProtocol::messageReceived, called on the protocol thread
+    void _messageReceived(LinkInterface* link, mavlink_message_t message);
+    void _pingReceived(LinkInterface* link, mavlink_message_t message);
+    // Subscribed directly to the sender system, called on the protocol thread
+    void _timedMessageReceived(LinkInterface* link, MAVLinkMessage message);
+
+private:
+    QByteArray _packPing(uint32_t seq, uint8_t sequenceNumber);
+    bool _waitForPings(int count);
+
+    static const uint8_t    _systemIdSender = 42;
+    static const int        _latencyMessageCount = 200;
+
+    MAVLinkProtocol*    _protocol;
+    MockLink*           _link;
+
+    QElapsedTimer       _latencyTimer;
+    QMutex              _latencyMutex;
+    QList<qint64>       _latencyNsecs;  ///< Time from bytesReceived to messageReceived for each ping
+
+    QMutex                              _pingMutex;
+    QMap<LinkInterface*, QList<int> >   _pingSeqs;  ///< Ping seq fields in order of reception, for each link
+    int                                 _pingCount;
+
+    QList<quint64>      _receiveUsecs;  ///< Receive time of each message of the sender, protected by _pingMutex
+};
+
+DECLARE_TEST(MAVLinkProtocolUnitTest)
+
+#endif
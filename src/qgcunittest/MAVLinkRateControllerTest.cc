@@ -0,0 +1,194 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include "MAVLinkRateControllerTest.h"
+
+/// @file
+///     @brief MAVLinkRateController unit test. A vehicle is heard on a radio link which reports its buffer
+///             running full, the requested stream rates and the uplink rate must follow.
+
+MAVLinkRateControllerUnitTest::MAVLinkRateControllerUnitTest(void) :
+    _link(NULL),
+    _queue(NULL),
+    _controller(NULL)
+{
+
+}
+
+void MAVLinkRateControllerUnitTest::init(void)
+{
+    Q_ASSERT(_controller == NULL);
+
+    _link = new MockLink();
+    _queue = new MAVLinkTransmitQueue(_link);
+    _controller = new MAVLinkRateController();
+    _controller->setAdjustInterval(0);
+}
+
+void MAVLinkRateControllerUnitTest::cleanup(void)
+{
+    delete _controller;
+    delete _queue;
+    delete _link;
+
+    _controller = NULL;
+    _queue = NULL;
+    _link = NULL;
+}
+
+/// @brief Reports the rates the vehicle runs its streams at, as in DATA_STREAM
+void MAVLinkRateControllerUnitTest::_reportVehicleRates(void)
+{
+    _controller->updateStreamRate(_vehicleSystemId, MAV_DATA_STREAM_RAW_SENSORS, 2);
+    _controller->updateStreamRate(_vehicleSystemId, MAV_DATA_STREAM_POSITION, 3);
+    _controller->updateStreamRate(_vehicleSystemId, MAV_DATA_STREAM_EXTRA1, 25);
+    _controller->updateStreamRate(_vehicleSystemId, MAV_DATA_STREAM_EXTRA2, 0);
+}
+
+/// @brief Checks that the running streams of the vehicle are requested at the scaled rates
+void MAVLinkRateControllerUnitTest::_checkRequests(const QList<mavlink_message_t>& requests, double scale)
+{
+    // The stopped stream stays stopped, the streams the vehicle did not report are left alone
+    QCOMPARE(requests.count(), 3);
+
+    foreach (const mavlink_message_t& message, requests) {
+        QCOMPARE((int)message.msgid, MAVLINK_MSG_ID_REQUEST_DATA_STREAM);
+        QCOMPARE((int)message.sysid, _localSystemId);
+
+        mavlink_request_data_stream_t request;
+        mavlink_msg_request_data_stream_decode(&message, &request);
+        QCOMPARE((int)request.target_system, _vehicleSystemId);
+        QCOMPARE((int)request.start_stop, 1);
+
+        int expectedRate = qMax(1, qRound(_controller->streamRate(_vehicleSystemId, request.req_stream_id) * scale));
+        QCOMPARE((int)request.req_message_rate, expectedRate);
+    }
+}
+
+void MAVLinkRateControllerUnitTest::_noVehicle_test(void)
+{
+    // Nothing to adapt without a vehicle
+    QVERIFY(_controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0).isEmpty());
+    QCOMPARE(_controller->scale(_link), 1.0);
+}
+
+void MAVLinkRateControllerUnitTest::_decrease_test(void)
+{
+    _controller->addSystem(_link, _queue, _vehicleSystemId);
+    _reportVehicleRates();
+
+    // A full radio buffer lowers the rates
+    QList<mavlink_message_t> requests = _controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0);
+    double scale = _controller->scale(_link);
+    QVERIFY(scale < 1.0);
+    _checkRequests(requests, scale);
+
+    // The uplink is throttled as well
+    QCOMPARE(_queue->rate(), (qint64)(_link->getConnectionSpeed() / 10 * scale));
+
+    // Down to the minimum, but streams are never turned off
+    for (int i=0; i<20; i++) {
+        _controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0);
+    }
+    QCOMPARE(_controller->scale(_link), MAVLinkRateController::minimumScale);
+    QVERIFY(_controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0).isEmpty());
+}
+
+void MAVLinkRateControllerUnitTest::_increase_test(void)
+{
+    _controller->addSystem(_link, _queue, _vehicleSystemId);
+    _reportVehicleRates();
+    _controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0);
+    _controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0);
+    double scale = _controller->scale(_link);
+
+    // An empty radio buffer raises the rates step by step
+    QList<mavlink_message_t> requests = _controller->updateRadioStatus(_link, _txbufEmpty, _localSystemId, 0);
+    QVERIFY(_controller->scale(_link) > scale);
+    _checkRequests(requests, _controller->scale(_link));
+
+    for (int i=0; i<20 && _controller->scale(_link) < 1.0; i++) {
+        requests = _controller->updateRadioStatus(_link, _txbufEmpty, _localSystemId, 0);
+    }
+    QCOMPARE(_controller->scale(_link), 1.0);
+
+    // The vehicle is back at its own rates
+    _checkRequests(requests, 1.0);
+    QCOMPARE(_controller->streamRate(_vehicleSystemId, MAV_DATA_STREAM_EXTRA1), 25);
+
+    // Back to the link rate
+    QCOMPARE(_queue->rate(), _link->getConnectionSpeed() / 10);
+}
+
+void MAVLinkRateControllerUnitTest::_loss_test(void)
+{
+    _controller->addSystem(_link, _queue, _vehicleSystemId);
+
+    // Loss lowers the rates even if the radio buffer has room
+    _controller->updateLoss(_link, 30.0f);
+    QVERIFY(!_controller->updateRadioStatus(_link, _txbufEmpty, _localSystemId, 0).isEmpty());
+    QVERIFY(_controller->scale(_link) < 1.0);
+}
+
+void MAVLinkRateControllerUnitTest::_adjustInterval_test(void)
+{
+    _controller->setAdjustInterval(10000);
+    _controller->addSystem(_link, _queue, _vehicleSystemId);
+
+    // The vehicle gets time to react before the rates are lowered further
+    QVERIFY(!_controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0).isEmpty());
+    double scale = _controller->scale(_link);
+    QVERIFY(_controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0).isEmpty());
+    QCOMPARE(_controller->scale(_link), scale);
+}
+
+void MAVLinkRateControllerUnitTest::_unknownRates_test(void)
+{
+    _controller->addSystem(_link, _queue, _vehicleSystemId);
+
+    // Without known rates nothing is requested from the vehicle, only the uplink is throttled
+    QVERIFY(_controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0).isEmpty());
+    QVERIFY(_controller->scale(_link) < 1.0);
+    QVERIFY(_queue->rate() > 0);
+
+    // A request for all streams at their default rate makes the rates unknown again
+    _controller->setStreamRate(_vehicleSystemId, MAV_DATA_STREAM_RAW_SENSORS, 4);
+    QCOMPARE(_controller->streamRate(_vehicleSystemId, MAV_DATA_STREAM_RAW_SENSORS), 4);
+    _controller->setStreamRate(_vehicleSystemId, MAV_DATA_STREAM_ALL, -1);
+    QCOMPARE(_controller->streamRate(_vehicleSystemId, MAV_DATA_STREAM_RAW_SENSORS), -1);
+}
+
+void MAVLinkRateControllerUnitTest::_throttledReport_test(void)
+{
+    _controller->addSystem(_link, _queue, _vehicleSystemId);
+    _reportVehicleRates();
+    _controller->updateRadioStatus(_link, _txbufFull, _localSystemId, 0);
+
+    // While throttled the vehicle reports the rates the controller asked for, they are not its own
+    _controller->updateStreamRate(_vehicleSystemId, MAV_DATA_STREAM_EXTRA1, 17);
+    QCOMPARE(_controller->streamRate(_vehicleSystemId, MAV_DATA_STREAM_EXTRA1), 25);
+
+    // The user may still change the rates
+    _controller->setStreamRate(_vehicleSystemId, MAV_DATA_STREAM_EXTRA1, 50);
+    QCOMPARE(_controller->streamRate(_vehicleSystemId, MAV_DATA_STREAM_EXTRA1), 50);
+}
@@ -0,0 +1,72 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MAVLINKRATECONTROLLERTEST_H
+#define MAVLINKRATECONTROLLERTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "MAVLinkRateController.h"
+#include "MockLink.h"
+
+/// @file
+///     @brief MAVLinkRateController unit test
+
+class MAVLinkRateControllerUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkRateControllerUnitTest(void);
+
+private slots:
+    void init(void);
+    void cleanup(void);
+
+    void _noVehicle_test(void);
+    void _decrease_test(void);
+    void _increase_test(void);
+    void _loss_test(void);
+    void _adjustInterval_test(void);
+    void _unknownRates_test(void);
+    void _throttledReport_test(void);
+
+private:
+    void _reportVehicleRates(void);
+    void _checkRequests(const QList<mavlink_message_t>& requests, double scale);
+
+    static const int _localSystemId = 255;
+    static const int _vehicleSystemId = 1;
+    static const unsigned _txbufFull = 5;       ///< Free radio buffer in percent when it runs full
+    static const unsigned _txbufEmpty = 100;    ///< Free radio buffer in percent when it is empty
+
+    MockLink*               _link;
+    MAVLinkTransmitQueue*   _queue;
+    MAVLinkRateController*  _controller;
+};
+
+DECLARE_TEST(MAVLinkRateControllerUnitTest)
+
+#endif
@@ -0,0 +1,144 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include "MAVLinkRouterTest.h"
+
+/// @file
+///     @brief MAVLinkRouter unit test. A vehicle is heard on the radio link, a companion computer on the
+///             companion link. Messages must only be forwarded to the links their target lives behind.
+
+MAVLinkRouterUnitTest::MAVLinkRouterUnitTest(void) :
+    _router(NULL),
+    _radioLink(NULL),
+    _companionLink(NULL),
+    _otherLink(NULL)
+{
+
+}
+
+void MAVLinkRouterUnitTest::init(void)
+{
+    Q_ASSERT(_router == NULL);
+
+    _router = new MAVLinkRouter();
+    _radioLink = new MockLink();
+    _companionLink = new MockLink();
+    _otherLink = new MockLink();
+
+    _router->addLink(_radioLink);
+    _router->addLink(_companionLink);
+    _router->addLink(_otherLink);
+
+    // Learn the routes from the heartbeats
+    mavlink_message_t message;
+    mavlink_msg_heartbeat_pack(_vehicleSystemId, MAV_COMP_ID_AUTOPILOT1, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_PX4, 0, 0, MAV_STATE_ACTIVE);
+    _router->routeMessage(_radioLink, message, _localSystemId);
+    mavlink_msg_heartbeat_pack(_companionSystemId, MAV_COMP_ID_SYSTEM_CONTROL, &message, MAV_TYPE_ONBOARD_CONTROLLER, MAV_AUTOPILOT_INVALID, 0, 0, MAV_STATE_ACTIVE);
+    _router->routeMessage(_companionLink, message, _localSystemId);
+}
+
+void MAVLinkRouterUnitTest::cleanup(void)
+{
+    delete _router;
+    delete _radioLink;
+    delete _companionLink;
+    delete _otherLink;
+
+    _router = NULL;
+    _radioLink = NULL;
+    _companionLink = NULL;
+    _otherLink = NULL;
+}
+
+void MAVLinkRouterUnitTest::_broadcast_test(void)
+{
+    QCOMPARE(_router->routeFor(_vehicleSystemId, MAV_COMP_ID_AUTOPILOT1), (LinkInterface*)_radioLink);
+    QCOMPARE(_router->routeFor(_companionSystemId, 0), (LinkInterface*)_companionLink);
+
+    // Broadcasts go to all links but the one they came from
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(_vehicleSystemId, MAV_COMP_ID_AUTOPILOT1, &message, 1000, 0.1f, 0.2f, 0.3f, 0, 0, 0);
+    QList<LinkInterface*> targets = _router->routeMessage(_radioLink, message, _localSystemId);
+
+    QCOMPARE(targets.count(), 2);
+    QVERIFY(targets.contains(_companionLink));
+    QVERIFY(targets.contains(_otherLink));
+}
+
+void MAVLinkRouterUnitTest::_targeted_test(void)
+{
+    // Command from the companion computer to the vehicle only goes to the radio
+    mavlink_message_t message;
+    mavlink_msg_command_long_pack(_companionSystemId, MAV_COMP_ID_SYSTEM_CONTROL, &message, _vehicleSystemId, MAV_COMP_ID_AUTOPILOT1, MAV_CMD_COMPONENT_ARM_DISARM, 0, 1, 0, 0, 0, 0, 0, 0);
+    QList<LinkInterface*> targets = _router->routeMessage(_companionLink, message, _localSystemId);
+
+    QCOMPARE(targets.count(), 1);
+    QCOMPARE(targets.first(), (LinkInterface*)_radioLink);
+
+    // Unknown component of a known system goes to the link of the system
+    mavlink_msg_command_long_pack(_companionSystemId, MAV_COMP_ID_SYSTEM_CONTROL, &message, _vehicleSystemId, MAV_COMP_ID_CAMERA, MAV_CMD_DO_DIGICAM_CONTROL, 0, 0, 0, 0, 0, 0, 0, 0);
+    targets = _router->routeMessage(_companionLink, message, _localSystemId);
+
+    QCOMPARE(targets.count(), 1);
+    QCOMPARE(targets.first(), (LinkInterface*)_radioLink);
+
+    // Unknown system could be anywhere
+    mavlink_msg_command_long_pack(_companionSystemId, MAV_COMP_ID_SYSTEM_CONTROL, &message, 77, 0, MAV_CMD_COMPONENT_ARM_DISARM, 0, 1, 0, 0, 0, 0, 0, 0);
+    targets = _router->routeMessage(_companionLink, message, _localSystemId);
+
+    QCOMPARE(targets.count(), 2);
+    QVERIFY(targets.contains(_radioLink));
+    QVERIFY(targets.contains(_otherLink));
+
+    // Messages for us are not forwarded
+    mavlink_msg_command_long_pack(_companionSystemId, MAV_COMP_ID_SYSTEM_CONTROL, &message, _localSystemId, 0, MAV_CMD_COMPONENT_ARM_DISARM, 0, 1, 0, 0, 0, 0, 0, 0);
+    targets = _router->routeMessage(_companionLink, message, _localSystemId);
+
+    QVERIFY(targets.isEmpty());
+}
+
+void MAVLinkRouterUnitTest::_duplicate_test(void)
+{
+    // The same message received over a second radio is only forwarded once
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(_vehicleSystemId, MAV_COMP_ID_AUTOPILOT1, &message, 1000, 0.1f, 0.2f, 0.3f, 0, 0, 0);
+    QList<LinkInterface*> targets = _router->routeMessage(_radioLink, message, _localSystemId);
+    QVERIFY(targets.contains(_companionLink));
+
+    targets = _router->routeMessage(_otherLink, message, _localSystemId);
+    QVERIFY(targets.isEmpty());
+    QCOMPARE(_router->duplicateCount(), (quint32)1);
+}
+
+void MAVLinkRouterUnitTest::_removeLink_test(void)
+{
+    _router->removeLink(_companionLink);
+    QVERIFY(_router->routeFor(_companionSystemId, 0) == NULL);
+
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(_vehicleSystemId, MAV_COMP_ID_AUTOPILOT1, &message, 1000, 0.1f, 0.2f, 0.3f, 0, 0, 0);
+    QList<LinkInterface*> targets = _router->routeMessage(_radioLink, message, _localSystemId);
+
+    QCOMPARE(targets.count(), 1);
+    QCOMPARE(targets.first(), (LinkInterface*)_otherLink);
+}
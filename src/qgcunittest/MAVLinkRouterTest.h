@@ -0,0 +1,66 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MAVLINKROUTERTEST_H
+#define MAVLINKROUTERTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "MAVLinkRouter.h"
+#include "MockLink.h"
+
+/// @file
+///     @brief MAVLinkRouter unit test
+
+class MAVLinkRouterUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkRouterUnitTest(void);
+
+private slots:
+    void init(void);
+    void cleanup(void);
+
+    void _broadcast_test(void);
+    void _targeted_test(void);
+    void _duplicate_test(void);
+    void _removeLink_test(void);
+
+private:
+    static const int _localSystemId = 255;
+    static const int _vehicleSystemId = 1;
+    static const int _companionSystemId = 2;
+
+    MAVLinkRouter*  _router;
+    MockLink*       _radioLink;         ///< The vehicle lives behind this link
+    MockLink*       _companionLink;     ///< The companion computer lives behind this link
+    MockLink*       _otherLink;         ///< Nobody was heard on this link yet
+};
+
+DECLARE_TEST(MAVLinkRouterUnitTest)
+
+#endif
@@ -0,0 +1,141 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#include "MAVLinkSwarmSimulationLinkTest.h"
+
+/// @file
+///     @brief MAVLinkSwarmSimulationLink unit test
+
+MAVLinkSwarmSimulationLinkUnitTest::MAVLinkSwarmSimulationLinkUnitTest(void)
+{
+
+}
+
+/// @brief Runs the swarm for the given time and returns all messages it sent
+///     @param command Bytes written to the link once it runs
+QList<mavlink_message_t> MAVLinkSwarmSimulationLinkUnitTest::_run(MAVLinkSwarmSimulationLink* link, int msecs, const QByteArray& command)
+{
+    QSignalSpy bytesSpy(link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)));
+
+    link->connect();
+    if (!command.isEmpty()) {
+        QTest::qWait(100);
+        link->writeBytes(command.constData(), command.size());
+    }
+    QTest::qWait(msecs);
+
+    // The link thread is stopped afterwards, the spy is no longer written to
+    link->disconnect();
+
+    MAVLinkFramer framer;
+    mavlink_message_t message;
+    QList<mavlink_message_t> messages;
+
+    for (int i = 0; i < bytesSpy.count(); i++) {
+        QByteArray bytes = bytesSpy[i][1].toByteArray();
+        framer.setInput(bytes.constData(), bytes.size());
+        while (framer.nextMessage(&message)) {
+            messages.append(message);
+        }
+    }
+    if (framer.parseErrorCount() || framer.skippedByteCount()) {
+        messages.clear();
+    }
+
+    return messages;
+}
+
+void MAVLinkSwarmSimulationLinkUnitTest::_swarm_test(void)
+{
+    const int vehicleCount = 200;
+
+    MAVLinkSwarmSimulationLink link(vehicleCount);
+    QList<mavlink_message_t> messages = _run(&link, 1500);
+    QVERIFY(!messages.isEmpty());
+
+    QSet<int> heartbeats;
+    QMap<int, int> nextSequences;
+    QMap<int, int> attitudeCounts;
+
+    foreach (const mavlink_message_t& message, messages) {
+        // The merged stream is in order for every vehicle
+        if (nextSequences.contains(message.sysid)) {
+            QCOMPARE((int)message.seq, nextSequences[message.sysid]);
+        }
+        nextSequences[message.sysid] = (message.seq + 1) & 0xFF;
+
+        if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+            heartbeats.insert(message.sysid);
+        } else if (message.msgid == MAVLINK_MSG_ID_ATTITUDE) {
+            attitudeCounts[message.sysid]++;
+        }
+    }
+
+    QCOMPARE(heartbeats.count(), vehicleCount);
+    QCOMPARE(nextSequences.count(), vehicleCount);
+    QVERIFY(heartbeats.contains(MAVLinkSwarmSimulationLink::firstSystemId));
+    QVERIFY(heartbeats.contains(MAVLinkSwarmSimulationLink::firstSystemId + vehicleCount - 1));
+
+    // 25 Hz attitude for 1.5 seconds, with room for a slow machine
+    QVERIFY(attitudeCounts[MAVLinkSwarmSimulationLink::firstSystemId] > 20);
+
+    qDebug() << vehicleCount << "vehicles:" << link.getTickCount() << "ticks, last tick" << link.getLastTickUsecs() << "usecs";
+}
+
+void MAVLinkSwarmSimulationLinkUnitTest::_command_test(void)
+{
+    const int targetSystem = MAVLinkSwarmSimulationLink::firstSystemId + 2;
+
+    mavlink_message_t message;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    mavlink_msg_command_long_pack(255, 0, &message, targetSystem, 0, MAV_CMD_COMPONENT_ARM_DISARM, 0, 0, 0, 0, 0, 0, 0, 0);
+    int length = mavlink_msg_to_send_buffer(buffer, &message);
+
+    MAVLinkSwarmSimulationLink link(10);
+    QList<mavlink_message_t> messages = _run(&link, 1500, QByteArray((const char*)buffer, length));
+    QVERIFY(!messages.isEmpty());
+
+    bool acked = false;
+    bool disarmed = false;
+    foreach (const mavlink_message_t& received, messages) {
+        if (received.msgid == MAVLINK_MSG_ID_COMMAND_ACK) {
+            // Only the target answers
+            QCOMPARE((int)received.sysid, targetSystem);
+            QCOMPARE((int)mavlink_msg_command_ack_get_command(&received), (int)MAV_CMD_COMPONENT_ARM_DISARM);
+            QCOMPARE((int)mavlink_msg_command_ack_get_result(&received), (int)MAV_RESULT_ACCEPTED);
+            acked = true;
+        } else if (received.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+            bool armed = (mavlink_msg_heartbeat_get_base_mode(&received) & MAV_MODE_FLAG_SAFETY_ARMED) != 0;
+            if (received.sysid == targetSystem && acked) {
+                QVERIFY(!armed);
+                disarmed = true;
+            } else if (received.sysid != targetSystem) {
+                QVERIFY(armed);
+            }
+        }
+    }
+
+    QVERIFY(acked);
+    QVERIFY(disarmed);
+}
@@ -0,0 +1,203 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#include "MAVLinkTimeSyncTest.h"
+#include "MAVLinkTimeSync.h"
+
+/// @file
+///     @brief MAVLinkTimeSync unit test
+
+/// Ground time the simulated vehicles boot at
+static const quint64 _bootUsecs = Q_UINT64_C(1400000000000000);
+
+MAVLinkTimeSyncUnitTest::MAVLinkTimeSyncUnitTest(void) :
+    _random(1)
+{
+
+}
+
+void MAVLinkTimeSyncUnitTest::init(void)
+{
+    _random = 1;
+}
+
+/// @brief Transport delay of a radio link: mostly 10 to 40 ms, every fifth message queued behind others for up to a second
+quint64 MAVLinkTimeSyncUnitTest::_delay(void)
+{
+    _random = _random * 1103515245 + 12345;
+    quint64 delay = 10000 + (_random >> 8) % 30000;
+    if ((_random >> 4) % 5 == 0) {
+        delay += (_random >> 12) % 1000000;
+    }
+    return delay;
+}
+
+/// @brief Jittery and queued round trips must not disturb the offset
+void MAVLinkTimeSyncUnitTest::_roundTrip_test(void)
+{
+    MAVLinkTimeSync timeSync;
+    QVERIFY(!timeSync.isSynchronized(1));
+
+    quint64 groundUsecs = _bootUsecs + 60000000;
+    for (int i = 0; i < 40; i++) {
+        quint64 requestUsecs = groundUsecs;
+        quint64 replyUsecs = requestUsecs + _delay();
+        quint64 receiveUsecs = replyUsecs + _delay();
+        timeSync.addRoundTrip(1, requestUsecs, replyUsecs - _bootUsecs, receiveUsecs);
+        groundUsecs += 1000000;
+    }
+
+    QVERIFY(timeSync.isSynchronized(1));
+    QVERIFY(timeSync.hasRoundTrip(1));
+    QVERIFY(!timeSync.isSynchronized(2));
+    QVERIFY(timeSync.getRoundTripUsecs(1) >= 20000);
+    QVERIFY(timeSync.getRoundTripUsecs(1) < 80000);
+
+    // The fast round trips are at most 30 ms asymmetric
+    quint64 converted = 0;
+    QVERIFY(timeSync.toGroundUsecs(1, 100000000, &converted));
+    qint64 error = (qint64)(converted - (_bootUsecs + 100000000));
+    QVERIFY(qAbs(error) < 15000);
+
+    // Unix timestamps are not in the time base of the vehicle
+    QVERIFY(!timeSync.toGroundUsecs(1, _bootUsecs, &converted));
+}
+
+/// @brief An onboard clock running 50 ppm fast is followed between the samples
+void MAVLinkTimeSyncUnitTest::_drift_test(void)
+{
+    MAVLinkTimeSync timeSync;
+
+    quint64 groundUsecs = _bootUsecs + 1000000;
+    for (int i = 0; i < MAVLinkTimeSync::sampleWindow; i++) {
+        quint64 replyUsecs = groundUsecs + 5000;
+        quint64 onboardUsecs = (replyUsecs - _bootUsecs) + (replyUsecs - _bootUsecs) / 20000;
+        timeSync.addRoundTrip(1, groundUsecs, onboardUsecs, replyUsecs + 5000);
+        groundUsecs += 1000000;
+    }
+
+    double drift = timeSync.getDriftPpm(1);
+    QVERIFY(drift > 49 && drift < 51);
+
+    // Ten seconds after the last sample the offset has changed by half a millisecond
+    quint64 expectedUsecs = groundUsecs + 10000000;
+    quint64 onboardUsecs = (expectedUsecs - _bootUsecs) + (expectedUsecs - _bootUsecs) / 20000;
+    quint64 converted = 0;
+    QVERIFY(timeSync.toGroundUsecs(1, onboardUsecs, &converted));
+    QVERIFY(qAbs((qint64)(converted - expectedUsecs)) < 50);
+}
+
+/// @brief The onboard clock starting over means the vehicle rebooted, the old offset is dropped
+void MAVLinkTimeSyncUnitTest::_reboot_test(void)
+{
+    MAVLinkTimeSync timeSync;
+
+    quint64 groundUsecs = _bootUsecs + 300000000;
+    for (int i = 0; i < 10; i++) {
+        timeSync.addRoundTrip(1, groundUsecs, groundUsecs + 10000 - _bootUsecs, groundUsecs + 20000);
+        groundUsecs += 1000000;
+    }
+
+    // Rebooted one second ago
+    quint64 rebootUsecs = groundUsecs - 1000000;
+    timeSync.addRoundTrip(1, groundUsecs, groundUsecs + 10000 - rebootUsecs, groundUsecs + 20000);
+
+    quint64 converted = 0;
+    QVERIFY(timeSync.toGroundUsecs(1, 2000000, &converted));
+    QCOMPARE(converted, rebootUsecs + 2000000);
+}
+
+/// @brief SYSTEM_TIME synchronizes vehicles without TIMESYNC, round trips take over once they arrive
+void MAVLinkTimeSyncUnitTest::_oneWay_test(void)
+{
+    MAVLinkTimeSync timeSync;
+
+    quint64 groundUsecs = _bootUsecs + 60000000;
+    for (int i = 0; i < 20; i++) {
+        timeSync.addOneWay(1, groundUsecs - _bootUsecs, groundUsecs + _delay());
+        groundUsecs += 1000000;
+    }
+
+    QVERIFY(timeSync.isSynchronized(1));
+    QVERIFY(!timeSync.hasRoundTrip(1));
+    QCOMPARE(timeSync.getRoundTripUsecs(1), (qint64)0);
+
+    // Off by about the fastest transport delay seen
+    quint64 converted = 0;
+    QVERIFY(timeSync.toGroundUsecs(1, 100000000, &converted));
+    qint64 error = (qint64)(converted - (_bootUsecs + 100000000));
+    QVERIFY(error > 5000 && error < 20000);
+
+    timeSync.addRoundTrip(1, groundUsecs, groundUsecs + 1000 - _bootUsecs, groundUsecs + 2000);
+    QVERIFY(timeSync.hasRoundTrip(1));
+    QVERIFY(timeSync.toGroundUsecs(1, 100000000, &converted));
+    QCOMPARE(converted, _bootUsecs + 100000000);
+
+    // One way samples are ignored from now on
+    timeSync.addOneWay(1, groundUsecs - _bootUsecs, groundUsecs + 500000);
+    QVERIFY(timeSync.toGroundUsecs(1, 100000000, &converted));
+    QCOMPARE(converted, _bootUsecs + 100000000);
+}
+
+/// @brief The alarm goes off once when the latency climbs over the threshold, and again only after it recovered
+void MAVLinkTimeSyncUnitTest::_latency_test(void)
+{
+    MAVLinkTimeSync timeSync;
+    timeSync.setLatencyThreshold(100000);
+    QSignalSpy spy(&timeSync, SIGNAL(latencyExceeded(int,qint64)));
+
+    quint64 groundUsecs = _bootUsecs + 60000000;
+    timeSync.addRoundTrip(1, groundUsecs, groundUsecs + 10000 - _bootUsecs, groundUsecs + 20000);
+
+    // Not synchronized, no latency
+    quint64 sentUsecs = 0;
+    QVERIFY(!timeSync.logLatency(2, 1000000, groundUsecs, &sentUsecs));
+
+    for (int i = 0; i < 20; i++) {
+        groundUsecs += 20000;
+        QVERIFY(timeSync.logLatency(1, groundUsecs - _bootUsecs, groundUsecs + 30000, &sentUsecs));
+        QCOMPARE(sentUsecs, groundUsecs);
+    }
+    QCOMPARE(timeSync.getLatencyUsecs(1), (qint64)30000);
+    QCOMPARE(spy.count(), 0);
+
+    for (int i = 0; i < 50; i++) {
+        groundUsecs += 20000;
+        timeSync.logLatency(1, groundUsecs - _bootUsecs, groundUsecs + 400000, &sentUsecs);
+    }
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toInt(), 1);
+    QVERIFY(spy.at(0).at(1).toLongLong() > 100000);
+
+    for (int i = 0; i < 50; i++) {
+        groundUsecs += 20000;
+        timeSync.logLatency(1, groundUsecs - _bootUsecs, groundUsecs + 30000, &sentUsecs);
+    }
+    for (int i = 0; i < 50; i++) {
+        groundUsecs += 20000;
+        timeSync.logLatency(1, groundUsecs - _bootUsecs, groundUsecs + 400000, &sentUsecs);
+    }
+    QCOMPARE(spy.count(), 2);
+}
@@ -0,0 +1,61 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#ifndef MAVLINKTIMESYNCTEST_H
+#define MAVLINKTIMESYNCTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+
+/// @file
+///     @brief MAVLinkTimeSync unit test
+
+class MAVLinkTimeSyncUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkTimeSyncUnitTest(void);
+
+private slots:
+    void init(void);
+
+    void _roundTrip_test(void);
+    void _drift_test(void);
+    void _reboot_test(void);
+    void _oneWay_test(void);
+    void _latency_test(void);
+
+private:
+    quint64 _delay(void);
+
+    quint32 _random;
+};
+
+DECLARE_TEST(MAVLinkTimeSyncUnitTest)
+
+#endif
@@ -0,0 +1,246 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include "MAVLinkTransmitQueueTest.h"
+#include "MAVLinkFramer.h"
+
+/// @file
+///     @brief MAVLinkTransmitQueue unit test. A parameter upload is queued on a slow link, manual control
+///             messages sent during the upload must go out first and the upload must be held to the link rate.
+
+MAVLinkTransmitQueueUnitTest::MAVLinkTransmitQueueUnitTest(void) :
+    _link(NULL),
+    _queue(NULL)
+{
+
+}
+
+void MAVLinkTransmitQueueUnitTest::init(void)
+{
+    Q_ASSERT(_link == NULL);
+
+    _link = new MockLink();
+    _link->connect();
+    _queue = new MAVLinkTransmitQueue(_link);
+    _queue->setRate(_rate);
+}
+
+void MAVLinkTransmitQueueUnitTest::cleanup(void)
+{
+    delete _queue;
+    delete _link;
+
+    _queue = NULL;
+    _link = NULL;
+}
+
+/// @brief Parses everything written to the link
+QList<mavlink_message_t> MAVLinkTransmitQueueUnitTest::_writtenMessages(int* parseErrors)
+{
+    QByteArray bytes = _link->writtenBytes();
+
+    MAVLinkFramer framer;
+    framer.setInput(bytes.constData(), bytes.size());
+
+    QList<mavlink_message_t> messages;
+    mavlink_message_t message;
+    while (framer.nextMessage(&message)) {
+        messages.append(message);
+    }
+    *parseErrors = framer.parseErrorCount();
+
+    return messages;
+}
+
+void MAVLinkTransmitQueueUnitTest::_enqueueParamSets(int count)
+{
+    mavlink_message_t message;
+    for (int i=0; i<count; i++) {
+        mavlink_msg_param_set_pack(255, 0, &message, 1, MAV_COMP_ID_AUTOPILOT1, "PARAM", (float)i, MAV_PARAM_TYPE_REAL32);
+        _queue->enqueue(message);
+    }
+}
+
+void MAVLinkTransmitQueueUnitTest::_priorityForMessage_test(void)
+{
+    QCOMPARE(MAVLinkTransmitQueue::priorityForMessage(MAVLINK_MSG_ID_MANUAL_CONTROL), MAVLinkTransmitQueue::PriorityControl);
+    QCOMPARE(MAVLinkTransmitQueue::priorityForMessage(MAVLINK_MSG_ID_HEARTBEAT), MAVLinkTransmitQueue::PriorityHeartbeat);
+    QCOMPARE(MAVLinkTransmitQueue::priorityForMessage(MAVLINK_MSG_ID_COMMAND_LONG), MAVLinkTransmitQueue::PriorityCommand);
+    QCOMPARE(MAVLinkTransmitQueue::priorityForMessage(MAVLINK_MSG_ID_PARAM_SET), MAVLinkTransmitQueue::PriorityBulk);
+    QCOMPARE(MAVLinkTransmitQueue::priorityForMessage(MAVLINK_MSG_ID_MISSION_ITEM), MAVLinkTransmitQueue::PriorityBulk);
+}
+
+void MAVLinkTransmitQueueUnitTest::_controlFirst_test(void)
+{
+    // More parameters than the link can take at once
+    _enqueueParamSets(100);
+    MAVLinkTransmitQueue::Statistics bulk = _queue->statistics(MAVLinkTransmitQueue::PriorityBulk);
+    QVERIFY(bulk.depth > 0);
+    QVERIFY(bulk.sentCount > 0);
+    _link->clearWrittenBytes();
+
+    // Stick input and commands don't wait for the upload
+    mavlink_message_t message;
+    mavlink_msg_manual_control_pack(255, 0, &message, 1, 100, 200, 300, 400, 0);
+    QVERIFY(_queue->enqueue(message) < 0);
+
+    int parseErrors;
+    QList<mavlink_message_t> messages = _writtenMessages(&parseErrors);
+    QCOMPARE(parseErrors, 0);
+    QCOMPARE(messages.count(), 1);
+    QCOMPARE((int)messages[0].msgid, MAVLINK_MSG_ID_MANUAL_CONTROL);
+
+    // Commands go before the remaining parameters once there is bandwidth again
+    mavlink_msg_command_long_pack(255, 0, &message, 1, MAV_COMP_ID_AUTOPILOT1, MAV_CMD_COMPONENT_ARM_DISARM, 0, 1, 0, 0, 0, 0, 0, 0);
+    _queue->enqueue(message);
+    _link->clearWrittenBytes();
+
+    int waitMsecs;
+    while ((waitMsecs = _queue->transmitPending()) >= 0 && _link->writtenBytes().isEmpty()) {
+        QTest::qWait(waitMsecs);
+    }
+
+    messages = _writtenMessages(&parseErrors);
+    QVERIFY(messages.count() > 0);
+    QCOMPARE((int)messages[0].msgid, MAVLINK_MSG_ID_COMMAND_LONG);
+
+    MAVLinkTransmitQueue::Statistics control = _queue->statistics(MAVLinkTransmitQueue::PriorityControl);
+    QCOMPARE(control.sentCount, (quint32)1);
+    QCOMPARE(control.depth, 0);
+    QCOMPARE(control.maxDepth, 1);
+}
+
+void MAVLinkTransmitQueueUnitTest::_shaping_test(void)
+{
+    static const int paramCount = 40;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    _enqueueParamSets(paramCount);
+
+    int waitMsecs;
+    while ((waitMsecs = _queue->transmitPending()) >= 0) {
+        QVERIFY(waitMsecs <= 1000);
+        QTest::qWait(waitMsecs);
+    }
+
+    // The first frame goes out with the initial tokens, the rest at the link rate
+    int bytes = _link->writtenBytes().size();
+    int frameLength = bytes / paramCount;
+    qint64 minimumMsecs = (bytes - MAVLINK_MAX_PACKET_LEN - frameLength) * 1000 / _rate;
+    QVERIFY(timer.elapsed() >= minimumMsecs);
+
+    MAVLinkTransmitQueue::Statistics bulk = _queue->statistics(MAVLinkTransmitQueue::PriorityBulk);
+    QCOMPARE(bulk.sentCount, (quint32)paramCount);
+    QCOMPARE(bulk.depth, 0);
+    QCOMPARE(bulk.maxDepth, paramCount);
+    QVERIFY(bulk.maxQueueUsecs >= (minimumMsecs - 10) * 1000);
+    QVERIFY(bulk.totalQueueUsecs >= bulk.maxQueueUsecs);
+}
+
+void MAVLinkTransmitQueueUnitTest::_sequence_test(void)
+{
+    _enqueueParamSets(20);
+
+    mavlink_message_t message;
+    mavlink_msg_manual_control_pack(255, 0, &message, 1, 100, 200, 300, 400, 0);
+    _queue->enqueue(message);
+
+    int waitMsecs;
+    while ((waitMsecs = _queue->transmitPending()) >= 0) {
+        QTest::qWait(waitMsecs);
+    }
+
+    // Sequence numbers are consecutive on the wire although the messages were reordered
+    int parseErrors;
+    QList<mavlink_message_t> messages = _writtenMessages(&parseErrors);
+    QCOMPARE(parseErrors, 0);
+    QCOMPARE(messages.count(), 21);
+    for (int i=0; i<messages.count(); i++) {
+        QCOMPARE((int)messages[i].seq, i);
+    }
+}
+
+void MAVLinkTransmitQueueUnitTest::_forwardedFrame_test(void)
+{
+    _enqueueParamSets(20);
+
+    // A frame forwarded from another link, with the sequence number its sender assigned
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(1, MAV_COMP_ID_AUTOPILOT1, &message, 1000, 0.1f, 0.2f, 0.3f, 0, 0, 0);
+
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    int length = mavlink_msg_to_send_buffer(frame, &message);
+    frame[2] = 200;
+    uint16_t crc = crc_calculate(frame + 1, MAVLINK_CORE_HEADER_LEN + frame[1]);
+    crc_accumulate(MAVLINK_MSG_ID_ATTITUDE_CRC, &crc);
+    frame[length - 2] = crc & 0xFF;
+    frame[length - 1] = crc >> 8;
+
+    _queue->enqueueFrame(frame, length);
+
+    int waitMsecs;
+    while ((waitMsecs = _queue->transmitPending()) >= 0) {
+        QTest::qWait(waitMsecs);
+    }
+
+    // It is written as received and does not use up a sequence number of this station
+    QVERIFY(_link->writtenBytes().contains(QByteArray((const char*)frame, length)));
+
+    int parseErrors;
+    QList<mavlink_message_t> messages = _writtenMessages(&parseErrors);
+    QCOMPARE(parseErrors, 0);
+    QCOMPARE(messages.count(), 21);
+
+    int sequence = 0;
+    for (int i=0; i<messages.count(); i++) {
+        if (messages[i].msgid == MAVLINK_MSG_ID_ATTITUDE) {
+            QCOMPARE((int)messages[i].seq, 200);
+        } else {
+            QCOMPARE((int)messages[i].seq, sequence++);
+        }
+    }
+}
+
+void MAVLinkTransmitQueueUnitTest::_drop_test(void)
+{
+    // Nothing can be sent while disconnected
+    _link->disconnect();
+    _enqueueParamSets(10);
+
+    MAVLinkTransmitQueue::Statistics bulk = _queue->statistics(MAVLinkTransmitQueue::PriorityBulk);
+    QCOMPARE(bulk.droppedCount, (quint32)10);
+    QCOMPARE(bulk.sentCount, (quint32)0);
+    QCOMPARE(bulk.depth, 0);
+    QCOMPARE(_link->writtenBytes().size(), 0);
+
+    // A full queue drops new messages
+    _link->connect();
+    _queue->setRate(1);
+    _enqueueParamSets(MAVLinkTransmitQueue::maxDepth * 2);
+
+    bulk = _queue->statistics(MAVLinkTransmitQueue::PriorityBulk);
+    QCOMPARE(bulk.depth, MAVLinkTransmitQueue::maxDepth);
+    QCOMPARE(bulk.droppedCount, 10 + MAVLinkTransmitQueue::maxDepth - bulk.sentCount);
+}
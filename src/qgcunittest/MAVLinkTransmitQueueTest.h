@@ -0,0 +1,67 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MAVLINKTRANSMITQUEUETEST_H
+#define MAVLINKTRANSMITQUEUETEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "MAVLinkTransmitQueue.h"
+#include "MockLink.h"
+
+/// @file
+///     @brief MAVLinkTransmitQueue unit test
+
+class MAVLinkTransmitQueueUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkTransmitQueueUnitTest(void);
+
+private slots:
+    void init(void);
+    void cleanup(void);
+
+    void _priorityForMessage_test(void);
+    void _controlFirst_test(void);
+    void _shaping_test(void);
+    void _sequence_test(void);
+    void _forwardedFrame_test(void);
+    void _drop_test(void);
+
+private:
+    QList<mavlink_message_t> _writtenMessages(int* parseErrors);
+    void _enqueueParamSets(int count);
+
+    static const qint64 _rate = 4000;   ///< Bytes per second the link is shaped to
+
+    MockLink*               _link;
+    MAVLinkTransmitQueue*   _queue;
+};
+
+DECLARE_TEST(MAVLinkTransmitQueueUnitTest)
+
+#endif
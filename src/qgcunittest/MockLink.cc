@@ -0,0 +1,70 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#include <QMutexLocker>
+
+#include "MockLink.h"
+
+/// @file
+///     @brief Mock implementation of a LinkInterface.
+
+MockLink::MockLink(void) :
+    _connected(false)
+{
+    _linkId = getNextLinkId();
+    _name = QString("Mock Link %1").arg(_linkId);
+}
+
+bool MockLink::connect(void)
+{
+    _connected = true;
+    emit connected();
+    emit connected(true);
+    return true;
+}
+
+bool MockLink::disconnect(void)
+{
+    _connected = false;
+    emit disconnected();
+    emit connected(false);
+    return true;
+}
+
+void MockLink::writeBytes(const char* bytes, qint64 length)
+{
+    QMutexLocker locker(&_writtenBytesMutex);
+    _writtenBytes.append(bytes, length);
+}
+
+QByteArray MockLink::writtenBytes(void)
+{
+    QMutexLocker locker(&_writtenBytesMutex);
+    return _writtenBytes;
+}
+
+void MockLink::clearWrittenBytes(void)
+{
+    QMutexLocker locker(&_writtenBytesMutex);
+    _writtenBytes.clear();
+}
@@ -0,0 +1,77 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+#ifndef MOCKLINK_H
+#define MOCKLINK_H
+
+#include <QMutex>
+#include <QByteArray>
+
+#include "LinkInterface.h"
+
+/// @file
+///     @brief Mock implementation of a LinkInterface. Bytes are fed into the application with
+///             emitBytesReceived, everything the application writes to the link is collected and
+///             can be retrieved with writtenBytes.
+
+class MockLink : public LinkInterface
+{
+    Q_OBJECT
+
+public:
+    MockLink(void);
+
+    // LinkInterface methods
+    virtual int     getId(void) const { return _linkId; }
+    virtual QString getName(void) const { return _name; }
+    virtual void    requestReset(void) { }
+    virtual bool    isConnected(void) const { return _connected; }
+    virtual qint64  getConnectionSpeed(void) const { return 100000000; }
+    virtual bool    connect(void);
+    virtual bool    disconnect(void);
+    virtual qint64  bytesAvailable(void) { return 0; }
+
+    /// @brief Emits bytesReceived as if the bytes had been received on the link
+    void emitBytesReceived(const QByteArray& bytes) { emit bytesReceived(this, bytes); }
+
+    /// @return All bytes written to the link since the last call to clearWrittenBytes
+    QByteArray writtenBytes(void);
+    void clearWrittenBytes(void);
+
+public slots:
+    // From LinkInterface
+    virtual void writeBytes(const char* bytes, qint64 length);
+
+protected slots:
+    // From LinkInterface
+    virtual void readBytes(void) { }
+
+private:
+    int         _linkId;
+    QString     _name;
+    bool        _connected;
+    QMutex      _writtenBytesMutex;     ///< writeBytes is called from the protocol thread
+    QByteArray  _writtenBytes;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#include "QGCUASSchedulerTest.h"
+#include "QGCUASScheduler.h"
+#include "MAVLinkProtocol.h"
+#include "UAS.h"
+
+/// @file
+///     @brief QGCUASScheduler unit test
+
+QGCUASSchedulerUnitTest::QGCUASSchedulerUnitTest(void)
+{
+
+}
+
+void QGCUASSchedulerUnitTest::_threadCount_test(void)
+{
+    QGCUASScheduler scheduler;
+    QVERIFY(scheduler.threadCount() >= 2);
+    QVERIFY(scheduler.threadCount() <= QGCUASScheduler::maximumThreadCount);
+
+    QGCUASScheduler fixed(3);
+    QCOMPARE(fixed.threadCount(), 3);
+}
+
+/// @brief The thread count stays fixed however many vehicles there are, and they are spread evenly
+void QGCUASSchedulerUnitTest::_balance_test(void)
+{
+    QGCUASScheduler scheduler(4);
+
+    QList<QThread*> threads;
+    for (int i = 0; i < 50; i++) {
+        QThread* thread = scheduler.acquireThread();
+        QVERIFY(thread->isRunning());
+        threads.append(thread);
+    }
+    QCOMPARE(threads.toSet().count(), 4);
+
+    QVector<int> counts = scheduler.vehicleCounts();
+    QCOMPARE(counts.count(), 4);
+    for (int i = 0; i < counts.count(); i++) {
+        QVERIFY(counts[i] == 12 || counts[i] == 13);
+    }
+
+    // Freed places are filled first
+    QThread* released = threads[0];
+    scheduler.releaseThread(released);
+    scheduler.releaseThread(released);
+    QCOMPARE(scheduler.acquireThread(), released);
+    threads.removeFirst();
+
+    for (int i = 0; i < threads.count(); i++) {
+        scheduler.releaseThread(threads[i]);
+    }
+    QCOMPARE(scheduler.vehicleCounts(), QVector<int>(4, 0));
+}
+
+void QGCUASSchedulerUnitTest::_foreignThread_test(void)
+{
+    QGCUASScheduler scheduler(2);
+    QThread* thread = scheduler.acquireThread();
+
+    // A vehicle of the unit tests runs on the test thread, releasing it leaves the pool alone
+    scheduler.releaseThread(QThread::currentThread());
+
+    QVector<int> counts = scheduler.vehicleCounts();
+    QCOMPARE(counts[0] + counts[1], 1);
+
+    scheduler.releaseThread(thread);
+}
+
+/// @brief Creates a scheduler the way the first vehicle does, from a thread other than the application thread
+class _SchedulerCreator : public QThread
+{
+public:
+    _SchedulerCreator(void) : scheduler(NULL) { }
+    QGCUASScheduler* scheduler;
+
+protected:
+    virtual void run(void) { scheduler = new QGCUASScheduler(2); }
+};
+
+void QGCUASSchedulerUnitTest::_createOnWorkerThread_test(void)
+{
+    _SchedulerCreator creator;
+    creator.start();
+    QVERIFY(creator.wait(5000));
+    Q_CHECK_PTR(creator.scheduler);
+
+    // The scheduler outlives the creating thread
+    QCOMPARE(creator.scheduler->thread(), qApp->thread());
+
+    delete creator.scheduler;
+}
+
+void QGCUASSchedulerUnitTest::_shutdown_test(void)
+{
+    QGCUASScheduler scheduler(2);
+    QThread* first = scheduler.acquireThread();
+    QThread* second = scheduler.acquireThread();
+    QVERIFY(first != second);
+
+    scheduler.shutdown();
+    QVERIFY(first->isFinished());
+    QVERIFY(second->isFinished());
+}
+
+/// @brief Vehicles are deleted after the shutdown at exit, no lane may deliver to them anymore
+void QGCUASSchedulerUnitTest::_shutdownDropsLanes_test(void)
+{
+    MAVLinkProtocol protocol;
+    UAS* uas = new UAS(&protocol, QThread::currentThread(), 7);
+
+    QGCUASScheduler scheduler(2);
+    scheduler.subscribe(&protocol, uas);
+
+    QGCUASScheduler::VehicleLoad load;
+    QVERIFY(scheduler.takeLoad(7, &load));
+
+    scheduler.shutdown();
+    QVERIFY(!scheduler.takeLoad(7, &load));
+
+    delete uas;
+}
@@ -0,0 +1,55 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#ifndef QGCUASSCHEDULERTEST_H
+#define QGCUASSCHEDULERTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+
+/// @file
+///     @brief QGCUASScheduler unit test
+
+class QGCUASSchedulerUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    QGCUASSchedulerUnitTest(void);
+
+private slots:
+    void _threadCount_test(void);
+    void _balance_test(void);
+    void _foreignThread_test(void);
+    void _createOnWorkerThread_test(void);
+    void _shutdown_test(void);
+    void _shutdownDropsLanes_test(void);
+};
+
+DECLARE_TEST(QGCUASSchedulerUnitTest)
+
+#endif
@@ -0,0 +1,149 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "SharedMemoryLinkTest.h"
+
+/// @file
+///     @brief SharedMemoryChannel and SharedMemoryLink unit test
+
+SharedMemoryLinkUnitTest::SharedMemoryLinkUnitTest(void)
+{
+
+}
+
+/// @brief Channel name which does not collide with a running ground station
+QString SharedMemoryLinkUnitTest::_channelName(void) const
+{
+    return QString("unittest-%1").arg(QCoreApplication::applicationPid());
+}
+
+void SharedMemoryLinkUnitTest::_channel_test(void)
+{
+    SharedMemoryChannel vehicle(_channelName(), SharedMemoryChannel::VehicleSide);
+    QCOMPARE(vehicle.open(), false);
+
+    SharedMemoryChannel groundStation(_channelName(), SharedMemoryChannel::GroundStationSide);
+    QCOMPARE(groundStation.open(), true);
+    QCOMPARE(vehicle.open(), true);
+
+    // Push more than the ring size through in odd sized chunks, so the ring wraps in the middle of a chunk
+    char chunk[1001];
+    char readBack[sizeof(chunk)];
+    for (int i = 0; i < 3 * SharedMemoryChannel::ringSize / (int)sizeof(chunk); i++) {
+        for (int j = 0; j < (int)sizeof(chunk); j++) {
+            chunk[j] = (char)(i + j);
+        }
+
+        QCOMPARE(vehicle.write(chunk, sizeof(chunk)), true);
+        QCOMPARE(groundStation.bytesAvailable(), (int)sizeof(chunk));
+        QCOMPARE(groundStation.read(readBack, sizeof(readBack)), (int)sizeof(chunk));
+        QCOMPARE(memcmp(chunk, readBack, sizeof(chunk)), 0);
+    }
+
+    // The other direction is a separate ring
+    QCOMPARE(vehicle.bytesAvailable(), 0);
+    QCOMPARE(groundStation.write("abc", 3), true);
+    QCOMPARE(groundStation.bytesAvailable(), 0);
+    QCOMPARE(vehicle.read(readBack, sizeof(readBack)), 3);
+    QCOMPARE(memcmp(readBack, "abc", 3), 0);
+}
+
+void SharedMemoryLinkUnitTest::_ringFull_test(void)
+{
+    SharedMemoryChannel groundStation(_channelName(), SharedMemoryChannel::GroundStationSide);
+    SharedMemoryChannel vehicle(_channelName(), SharedMemoryChannel::VehicleSide);
+    QCOMPARE(groundStation.open(), true);
+    QCOMPARE(vehicle.open(), true);
+
+    QByteArray block(SharedMemoryChannel::ringSize - 10, 'x');
+    QCOMPARE(vehicle.write(block.constData(), block.size()), true);
+
+    // Writes are all or nothing
+    QCOMPARE(vehicle.write(block.constData(), 11), false);
+    QCOMPARE(groundStation.bytesAvailable(), block.size());
+    QCOMPARE(vehicle.write(block.constData(), 10), true);
+    QCOMPARE(groundStation.bytesAvailable(), SharedMemoryChannel::ringSize);
+
+    QByteArray readBack(100, 0);
+    QCOMPARE(groundStation.read(readBack.data(), readBack.size()), readBack.size());
+    QCOMPARE(vehicle.write(block.constData(), 100), true);
+}
+
+static void _delayedWrite(SharedMemoryChannel* channel)
+{
+    QThread::msleep(50);
+    channel->write("wake", 4);
+}
+
+void SharedMemoryLinkUnitTest::_wait_test(void)
+{
+    SharedMemoryChannel groundStation(_channelName(), SharedMemoryChannel::GroundStationSide);
+    SharedMemoryChannel vehicle(_channelName(), SharedMemoryChannel::VehicleSide);
+    QCOMPARE(groundStation.open(), true);
+    QCOMPARE(vehicle.open(), true);
+
+    QElapsedTimer timer;
+    timer.start();
+    QCOMPARE(groundStation.waitForData(50), false);
+    QVERIFY(timer.elapsed() >= 40);
+
+    // A write from another thread wakes the reader long before the timeout
+    QFuture<void> writer = QtConcurrent::run(_delayedWrite, &vehicle);
+    timer.start();
+    QCOMPARE(groundStation.waitForData(5000), true);
+    QVERIFY(timer.elapsed() < 2000);
+    writer.waitForFinished();
+    QCOMPARE(groundStation.bytesAvailable(), 4);
+
+    // Data already waiting returns right away
+    QCOMPARE(groundStation.waitForData(5000), true);
+}
+
+void SharedMemoryLinkUnitTest::_link_test(void)
+{
+    SharedMemoryLink link(_channelName());
+    QSignalSpy receivedSpy(&link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)));
+
+    QCOMPARE(link.connect(), true);
+    QCOMPARE(link.isConnected(), true);
+
+    SharedMemoryChannel vehicle(_channelName(), SharedMemoryChannel::VehicleSide);
+    QCOMPARE(vehicle.open(), true);
+
+    QCOMPARE(vehicle.write("frame", 5), true);
+    QVERIFY(receivedSpy.count() > 0 || receivedSpy.wait(1000));
+    QCOMPARE(receivedSpy.at(0).at(1).toByteArray(), QByteArray("frame"));
+    QCOMPARE(link.getStatistics().bytesReceived(), (quint32)5);
+
+    link.writeBytes("reply", 5);
+    char readBack[16];
+    QCOMPARE(vehicle.read(readBack, sizeof(readBack)), 5);
+    QCOMPARE(memcmp(readBack, "reply", 5), 0);
+    QCOMPARE(link.getStatistics().bytesSent(), (quint32)5);
+
+    QCOMPARE(link.disconnect(), true);
+    QCOMPARE(link.isConnected(), false);
+}
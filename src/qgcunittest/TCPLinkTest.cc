@@ -209,3 +209,172 @@ void TCPLinkUnitTest::_connectSucceed_test(void)
     QTest::qWait(500);  // Wait a little for server thread to terminate
     delete server;
 }
+
+/// @brief Switches the link to server mode and connects it
+void TCPLinkUnitTest::_startServer(void)
+{
+    _link->setMode(TCPLink::ServerMode);
+    QCOMPARE(_link->getMode(), TCPLink::ServerMode);
+    QCOMPARE(_link->connect(), true);
+    QCOMPARE(_multiSpy->waitForSignalByIndex(connectedSignalIndex, 1000), true);
+    _multiSpy->clearAllSignals();
+}
+
+bool TCPLinkUnitTest::_waitForClientCount(int count, int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (_link->getClientCount() != count && timer.elapsed() < msecs) {
+        QTest::qWait(10);
+    }
+    return _link->getClientCount() == count;
+}
+
+void TCPLinkUnitTest::_serverFanOut_test(void)
+{
+    Q_ASSERT(_link);
+
+    const int clientCount = 4;
+    const int frameSize = 1024;
+    const int totalBytes = 4 * 1024 * 1024;
+
+    // Queues large enough for everything, so nothing is dropped while measuring
+    _link->setMaxClientQueueBytes(totalBytes);
+    _startServer();
+
+    QList<TCPLoopBackClient*> clients;
+    for (int i = 0; i < clientCount; i++) {
+        TCPLoopBackClient* client = new TCPLoopBackClient(_hostAddress, _port);
+        Q_CHECK_PTR(client);
+        clients.append(client);
+        QCOMPARE(client->waitForConnected(1000), true);
+    }
+    QCOMPARE(_waitForClientCount(clientCount, 1000), true);
+
+    QByteArray frame(frameSize, 'x');
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < totalBytes / frameSize; i++) {
+        _link->writeBytes(frame.constData(), frame.size());
+    }
+
+    bool allReceived = false;
+    while (!allReceived && timer.elapsed() < 10000) {
+        allReceived = true;
+        foreach (TCPLoopBackClient* client, clients) {
+            if (client->bytesReceived() < (quint32)totalBytes) {
+                allReceived = false;
+            }
+        }
+        if (!allReceived) {
+            QTest::qWait(1);
+        }
+    }
+    qint64 msecs = qMax(timer.elapsed(), (qint64)1);
+
+    qDebug() << "TCP server fan-out:" << clientCount << "clients," << totalBytes / 1024 << "KB each in" << msecs << "ms,"
+             << (double)clientCount * totalBytes / 1024.0 / 1024.0 / (msecs / 1000.0) << "MB/s total";
+
+    QCOMPARE(allReceived, true);
+    foreach (TCPLoopBackClient* client, clients) {
+        QCOMPARE(client->bytesReceived(), (quint32)totalBytes);
+    }
+    QCOMPARE(_link->getStatistics().droppedFrames(), (quint32)0);
+
+    qDeleteAll(clients);
+}
+
+void TCPLinkUnitTest::_serverDropSlowClient_test(void)
+{
+    Q_ASSERT(_link);
+
+    _link->setSlowClientPolicy(TCPLink::DropSlowClientData);
+    _link->setMaxClientQueueBytes(64 * 1024);
+    _startServer();
+
+    // A client which never reads, once the socket buffers are full its queue overflows
+    TCPLoopBackClient* slowClient = new TCPLoopBackClient(_hostAddress, _port, false);
+    QCOMPARE(slowClient->waitForConnected(1000), true);
+    QCOMPARE(_waitForClientCount(1, 1000), true);
+
+    QByteArray frame(1024, 'x');
+    for (int i = 0; i < 64 * 1024 && _link->getStatistics().droppedFrames() == 0; i++) {
+        _link->writeBytes(frame.constData(), frame.size());
+    }
+    QVERIFY(_link->getStatistics().droppedFrames() > 0);
+
+    // Writing did not block and the client stays connected
+    QTest::qWait(100);
+    QCOMPARE(_link->getClientCount(), 1);
+    QCOMPARE(slowClient->isConnected(), true);
+
+    delete slowClient;
+}
+
+void TCPLinkUnitTest::_serverDisconnectSlowClient_test(void)
+{
+    Q_ASSERT(_link);
+
+    _link->setSlowClientPolicy(TCPLink::DisconnectSlowClient);
+    _link->setMaxClientQueueBytes(64 * 1024);
+    _startServer();
+
+    TCPLoopBackClient* slowClient = new TCPLoopBackClient(_hostAddress, _port, false);
+    QCOMPARE(slowClient->waitForConnected(1000), true);
+    QCOMPARE(_waitForClientCount(1, 1000), true);
+
+    QByteArray frame(1024, 'x');
+    for (int i = 0; i < 64 * 1024 && _link->getClientCount() != 0; i++) {
+        _link->writeBytes(frame.constData(), frame.size());
+    }
+    QCOMPARE(_waitForClientCount(0, 1000), true);
+
+    delete slowClient;
+}
+
+void TCPLinkUnitTest::_serverClientFraming_test(void)
+{
+    Q_ASSERT(_link);
+
+    _startServer();
+
+    QTcpSocket first;
+    QTcpSocket second;
+    first.connectToHost(_hostAddress, _port);
+    second.connectToHost(_hostAddress, _port);
+    QCOMPARE(first.waitForConnected(1000), true);
+    QCOMPARE(second.waitForConnected(1000), true);
+    QCOMPARE(_waitForClientCount(2, 1000), true);
+
+    mavlink_message_t message;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    mavlink_msg_heartbeat_pack(1, 0, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_GENERIC, 0, 0, MAV_STATE_ACTIVE);
+    QByteArray firstFrame((const char*)buffer, mavlink_msg_to_send_buffer(buffer, &message));
+    mavlink_msg_heartbeat_pack(2, 0, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_GENERIC, 0, 0, MAV_STATE_ACTIVE);
+    QByteArray secondFrame((const char*)buffer, mavlink_msg_to_send_buffer(buffer, &message));
+
+    QSignalSpy receivedSpy(_link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)));
+
+    // The second client sends a whole frame while the first one is in the middle of its frame
+    int split = firstFrame.size() / 2;
+    first.write(firstFrame.left(split));
+    QCOMPARE(first.waitForBytesWritten(1000), true);
+    QTest::qWait(100);
+    second.write(secondFrame);
+    QCOMPARE(second.waitForBytesWritten(1000), true);
+    QTest::qWait(100);
+    first.write(firstFrame.mid(split));
+    QCOMPARE(first.waitForBytesWritten(1000), true);
+
+    QByteArray received;
+    for (int i = 0; i < 100 && received.size() < firstFrame.size() + secondFrame.size(); i++) {
+        QTest::qWait(10);
+        received.clear();
+        for (int j = 0; j < receivedSpy.count(); j++) {
+            received.append(receivedSpy.at(j).at(1).toByteArray());
+        }
+    }
+
+    // Both frames arrive whole, the half frame does not tear the frame of the other client apart
+    QCOMPARE(received, secondFrame + firstFrame);
+}
@@ -56,8 +56,15 @@ private slots:
     void _nameChangedSignal_test(void);
     void _connectFail_test(void);
     void _connectSucceed_test(void);
+    void _serverFanOut_test(void);
+    void _serverDropSlowClient_test(void);
+    void _serverDisconnectSlowClient_test(void);
+    void _serverClientFraming_test(void);
   
 private:
+    void _startServer(void);
+    bool _waitForClientCount(int count, int msecs);
+
     enum {
         bytesReceivedSignalIndex = 0,
         connectedSignalIndex,
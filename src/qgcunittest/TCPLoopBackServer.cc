@@ -21,6 +21,8 @@
  
  ======================================================================*/
 
+#include <QElapsedTimer>
+
 #include "TCPLoopBackServer.h"
 
 /// @file
@@ -70,3 +72,63 @@ void TCPLoopBackServer::_readBytes(void)
     Q_ASSERT(_tcpSocket->write(bytesIn) == bytesIn.count());
     Q_ASSERT(_tcpSocket->waitForBytesWritten(1000));
 }
+
+TCPLoopBackClient::TCPLoopBackClient(QHostAddress hostAddress, quint16 port, bool read) :
+    _hostAddress(hostAddress),
+    _port(port),
+    _read(read),
+    _tcpSocket(NULL)
+{
+    moveToThread(this);
+    start(HighPriority);
+}
+
+TCPLoopBackClient::~TCPLoopBackClient()
+{
+    quit();
+    wait();
+}
+
+bool TCPLoopBackClient::waitForConnected(int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (_connected.load() == 0 && timer.elapsed() < msecs) {
+        QThread::msleep(1);
+    }
+    return isConnected();
+}
+
+void TCPLoopBackClient::run(void)
+{
+    _tcpSocket = new QTcpSocket();
+    Q_CHECK_PTR(_tcpSocket);
+
+    _tcpSocket->connectToHost(_hostAddress, _port);
+    if (!_tcpSocket->waitForConnected(1000)) {
+        _connected.store(-1);
+    } else {
+        if (_read) {
+            QObject::connect(_tcpSocket, SIGNAL(readyRead()), this, SLOT(_readBytes()));
+        }
+        QObject::connect(_tcpSocket, SIGNAL(disconnected()), this, SLOT(_disconnected()));
+        _connected.store(1);
+
+        // Fall into main event loop
+        exec();
+    }
+
+    delete _tcpSocket;
+    _tcpSocket = NULL;
+}
+
+void TCPLoopBackClient::_readBytes(void)
+{
+    Q_ASSERT(_tcpSocket);
+    _bytesReceived.fetchAndAddRelaxed(_tcpSocket->readAll().count());
+}
+
+void TCPLoopBackClient::_disconnected(void)
+{
+    _connected.store(-1);
+}
@@ -27,6 +27,7 @@
 #include <QThread>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QAtomicInt>
 
 /// @file
 ///     @brief Simple TCP loop back server
@@ -57,4 +58,36 @@ private:
     QTcpSocket*     _tcpSocket;
 };
 
+/// @brief Client counting the bytes it receives from a TCPLink in server mode. A client which
+/// does not read plays a consumer which does not keep up.
+class TCPLoopBackClient : public QThread
+{
+    Q_OBJECT
+
+public:
+    TCPLoopBackClient(QHostAddress hostAddress, quint16 port, bool read = true);
+    ~TCPLoopBackClient();
+
+    /// @brief Waits for the connection to the server, false if it failed
+    bool waitForConnected(int msecs);
+
+    bool isConnected(void) const { return _connected.load() == 1; }
+    quint32 bytesReceived(void) const { return _bytesReceived.load(); }
+
+protected:
+    virtual void run(void);
+
+private slots:
+    void _readBytes(void);
+    void _disconnected(void);
+
+private:
+    QHostAddress    _hostAddress;
+    quint16         _port;
+    bool            _read;
+    QTcpSocket*     _tcpSocket;
+    QAtomicInt      _connected;     ///< 0: connecting, 1: connected, -1: disconnected or failed
+    QAtomicInt      _bytesReceived;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "TelemetryKeyRegistryTest.h"
+#include "TelemetryKeyRegistry.h"
+
+/// @file
+///     @brief TelemetryKeyRegistry unit test
+
+TelemetryKeyRegistryUnitTest::TelemetryKeyRegistryUnitTest(void)
+{
+
+}
+
+void TelemetryKeyRegistryUnitTest::_intern_test(void)
+{
+    TelemetryKeyRegistry* registry = TelemetryKeyRegistry::instance();
+
+    int voltage = registry->intern(201, "battery_voltage", "V");
+    int current = registry->intern(201, "battery_current", "A");
+    int otherVehicle = registry->intern(202, "battery_voltage", "V");
+    int otherUnit = registry->intern(201, "battery_voltage", "mV");
+    int mode = registry->intern(201, "base_mode", "bits", true);
+
+    // Every triple gets its own key, the same triple the same key
+    QVERIFY(voltage != current);
+    QVERIFY(voltage != otherVehicle);
+    QVERIFY(voltage != otherUnit);
+    QCOMPARE(registry->intern(201, "battery_voltage", "V"), voltage);
+    QVERIFY(registry->count() > mode);
+
+    TelemetryKeyRegistry::Key key = registry->key(otherVehicle);
+    QCOMPARE(key.uasId, 202);
+    QCOMPARE(key.name, QString("battery_voltage"));
+    QCOMPARE(key.unit, QString("V"));
+    QCOMPARE(key.integer, false);
+    QCOMPARE(registry->key(mode).integer, true);
+
+    QCOMPARE(registry->key(-1).uasId, -1);
+    QCOMPARE(registry->key(registry->count()).uasId, -1);
+}
+
+/// @brief Interns the fields of a vehicle, the way the constructor of UAS does
+static QList<int> _internVehicleFields(int uasId)
+{
+    QList<int> keys;
+    for (int field = 0; field < 50; field++) {
+        keys.append(TelemetryKeyRegistry::instance()->intern(uasId, QString("field%1").arg(field), "-"));
+    }
+    return keys;
+}
+
+/// @brief Vehicles are created on their own threads, the same field must get the same key on all of them
+void TelemetryKeyRegistryUnitTest::_concurrentIntern_test(void)
+{
+    QList< QFuture< QList<int> > > futures;
+    for (int i = 0; i < 16; i++) {
+        futures.append(QtConcurrent::run(_internVehicleFields, 210 + i % 4));
+    }
+
+    QList< QList<int> > keys;
+    for (int i = 0; i < futures.count(); i++) {
+        keys.append(futures[i].result());
+    }
+
+    for (int i = 0; i < keys.count(); i++) {
+        QVERIFY(keys[i] == keys[i % 4]);
+        for (int field = 0; field < keys[i].count(); field++) {
+            TelemetryKeyRegistry::Key key = TelemetryKeyRegistry::instance()->key(keys[i][field]);
+            QCOMPARE(key.uasId, 210 + i % 4);
+            QCOMPARE(key.name, QString("field%1").arg(field));
+        }
+    }
+}
@@ -0,0 +1,142 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "TelemetryStoreTest.h"
+#include "TelemetryStore.h"
+
+/// @file
+///     @brief TelemetryStore unit test
+
+TelemetryStoreUnitTest::TelemetryStoreUnitTest(void)
+{
+
+}
+
+void TelemetryStoreUnitTest::_latest_test(void)
+{
+    TelemetryStore store;
+    TelemetryStore::Sample sample;
+
+    QVERIFY(!store.latest(3, &sample));
+    QVERIFY(!store.latest(-1, &sample));
+
+    store.append(3, 1000, 1.5);
+    store.append(3, 1010, 2.5);
+    store.append(4, 1005, -1.0);
+
+    QVERIFY(store.latest(3, &sample));
+    QCOMPARE(sample.msecs, (quint64)1010);
+    QCOMPARE(sample.value, 2.5);
+    QVERIFY(store.latest(4, &sample));
+    QCOMPARE(sample.value, -1.0);
+    QCOMPARE(store.sampleCount(3), (quint32)2);
+    QCOMPARE(store.sampleCount(5), (quint32)0);
+
+    // Keys beyond the store are dropped
+    store.append(TelemetryStore::maximumKeys, 1000, 1.0);
+    QVERIFY(!store.latest(TelemetryStore::maximumKeys, &sample));
+}
+
+void TelemetryStoreUnitTest::_window_test(void)
+{
+    TelemetryStore store;
+    for (int i = 0; i < 1000; i++) {
+        store.append(7, 10000 + i * 10, i);
+    }
+
+    QVector<TelemetryStore::Sample> samples;
+    QCOMPARE(store.window(7, 12000, 12995, &samples), 100);
+    QCOMPARE(samples.first().msecs, (quint64)12000);
+    QCOMPARE(samples.first().value, 200.0);
+    QCOMPARE(samples.last().msecs, (quint64)12990);
+
+    // Partly before the first sample
+    QCOMPARE(store.window(7, 0, 10095, &samples), 10);
+    QCOMPARE(samples.first().value, 0.0);
+
+    QCOMPARE(store.window(7, 30000, 40000, &samples), 0);
+    QCOMPARE(store.window(8, 0, 40000, &samples), 0);
+}
+
+/// @brief A column keeps the newest samples only
+void TelemetryStoreUnitTest::_retention_test(void)
+{
+    TelemetryStore store;
+    int total = TelemetryStore::sampleCapacity * 3 + 17;
+    for (int i = 0; i < total; i++) {
+        store.append(1, i, i);
+    }
+
+    QCOMPARE(store.sampleCount(1), (quint32)total);
+
+    QVector<TelemetryStore::Sample> samples;
+    int capacity = TelemetryStore::sampleCapacity;
+    QCOMPARE(store.window(1, 0, total, &samples), capacity);
+    QCOMPARE(samples.first().value, (double)(total - capacity));
+    QCOMPARE(samples.last().value, (double)(total - 1));
+}
+
+/// @brief Appends a sample per millisecond whose value is its timestamp
+static void _writeSamples(TelemetryStore* store, int count)
+{
+    for (int i = 1; i <= count; i++) {
+        store->append(2, i, i);
+    }
+}
+
+/// @brief Readers pulling while the writer wraps around the ring must never see a torn or stale sample
+void TelemetryStoreUnitTest::_concurrentRead_test(void)
+{
+    TelemetryStore store;
+    int count = TelemetryStore::sampleCapacity * 50;
+
+    QFuture<void> writer = QtConcurrent::run(_writeSamples, &store, count);
+
+    quint64 lastLatest = 0;
+    QVector<TelemetryStore::Sample> samples;
+    while (!writer.isFinished()) {
+        TelemetryStore::Sample sample;
+        if (store.latest(2, &sample)) {
+            QCOMPARE(sample.value, (double)sample.msecs);
+            QVERIFY(sample.msecs >= lastLatest);
+            lastLatest = sample.msecs;
+        }
+
+        store.window(2, lastLatest > 1000 ? lastLatest - 1000 : 0, lastLatest, &samples);
+        for (int i = 0; i < samples.count(); i++) {
+            QCOMPARE(samples[i].value, (double)samples[i].msecs);
+            if (i > 0) {
+                QCOMPARE(samples[i].msecs, samples[i - 1].msecs + 1);
+            }
+        }
+    }
+    writer.waitForFinished();
+
+    TelemetryStore::Sample sample;
+    QVERIFY(store.latest(2, &sample));
+    QCOMPARE(sample.msecs, (quint64)count);
+}
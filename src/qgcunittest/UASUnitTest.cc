@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <QObject>
 #include <QThread>
+#include "MAVLinkTimeSync.h"
+#include "QGC.h"
 
 UASUnitTest::UASUnitTest()
 {
@@ -417,3 +419,31 @@ void UASUnitTest::signalIdUASLink_test()
 
     QCOMPARE(LinkManager::instance()->getLinks().count(), 0);
 }
+
+// ATTITUDE is stamped in milliseconds since boot, once synced it must map to the ground time it was sent at
+void UASUnitTest::attitudeTimeSync_test()
+{
+    // The vehicle booted 100 seconds ago and answers TIMESYNC with a symmetric 5 ms delay
+    quint64 groundUsecs = QGC::groundTimeUsecs();
+    quint64 bootUsecs = groundUsecs - 100000000;
+    for (int i = 0; i < 4; i++)
+    {
+        quint64 requestUsecs = groundUsecs + i * 1000000;
+        mav->getTimeSync()->addRoundTrip(UASID, requestUsecs, requestUsecs + 5000 - bootUsecs, requestUsecs + 10000);
+    }
+    QVERIFY(mav->getTimeSync()->isSynchronized(UASID));
+
+    SerialLink* link = new SerialLink();
+    QSignalSpy spy(uas, SIGNAL(attitudeChanged(UASInterface*,double,double,double,quint64)));
+
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(UASID, MAV_COMP_ID_IMU, &message, 90000, 0.1f, 0.2f, 0.3f, 0, 0, 0);
+    uas->receiveMessage(link, message);
+
+    QCOMPARE(spy.count(), 1);
+    qint64 time = (qint64)spy.at(0).at(4).toULongLong();
+    qint64 expected = (qint64)((bootUsecs + 90000000) / 1000);
+    QVERIFY(qAbs(time - expected) <= 1);
+
+    delete link;
+}
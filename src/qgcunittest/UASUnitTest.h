@@ -56,6 +56,7 @@ private slots:
   void getWaypoint_test();
   void signalUASLink_test();
   void signalIdUASLink_test();
+  void attitudeTimeSync_test();
 };
 
 DECLARE_TEST(UASUnitTest)
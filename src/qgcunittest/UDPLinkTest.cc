@@ -0,0 +1,129 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#include "UDPLinkTest.h"
+
+/// @file
+///     @brief UDPLink unit test
+
+UDPLinkUnitTest::UDPLinkUnitTest(void) :
+    _link(NULL)
+{
+    _peers[0] = NULL;
+    _peers[1] = NULL;
+}
+
+void UDPLinkUnitTest::init(void)
+{
+    Q_ASSERT(_link == NULL);
+
+    _link = new UDPLink(QHostAddress::LocalHost, _linkPort);
+    Q_CHECK_PTR(_link);
+
+    QSignalSpy connectedSpy(_link, SIGNAL(connected()));
+    _link->connect();
+    QVERIFY(connectedSpy.count() == 1 || connectedSpy.wait(1000));
+
+    for (int i = 0; i < 2; i++) {
+        _peers[i] = new QUdpSocket(this);
+        Q_CHECK_PTR(_peers[i]);
+        QVERIFY(_peers[i]->bind(QHostAddress::LocalHost, 0));
+    }
+}
+
+void UDPLinkUnitTest::cleanup(void)
+{
+    delete _link;
+    _link = NULL;
+
+    for (int i = 0; i < 2; i++) {
+        delete _peers[i];
+        _peers[i] = NULL;
+    }
+}
+
+/// @brief Sends a datagram from each peer and waits for the link to receive both
+void UDPLinkUnitTest::_sendFromPeers(void)
+{
+    QSignalSpy receivedSpy(_link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)));
+
+    _peers[0]->writeDatagram("ab", 2, QHostAddress::LocalHost, _linkPort);
+    _peers[1]->writeDatagram("cd", 2, QHostAddress::LocalHost, _linkPort);
+
+    QByteArray received;
+    while (received.size() < 4 && (receivedSpy.count() > 0 || receivedSpy.wait(1000))) {
+        received.append(receivedSpy.takeFirst().at(1).toByteArray());
+    }
+    QCOMPARE(received.size(), 4);
+}
+
+void UDPLinkUnitTest::_peerLearning_test(void)
+{
+    QCOMPARE(_link->getPeerCount(), 0);
+
+    _sendFromPeers();
+
+    // Both peers are on the same address, they are kept apart by their port
+    QCOMPARE(_link->getPeerCount(), 2);
+
+    // Hearing the peers again does not add them twice
+    _sendFromPeers();
+    QCOMPARE(_link->getPeerCount(), 2);
+}
+
+void UDPLinkUnitTest::_broadcast_test(void)
+{
+    _sendFromPeers();
+
+    const char data[] = "mavlink";
+    _link->writeBytes(data, sizeof(data));
+
+    for (int i = 0; i < 2; i++) {
+        QVERIFY(_peers[i]->hasPendingDatagrams() || _peers[i]->waitForReadyRead(1000));
+
+        char buffer[64];
+        qint64 length = _peers[i]->readDatagram(buffer, sizeof(buffer));
+        QCOMPARE(length, (qint64)sizeof(data));
+        QCOMPARE(memcmp(buffer, data, sizeof(data)), 0);
+    }
+
+    QCOMPARE(_link->getStatistics().bytesSent(), (quint32)(2 * sizeof(data)));
+}
+
+void UDPLinkUnitTest::_peerAging_test(void)
+{
+    _link->addHost(QString("127.0.0.1:%1").arg(_linkPort + 1));
+    QCOMPARE(_link->getPeerCount(), 1);
+
+    _sendFromPeers();
+    QCOMPARE(_link->getPeerCount(), 3);
+
+    _link->setPeerTimeout(50);
+    QTest::qWait(200);
+    _link->removeStalePeers();
+
+    // The learned peers are dropped, the host added by the user stays
+    QCOMPARE(_link->getPeerCount(), 1);
+    QCOMPARE(_link->getHosts().at(0), QHostAddress(QHostAddress::LocalHost));
+}
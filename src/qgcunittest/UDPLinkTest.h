@@ -0,0 +1,63 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+
+#ifndef UDPLINKTEST_H
+#define UDPLINKTEST_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "UDPLink.h"
+
+/// @file
+///     @brief UDPLink unit test
+
+class UDPLinkUnitTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    UDPLinkUnitTest(void);
+
+private slots:
+    void init(void);
+    void cleanup(void);
+
+    void _peerLearning_test(void);
+    void _broadcast_test(void);
+    void _peerAging_test(void);
+
+private:
+    void _sendFromPeers(void);
+
+    UDPLink*    _link;
+    QUdpSocket* _peers[2];
+
+    static const quint16 _linkPort = 14570;
+};
+
+DECLARE_TEST(UDPLinkUnitTest)
+
+#endif
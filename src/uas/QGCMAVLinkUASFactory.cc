@@ -1,6 +1,6 @@
 #include "QGCMAVLinkUASFactory.h"
 #include "UASManager.h"
-#include "QGCUASWorker.h"
+#include "QGCUASScheduler.h"
 #include "QGXPX4UAS.h"
 
 QGCMAVLinkUASFactory::QGCMAVLinkUASFactory(QObject *parent) :
@@ -23,82 +23,70 @@ UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInte
 
     UASInterface* uas;
 
-    QGCUASWorker* worker = new QGCUASWorker();
+    // The vehicle runs on a thread of the shared pool
+    QGCUASScheduler* scheduler = QGCUASScheduler::instance();
+    QThread* thread = scheduler->acquireThread();
 
     switch (heartbeat->autopilot)
     {
     case MAV_AUTOPILOT_GENERIC:
     {
-        UAS* mav = new UAS(mavlink, worker, sysid);
+        UAS* mav = new UAS(mavlink, thread, sysid);
         // Set the system type
         mav->setSystemType((int)heartbeat->type);
 
-        // Connect this robot to the UAS object
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), mav->getFileManager(), SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        // Deliver the messages of this robot to the UAS object
+        scheduler->subscribe(mavlink, mav);
         uas = mav;
     }
     break;
     case MAV_AUTOPILOT_PIXHAWK:
     {
-        PxQuadMAV* mav = new PxQuadMAV(mavlink, worker, sysid);
+        PxQuadMAV* mav = new PxQuadMAV(mavlink, thread, sysid);
         // Set the system type
         mav->setSystemType((int)heartbeat->type);
 
-        // Connect this robot to the UAS object
-        // it is IMPORTANT here to use the right object type,
-        // else the slot of the parent object is called (and thus the special
-        // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        // Deliver the messages of this robot to the UAS object
+        scheduler->subscribe(mavlink, mav);
         uas = mav;
     }
     break;
     case MAV_AUTOPILOT_PX4:
     {
-        QGXPX4UAS* px4 = new QGXPX4UAS(mavlink, worker, sysid);
+        QGXPX4UAS* px4 = new QGXPX4UAS(mavlink, thread, sysid);
         // Set the system type
         px4->setSystemType((int)heartbeat->type);
 
-        // Connect this robot to the UAS object
-        // it is IMPORTANT here to use the right object type,
-        // else the slot of the parent object is called (and thus the special
-        // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), px4, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        // Deliver the messages of this robot to the UAS object
+        scheduler->subscribe(mavlink, px4);
         uas = px4;
     }
     break;
 #ifdef QGC_USE_SENSESOAR_MESSAGES
 	case MAV_AUTOPILOT_SENSESOAR:
 		{
-            senseSoarMAV* mav = new senseSoarMAV(mavlink,worker, sysid);
+            senseSoarMAV* mav = new senseSoarMAV(mavlink,thread, sysid);
 			mav->setSystemType((int)heartbeat->type);
 
-            mav->moveToThread(worker);
+            mav->moveToThread(thread);
 
-			connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+			scheduler->subscribe(mavlink, mav);
 			uas = mav;
 			break;
 		}
 #endif
     default:
     {
-        UAS* mav = new UAS(mavlink, worker, sysid);
+        UAS* mav = new UAS(mavlink, thread, sysid);
         mav->setSystemType((int)heartbeat->type);
 
-        // Connect this robot to the UAS object
-        // it is IMPORTANT here to use the right object type,
-        // else the slot of the parent object is called (and thus the special
-        // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        // Deliver the messages of this robot to the UAS object
+        scheduler->subscribe(mavlink, mav);
         uas = mav;
     }
     break;
     }
 
-    // Get the UAS ready
-    worker->start(QThread::HighPriority);
-    connect(uas, SIGNAL(destroyed()), worker, SLOT(quit()));
-
     // Set the autopilot type
     uas->setAutopilotType((int)heartbeat->autopilot);
 
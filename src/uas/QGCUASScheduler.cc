@@ -0,0 +1,290 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Runs the vehicle objects on a fixed pool of threads
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+
+#include "QGCUASScheduler.h"
+#include "MAVLinkProtocol.h"
+#include "UAS.h"
+#include "TelemetryKeyRegistry.h"
+#include "TelemetryStore.h"
+#include "QGC.h"
+
+Q_GLOBAL_STATIC(QGCUASScheduler, uasScheduler)
+
+QGCUASScheduler* QGCUASScheduler::instance(void)
+{
+    return uasScheduler();
+}
+
+QGCUASScheduler::QGCUASScheduler(int threadCount) :
+    QObject()
+{
+    // The first vehicle is created on the protocol thread, the load timer has to run on a thread
+    // which lives as long as the scheduler
+    _loadTimer.setParent(this);
+    if (qApp && QThread::currentThread() != qApp->thread()) {
+        moveToThread(qApp->thread());
+    }
+
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+        int maximum = maximumThreadCount;
+        threadCount = qBound(2, threadCount, maximum);
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("UAS %1").arg(i));
+        thread->start(QThread::HighPriority);
+        _threads.append(thread);
+        _vehicleCounts.append(0);
+    }
+
+    connect(&_loadTimer, SIGNAL(timeout()), this, SLOT(_publishLoad()));
+    // Started from the event loop of the thread the timer lives in
+    QMetaObject::invokeMethod(&_loadTimer, "start", Qt::QueuedConnection, Q_ARG(int, loadIntervalMsecs));
+}
+
+QGCUASScheduler::~QGCUASScheduler()
+{
+    shutdown();
+    qDeleteAll(_threads);
+}
+
+void QGCUASScheduler::shutdown(void)
+{
+    if (QThread::currentThread() == thread()) {
+        _loadTimer.stop();
+    }
+
+    foreach (QThread* thread, _threads) {
+        thread->quit();
+        thread->wait();
+    }
+
+    // No lane is processing anymore. Deleting them unsubscribes them, so the vehicles can be deleted on any thread
+    QList<QGCUASLane*> lanes;
+    {
+        QMutexLocker locker(&_mutex);
+        lanes = _lanes;
+    }
+    qDeleteAll(lanes);
+}
+
+QThread* QGCUASScheduler::acquireThread(void)
+{
+    QMutexLocker locker(&_mutex);
+
+    int index = 0;
+    for (int i = 1; i < _threads.count(); i++) {
+        if (_vehicleCounts[i] < _vehicleCounts[index]) {
+            index = i;
+        }
+    }
+    _vehicleCounts[index]++;
+
+    return _threads[index];
+}
+
+void QGCUASScheduler::releaseThread(QThread* thread)
+{
+    QMutexLocker locker(&_mutex);
+
+    // Vehicles created outside the factory, by the unit tests, run on threads of their own
+    int index = _threads.indexOf(thread);
+    if (index != -1 && _vehicleCounts[index] > 0) {
+        _vehicleCounts[index]--;
+    }
+}
+
+QVector<int> QGCUASScheduler::vehicleCounts(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _vehicleCounts;
+}
+
+void QGCUASScheduler::subscribe(MAVLinkProtocol* protocol, UAS* uas)
+{
+    QGCUASLane* lane = new QGCUASLane(this, protocol, uas);
+
+    {
+        QMutexLocker locker(&_mutex);
+        _lanes.append(lane);
+    }
+
+    // The lane is queued to directly by the dispatching thread and processes the messages on the vehicle's thread
+    protocol->subscribeSystem(uas->getUASID(), lane, SLOT(receiveMessage(LinkInterface*,MAVLinkMessage)), -1, Qt::DirectConnection);
+    connect(uas, SIGNAL(destroyed()), lane, SLOT(deleteLater()));
+}
+
+bool QGCUASScheduler::takeLoad(int uasId, VehicleLoad* load)
+{
+    QMutexLocker locker(&_mutex);
+
+    foreach (QGCUASLane* lane, _lanes) {
+        if (lane->uasId() == uasId) {
+            lane->takeLoad(load);
+            return true;
+        }
+    }
+    return false;
+}
+
+void QGCUASScheduler::_removeLane(QGCUASLane* lane)
+{
+    QMutexLocker locker(&_mutex);
+    _lanes.removeOne(lane);
+}
+
+/// Publishes the load of every vehicle like any other telemetry value, so it can be watched and plotted.
+void QGCUASScheduler::_publishLoad(void)
+{
+    QList< QPair<int, VehicleLoad> > loads;
+    {
+        QMutexLocker locker(&_mutex);
+        foreach (QGCUASLane* lane, _lanes) {
+            VehicleLoad load;
+            lane->takeLoad(&load);
+            loads.append(qMakePair(lane->uasId(), load));
+        }
+    }
+
+    TelemetryKeyRegistry* registry = TelemetryKeyRegistry::instance();
+    TelemetryStore* store = TelemetryStore::instance();
+    quint64 msecs = QGC::groundTimeMilliseconds();
+    for (int i = 0; i < loads.count(); i++) {
+        int uasId = loads[i].first;
+        const VehicleLoad& load = loads[i].second;
+        QString prefix = QString("M%1:SCHEDULER.").arg(uasId);
+
+        store->append(registry->intern(uasId, prefix + "queue_depth_max", "msgs", true), msecs, load.maximumQueueDepth);
+        store->append(registry->intern(uasId, prefix + "messages", "msgs", true), msecs, load.messageCount);
+        store->append(registry->intern(uasId, prefix + "busy", "%"), msecs, load.busyUsecs / (loadIntervalMsecs * 10.0));
+        store->append(registry->intern(uasId, prefix + "message_time_max", "us", true), msecs, load.maximumMessageUsecs);
+    }
+}
+
+QGCUASLane::QGCUASLane(QGCUASScheduler* scheduler, MAVLinkProtocol* protocol, UAS* uas) :
+    QObject(),
+    _scheduler(scheduler),
+    _protocol(protocol),
+    _uas(uas),
+    _uasId(uas->getUASID()),
+    _scheduled(false)
+{
+    _load.queueDepth = 0;
+    _load.maximumQueueDepth = 0;
+    _load.messageCount = 0;
+    _load.busyUsecs = 0;
+    _load.maximumMessageUsecs = 0;
+
+    moveToThread(uas->thread());
+}
+
+QGCUASLane::~QGCUASLane()
+{
+    // Once unsubscribed no dispatching thread is inside receiveMessage anymore
+    if (_protocol) {
+        _protocol->unsubscribeSystem(_uasId, this);
+    }
+    _scheduler->_removeLane(this);
+}
+
+void QGCUASLane::receiveMessage(LinkInterface* link, MAVLinkMessage message)
+{
+    QMutexLocker locker(&_mutex);
+
+    _queue.enqueue(qMakePair(link, message));
+    if (_queue.count() > _load.maximumQueueDepth) {
+        _load.maximumQueueDepth = _queue.count();
+    }
+
+    // One scheduling of the lane serves a whole burst of messages
+    if (!_scheduled) {
+        _scheduled = true;
+        QMetaObject::invokeMethod(this, "_process", Qt::QueuedConnection);
+    }
+}
+
+void QGCUASLane::takeLoad(QGCUASScheduler::VehicleLoad* load)
+{
+    QMutexLocker locker(&_mutex);
+
+    _load.queueDepth = _queue.count();
+    *load = _load;
+
+    _load.maximumQueueDepth = _load.queueDepth;
+    _load.messageCount = 0;
+    _load.busyUsecs = 0;
+    _load.maximumMessageUsecs = 0;
+}
+
+void QGCUASLane::_process(void)
+{
+    QPair<LinkInterface*, MAVLinkMessage> batch[batchSize];
+    int count = 0;
+    {
+        QMutexLocker locker(&_mutex);
+        while (count < batchSize && !_queue.isEmpty()) {
+            batch[count++] = _queue.dequeue();
+        }
+    }
+
+    quint64 busyUsecs = 0;
+    quint64 maximumUsecs = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < count; i++) {
+        if (_uas.isNull()) {
+            break;
+        }
+
+        timer.start();
+        _uas->receiveMessage(batch[i].first, *batch[i].second);
+        quint64 usecs = timer.nsecsElapsed() / 1000;
+
+        busyUsecs += usecs;
+        if (usecs > maximumUsecs) {
+            maximumUsecs = usecs;
+        }
+    }
+
+    QMutexLocker locker(&_mutex);
+
+    _load.messageCount += count;
+    _load.busyUsecs += busyUsecs;
+    if (maximumUsecs > _load.maximumMessageUsecs) {
+        _load.maximumMessageUsecs = maximumUsecs;
+    }
+
+    if (_queue.isEmpty()) {
+        _scheduled = false;
+    } else {
+        // Let the other vehicles on this thread run before the next batch
+        QMetaObject::invokeMethod(this, "_process", Qt::QueuedConnection);
+    }
+}
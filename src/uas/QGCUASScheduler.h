@@ -0,0 +1,154 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Runs the vehicle objects on a fixed pool of threads
+
+#ifndef QGCUASSCHEDULER_H
+#define QGCUASSCHEDULER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QQueue>
+#include <QPair>
+#include <QVector>
+#include <QPointer>
+#include <QTimer>
+
+#include "MAVLinkMessage.h"
+
+class UAS;
+class MAVLinkProtocol;
+class LinkInterface;
+class QGCUASLane;
+
+/// @brief Runs the vehicle objects on a fixed pool of event loop threads.
+///
+/// The pool has as many threads as the machine has cores, at least two and at most maximumThreadCount.
+/// Each vehicle is assigned to the thread running the fewest vehicles when it is created and stays there.
+/// Idle threads sleep in their event loop, so neither idle CPU nor the thread count grow with the fleet.
+///
+/// The messages of a vehicle are queued to its lane, which processes them in order on the vehicle's
+/// thread. The lane is scheduled once for a burst of messages instead of once per message, and hands
+/// the thread back after a batch so a busy vehicle doesn't hold up the others on the same thread.
+/// The queue depth and processing time of every lane are published to the telemetry store once a second.
+class QGCUASScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// @brief Load of one vehicle
+    struct VehicleLoad {
+        int     queueDepth;             ///< Messages waiting to be processed
+        int     maximumQueueDepth;      ///< Since the last call of takeLoad
+        quint64 messageCount;           ///< Processed since the last call of takeLoad
+        quint64 busyUsecs;              ///< Spent processing since the last call of takeLoad
+        quint64 maximumMessageUsecs;    ///< Longest processing time of one message since the last call of takeLoad
+    };
+
+    /// @brief Returns the scheduler of the application, created on first use from any thread.
+    ///     @return NULL once it was destroyed at exit
+    static QGCUASScheduler* instance(void);
+
+    QGCUASScheduler(int threadCount = 0);
+    ~QGCUASScheduler();
+
+    /// @brief Stops and waits for all threads of the pool and drops the lanes. Call at exit before the
+    ///         vehicles are deleted, afterwards no message is delivered to a vehicle anymore.
+    void shutdown(void);
+
+    /// @brief Returns the thread of the pool running the fewest vehicles, the vehicle moves itself to it
+    QThread* acquireThread(void);
+
+    /// @brief Hands the thread of a destroyed vehicle back to the pool, threads not of the pool are ignored
+    void releaseThread(QThread* thread);
+
+    /// @brief Delivers the messages of a vehicle to it through a lane on the vehicle's thread. Replaces
+    ///         subscribing the vehicle to its system directly.
+    void subscribe(MAVLinkProtocol* protocol, UAS* uas);
+
+    /// @brief Returns the load of a vehicle and restarts its measurement
+    ///     @return false if the vehicle has no lane
+    bool takeLoad(int uasId, VehicleLoad* load);
+
+    int threadCount(void) const { return _threads.count(); }
+
+    /// @brief Number of vehicles running on each thread of the pool
+    QVector<int> vehicleCounts(void) const;
+
+    static const int maximumThreadCount = 8;
+    static const int loadIntervalMsecs = 1000;
+
+private slots:
+    void _publishLoad(void);
+
+private:
+    void _removeLane(QGCUASLane* lane);
+
+    mutable QMutex          _mutex;             ///< Protects the vehicle counts and the lanes
+    QVector<QThread*>       _threads;
+    QVector<int>            _vehicleCounts;     ///< Per thread of the pool
+    QList<QGCUASLane*>      _lanes;
+    QTimer                  _loadTimer;
+
+    friend class QGCUASLane;
+};
+
+/// @brief Queue of the messages of one vehicle, processed in order on the vehicle's thread
+class QGCUASLane : public QObject
+{
+    Q_OBJECT
+
+public:
+    QGCUASLane(QGCUASScheduler* scheduler, MAVLinkProtocol* protocol, UAS* uas);
+    ~QGCUASLane();
+
+    int uasId(void) const { return _uasId; }
+
+    /// @brief Takes the load measured since the last call
+    void takeLoad(QGCUASScheduler::VehicleLoad* load);
+
+    /// @brief Messages processed per scheduling of the lane before the thread is handed back
+    static const int batchSize = 64;
+
+public slots:
+    /// @brief Queues a message, called directly on the thread which dispatches it
+    void receiveMessage(LinkInterface* link, MAVLinkMessage message);
+
+private slots:
+    void _process(void);
+
+private:
+    QGCUASScheduler*    _scheduler;
+    QPointer<MAVLinkProtocol> _protocol;    ///< May be destroyed before the lane at exit
+    QPointer<UAS>       _uas;
+    int                 _uasId;
+
+    QMutex              _mutex;         ///< Protects the queue and the load
+    QQueue< QPair<LinkInterface*, MAVLinkMessage> > _queue;
+    bool                _scheduled;     ///< A call of _process is pending
+    QGCUASScheduler::VehicleLoad _load;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Assigns integer keys to the telemetry values published by the vehicles
+
+#include "TelemetryKeyRegistry.h"
+
+Q_GLOBAL_STATIC(TelemetryKeyRegistry, telemetryKeyRegistry)
+
+TelemetryKeyRegistry* TelemetryKeyRegistry::instance(void)
+{
+    return telemetryKeyRegistry();
+}
+
+int TelemetryKeyRegistry::intern(int uasId, const QString& name, const QString& unit, bool integer)
+{
+    QMutexLocker locker(&_mutex);
+
+    _Triple triple(uasId, qMakePair(name, unit));
+    QHash<_Triple, int>::const_iterator i = _index.constFind(triple);
+    if (i != _index.constEnd()) {
+        return i.value();
+    }
+
+    Key key;
+    key.uasId = uasId;
+    key.name = name;
+    key.unit = unit;
+    key.integer = integer;
+
+    int id = _keys.count();
+    _keys.append(key);
+    _index.insert(triple, id);
+    return id;
+}
+
+TelemetryKeyRegistry::Key TelemetryKeyRegistry::key(int id) const
+{
+    QMutexLocker locker(&_mutex);
+
+    if (id < 0 || id >= _keys.count()) {
+        Key unknown;
+        unknown.uasId = -1;
+        unknown.integer = false;
+        return unknown;
+    }
+    return _keys[id];
+}
+
+int TelemetryKeyRegistry::count(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _keys.count();
+}
@@ -0,0 +1,74 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Assigns integer keys to the telemetry values published by the vehicles
+
+#ifndef TELEMETRYKEYREGISTRY_H
+#define TELEMETRYKEYREGISTRY_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QMutex>
+
+/// @brief Interns the (vehicle, field, unit) triples of the telemetry values.
+///
+/// A publisher registers each of its fields once and then sends samples tagged with the integer key,
+/// so neither the publisher nor the subscribers build, hash or compare strings per sample. Subscribers
+/// look the name and unit of a key up the first time they see it and keep what they need in a vector
+/// indexed by the key. Keys are never removed, they stay valid for the lifetime of the application.
+///
+/// All methods are thread safe.
+class TelemetryKeyRegistry
+{
+public:
+    /// @brief Description of a key
+    struct Key {
+        int     uasId;
+        QString name;
+        QString unit;
+        bool    integer;    ///< The values are integers, e.g. bit fields or counters
+    };
+
+    static TelemetryKeyRegistry* instance(void);
+
+    /// @brief Returns the key of a field, registering it if it is new
+    int intern(int uasId, const QString& name, const QString& unit, bool integer = false);
+
+    /// @brief Returns the description of a key, an empty description with uasId -1 for an unknown key
+    Key key(int id) const;
+
+    /// @brief Returns the number of keys registered, keys are numbered from 0 to count() - 1
+    int count(void) const;
+
+private:
+    typedef QPair<int, QPair<QString, QString> > _Triple;
+
+    mutable QMutex          _mutex;
+    QVector<Key>            _keys;
+    QHash<_Triple, int>     _index;
+};
+
+#endif
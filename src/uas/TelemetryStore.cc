@@ -0,0 +1,226 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Keeps the recent history of every telemetry value for the views to pull from
+
+#include <QThread>
+
+#include "TelemetryStore.h"
+
+Q_GLOBAL_STATIC(TelemetryStore, telemetryStore)
+
+TelemetryStore* TelemetryStore::instance(void)
+{
+    return telemetryStore();
+}
+
+TelemetryStore::TelemetryStore(void)
+{
+    for (int i = 0; i < _pageCount; i++) {
+        _pages[i].store(NULL);
+    }
+}
+
+TelemetryStore::~TelemetryStore()
+{
+    for (int i = 0; i < _pageCount; i++) {
+        _Page* page = _pages[i].load();
+        if (!page) {
+            continue;
+        }
+        for (int j = 0; j < _pageSize; j++) {
+            _Column* column = page->columns[j].load();
+            if (!column) {
+                continue;
+            }
+            for (int k = 0; k < chunkCount; k++) {
+                delete column->chunks[k].load();
+            }
+            delete column;
+        }
+        delete page;
+    }
+}
+
+void TelemetryStore::append(int key, quint64 msecs, double value)
+{
+    _Column* column = _createColumn(key);
+    if (!column) {
+        return;
+    }
+
+    quint32 index = (quint32)column->reserved.fetchAndAddRelaxed(1);
+
+    QAtomicPointer<_Chunk>& slot = column->chunks[(index / chunkSize) % chunkCount];
+    _Chunk* chunk = slot.loadAcquire();
+    if (!chunk) {
+        // First time around the ring, another writer may be allocating the chunk as well
+        _Chunk* newChunk = new _Chunk;
+        if (!slot.testAndSetOrdered(NULL, newChunk)) {
+            delete newChunk;
+        }
+        chunk = slot.loadAcquire();
+    }
+
+    Sample& sample = chunk->samples[index % chunkSize];
+    sample.msecs = msecs;
+    sample.value = value;
+
+    // Publish in index order. With a single writer per key this succeeds right away, a writer which
+    // overtook another one on the same key waits until the earlier sample is published.
+    while (!column->committed.testAndSetRelease((int)index, (int)(index + 1))) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+bool TelemetryStore::latest(int key, Sample* sample) const
+{
+    const _Column* column = _column(key);
+    if (!column) {
+        return false;
+    }
+
+    quint32 committed = (quint32)column->committed.loadAcquire();
+    if (committed == 0) {
+        return false;
+    }
+
+    *sample = _sampleAt(column, committed - 1);
+    return _retained(column, committed - 1);
+}
+
+int TelemetryStore::window(int key, quint64 fromMsecs, quint64 toMsecs, QVector<Sample>* samples) const
+{
+    samples->clear();
+
+    const _Column* column = _column(key);
+    if (!column) {
+        return 0;
+    }
+
+    quint32 end = (quint32)column->committed.loadAcquire();
+    quint32 retained = end < (quint32)sampleCapacity ? end : (quint32)sampleCapacity;
+    quint32 begin = end - retained;
+
+    // Find the first sample at or after fromMsecs
+    quint32 low = begin;
+    quint32 high = end;
+    while (low != high) {
+        quint32 middle = low + (high - low) / 2;
+        if (_sampleAt(column, middle).msecs < fromMsecs) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    quint32 first = low;
+    for (quint32 index = first; index != end; index++) {
+        const Sample& sample = _sampleAt(column, index);
+        if (sample.msecs > toMsecs) {
+            break;
+        }
+        samples->append(sample);
+    }
+
+    // The oldest samples may have been overwritten while they were copied
+    quint32 dropped = 0;
+    while (dropped < (quint32)samples->count() && !_retained(column, first + dropped)) {
+        dropped++;
+    }
+    if (dropped > 0) {
+        samples->remove(0, dropped);
+    }
+
+    return samples->count();
+}
+
+quint32 TelemetryStore::sampleCount(int key) const
+{
+    const _Column* column = _column(key);
+    return column ? (quint32)column->committed.loadAcquire() : 0;
+}
+
+TelemetryStore::_Column* TelemetryStore::_column(int key) const
+{
+    if (key < 0 || key >= maximumKeys) {
+        return NULL;
+    }
+
+    _Page* page = _pages[key / _pageSize].loadAcquire();
+    return page ? page->columns[key % _pageSize].loadAcquire() : NULL;
+}
+
+TelemetryStore::_Column* TelemetryStore::_createColumn(int key)
+{
+    if (key < 0 || key >= maximumKeys) {
+        return NULL;
+    }
+
+    QAtomicPointer<_Page>& pageSlot = _pages[key / _pageSize];
+    _Page* page = pageSlot.loadAcquire();
+    if (!page) {
+        _Page* newPage = new _Page;
+        for (int i = 0; i < _pageSize; i++) {
+            newPage->columns[i].store(NULL);
+        }
+        if (!pageSlot.testAndSetOrdered(NULL, newPage)) {
+            delete newPage;
+        }
+        page = pageSlot.loadAcquire();
+    }
+
+    QAtomicPointer<_Column>& columnSlot = page->columns[key % _pageSize];
+    _Column* column = columnSlot.loadAcquire();
+    if (!column) {
+        _Column* newColumn = new _Column;
+        newColumn->reserved.store(0);
+        newColumn->committed.store(0);
+        for (int i = 0; i < chunkCount; i++) {
+            newColumn->chunks[i].store(NULL);
+        }
+        if (!columnSlot.testAndSetOrdered(NULL, newColumn)) {
+            delete newColumn;
+        }
+        column = columnSlot.loadAcquire();
+    }
+
+    return column;
+}
+
+/// The index must be below the committed count, its chunk is allocated then.
+const TelemetryStore::Sample& TelemetryStore::_sampleAt(const _Column* column, quint32 index)
+{
+    return column->chunks[(index / chunkSize) % chunkCount].loadAcquire()->samples[index % chunkSize];
+}
+
+/// Checks after a sample was copied that no writer got to reuse its slot meanwhile.
+bool TelemetryStore::_retained(const _Column* column, quint32 index)
+{
+    // The ordered read-modify-write is a full barrier, the copy of the sample is complete before the
+    // reserved count is read
+    QAtomicInt& reserved = const_cast<QAtomicInt&>(column->reserved);
+    quint32 reservedCount = (quint32)reserved.fetchAndAddOrdered(0);
+    return reservedCount - index <= (quint32)sampleCapacity;
+}
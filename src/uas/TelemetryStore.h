@@ -0,0 +1,107 @@
+/*=====================================================================
+ 
+ QGroundControl Open Source Ground Control Station
+ 
+ (c) 2009 - 2014 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ 
+ This file is part of the QGROUNDCONTROL project
+ 
+ QGROUNDCONTROL is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ QGROUNDCONTROL is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+ 
+ ======================================================================*/
+
+/// @file
+///     @brief Keeps the recent history of every telemetry value for the views to pull from
+
+#ifndef TELEMETRYSTORE_H
+#define TELEMETRYSTORE_H
+
+#include <QVector>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+/// @brief Time series store with one column per TelemetryKeyRegistry key.
+///
+/// The publishers append every sample of a value once, on their own thread, and the views pull the
+/// latest value or a time window when they repaint. A view costs the same no matter how fast the data
+/// arrives, and the receive path costs the same no matter how many views are open.
+///
+/// A column is a ring of chunks which are allocated as the column fills, so rarely updated values take
+/// little memory. Once all chunks are in use the oldest chunk is reused, the retention is bounded by
+/// sampleCapacity samples per key.
+///
+/// Appending is lock free. Each writer reserves an index, writes its sample and publishes it once all
+/// earlier indexes are published, which never waits with the usual single writer per key. Readers don't
+/// block the writers either, they check after copying whether the samples were overwritten meanwhile
+/// and drop those which were.
+class TelemetryStore
+{
+public:
+    /// @brief One value of a key
+    struct Sample {
+        quint64 msecs;  ///< Timestamp of the value in milliseconds since the epoch
+        double  value;
+    };
+
+    TelemetryStore(void);
+    ~TelemetryStore();
+
+    static TelemetryStore* instance(void);
+
+    /// @brief Appends a sample to the column of a key. Lock free, may be called from any thread.
+    void append(int key, quint64 msecs, double value);
+
+    /// @brief Returns the newest sample of a key, false if the key has no samples
+    bool latest(int key, Sample* sample) const;
+
+    /// @brief Copies the retained samples of a key from fromMsecs up to toMsecs, oldest first. The timestamps of
+    ///         a key are expected to be increasing.
+    ///     @return Number of samples copied
+    int window(int key, quint64 fromMsecs, quint64 toMsecs, QVector<Sample>* samples) const;
+
+    /// @brief Returns the number of samples ever appended to a key, retained or not
+    quint32 sampleCount(int key) const;
+
+    static const int chunkSize = 256;               ///< Samples per chunk
+    static const int chunkCount = 16;               ///< Chunks retained per key
+    static const int sampleCapacity = chunkSize * chunkCount;
+    static const int maximumKeys = 65536;           ///< Samples of higher keys are dropped
+
+private:
+    struct _Chunk {
+        Sample samples[chunkSize];
+    };
+
+    struct _Column {
+        QAtomicInt              reserved;           ///< Indexes handed out to writers
+        QAtomicInt              committed;          ///< Indexes below are written and may be read
+        QAtomicPointer<_Chunk>  chunks[chunkCount]; ///< Allocated on first use
+    };
+
+    static const int _pageSize = 256;               ///< Columns per page
+    static const int _pageCount = maximumKeys / _pageSize;
+
+    struct _Page {
+        QAtomicPointer<_Column> columns[_pageSize];
+    };
+
+    _Column* _column(int key) const;
+    _Column* _createColumn(int key);
+    static const Sample& _sampleAt(const _Column* column, quint32 index);
+    static bool _retained(const _Column* column, quint32 index);
+
+    QAtomicPointer<_Page>   _pages[_pageCount];     ///< Allocated on first use
+};
+
+#endif
@@ -27,9 +27,70 @@
 #include "LinkManager.h"
 #include "SerialLink.h"
 #include "UASParameterCommsMgr.h"
+#include "TelemetryKeyRegistry.h"
+#include "TelemetryStore.h"
+#include "QGCUASScheduler.h"
 #include <Eigen/Geometry>
 #include <comm/px4_custom_mode.h>
 
+/**
+ * Name, unit and type of the values published to the plots, in the order of UAS::TelemetryField.
+ * Fields of a message are named M<system id>:<message>.<field>.
+ */
+static const struct {
+    const char* message;
+    const char* name;
+    const char* unit;
+    bool integer;
+} telemetryFields[] = {
+    { "HEARTBEAT", "base_mode", "bits", true },
+    { "HEARTBEAT", "custom_mode", "bits", true },
+    { "HEARTBEAT", "system_status", "-", true },
+    { "SYS_STATUS", "sensors_enabled", "bits", true },
+    { "SYS_STATUS", "sensors_health", "bits", true },
+    { "SYS_STATUS", "errors_comm", "-", true },
+    { "SYS_STATUS", "errors_count1", "-", true },
+    { "SYS_STATUS", "errors_count2", "-", true },
+    { "SYS_STATUS", "errors_count3", "-", true },
+    { "SYS_STATUS", "errors_count4", "-", true },
+    { "SYS_STATUS", "load", "%", false },
+    { "SYS_STATUS", "battery_remaining", "%", false },
+    { "SYS_STATUS", "battery_voltage", "V", false },
+    { "SYS_STATUS", "battery_current", "A", false },
+    { "SYS_STATUS", "drop_rate_comm", "%", false },
+    { NULL, "roll sp", "rad", false },
+    { NULL, "pitch sp", "rad", false },
+    { NULL, "yaw sp", "rad", false },
+    { NULL, "roll sim", "rad", false },
+    { NULL, "pitch sim", "rad", false },
+    { NULL, "yaw sim", "rad", false },
+    { NULL, "roll rate sim", "rad/s", false },
+    { NULL, "pitch rate sim", "rad/s", false },
+    { NULL, "yaw rate sim", "rad/s", false },
+    { NULL, "lat sim", "deg", false },
+    { NULL, "lon sim", "deg", false },
+    { NULL, "alt sim", "deg", false },
+    { NULL, "vx sim", "m/s", false },
+    { NULL, "vy sim", "m/s", false },
+    { NULL, "vz sim", "m/s", false },
+    { NULL, "IAS sim", "m/s", false },
+    { NULL, "TAS sim", "m/s", false },
+    { NULL, "groundSpeed", "m/s", false },
+    { NULL, "airSpeed", "m/s", false },
+    { NULL, "localX", "m", false },
+    { NULL, "localY", "m", false },
+    { NULL, "localZ", "m", false },
+    { NULL, "latitude", "deg", false },
+    { NULL, "longitude", "deg", false },
+    { NULL, "altitudeAMSL", "m", false },
+    { NULL, "altitudeAMSLFT", "m", false },
+    { NULL, "altitudeWGS84", "m", false },
+    { NULL, "altitudeRelative", "m", false },
+    { NULL, "satelliteCount", "", false },
+    { NULL, "distToWaypoint", "m", false },
+    { NULL, "bearingToWaypoint", "deg", false },
+};
+
 /**
 * Gets the settings from the previous UAS (name, airframe, autopilot, battery specs)
 * by calling readSettings. This means the new UAS will have the same settings
@@ -169,7 +230,24 @@ UAS::UAS(MAVLinkProtocol* protocol, QThread* thread, int id) : UASInterface(),
         componentMulti[i] = false;
     }
 
-    connect(mavlink, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), &fileManager, SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
+    // Intern the telemetry fields up front, publishing a value then only looks up its key
+    Q_STATIC_ASSERT(sizeof(telemetryFields) / sizeof(telemetryFields[0]) == TELEMETRY_FIELD_COUNT);
+    for (int i = 0; i < TELEMETRY_FIELD_COUNT; ++i)
+    {
+        if (telemetryFields[i].message)
+        {
+            telemetryNames[i] = QString("M%1:%2.%3").arg(uasId).arg(telemetryFields[i].message).arg(telemetryFields[i].name);
+        }
+        else
+        {
+            telemetryNames[i] = telemetryFields[i].name;
+        }
+        telemetryUnits[i] = telemetryFields[i].unit;
+        telemetryIntegers[i] = telemetryFields[i].integer;
+        telemetryKeys[i] = TelemetryKeyRegistry::instance()->intern(uasId, telemetryNames[i], telemetryUnits[i], telemetryIntegers[i]);
+    }
+
+    mavlink->subscribeSystem(uasId, &fileManager, SLOT(receiveMessage(LinkInterface*,mavlink_message_t)), MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL);
 
     // Store a list of available actions for this UAS.
     // Basically everything exposed as a SLOT with no return value or arguments.
@@ -250,8 +328,11 @@ UAS::~UAS()
 {
     writeSettings();
 
-    _thread->quit();
-    _thread->wait();
+    // The thread is shared with other vehicles. Vehicles destroyed at exit may outlive the scheduler
+    QGCUASScheduler* scheduler = QGCUASScheduler::instance();
+    if (scheduler) {
+        scheduler->releaseThread(_thread);
+    }
 
     delete links;
     delete simulation;
@@ -489,10 +570,9 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
             // Send the base_mode and system_status values to the plotter. This uses the ground time
             // so the Ground Time checkbox must be ticked for these values to display
             quint64 time = getUnixTime();
-            QString name = QString("M%1:HEARTBEAT.%2").arg(message.sysid);
-            emit valueChanged(uasId, name.arg("base_mode"), "bits", state.base_mode, time);
-            emit valueChanged(uasId, name.arg("custom_mode"), "bits", state.custom_mode, time);
-            emit valueChanged(uasId, name.arg("system_status"), "-", state.system_status, time);
+            publishValue(TELEMETRY_HEARTBEAT_BASE_MODE, state.base_mode, time);
+            publishValue(TELEMETRY_HEARTBEAT_CUSTOM_MODE, state.custom_mode, time);
+            publishValue(TELEMETRY_HEARTBEAT_SYSTEM_STATUS, state.system_status, time);
 
             // Set new type if it has changed
             if (this->type != state.type)
@@ -596,18 +676,17 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
 
             // Prepare for sending data to the realtime plotter, which is every field excluding onboard_control_sensors_present.
             quint64 time = getUnixTime();
-            QString name = QString("M%1:SYS_STATUS.%2").arg(message.sysid);
-            emit valueChanged(uasId, name.arg("sensors_enabled"), "bits", state.onboard_control_sensors_enabled, time);
-            emit valueChanged(uasId, name.arg("sensors_health"), "bits", state.onboard_control_sensors_health, time);
-            emit valueChanged(uasId, name.arg("errors_comm"), "-", state.errors_comm, time);
-            emit valueChanged(uasId, name.arg("errors_count1"), "-", state.errors_count1, time);
-            emit valueChanged(uasId, name.arg("errors_count2"), "-", state.errors_count2, time);
-            emit valueChanged(uasId, name.arg("errors_count3"), "-", state.errors_count3, time);
-            emit valueChanged(uasId, name.arg("errors_count4"), "-", state.errors_count4, time);
+            publishValue(TELEMETRY_SYS_STATUS_SENSORS_ENABLED, state.onboard_control_sensors_enabled, time);
+            publishValue(TELEMETRY_SYS_STATUS_SENSORS_HEALTH, state.onboard_control_sensors_health, time);
+            publishValue(TELEMETRY_SYS_STATUS_ERRORS_COMM, state.errors_comm, time);
+            publishValue(TELEMETRY_SYS_STATUS_ERRORS_COUNT1, state.errors_count1, time);
+            publishValue(TELEMETRY_SYS_STATUS_ERRORS_COUNT2, state.errors_count2, time);
+            publishValue(TELEMETRY_SYS_STATUS_ERRORS_COUNT3, state.errors_count3, time);
+            publishValue(TELEMETRY_SYS_STATUS_ERRORS_COUNT4, state.errors_count4, time);
 
             // Process CPU load.
             emit loadChanged(this,state.load/10.0f);
-            emit valueChanged(uasId, name.arg("load"), "%", state.load/10.0f, time);
+            publishValue(TELEMETRY_SYS_STATUS_LOAD, state.load/10.0f, time);
 
             // Battery charge/time remaining/voltage calculations
             currentVoltage = state.voltage_battery/1000.0f;
@@ -643,15 +722,15 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
             }
 
             emit batteryChanged(this, lpVoltage, currentCurrent, getChargeLevel(), timeRemaining);
-            emit valueChanged(uasId, name.arg("battery_remaining"), "%", getChargeLevel(), time);
+            publishValue(TELEMETRY_SYS_STATUS_BATTERY_REMAINING, getChargeLevel(), time);
             // emit voltageChanged(message.sysid, currentVoltage);
-            emit valueChanged(uasId, name.arg("battery_voltage"), "V", currentVoltage, time);
+            publishValue(TELEMETRY_SYS_STATUS_BATTERY_VOLTAGE, currentVoltage, time);
 
             // And if the battery current draw is measured, log that also.
             if (state.current_battery != -1)
             {
                 currentCurrent = ((double)state.current_battery)/100.0f;
-                emit valueChanged(uasId, name.arg("battery_current"), "A", currentCurrent, time);
+                publishValue(TELEMETRY_SYS_STATUS_BATTERY_CURRENT, currentCurrent, time);
             }
 
             // LOW BATTERY ALARM
@@ -681,14 +760,14 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
                 state.drop_rate_comm = 10000;
             }
             emit dropRateChanged(this->getUASID(), state.drop_rate_comm/100.0f);
-            emit valueChanged(uasId, name.arg("drop_rate_comm"), "%", state.drop_rate_comm/100.0f, time);
+            publishValue(TELEMETRY_SYS_STATUS_DROP_RATE_COMM, state.drop_rate_comm/100.0f, time);
         }
             break;
         case MAVLINK_MSG_ID_ATTITUDE:
         {
             mavlink_attitude_t attitude;
             mavlink_msg_attitude_decode(&message, &attitude);
-            quint64 time = getUnixReferenceTime(attitude.time_boot_ms);
+            quint64 time = getUnixReferenceTime((quint64)attitude.time_boot_ms * 1000);
 
             emit attitudeChanged(this, message.compid, QGC::limitAngleToPMPIf(attitude.roll), QGC::limitAngleToPMPIf(attitude.pitch), QGC::limitAngleToPMPIf(attitude.yaw), time);
 
@@ -709,7 +788,7 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
         {
             mavlink_attitude_quaternion_t attitude;
             mavlink_msg_attitude_quaternion_decode(&message, &attitude);
-            quint64 time = getUnixReferenceTime(attitude.time_boot_ms);
+            quint64 time = getUnixReferenceTime((quint64)attitude.time_boot_ms * 1000);
 
             double a = attitude.q1;
             double b = attitude.q2;
@@ -814,7 +893,7 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
         {
             mavlink_local_position_ned_t pos;
             mavlink_msg_local_position_ned_decode(&message, &pos);
-            quint64 time = getUnixTime(pos.time_boot_ms);
+            quint64 time = getUnixTimeFromMs(pos.time_boot_ms);
 
             // Emit position always with component ID
             emit localPositionChanged(this, message.compid, pos.x, pos.y, pos.z, time);
@@ -1117,9 +1196,9 @@ void UAS::receiveMessage(LinkInterface* link, mavlink_message_t message)
             emit attitudeThrustSetPointChanged(this, roll, pitch, yaw, out.thrust, time);
 
             // For plotting emit roll sp, pitch sp and yaw sp values
-            emit valueChanged(uasId, "roll sp", "rad", roll, time);
-            emit valueChanged(uasId, "pitch sp", "rad", pitch, time);
-            emit valueChanged(uasId, "yaw sp", "rad", yaw, time);
+            publishValue(TELEMETRY_ROLL_SETPOINT, roll, time);
+            publishValue(TELEMETRY_PITCH_SETPOINT, pitch, time);
+            publishValue(TELEMETRY_YAW_SETPOINT, yaw, time);
         }
             break;
         case MAVLINK_MSG_ID_MISSION_COUNT:
@@ -1581,11 +1660,17 @@ void UAS::startPressureCalibration()
 quint64 UAS::getUnixReferenceTime(quint64 time)
 {
     // Same as getUnixTime, but does not react to attitudeStamped mode
+    quint64 groundUsecs = 0;
     if (time == 0)
     {
         //        qDebug() << "XNEW time:" <<QGC::groundTimeMilliseconds();
         return QGC::groundTimeMilliseconds();
     }
+    else if (mavlink && mavlink->getTimeSync()->toGroundUsecs(uasId, time, &groundUsecs))
+    {
+        // Synchronized with the vehicle, exact to the accuracy of the time sync
+        return groundUsecs/1000;
+    }
     // Check if time is smaller than 40 years,
     // assuming no system without Unix timestamp
     // runs longer than 40 years continuously without
@@ -1623,6 +1708,38 @@ quint64 UAS::getUnixReferenceTime(quint64 time)
     }
 }
 
+/**
+* Subscribers of the typed signal get the interned key and the plain value. The
+* legacy signal is only emitted if something is connected to it, the name and unit
+* it carries were built in the constructor and are shared, not copied.
+* @param field the field to publish
+* @param value the value of the field
+* @param time the timestamp of the value, in milliseconds
+*/
+void UAS::publishValue(TelemetryField field, double value, quint64 time)
+{
+    TelemetryStore::instance()->append(telemetryKeys[field], time, value);
+    emit telemetrySample(telemetryKeys[field], value, time);
+
+    if (receivers(SIGNAL(valueChanged(int,QString,QString,QVariant,quint64))) > 0)
+    {
+        QVariant variant = telemetryIntegers[field] ? QVariant((uint)value) : QVariant(value);
+        emit valueChanged(uasId, telemetryNames[field], telemetryUnits[field], variant, time);
+    }
+}
+
+void UAS::publishValue(const QString& name, const QString& unit, double value, quint64 time)
+{
+    int key = TelemetryKeyRegistry::instance()->intern(uasId, name, unit);
+    TelemetryStore::instance()->append(key, time, value);
+    emit telemetrySample(key, value, time);
+
+    if (receivers(SIGNAL(valueChanged(int,QString,QString,QVariant,quint64))) > 0)
+    {
+        emit valueChanged(uasId, name, unit, QVariant(value), time);
+    }
+}
+
 /**
 * @warning If attitudeStamped is enabled, this function will not actually return
 * the precise time stamp of this measurement augmented to UNIX time, but will
@@ -1649,6 +1766,7 @@ quint64 UAS::getUnixTimeFromMs(quint64 time)
 quint64 UAS::getUnixTime(quint64 time)
 {
     quint64 ret = 0;
+    quint64 groundUsecs = 0;
     if (attitudeStamped)
     {
         ret = lastAttitude;
@@ -1658,6 +1776,11 @@ quint64 UAS::getUnixTime(quint64 time)
     {
         ret = QGC::groundTimeMilliseconds();
     }
+    else if (mavlink && mavlink->getTimeSync()->toGroundUsecs(uasId, time, &groundUsecs))
+    {
+        // Synchronized with the vehicle, exact to the accuracy of the time sync
+        ret = groundUsecs/1000;
+    }
     // Check if time is smaller than 40 years,
     // assuming no system without Unix timestamp
     // runs longer than 40 years continuously without
@@ -1839,23 +1962,8 @@ void UAS::forwardMessage(mavlink_message_t message)
 void UAS::sendMessage(LinkInterface* link, mavlink_message_t message)
 {
     if(!link) return;
-    // Create buffer
-    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
-    // Write message into buffer, prepending start sign
-    int len = mavlink_msg_to_send_buffer(buffer, &message);
-    static uint8_t messageKeys[256] = MAVLINK_MESSAGE_CRCS;
-    mavlink_finalize_message_chan(&message, mavlink->getSystemId(), mavlink->getComponentId(), link->getId(), message.len, messageKeys[message.msgid]);
-
-    // If link is connected
-    if (link->isConnected())
-    {
-        // Send the portion of the buffer now occupied by the message
-        link->writeBytes((const char*)buffer, len);
-    }
-    else
-    {
-        qDebug() << "LINK NOT CONNECTED, NOT SENDING!";
-    }
+    // Queued by priority and shaped to the bandwidth of the link
+    mavlink->sendMessage(link, message);
 }
 
 /**
@@ -3037,24 +3145,25 @@ void UAS::sendHilGroundTruth(quint64 time_us, float roll, float pitch, float yaw
     Q_UNUSED(zacc);
 
         // Emit attitude for cross-check
-        emit valueChanged(uasId, "roll sim", "rad", roll, getUnixTime());
-        emit valueChanged(uasId, "pitch sim", "rad", pitch, getUnixTime());
-        emit valueChanged(uasId, "yaw sim", "rad", yaw, getUnixTime());
+        quint64 time = getUnixTime();
+        publishValue(TELEMETRY_ROLL_SIM, roll, time);
+        publishValue(TELEMETRY_PITCH_SIM, pitch, time);
+        publishValue(TELEMETRY_YAW_SIM, yaw, time);
 
-        emit valueChanged(uasId, "roll rate sim", "rad/s", rollspeed, getUnixTime());
-        emit valueChanged(uasId, "pitch rate sim", "rad/s", pitchspeed, getUnixTime());
-        emit valueChanged(uasId, "yaw rate sim", "rad/s", yawspeed, getUnixTime());
+        publishValue(TELEMETRY_ROLL_RATE_SIM, rollspeed, time);
+        publishValue(TELEMETRY_PITCH_RATE_SIM, pitchspeed, time);
+        publishValue(TELEMETRY_YAW_RATE_SIM, yawspeed, time);
 
-        emit valueChanged(uasId, "lat sim", "deg", lat*1e7, getUnixTime());
-        emit valueChanged(uasId, "lon sim", "deg", lon*1e7, getUnixTime());
-        emit valueChanged(uasId, "alt sim", "deg", alt*1e3, getUnixTime());
+        publishValue(TELEMETRY_LAT_SIM, lat*1e7, time);
+        publishValue(TELEMETRY_LON_SIM, lon*1e7, time);
+        publishValue(TELEMETRY_ALT_SIM, alt*1e3, time);
 
-        emit valueChanged(uasId, "vx sim", "m/s", vx*1e2, getUnixTime());
-        emit valueChanged(uasId, "vy sim", "m/s", vy*1e2, getUnixTime());
-        emit valueChanged(uasId, "vz sim", "m/s", vz*1e2, getUnixTime());
+        publishValue(TELEMETRY_VX_SIM, vx*1e2, time);
+        publishValue(TELEMETRY_VY_SIM, vy*1e2, time);
+        publishValue(TELEMETRY_VZ_SIM, vz*1e2, time);
 
-        emit valueChanged(uasId, "IAS sim", "m/s", ind_airspeed, getUnixTime());
-        emit valueChanged(uasId, "TAS sim", "m/s", true_airspeed, getUnixTime());
+        publishValue(TELEMETRY_IAS_SIM, ind_airspeed, time);
+        publishValue(TELEMETRY_TAS_SIM, true_airspeed, time);
 }
 
 /**
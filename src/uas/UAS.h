@@ -118,7 +118,7 @@ public:
     {
         groundSpeed = val;
         emit groundSpeedChanged(val,"groundSpeed");
-        emit valueChanged(this->uasId,"groundSpeed","m/s",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_GROUND_SPEED, val, getUnixTime());
     }
     double getGroundSpeed() const
     {
@@ -129,7 +129,7 @@ public:
     {
         airSpeed = val;
         emit airSpeedChanged(val,"airSpeed");
-        emit valueChanged(this->uasId,"airSpeed","m/s",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_AIR_SPEED, val, getUnixTime());
     }
 
     double getAirSpeed() const
@@ -141,7 +141,7 @@ public:
     {
         localX = val;
         emit localXChanged(val,"localX");
-        emit valueChanged(this->uasId,"localX","m",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_LOCAL_X, val, getUnixTime());
     }
 
     double getLocalX() const
@@ -153,7 +153,7 @@ public:
     {
         localY = val;
         emit localYChanged(val,"localY");
-        emit valueChanged(this->uasId,"localY","m",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_LOCAL_Y, val, getUnixTime());
     }
     double getLocalY() const
     {
@@ -164,7 +164,7 @@ public:
     {
         localZ = val;
         emit localZChanged(val,"localZ");
-        emit valueChanged(this->uasId,"localZ","m",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_LOCAL_Z, val, getUnixTime());
     }
     double getLocalZ() const
     {
@@ -175,7 +175,7 @@ public:
     {
         latitude = val;
         emit latitudeChanged(val,"latitude");
-        emit valueChanged(this->uasId,"latitude","deg",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_LATITUDE, val, getUnixTime());
     }
 
     double getLatitude() const
@@ -187,7 +187,7 @@ public:
     {
         longitude = val;
         emit longitudeChanged(val,"longitude");
-        emit valueChanged(this->uasId,"longitude","deg",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_LONGITUDE, val, getUnixTime());
     }
 
     double getLongitude() const
@@ -199,10 +199,10 @@ public:
     {
         altitudeAMSL = val;
         emit altitudeAMSLChanged(val, "altitudeAMSL");
-        emit valueChanged(this->uasId,"altitudeAMSL","m",QVariant(altitudeAMSL),getUnixTime());
+        publishValue(TELEMETRY_ALTITUDE_AMSL, altitudeAMSL, getUnixTime());
         altitudeAMSLFT = 3.28084 * altitudeAMSL;
         emit altitudeAMSLFTChanged(val, "altitudeAMSLFT");
-        emit valueChanged(this->uasId,"altitudeAMSLFT","m",QVariant(altitudeAMSLFT),getUnixTime());
+        publishValue(TELEMETRY_ALTITUDE_AMSL_FT, altitudeAMSLFT, getUnixTime());
     }
 
     double getAltitudeAMSL() const
@@ -219,7 +219,7 @@ public:
     {
         altitudeWGS84 = val;
         emit altitudeWGS84Changed(val, "altitudeWGS84");
-        emit valueChanged(this->uasId,"altitudeWGS84","m",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_ALTITUDE_WGS84, val, getUnixTime());
     }
 
     double getAltitudeWGS84() const
@@ -232,7 +232,7 @@ public:
     {
         altitudeRelative = val;
         emit altitudeRelativeChanged(val, "altitudeRelative");
-        emit valueChanged(this->uasId,"altitudeRelative","m",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_ALTITUDE_RELATIVE, val, getUnixTime());
     }
 
     double getAltitudeRelative() const
@@ -244,7 +244,7 @@ public:
     {
         satelliteCount = val;
         emit satelliteCountChanged(val,"satelliteCount");
-        emit valueChanged(this->uasId,"satelliteCount","",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_SATELLITE_COUNT, val, getUnixTime());
     }
 
     double getSatelliteCount() const
@@ -266,7 +266,7 @@ public:
     {
         distToWaypoint = val;
         emit distToWaypointChanged(val,"distToWaypoint");
-        emit valueChanged(this->uasId,"distToWaypoint","m",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_DIST_TO_WAYPOINT, val, getUnixTime());
     }
 
     double getDistToWaypoint() const
@@ -278,7 +278,7 @@ public:
     {
         bearingToWaypoint = val;
         emit bearingToWaypointChanged(val,"bearingToWaypoint");
-        emit valueChanged(this->uasId,"bearingToWaypoint","deg",QVariant(val),getUnixTime());
+        publishValue(TELEMETRY_BEARING_TO_WAYPOINT, val, getUnixTime());
     }
 
     double getBearingToWaypoint() const
@@ -454,6 +454,62 @@ protected: //COMMENTS FOR TEST UNIT
     quint64 startTime;            ///< The time the UAS was switched on
     quint64 onboardTimeOffset;
 
+    /// TELEMETRY
+    /** @brief Values published to the plots, each is interned once as a key of the TelemetryKeyRegistry */
+    enum TelemetryField {
+        TELEMETRY_HEARTBEAT_BASE_MODE,
+        TELEMETRY_HEARTBEAT_CUSTOM_MODE,
+        TELEMETRY_HEARTBEAT_SYSTEM_STATUS,
+        TELEMETRY_SYS_STATUS_SENSORS_ENABLED,
+        TELEMETRY_SYS_STATUS_SENSORS_HEALTH,
+        TELEMETRY_SYS_STATUS_ERRORS_COMM,
+        TELEMETRY_SYS_STATUS_ERRORS_COUNT1,
+        TELEMETRY_SYS_STATUS_ERRORS_COUNT2,
+        TELEMETRY_SYS_STATUS_ERRORS_COUNT3,
+        TELEMETRY_SYS_STATUS_ERRORS_COUNT4,
+        TELEMETRY_SYS_STATUS_LOAD,
+        TELEMETRY_SYS_STATUS_BATTERY_REMAINING,
+        TELEMETRY_SYS_STATUS_BATTERY_VOLTAGE,
+        TELEMETRY_SYS_STATUS_BATTERY_CURRENT,
+        TELEMETRY_SYS_STATUS_DROP_RATE_COMM,
+        TELEMETRY_ROLL_SETPOINT,
+        TELEMETRY_PITCH_SETPOINT,
+        TELEMETRY_YAW_SETPOINT,
+        TELEMETRY_ROLL_SIM,
+        TELEMETRY_PITCH_SIM,
+        TELEMETRY_YAW_SIM,
+        TELEMETRY_ROLL_RATE_SIM,
+        TELEMETRY_PITCH_RATE_SIM,
+        TELEMETRY_YAW_RATE_SIM,
+        TELEMETRY_LAT_SIM,
+        TELEMETRY_LON_SIM,
+        TELEMETRY_ALT_SIM,
+        TELEMETRY_VX_SIM,
+        TELEMETRY_VY_SIM,
+        TELEMETRY_VZ_SIM,
+        TELEMETRY_IAS_SIM,
+        TELEMETRY_TAS_SIM,
+        TELEMETRY_GROUND_SPEED,
+        TELEMETRY_AIR_SPEED,
+        TELEMETRY_LOCAL_X,
+        TELEMETRY_LOCAL_Y,
+        TELEMETRY_LOCAL_Z,
+        TELEMETRY_LATITUDE,
+        TELEMETRY_LONGITUDE,
+        TELEMETRY_ALTITUDE_AMSL,
+        TELEMETRY_ALTITUDE_AMSL_FT,
+        TELEMETRY_ALTITUDE_WGS84,
+        TELEMETRY_ALTITUDE_RELATIVE,
+        TELEMETRY_SATELLITE_COUNT,
+        TELEMETRY_DIST_TO_WAYPOINT,
+        TELEMETRY_BEARING_TO_WAYPOINT,
+        TELEMETRY_FIELD_COUNT
+    };
+    int telemetryKeys[TELEMETRY_FIELD_COUNT];       ///< Key of each field, interned in the constructor
+    QString telemetryNames[TELEMETRY_FIELD_COUNT];  ///< Name of each field, shared by all legacy valueChanged signals
+    QString telemetryUnits[TELEMETRY_FIELD_COUNT];  ///< Unit of each field, shared by all legacy valueChanged signals
+    bool telemetryIntegers[TELEMETRY_FIELD_COUNT];  ///< The field is sent as an integer with the legacy signal
+
     /// MANUAL CONTROL
     bool controlRollManual;     ///< status flag, true if roll is controlled manually
     bool controlPitchManual;    ///< status flag, true if pitch is controlled manually
@@ -1010,6 +1066,10 @@ protected:
     quint64 getUnixTimeFromMs(quint64 time);
     /** @brief Get the UNIX timestamp in milliseconds, ignore attitudeStamped mode */
     quint64 getUnixReferenceTime(quint64 time);
+    /** @brief Publish a value to the telemetry store, with the typed telemetrySample signal, and with valueChanged if anyone listens to it */
+    void publishValue(TelemetryField field, double value, quint64 time);
+    /** @brief Like publishValue() for the values of the autopilot subclasses, the key is interned on every call */
+    void publishValue(const QString& name, const QString& unit, double value, quint64 time);
 
     virtual void processParamValueMsg(mavlink_message_t& msg, const QString& paramName,const mavlink_param_value_t& rawValue, mavlink_param_union_t& paramValue);
     virtual void processParamValueMsgHook(mavlink_message_t& msg, const QString& paramName,const mavlink_param_value_t& rawValue, mavlink_param_union_t& paramValue) { Q_UNUSED(msg); Q_UNUSED(paramName); Q_UNUSED(rawValue); Q_UNUSED(paramValue); };
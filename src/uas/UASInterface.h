@@ -496,6 +496,16 @@ signals:
       * @param msec the timestamp of the message, in milliseconds
       */
     void valueChanged(const int uasid, const QString& name, const QString& unit, const QVariant &value,const quint64 msecs);
+    /** @brief A value of the robot has changed, typed variant of valueChanged.
+      *
+      * Emitted for the same values as valueChanged, but without building or copying any strings per sample. The
+      * system, name and unit of the value are looked up once per key in the TelemetryKeyRegistry.
+      *
+      * @param key key of the value in the TelemetryKeyRegistry
+      * @param value the value that changed
+      * @param msecs the timestamp of the message, in milliseconds
+      */
+    void telemetrySample(int key, double value, quint64 msecs);
 
     void voltageChanged(int uasId, double voltage);
     void waypointUpdated(int uasId, int id, double x, double y, double z, double yaw, bool autocontinue, bool active);
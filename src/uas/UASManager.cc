@@ -295,6 +295,10 @@ void UASManager::addUAS(UASInterface* uas)
     {
         qDebug() << "Add new UAS: " << uas->getUASID();
         systems.append(uas);
+        int id = uas->getUASID();
+        if (id >= 0 && id < 256) {
+            systemsById[id].storeRelease(uas);
+        }
         // Set home position on UAV if set in UI
         // - this is done on a per-UAV basis
         // Set home position in UI if UAV chooses a new one (caution! if multiple UAVs are connected, take care!)
@@ -338,6 +342,10 @@ void UASManager::removeUAS(UASInterface* uas)
 
         // Remove this system from local data store.
         systems.removeAt(listindex);
+        int id = uas->getUASID();
+        if (id >= 0 && id < 256) {
+            systemsById[id].testAndSetOrdered(uas, NULL);
+        }
 
         // If this is the active UAS, select a new one if one exists otherwise
         // indicate that there are no active UASes.
@@ -446,6 +454,11 @@ void UASManager::configureActiveUAS()
 
 UASInterface* UASManager::getUASForId(int id)
 {
+    // Called for every received packet, MAVLink system ids are looked up without locking or scanning
+    if (id >= 0 && id < 256) {
+        return systemsById[id].loadAcquire();
+    }
+
     UASInterface* system = NULL;
 
     foreach(UASInterface* sys, systems) {
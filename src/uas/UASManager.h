@@ -35,6 +35,7 @@ This file is part of the QGROUNDCONTROL project
 #include <QThread>
 #include <QList>
 #include <QMutex>
+#include <QAtomicPointer>
 #include <UASInterface.h>
 #include "../../libs/eigen/Eigen/Eigen"
 #include "QGCGeo.h"
@@ -258,6 +259,7 @@ public slots:
 protected:
     UASManager();
     QList<UASInterface*> systems;
+    QAtomicPointer<UASInterface> systemsById[256];  ///< Systems indexed by their MAVLink system id, for lookups from the protocol thread
     UASInterface* activeUAS;
     UASWaypointManager *offlineUASWaypointManager;
     QMutex activeUASMutex;
@@ -41,6 +41,7 @@ This file is part of the QGROUNDCONTROL project
 #include "SerialLink.h"
 #include "UDPLink.h"
 #include "TCPLink.h"
+#include "SharedMemoryLink.h"
 #include "MAVLinkSimulationLink.h"
 #ifdef QGC_XBEE_ENABLED
 #include "XbeeLink.h"
@@ -54,6 +55,7 @@ This file is part of the QGROUNDCONTROL project
 #include "MAVLinkSettingsWidget.h"
 #include "QGCUDPLinkConfiguration.h"
 #include "QGCTCPLinkConfiguration.h"
+#include "QGCSharedMemoryLinkConfiguration.h"
 #include "LinkManager.h"
 #include "MainWindow.h"
 
@@ -85,6 +87,7 @@ CommConfigurationWindow::CommConfigurationWindow(LinkInterface* link, ProtocolIn
     ui.linkType->addItem(tr("Serial"), QGC_LINK_SERIAL);
     ui.linkType->addItem(tr("UDP"), QGC_LINK_UDP);
     ui.linkType->addItem(tr("TCP"), QGC_LINK_TCP);
+    ui.linkType->addItem(tr("Shared Memory"), QGC_LINK_SHARED_MEMORY);
     if(dynamic_cast<MAVLinkSimulationLink*>(link)) {
         //Only show simulation option if already setup elsewhere as a simulation
         ui.linkType->addItem(tr("Simulation"), QGC_LINK_SIMULATION);
@@ -158,6 +161,13 @@ CommConfigurationWindow::CommConfigurationWindow(LinkInterface* link, ProtocolIn
         ui.linkGroupBox->setTitle(tr("TCP Link"));
         ui.linkType->setCurrentIndex(ui.linkType->findData(QGC_LINK_TCP));
     }
+    SharedMemoryLink* shm = dynamic_cast<SharedMemoryLink*>(link);
+    if (shm != 0) {
+        QWidget* conf = new QGCSharedMemoryLinkConfiguration(shm, this);
+        ui.linkScrollArea->setWidget(conf);
+        ui.linkGroupBox->setTitle(tr("Shared Memory Link"));
+        ui.linkType->setCurrentIndex(ui.linkType->findData(QGC_LINK_SHARED_MEMORY));
+    }
     MAVLinkSimulationLink* sim = dynamic_cast<MAVLinkSimulationLink*>(link);
     if (sim != 0) {
         ui.linkType->setCurrentIndex(ui.linkType->findData(QGC_LINK_SIMULATION));
@@ -187,7 +197,7 @@ CommConfigurationWindow::CommConfigurationWindow(LinkInterface* link, ProtocolIn
 		connect(xbee,SIGNAL(tryConnectEnd(bool)),ui.actionConnect,SLOT(setEnabled(bool)));
 	}
 #endif // QGC_XBEE_ENABLED
-    if (serial == 0 && udp == 0 && sim == 0 && tcp == 0
+    if (serial == 0 && udp == 0 && sim == 0 && tcp == 0 && shm == 0
 #ifdef QGC_RTLAB_ENABLED
             && opal == 0
 #endif
@@ -274,6 +284,14 @@ void CommConfigurationWindow::setLinkType(qgc_link_t linktype)
             break;
             }
 
+        case QGC_LINK_SHARED_MEMORY:
+            {
+            SharedMemoryLink *shm = new SharedMemoryLink();
+            tmpLink = shm;
+            MainWindow::instance()->addLink(tmpLink);
+            break;
+            }
+
 #ifdef QGC_RTLAB_ENABLED
         case QGC_LINK_OPAL:
 			{
@@ -43,6 +43,7 @@ enum qgc_link_t {
     QGC_LINK_SERIAL,
     QGC_LINK_UDP,
     QGC_LINK_TCP,
+    QGC_LINK_SHARED_MEMORY,
     QGC_LINK_SIMULATION,
     QGC_LINK_FORWARDING,
 #ifdef QGC_XBEE_ENABLED
@@ -349,6 +349,15 @@ void DebugConsole::updateTrafficMeasurements()
    
     // Update the outoing data rate label.
     m_ui->upSpeedLabel->setText(tr("%L1 kB/s").arg(lowpassOutDataRate, 4, 'f', 1, '0'));
+
+    // The link counters are read without locking, so polling them doesn't slow down the link.
+    const LinkStatistics& statistics = currLink->getStatistics();
+    m_ui->downSpeedLabel->setToolTip(tr("%L1 bytes, %L2 frames received, %L3 CRC errors, %L4 frames lost")
+                                     .arg(statistics.bytesReceived()).arg(statistics.framesReceived())
+                                     .arg(statistics.crcErrors()).arg(statistics.sequenceGaps()));
+    m_ui->upSpeedLabel->setToolTip(tr("%L1 bytes, %L2 frames sent, %L3 frames dropped")
+                                   .arg(statistics.bytesSent()).arg(statistics.framesSent())
+                                   .arg(statistics.droppedFrames()));
 }
 
 void DebugConsole::paintEvent(QPaintEvent *event)
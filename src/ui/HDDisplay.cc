@@ -25,6 +25,9 @@
 #include "MG.h"
 #include "QGC.h"
 #include "MainWindow.h"
+#include "MAVLinkDecoder.h"
+#include "TelemetryKeyRegistry.h"
+#include "TelemetryStore.h"
 #include <QDebug>
 
 HDDisplay::HDDisplay(const QStringList &plotList, QString title, QWidget *parent) :
@@ -52,6 +55,8 @@ HDDisplay::HDDisplay(const QStringList &plotList, QString title, QWidget *parent
     lastPaintTime(0),
     columns(3),
     valuesChanged(true),
+    decodersSubscribed(false),
+    telemetryKeyCount(0),
     m_ui(NULL)
 {
     setWindowTitle(title);
@@ -133,6 +138,7 @@ HDDisplay::HDDisplay(const QStringList &plotList, QString title, QWidget *parent
 HDDisplay::~HDDisplay()
 {
     saveState();
+    subscribeDecoders(false);
 	if(this->refreshTimer)
 	{
 		delete this->refreshTimer;
@@ -163,6 +169,8 @@ void HDDisplay::enableGLRendering(bool enable)
 
 void HDDisplay::triggerUpdate()
 {
+    pullValues();
+
     // Only repaint the regions necessary
     update(this->geometry());
 }
@@ -484,14 +492,10 @@ void HDDisplay::setActiveUAS(UASInterface* uas)
 {
     if (!uas)
         return;
-    // Disconnect any previously connected active UAS
-    if (this->uas != NULL) {
-        removeSource(this->uas);
-    }
-
-    // Now connect the new UAS
-	addSource(uas);
     this->uas = uas;
+
+    // Look at all keys again on the next update, to point the shared variable names to the new active system
+    telemetryKeyCount = 0;
 }
 
 /**
@@ -862,36 +866,111 @@ float HDDisplay::refLineWidthToPen(float line)
 // Connect a generic source
 void HDDisplay::addSource(QObject* obj)
 {
-    connect(obj, SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)), this, SLOT(updateValue(int,QString,QString,QVariant,quint64)));
+    // The gauges can be set to any value, take all of them
+    MAVLinkDecoder* decoder = qobject_cast<MAVLinkDecoder*>(obj);
+    if (decoder && !decoders.contains(decoder))
+    {
+        decoders.append(decoder);
+        if (decodersSubscribed)
+        {
+            decoder->subscribe(0, -1);
+        }
+    }
 }
 
 // Disconnect a generic source
 void HDDisplay::removeSource(QObject* obj)
 {
-    disconnect(obj, SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)), this, SLOT(updateValue(int,QString,QString,QVariant,quint64)));
+    MAVLinkDecoder* decoder = qobject_cast<MAVLinkDecoder*>(obj);
+    if (decoder && decoders.removeOne(decoder) && decodersSubscribed)
+    {
+        decoder->unsubscribe(0, -1);
+    }
 }
 
-void HDDisplay::updateValue(const int uasId, const QString& name, const QString& unit, const QVariant &variant, const quint64 msec)
+void HDDisplay::subscribeDecoders(bool subscribe)
 {
-    Q_UNUSED(uasId);
-    Q_UNUSED(unit);
-
-    QMetaType::Type type = static_cast< QMetaType::Type>(variant.type());
-    if(type == QMetaType::QByteArray || type == QMetaType::QString)
+    if (subscribe == decodersSubscribed)
+    {
         return;
+    }
+    decodersSubscribed = subscribe;
 
-    bool ok;
-    double value = variant.toDouble(&ok);
-    if(!ok)
-        return;
+    for (int i = 0; i < decoders.count(); ++i)
+    {
+        if (subscribe)
+        {
+            decoders[i]->subscribe(0, -1);
+        }
+        else
+        {
+            decoders[i]->unsubscribe(0, -1);
+        }
+    }
+}
+
+/**
+ * The UAS objects and the decoders publish every value to the telemetry store
+ * once. The display reads what arrived since its last repaint, so it costs the
+ * same no matter how fast the values arrive.
+ */
+void HDDisplay::pullValues()
+{
+    TelemetryKeyRegistry* registry = TelemetryKeyRegistry::instance();
+    TelemetryStore* store = TelemetryStore::instance();
+
+    // Pick up the variables registered since the last update
+    int count = registry->count();
+    int activeId = uas ? uas->getUASID() : -1;
+    for (; telemetryKeyCount < count; telemetryKeyCount++)
+    {
+        TelemetryKeyRegistry::Key key = registry->key(telemetryKeyCount);
+
+        // The UAS objects publish the same names for every system, show those of the active one
+        QMap<QString, ValueKey>::iterator known = valueKeys.find(key.name);
+        if (known != valueKeys.end() && (known.value().key == telemetryKeyCount || key.uasId != activeId))
+        {
+            continue;
+        }
+
+        if (known != valueKeys.end())
+        {
+            // Start over with the samples of the active system
+            lastUpdate.remove(key.name);
+        }
 
-    if(type == QMetaType::Int || type == QMetaType::UInt || type == QMetaType::Long || type == QMetaType::LongLong
-       || type == QMetaType::Short || type == QMetaType::Char || type == QMetaType::ULong || type == QMetaType::ULongLong
-       || type == QMetaType::UShort || type == QMetaType::UChar || type == QMetaType::Bool ) {
-            if (!intValues.contains(name))
-                intValues.insert(name, true);
+        ValueKey valueKey;
+        valueKey.key = telemetryKeyCount;
+        valueKey.pulledCount = 0;
+        valueKeys.insert(key.name, valueKey);
+        units.insert(key.name, key.unit);
+        if (key.integer)
+        {
+            intValues.insert(key.name, true);
+        }
     }
 
+    QVector<TelemetryStore::Sample> samples;
+    for (QMap<QString, ValueKey>::iterator i = valueKeys.begin(); i != valueKeys.end(); ++i)
+    {
+        quint32 sampleCount = store->sampleCount(i.value().key);
+        if (sampleCount == i.value().pulledCount)
+        {
+            continue;
+        }
+        i.value().pulledCount = sampleCount;
+
+        // The mean and the rate of change take every sample into account
+        store->window(i.value().key, lastUpdate.value(i.key(), 0) + 1, Q_UINT64_C(0xFFFFFFFFFFFFFFFF), &samples);
+        for (int j = 0; j < samples.count(); ++j)
+        {
+            updateValue(i.key(), samples[j].value, samples[j].msecs);
+        }
+    }
+}
+
+void HDDisplay::updateValue(const QString& name, double value, quint64 msec)
+{
     // Update mean
     const float oldMean = valuesMean.value(name, 0.0f);
     const int meanCount = valuesCount.value(name, 0);
@@ -900,7 +979,6 @@ void HDDisplay::updateValue(const int uasId, const QString& name, const QString&
     valuesDot.insert(name, (value - values.value(name, 0.0f)) / ((msec - lastUpdate.value(name, 0))/1000.0f));
     if (values.value(name, 0.0) != value) valuesChanged = true;
     values.insert(name, value);
-    units.insert(name, unit);
     lastUpdate.insert(name, msec);
 }
 
@@ -974,6 +1052,7 @@ void HDDisplay::showEvent(QShowEvent* event)
     // events
     Q_UNUSED(event);
     refreshTimer->start(updateInterval);
+    subscribeDecoders(true);
 }
 
 void HDDisplay::hideEvent(QHideEvent* event)
@@ -982,6 +1061,7 @@ void HDDisplay::hideEvent(QHideEvent* event)
     // events
     Q_UNUSED(event);
     refreshTimer->stop();
+    subscribeDecoders(false);
     saveState();
 }
 
@@ -43,6 +43,8 @@ This file is part of the QGROUNDCONTROL project
 
 #include "UASInterface.h"
 
+class MAVLinkDecoder;
+
 namespace Ui
 {
 class HDDisplay;
@@ -64,14 +66,11 @@ public:
     ~HDDisplay();
 
 public slots:
-    /** @brief Update the HDD with new data */
-    void updateValue(const int uasId, const QString& name, const QString& unit, const QVariant &value, const quint64 msec);
-	
     virtual void setActiveUAS(UASInterface* uas);
 	
-	/** @brief Connects a source to the updateValue() signals */
+	/** @brief Decodes the values of a source while the display is shown, they are read from the telemetry store */
     void addSource(QObject* obj);
-	/** @brief Disconnects a source to the updateValue() signals */
+	/** @brief Stops decoding the values of a source */
     void removeSource(QObject* obj);
 
     /** @brief Removes a plot item by the action data */
@@ -124,6 +123,12 @@ protected:
     void drawGauge(float xRef, float yRef, float radius, float min, float max, const QString name, float value, const QColor& color, QPainter* painter, bool symmetric, QPair<float, float> goodRange, QPair<float, float> criticalRange, bool solid=true);
     void drawSystemIndicator(float xRef, float yRef, int maxNum, float maxWidth, float maxHeight, QPainter* painter);
     void paintText(QString text, QColor color, float fontSize, float refX, float refY, QPainter* painter);
+    /** @brief Decode the values of the decoder sources only while the display is shown */
+    void subscribeDecoders(bool subscribe);
+    /** @brief Read the values received since the last repaint from the telemetry store */
+    void pullValues();
+    /** @brief Update the value, mean and rate of change of a variable with a new sample */
+    void updateValue(const QString& name, double value, quint64 msec);
 
 //    //Holds the current centerpoint for the view, used for panning and zooming
 //     QPointF currentCenterPoint;
@@ -197,6 +202,16 @@ protected:
     QAction* setTitleAction;   ///< Action setting the title
     QAction* setColumnsAction; ///< Action setting the number of columns
     bool valuesChanged;
+    QList<MAVLinkDecoder*> decoders;  ///< Sources which only decode the subscribed values
+    bool decodersSubscribed;   ///< All values of the decoders are subscribed
+
+    /** @brief Telemetry store key of a variable */
+    struct ValueKey {
+        int key;
+        quint32 pulledCount;   ///< Samples of the key in the telemetry store when it was last read
+    };
+    QMap<QString, ValueKey> valueKeys; ///< Keys of the variables, those of the active UAS for names several systems publish
+    int telemetryKeyCount;     ///< Number of telemetry keys already looked at for new variables
 
 private:
     Ui::HDDisplay *m_ui;
@@ -1,24 +1,33 @@
 #include "MAVLinkDecoder.h"
 #include "UASManager.h"
+#include "TelemetryKeyRegistry.h"
+#include "TelemetryStore.h"
+#include "QGC.h"
 
 MAVLinkDecoder::MAVLinkDecoder(MAVLinkProtocol* protocol, QObject *parent) :
-    QThread()
+    QThread(),
+    descriptors(MAVLinkDescriptorTable::instance()),
+    timeSync(protocol->getTimeSync()),
+    latencyName("TIMESYNC.latency"),
+    latencyUnit("ms"),
+    subscriptionVersion(0),
+    routedVersion(-1),
+    routes(256 * 256, ROUTE_NONE),
+    discovered(256 * 256, false)
 {
     Q_UNUSED(parent);
     // We're doing it wrong - because the Qt folks got the API wrong:
     // http://blog.qt.digia.com/blog/2010/06/17/youre-doing-it-wrong/
     moveToThread(this);
 
-    mavlink_message_info_t msg[256] = MAVLINK_MESSAGE_INFO;
-    memcpy(messageInfo, msg, sizeof(mavlink_message_info_t)*256);
-    memset(receivedMessages, 0, sizeof(mavlink_message_t)*256);
-    for (unsigned int i = 0; i<255;++i)
+    for (unsigned int i = 0; i<256;++i)
     {
         componentID[i] = -1;
         componentMulti[i] = false;
         onboardTimeOffset[i] = 0;
-        onboardToGCSUnixTimeOffsetAndDelay[i] = 0;
         firstOnboardTime[i] = 0;
+        lastLatencyTime[i] = 0;
+        latencyKey[i] = -1;
     }
 
     // Fill filter
@@ -51,7 +60,7 @@ MAVLinkDecoder::MAVLinkDecoder(MAVLinkProtocol* protocol, QObject *parent) :
     textMessageFilter.insert(MAVLINK_MSG_ID_NAMED_VALUE_INT, false);
 //    textMessageFilter.insert(MAVLINK_MSG_ID_HIGHRES_IMU, false);
 
-    connect(protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), this, SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
+    connect(protocol, SIGNAL(sharedMessageReceived(LinkInterface*,MAVLinkMessage)), this, SLOT(receiveMessage(LinkInterface*,MAVLinkMessage)));
 
     start(LowPriority);
 }
@@ -65,60 +74,113 @@ void MAVLinkDecoder::run()
     exec();
 }
 
-void MAVLinkDecoder::receiveMessage(LinkInterface* link,mavlink_message_t message)
+void MAVLinkDecoder::receiveMessage(LinkInterface* link, MAVLinkMessage messageRef)
 {
     Q_UNUSED(link);
-    memcpy(receivedMessages+message.msgid, &message, sizeof(mavlink_message_t));
-
+    const mavlink_message_t& message = *messageRef;
     uint8_t msgid = message.msgid;
+    int index = (message.sysid << 8) | msgid;
 
-    // Store an arrival time for this message. This value ends up being calculated later.
-    quint64 time = 0;
-    
-    // The SYSTEM_TIME message is special, in that it's handled here for synchronizing the QGC time with the remote time.
-    if (message.msgid == MAVLINK_MSG_ID_SYSTEM_TIME)
+    // Multi component detection
+    if (componentID[msgid] == -1)
     {
-        mavlink_system_time_t timebase;
-        mavlink_msg_system_time_decode(&message, &timebase);
-        onboardTimeOffset[message.sysid] = (timebase.time_unix_usec+500)/1000 - timebase.time_boot_ms;
-        onboardToGCSUnixTimeOffsetAndDelay[message.sysid] = static_cast<qint64>(QGC::groundTimeMilliseconds() - (timebase.time_unix_usec+500)/1000);
+        componentID[msgid] = message.compid;
     }
-    else
+    else if (componentID[msgid] != message.compid && !componentMulti[msgid])
     {
+        componentMulti[msgid] = true;
 
-        // See if first value is a time value and if it is, use that as the arrival time for this data.
-        uint8_t fieldid = 0;
-        uint8_t* m = ((uint8_t*)(receivedMessages+msgid))+8;
-        if (QString(messageInfo[msgid].fields[fieldid].name) == QString("time_boot_ms") && messageInfo[msgid].fields[fieldid].type == MAVLINK_TYPE_UINT32_T)
+        // The names get the component, learn them again
+        for (int i = 0; i < 256; ++i)
         {
-            time = *((quint32*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
+            discovered[(i << 8) | msgid] = false;
         }
-        else if (QString(messageInfo[msgid].fields[fieldid].name).contains("usec") && messageInfo[msgid].fields[fieldid].type == MAVLINK_TYPE_UINT64_T)
+    }
+
+    if (messageFilter.contains(msgid)) return;
+
+    if (subscriptionVersion.load() != routedVersion)
+    {
+        updateRoutes();
+    }
+
+    Route route = (Route)routes.at(index);
+    if (route == ROUTE_NONE)
+    {
+        // Nobody listens, only learn the names so the views can offer them
+        if (!discovered.at(index))
         {
-            time = *((quint64*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            time = (time+500)/1000; // Scale to milliseconds, round up/down correctly
+            valueNames(message);
         }
+        return;
+    }
+
+    ValueNames& names = valueNames(message);
+    if (names.version != routedVersion)
+    {
+        routeValues(message, route, &names);
+    }
+    if (names.routed.isEmpty() && !names.textsRouted)
+    {
+        return;
     }
 
     // Align UAS time to global time
-    time = getUnixTimeFromMs(message.sysid, time);
+    quint64 onboardUsecs = descriptors->onboardUsecs(message);
+    quint64 receiveUsecs = messageRef.receiveUsecs() ? messageRef.receiveUsecs() : QGC::groundTimeUsecs();
+    quint64 time = getUnixTime(message.sysid, onboardUsecs, receiveUsecs);
+
+    // Send out the subscribed field values of this message, the names and keys are looked up once per system
+    const MAVLinkDescriptorTable::Message& descriptor = descriptors->message(msgid);
+    const uint8_t* payload = (const uint8_t*)_MAV_PAYLOAD(&message);
+    TelemetryStore* store = TelemetryStore::instance();
+    for (int j = 0; j < names.routed.count(); ++j)
+    {
+        int i = names.routed[j];
+        const MAVLinkDescriptorTable::Value& value = descriptor.values[i];
+        QVariant variant = value.extract(payload + value.offset);
+        store->append(names.keys[i], time, variant.toDouble());
+        emit valueChanged(message.sysid, names.names[i], value.unit, variant, time);
+    }
 
-    // Send out all field values for this message
-    for (unsigned int i = 0; i < messageInfo[msgid].num_fields; ++i)
+    // Text fields are only decoded if they are shown
+    if (names.textsRouted && !textMessageFilter.contains(msgid))
     {
-        emitFieldValue(&message, i, time);
+        for (int i = 0; i < descriptor.texts.count(); ++i)
+        {
+            const MAVLinkDescriptorTable::Text& text = descriptor.texts[i];
+            // Enforce null termination
+            QByteArray string((const char*)payload + text.offset, text.length);
+            string[text.length - 1] = '\0';
+            emit textMessageReceived(message.sysid, message.compid, MAV_SEVERITY_INFO, valueName(message, text.fieldName, -1) + ": " + string.constData());
+        }
     }
 
     // Send out combined math expressions
     // FIXME XXX TODO
 }
 
-quint64 MAVLinkDecoder::getUnixTimeFromMs(int systemID, quint64 time)
+quint64 MAVLinkDecoder::getUnixTime(int systemID, quint64 onboardUsecs, quint64 receiveUsecs)
 {
     quint64 ret = 0;
-    if (time == 0)
+    quint64 groundUsecs = 0;
+    quint64 time = (onboardUsecs+500)/1000; // Scale to milliseconds, round up/down correctly
+    if (onboardUsecs == 0)
     {
-        ret = QGC::groundTimeMilliseconds() - onboardToGCSUnixTimeOffsetAndDelay[systemID];
+        // Without a timestamp the arrival time is the best we know
+        ret = receiveUsecs/1000;
+    }
+    else if (timeSync->logLatency(systemID, onboardUsecs, receiveUsecs, &groundUsecs))
+    {
+        // Synchronized, this also measures the latency of the message
+        ret = (groundUsecs+500)/1000;
+
+        // The smoothed latency is plotted like any other value, a few times a second is plenty
+        if (receiveUsecs >= lastLatencyTime[systemID] + 200000)
+        {
+            lastLatencyTime[systemID] = receiveUsecs;
+            emitLatency(systemID, timeSync->getLatencyUsecs(systemID) / 1000.0, receiveUsecs/1000);
+        }
     }
     // Check if time is smaller than 40 years,
     // assuming no system without Unix timestamp
@@ -145,7 +207,7 @@ quint64 MAVLinkDecoder::getUnixTimeFromMs(int systemID, quint64 time)
         if (onboardTimeOffset[systemID] == 0 || time < (firstOnboardTime[systemID]-100))
         {
             firstOnboardTime[systemID] = time;
-            onboardTimeOffset[systemID] = QGC::groundTimeMilliseconds() - time;
+            onboardTimeOffset[systemID] = receiveUsecs/1000 - time;
         }
 
         if (time > firstOnboardTime[systemID]) firstOnboardTime[systemID] = time;
@@ -191,309 +253,304 @@ quint64 MAVLinkDecoder::getUnixTimeFromMs(int systemID, quint64 time)
     return ret;
 }
 
-void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time)
+/**
+ * The names depend on the system, on the component if a message comes from several, and for some
+ * messages on the port or the name in the payload. They are built on the first message of a kind
+ * and the keys are interned along with them.
+ */
+MAVLinkDecoder::ValueNames& MAVLinkDecoder::valueNames(const mavlink_message_t& message)
 {
-    bool multiComponentSourceDetected = false;
+    int index = (message.sysid << 8) | message.msgid;
+    uint8_t msgid = message.msgid;
+    quint64 id = message.sysid | (msgid << 8);
+    if (componentMulti[msgid])
+    {
+        id |= (quint64)(message.compid + 1) << 16;
+    }
+
+    QHash<QByteArray, ValueNames>* namedCache = NULL;
+    QByteArray namedId;
+    char debugName[11];
+    bool namedByPayload = true;
+    switch (msgid)
+    {
+    case MAVLINK_MSG_ID_RC_CHANNELS_RAW:
+        id |= (quint64)mavlink_msg_rc_channels_raw_get_port(&message) << 32;
+        break;
+    case MAVLINK_MSG_ID_RC_CHANNELS_SCALED:
+        id |= (quint64)mavlink_msg_rc_channels_scaled_get_port(&message) << 32;
+        break;
+    case MAVLINK_MSG_ID_SERVO_OUTPUT_RAW:
+        id |= (quint64)mavlink_msg_servo_output_raw_get_port(&message) << 32;
+        break;
+    case MAVLINK_MSG_ID_DEBUG:
+        id |= (quint64)mavlink_msg_debug_get_ind(&message) << 32;
+        break;
+    case MAVLINK_MSG_ID_DEBUG_VECT:
+    case MAVLINK_MSG_ID_NAMED_VALUE_FLOAT:
+    case MAVLINK_MSG_ID_NAMED_VALUE_INT:
+        // Named by the payload, up to ten chars
+        if (msgid == MAVLINK_MSG_ID_DEBUG_VECT)
+        {
+            mavlink_msg_debug_vect_get_name(&message, debugName);
+        }
+        else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT)
+        {
+            mavlink_msg_named_value_float_get_name(&message, debugName);
+        }
+        else
+        {
+            mavlink_msg_named_value_int_get_name(&message, debugName);
+        }
+        namedId = QByteArray((const char*)&id, sizeof(id)) + QByteArray(debugName, 10);
+        namedCache = &namedValueNameCache;
+        break;
+    default:
+        namedByPayload = false;
+        break;
+    }
 
-    // Store component ID
-    if (componentID[msg->msgid] == -1)
+    // Unless the payload changes them the names of a message of a system are known after the first one
+    if (!namedByPayload)
     {
-        componentID[msg->msgid] = msg->compid;
+        discovered[index] = true;
+    }
+
+    if (namedCache)
+    {
+        QHash<QByteArray, ValueNames>::iterator it = namedCache->find(namedId);
+        if (it != namedCache->end())
+        {
+            return it.value();
+        }
     }
     else
     {
-        // Got this message already
-        if (componentID[msg->msgid] != msg->compid)
+        QHash<quint64, ValueNames>::iterator it = valueNameCache.find(id);
+        if (it != valueNameCache.end())
         {
-            componentMulti[msg->msgid] = true;
+            return it.value();
         }
     }
 
-    if (componentMulti[msg->msgid] == true) multiComponentSourceDetected = true;
+    ValueNames names;
+    names.textsRouted = false;
+    names.version = -1;
+    const MAVLinkDescriptorTable::Message& descriptor = descriptors->message(msgid);
+    TelemetryKeyRegistry* registry = TelemetryKeyRegistry::instance();
+    QMutexLocker locker(&subscriptionMutex);
+    for (int i = 0; i < descriptor.values.count(); ++i)
+    {
+        const MAVLinkDescriptorTable::Value& value = descriptor.values[i];
+        QString name = valueName(message, value.fieldName, value.element);
+        int key = registry->intern(message.sysid, name, value.unit, value.integer);
+        names.names.append(name);
+        names.keys.append(key);
+        keyFields.insert(key, FieldId(message.sysid, QPair<int, QString>(msgid, value.fieldName)));
+    }
+    locker.unlock();
 
-    // Add field tree widget item
-    uint8_t msgid = msg->msgid;
-    if (messageFilter.contains(msgid)) return;
-    QString fieldName(messageInfo[msgid].fields[fieldid].name);
-    QString fieldType;
-    uint8_t* m = ((uint8_t*)(receivedMessages+msgid))+8;
-    QString name("%1.%2");
-    QString unit("");
+    if (namedCache)
+    {
+        return namedCache->insert(namedId, names).value();
+    }
+    return valueNameCache.insert(id, names).value();
+}
+
+/** @brief Name of a value of a message as shown to the user, element is -1 for scalar fields */
+QString MAVLinkDecoder::valueName(const mavlink_message_t& message, const QString& fieldName, int element) const
+{
+    uint8_t msgid = message.msgid;
+    QString messageName = descriptors->message(msgid).name;
+    QString name;
+    char buf[11];
 
     // Debug vector messages
     if (msgid == MAVLINK_MSG_ID_DEBUG_VECT)
     {
-        mavlink_debug_vect_t debug;
-        mavlink_msg_debug_vect_decode(msg, &debug);
-        char buf[11];
-        strncpy(buf, debug.name, 10);
+        mavlink_msg_debug_vect_get_name(&message, buf);
         buf[10] = '\0';
         name = QString("%1.%2").arg(buf).arg(fieldName);
-        time = getUnixTimeFromMs(msg->sysid, (debug.time_usec+500)/1000); // Scale to milliseconds, round up/down correctly
     }
     else if (msgid == MAVLINK_MSG_ID_DEBUG)
     {
-        mavlink_debug_t debug;
-        mavlink_msg_debug_decode(msg, &debug);
-        name = name.arg(QString("debug")).arg(debug.ind);
-        time = getUnixTimeFromMs(msg->sysid, debug.time_boot_ms);
+        name = QString("debug.%1").arg(mavlink_msg_debug_get_ind(&message));
     }
     else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT)
     {
-        mavlink_named_value_float_t debug;
-        mavlink_msg_named_value_float_decode(msg, &debug);
-        char buf[11];
-        strncpy(buf, debug.name, 10);
+        mavlink_msg_named_value_float_get_name(&message, buf);
         buf[10] = '\0';
         name = QString(buf);
-        time = getUnixTimeFromMs(msg->sysid, debug.time_boot_ms);
     }
     else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_INT)
     {
-        mavlink_named_value_int_t debug;
-        mavlink_msg_named_value_int_decode(msg, &debug);
-        char buf[11];
-        strncpy(buf, debug.name, 10);
+        mavlink_msg_named_value_int_get_name(&message, buf);
         buf[10] = '\0';
         name = QString(buf);
-        time = getUnixTimeFromMs(msg->sysid, debug.time_boot_ms);
     }
     else if (msgid == MAVLINK_MSG_ID_RC_CHANNELS_RAW)
     {
-        // XXX this is really ugly, but we do not know a better way to do this
-        mavlink_rc_channels_raw_t raw;
-        mavlink_msg_rc_channels_raw_decode(msg, &raw);
-        name = name.arg(messageInfo[msgid].name).arg(fieldName);
-        name.prepend(QString("port%1_").arg(raw.port));
+        name = QString("port%1_%2.%3").arg(mavlink_msg_rc_channels_raw_get_port(&message)).arg(messageName).arg(fieldName);
     }
     else if (msgid == MAVLINK_MSG_ID_RC_CHANNELS_SCALED)
     {
-        // XXX this is really ugly, but we do not know a better way to do this
-        mavlink_rc_channels_scaled_t scaled;
-        mavlink_msg_rc_channels_scaled_decode(msg, &scaled);
-        name = name.arg(messageInfo[msgid].name).arg(fieldName);
-        name.prepend(QString("port%1_").arg(scaled.port));
+        name = QString("port%1_%2.%3").arg(mavlink_msg_rc_channels_scaled_get_port(&message)).arg(messageName).arg(fieldName);
     }
     else if (msgid == MAVLINK_MSG_ID_SERVO_OUTPUT_RAW)
     {
-        // XXX this is really ugly, but we do not know a better way to do this
-        mavlink_servo_output_raw_t servo;
-        mavlink_msg_servo_output_raw_decode(msg, &servo);
-        name = name.arg(messageInfo[msgid].name).arg(fieldName);
-        name.prepend(QString("port%1_").arg(servo.port));
+        name = QString("port%1_%2.%3").arg(mavlink_msg_servo_output_raw_get_port(&message)).arg(messageName).arg(fieldName);
     }
     else
     {
-        name = name.arg(messageInfo[msgid].name).arg(fieldName);
+        name = QString("%1.%2").arg(messageName).arg(fieldName);
     }
 
-    if (multiComponentSourceDetected)
+    if (componentMulti[msgid])
     {
-        name = name.prepend(QString("C%1:").arg(msg->compid));
+        name.prepend(QString("C%1:").arg(message.compid));
     }
 
-    name = name.prepend(QString("M%1:").arg(msg->sysid));
+    name.prepend(QString("M%1:").arg(message.sysid));
 
-    switch (messageInfo[msgid].fields[fieldid].type)
+    if (element >= 0)
     {
-    case MAVLINK_TYPE_CHAR:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            char* str = (char*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            // Enforce null termination
-            str[messageInfo[msgid].fields[fieldid].array_length-1] = '\0';
-            QString string(name + ": " + str);
-            if (!textMessageFilter.contains(msgid)) emit textMessageReceived(msg->sysid, msg->compid, MAV_SEVERITY_INFO, string);
-        }
-        else
-        {
-            // Single char
-            char b = *((char*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            unit = QString("char[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            emit valueChanged(msg->sysid, name, unit, b, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT8_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint8_t* nums = m+messageInfo[msgid].fields[fieldid].wire_offset;
-            fieldType = QString("uint8_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint8_t u = *(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = "uint8_t";
-            emit valueChanged(msg->sysid, name, fieldType, u, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT8_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            int8_t* nums = (int8_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int8_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int8_t n = *((int8_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int8_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT16_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint16_t* nums = (uint16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("uint16_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint16_t n = *((uint16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "uint16_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT16_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            int16_t* nums = (int16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int16_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int16_t n = *((int16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int16_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT32_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint32_t* nums = (uint32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("uint32_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint32_t n = *((uint32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "uint32_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT32_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            int32_t* nums = (int32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int32_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int32_t n = *((int32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int32_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_FLOAT:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            float* nums = (float*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("float[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (float)(nums[j]), time);
-            }
-        }
-        else
-        {
-            // Single value
-            float f = *((float*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "float";
-            emit valueChanged(msg->sysid, name, fieldType, f, time);
-        }
-        break;
-    case MAVLINK_TYPE_DOUBLE:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            double* nums = (double*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("double[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            double f = *((double*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "double";
-            emit valueChanged(msg->sysid, name, fieldType, f, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT64_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint64_t* nums = (uint64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("uint64_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (quint64) nums[j], time);
-            }
-        }
-        else
+        name = QString("%1.%2").arg(name).arg(element);
+    }
+
+    return name;
+}
+
+void MAVLinkDecoder::subscribe(int uasId, int msgid, const QString& field)
+{
+    QMutexLocker locker(&subscriptionMutex);
+    changeSubscription(FieldId(uasId, QPair<int, QString>(msgid, field)), 1);
+}
+
+void MAVLinkDecoder::unsubscribe(int uasId, int msgid, const QString& field)
+{
+    QMutexLocker locker(&subscriptionMutex);
+    changeSubscription(FieldId(uasId, QPair<int, QString>(msgid, field)), -1);
+}
+
+bool MAVLinkDecoder::subscribeKey(int key)
+{
+    QMutexLocker locker(&subscriptionMutex);
+    QHash<int, FieldId>::const_iterator it = keyFields.constFind(key);
+    if (it == keyFields.constEnd())
+    {
+        return false;
+    }
+    changeSubscription(it.value(), 1);
+    return true;
+}
+
+bool MAVLinkDecoder::unsubscribeKey(int key)
+{
+    QMutexLocker locker(&subscriptionMutex);
+    QHash<int, FieldId>::const_iterator it = keyFields.constFind(key);
+    if (it == keyFields.constEnd())
+    {
+        return false;
+    }
+    changeSubscription(it.value(), -1);
+    return true;
+}
+
+/** @brief Call with the subscription mutex locked */
+void MAVLinkDecoder::changeSubscription(const FieldId& id, int delta)
+{
+    int count = subscriptions.value(id, 0) + delta;
+    if (count > 0)
+    {
+        subscriptions.insert(id, count);
+    }
+    else
+    {
+        subscriptions.remove(id);
+    }
+
+    // The decoder thread picks the change up with the next message
+    subscriptionVersion.ref();
+}
+
+/**
+ * The routes tell for every system and message id in one lookup whether anything of the message
+ * is subscribed, so the messages nobody listens to are dropped before they are decoded.
+ */
+void MAVLinkDecoder::updateRoutes()
+{
+    QMutexLocker locker(&subscriptionMutex);
+    routedVersion = subscriptionVersion.load();
+    routes.fill(ROUTE_NONE);
+
+    for (QHash<FieldId, int>::const_iterator it = subscriptions.constBegin(); it != subscriptions.constEnd(); ++it)
+    {
+        int uasId = it.key().first;
+        int msgid = it.key().second.first;
+        quint8 route = it.key().second.second.isEmpty() ? ROUTE_ALL : ROUTE_FIELDS;
+        if (uasId < 0 || uasId > 255 || msgid < -1 || msgid > 255)
         {
-            // Single value
-            uint64_t n = *((uint64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "uint64_t";
-            emit valueChanged(msg->sysid, name, fieldType, (quint64) n, time);
+            continue;
         }
-        break;
-    case MAVLINK_TYPE_INT64_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
+
+        int firstSystem = uasId == 0 ? 0 : uasId;
+        int lastSystem = uasId == 0 ? 255 : uasId;
+        int firstMessage = msgid == -1 ? 0 : msgid;
+        int lastMessage = msgid == -1 ? 255 : msgid;
+        for (int system = firstSystem; system <= lastSystem; ++system)
         {
-            int64_t* nums = (int64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int64_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
+            for (int message = firstMessage; message <= lastMessage; ++message)
             {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (qint64) nums[j], time);
+                quint8& current = routes[(system << 8) | message];
+                if (current < route)
+                {
+                    current = route;
+                }
             }
         }
-        else
+    }
+}
+
+void MAVLinkDecoder::routeValues(const mavlink_message_t& message, Route route, ValueNames* names)
+{
+    const MAVLinkDescriptorTable::Message& descriptor = descriptors->message(message.msgid);
+    QMutexLocker locker(&subscriptionMutex);
+
+    names->routed.clear();
+    for (int i = 0; i < descriptor.values.count(); ++i)
+    {
+        if (route == ROUTE_ALL || isSubscribed(message.sysid, message.msgid, descriptor.values[i].fieldName))
         {
-            // Single value
-            int64_t n = *((int64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int64_t";
-            emit valueChanged(msg->sysid, name, fieldType, (qint64) n, time);
+            names->routed.append(i);
         }
-        break;
-    default:
-        qDebug() << "WARNING: UNKNOWN MAVLINK TYPE";
     }
+
+    names->textsRouted = route == ROUTE_ALL;
+    for (int i = 0; i < descriptor.texts.count() && !names->textsRouted; ++i)
+    {
+        names->textsRouted = isSubscribed(message.sysid, message.msgid, descriptor.texts[i].fieldName);
+    }
+
+    names->version = routedVersion;
+}
+
+bool MAVLinkDecoder::isSubscribed(int uasId, int msgid, const QString& field) const
+{
+    return subscriptions.contains(FieldId(uasId, QPair<int, QString>(msgid, field)))
+        || subscriptions.contains(FieldId(0, QPair<int, QString>(msgid, field)))
+        || subscriptions.contains(FieldId(uasId, QPair<int, QString>(-1, field)))
+        || subscriptions.contains(FieldId(0, QPair<int, QString>(-1, field)));
+}
+
+void MAVLinkDecoder::emitLatency(int uasId, double latencyMsecs, quint64 time)
+{
+    // Interned once per system, the key cache is only used on the decoder thread
+    int& key = latencyKey[uasId];
+    if (key == -1)
+    {
+        key = TelemetryKeyRegistry::instance()->intern(uasId, latencyName, latencyUnit, false);
+    }
+
+    TelemetryStore::instance()->append(key, time, latencyMsecs);
+    emit valueChanged(uasId, latencyName, latencyUnit, QVariant(latencyMsecs), time);
 }
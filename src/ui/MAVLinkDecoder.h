@@ -2,7 +2,13 @@
 #define MAVLINKDECODER_H
 
 #include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <QMutex>
+#include <QAtomicInt>
 #include "MAVLinkProtocol.h"
+#include "MAVLinkDescriptorTable.h"
 
 class MAVLinkDecoder : public QThread
 {
@@ -12,28 +18,93 @@ public:
 
     void run();
 
+    /**
+     * @brief Decode and emit a field of a message. Messages nobody subscribed to are not decoded.
+     *
+     * Subscriptions are counted, every subscribe needs its unsubscribe. Can be called from any thread.
+     *
+     * @param uasId System to decode the field of, 0 for all systems
+     * @param msgid Message to decode the field of, -1 for all messages
+     * @param field Field name as in the message definition, all elements of an array field. Empty for all fields.
+     */
+    void subscribe(int uasId, int msgid, const QString& field = QString());
+    /** @brief Remove a subscription made with subscribe() */
+    void unsubscribe(int uasId, int msgid, const QString& field = QString());
+    /**
+     * @brief Subscribe the field a telemetry key was interned for by this decoder.
+     * Values named by their payload, like NAMED_VALUE_FLOAT, subscribe all names of their system.
+     * @return false if the key is not a value of this decoder (yet)
+     */
+    bool subscribeKey(int key);
+    /** @brief Remove a subscription made with subscribeKey() */
+    bool unsubscribeKey(int key);
+
 signals:
     void textMessageReceived(int uasid, int componentid, int severity, const QString& text);
     void valueChanged(const int uasId, const QString& name, const QString& unit, const QVariant& value, const quint64 msec);
 
 public slots:
     /** @brief Receive one message from the protocol and decode it */
-    void receiveMessage(LinkInterface* link,mavlink_message_t message);
+    void receiveMessage(LinkInterface* link, MAVLinkMessage message);
 protected:
-    /** @brief Emit the value of one message field */
-    void emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time);
-    /** @brief Shift a timestamp in Unix time if necessary */
-    quint64 getUnixTimeFromMs(int systemID, quint64 time);
+    /** @brief Names and telemetry keys of the values of one kind of message */
+    struct ValueNames {
+        QVector<QString> names;
+        QVector<int> keys;
+        QVector<int> routed;    ///< Indices of the subscribed values
+        bool textsRouted;       ///< A text field is subscribed
+        int version;            ///< Subscriptions the routing was computed for
+    };
+
+    /** @brief A field of the messages of a system */
+    typedef QPair<int, QPair<int, QString> > FieldId;
+
+    /** @brief How much of a message of a system is subscribed */
+    enum Route {
+        ROUTE_NONE = 0,
+        ROUTE_FIELDS,
+        ROUTE_ALL
+    };
 
-    mavlink_message_t receivedMessages[256]; ///< Available / known messages
-    mavlink_message_info_t messageInfo[256]; ///< Message information
+    /** @brief Returns the names and keys of the values of a message, building them on first use */
+    ValueNames& valueNames(const mavlink_message_t& message);
+    /** @brief Rebuild the routes after the subscriptions changed */
+    void updateRoutes(void);
+    /** @brief Select the subscribed values of a message */
+    void routeValues(const mavlink_message_t& message, Route route, ValueNames* names);
+    /** @brief The field is subscribed directly or through a system or message wildcard, call with the subscription mutex locked */
+    bool isSubscribed(int uasId, int msgid, const QString& field) const;
+    /** @brief Change the count of a subscription */
+    void changeSubscription(const FieldId& id, int delta);
+    /** @brief Build the name of a message field as shown to the user, element is -1 for scalar fields */
+    QString valueName(const mavlink_message_t& message, const QString& fieldName, int element) const;
+    /** @brief Append the latency of a system to the telemetry store and emit it with valueChanged */
+    void emitLatency(int uasId, double latencyMsecs, quint64 time);
+    /** @brief Convert an onboard timestamp to ground time in milliseconds, using the time sync of the protocol if the system is synchronized */
+    quint64 getUnixTime(int systemID, quint64 onboardUsecs, quint64 receiveUsecs);
+
+    const MAVLinkDescriptorTable* descriptors;       ///< Fields and time locators of all messages
+    QHash<quint64, ValueNames> valueNameCache;        ///< By system, component, message and port
+    QHash<QByteArray, ValueNames> namedValueNameCache; ///< Of the messages named by their payload
     QMap<uint16_t, bool> messageFilter;               ///< Message/field names not to emit
     QMap<uint16_t, bool> textMessageFilter;           ///< Message/field names not to emit in text mode
     int componentID[256];                             ///< Multi component detection
     bool componentMulti[256];                         ///< Multi components detected
-    quint64 onboardTimeOffset[256];                   ///< Offset of onboard time from Unix epoch (of the receiving GCS)
-    qint64 onboardToGCSUnixTimeOffsetAndDelay[256];   ///< Offset of onboard time and GCS Unix time
+    MAVLinkTimeSync* timeSync;                        ///< Onboard to ground clock offsets, shared with the UAS objects
+    quint64 onboardTimeOffset[256];                   ///< Offset of onboard time from Unix epoch (of the receiving GCS), used until the system is synchronized
     quint64 firstOnboardTime[256];                    ///< First seen onboard time
+    quint64 lastLatencyTime[256];                     ///< Receive time the latency was last emitted at, in microseconds
+    int latencyKey[256];                              ///< Telemetry key of the latency by system, -1 until interned
+    const QString latencyName;                        ///< Name of the latency value
+    const QString latencyUnit;
+
+    QMutex subscriptionMutex;                         ///< Protects the subscriptions and keyFields, they are changed from other threads
+    QHash<FieldId, int> subscriptions;                ///< Subscription counts, system 0 and message -1 match all, an empty field all fields
+    QHash<int, FieldId> keyFields;                    ///< Fields of the telemetry keys interned by the decoder
+    QAtomicInt subscriptionVersion;                   ///< Incremented on every change of the subscriptions
+    int routedVersion;                                ///< Subscriptions the routes were built for, decoder thread only
+    QVector<quint8> routes;                           ///< Route by system and message id, decoder thread only
+    QVector<bool> discovered;                         ///< Names of the message known, by system and message id, decoder thread only
 
 };
 
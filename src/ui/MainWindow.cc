@@ -133,6 +133,7 @@ MainWindow::MainWindow(QWidget *parent):
     connect(menuActionHelper, SIGNAL(needToShowDockWidget(QString,bool)),SLOT(showDockWidget(QString,bool)));
     //TODO:  move protocol outside UI
     connect(mavlink, SIGNAL(protocolStatusMessage(QString,QString)), this, SLOT(showCriticalMessage(QString,QString)), Qt::QueuedConnection);
+    connect(mavlink->getTimeSync(), SIGNAL(latencyExceeded(int,qint64)), this, SLOT(showLatencyWarning(int,qint64)), Qt::QueuedConnection);
     loadSettings();
 }
 
@@ -1126,6 +1127,11 @@ void MainWindow::showStatusMessage(const QString& status)
     statusBar()->showMessage(status, 20000);
 }
 
+void MainWindow::showLatencyWarning(int sysid, qint64 latencyUsecs)
+{
+    showStatusMessage(tr("The telemetry of system %1 arrives with a latency of %2 ms").arg(sysid).arg(latencyUsecs / 1000));
+}
+
 void MainWindow::showCriticalMessage(const QString& title, const QString& message)
 {
     QMessageBox msgBox(this);
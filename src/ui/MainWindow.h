@@ -143,6 +143,12 @@ public:
         return currentStyle;
     }
 
+    /** @brief Get the decoder of the generic MAVLink values, NULL until the widgets are built */
+    MAVLinkDecoder* getMAVLinkDecoder() const
+    {
+        return mavlinkDecoder;
+    }
+
     /** @brief Get current light visual stylesheet */
     QString getLightStyleSheet() const
     {
@@ -191,6 +197,8 @@ public slots:
     void showStatusMessage(const QString& status);
     /** @brief Shows a critical message as popup or as widget */
     void showCriticalMessage(const QString& title, const QString& message);
+    /** @brief Warns on the status bar that the messages of a system arrive late */
+    void showLatencyWarning(int sysid, qint64 latencyUsecs);
     /** @brief Shows an info message as popup or as widget */
     void showInfoMessage(const QString& title, const QString& message);
 
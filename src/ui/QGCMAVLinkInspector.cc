@@ -51,7 +51,7 @@ QGCMAVLinkInspector::QGCMAVLinkInspector(MAVLinkProtocol* protocol, QWidget *par
 
     // Connect external connections
     connect(UASManager::instance(), SIGNAL(UASCreated(UASInterface*)), this, SLOT(addSystem(UASInterface*)));
-    connect(protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), this, SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
+    connect(protocol, SIGNAL(sharedMessageReceived(LinkInterface*,MAVLinkMessage)), this, SLOT(receiveMessage(LinkInterface*,MAVLinkMessage)));
 
     // Attach the UI's refresh rate to a timer.
     connect(&updateTimer, SIGNAL(timeout()), this, SLOT(refreshView()));
@@ -351,9 +351,10 @@ void QGCMAVLinkInspector::addUAStoTree(int sysId)
     }
 }
 
-void QGCMAVLinkInspector::receiveMessage(LinkInterface* link,mavlink_message_t message)
+void QGCMAVLinkInspector::receiveMessage(LinkInterface* link, MAVLinkMessage messageRef)
 {
     Q_UNUSED(link);
+    const mavlink_message_t& message = *messageRef;
 
     quint64 receiveTime;
     
@@ -23,7 +23,7 @@ public:
     ~QGCMAVLinkInspector();
 
 public slots:
-    void receiveMessage(LinkInterface* link,mavlink_message_t message);
+    void receiveMessage(LinkInterface* link, MAVLinkMessage message);
     /** @brief Clear all messages */
     void clearView();
     /** @brief Update view */
@@ -103,7 +103,7 @@ void QGCMAVLinkLogPlayer::play()
 
         // Always correct the current start time such that the next message will play immediately at playback.
         // We do this by subtracting the current file playback offset  from now()
-        playbackStartTime = (quint64)QDateTime::currentMSecsSinceEpoch() - (logCurrentTime - logStartTime) / 1000;
+        playbackStartTime = QGC::groundTimeMilliseconds() - (logCurrentTime - logStartTime) / 1000;
 
         // Start timer
         if (mavlinkLogFormat)
@@ -500,7 +500,7 @@ quint64 QGCMAVLinkLogPlayer::parseTimestamp(const QByteArray &data)
     quint64 timestamp = qFromBigEndian(*((quint64*)(data.constData())));
 
     // And get the current time in microseconds
-    quint64 currentTimestamp = ((quint64)QDateTime::currentMSecsSinceEpoch()) * 1000;
+    quint64 currentTimestamp = QGC::groundTimeUsecs();
 
     // Now if the parsed timestamp is in the future, it must be an old file where the timestamp was stored as
     // little endian, so switch it.
@@ -614,7 +614,7 @@ void QGCMAVLinkLogPlayer::logLoop()
             // We pace ourselves relative to the start time of playback to fix any drift (initially set in play())
             qint64 timediff = (logCurrentTime - logStartTime) / accelerationFactor;
             quint64 desiredPacedTime = playbackStartTime + ((quint64)timediff) / 1000;
-            quint64 currentTime = (quint64)QDateTime::currentMSecsSinceEpoch();
+            quint64 currentTime = QGC::groundTimeMilliseconds();
             nextExecutionTime = desiredPacedTime - currentTime;
         }
 
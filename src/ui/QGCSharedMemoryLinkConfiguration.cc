@@ -0,0 +1,29 @@
+#include "QGCSharedMemoryLinkConfiguration.h"
+#include "ui_QGCSharedMemoryLinkConfiguration.h"
+
+QGCSharedMemoryLinkConfiguration::QGCSharedMemoryLinkConfiguration(SharedMemoryLink* link, QWidget *parent) :
+    QWidget(parent),
+    link(link),
+    ui(new Ui::QGCSharedMemoryLinkConfiguration)
+{
+    ui->setupUi(this);
+    ui->channelNameLineEdit->setText(link->getChannelName());
+    connect(ui->channelNameLineEdit, SIGNAL(textChanged(const QString &)), link, SLOT(setChannelName(const QString &)));
+}
+
+QGCSharedMemoryLinkConfiguration::~QGCSharedMemoryLinkConfiguration()
+{
+    delete ui;
+}
+
+void QGCSharedMemoryLinkConfiguration::changeEvent(QEvent *e)
+{
+    QWidget::changeEvent(e);
+    switch (e->type()) {
+    case QEvent::LanguageChange:
+        ui->retranslateUi(this);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef QGCSHAREDMEMORYLINKCONFIGURATION_H
+#define QGCSHAREDMEMORYLINKCONFIGURATION_H
+
+#include <QWidget>
+
+#include "SharedMemoryLink.h"
+
+namespace Ui
+{
+class QGCSharedMemoryLinkConfiguration;
+}
+
+class QGCSharedMemoryLinkConfiguration : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit QGCSharedMemoryLinkConfiguration(SharedMemoryLink* link, QWidget *parent = 0);
+    ~QGCSharedMemoryLinkConfiguration();
+
+public slots:
+
+protected:
+    void changeEvent(QEvent *e);
+
+    SharedMemoryLink* link;    ///< Shared memory link instance this widget configures
+
+private:
+    Ui::QGCSharedMemoryLinkConfiguration *ui;
+};
+
+#endif // QGCSHAREDMEMORYLINKCONFIGURATION_H
@@ -15,6 +15,13 @@ QGCTCPLinkConfiguration::QGCTCPLinkConfiguration(TCPLink* link, QWidget *parent)
     ui->hostAddressLineEdit->setText(addr);
     connect(ui->portSpinBox, SIGNAL(valueChanged(int)), link, SLOT(setPort(int)));
     connect(ui->hostAddressLineEdit, SIGNAL(textChanged (const QString &)), link, SLOT(setHostAddress(const QString &)));
+    ui->serverModeCheckBox->setChecked(link->getMode() == TCPLink::ServerMode);
+    connect(ui->serverModeCheckBox, SIGNAL(toggled(bool)), this, SLOT(setServerMode(bool)));
+}
+
+void QGCTCPLinkConfiguration::setServerMode(bool server)
+{
+    link->setMode(server ? TCPLink::ServerMode : TCPLink::ClientMode);
 }
 
 QGCTCPLinkConfiguration::~QGCTCPLinkConfiguration()
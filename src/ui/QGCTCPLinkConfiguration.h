@@ -19,6 +19,7 @@ public:
     ~QGCTCPLinkConfiguration();
 
 public slots:
+    void setServerMode(bool server);
 
 protected:
     void changeEvent(QEvent *e);
@@ -437,6 +437,21 @@ void QGCToolBar::updateArmingState(bool armed)
 
 void QGCToolBar::updateView()
 {
+    // The link counters are read without locking
+    if (currentLink && currentLink->isConnected())
+    {
+        const LinkStatistics& statistics = currentLink->getStatistics();
+        connectButton->setToolTip(tr("In: %L1 kB/s, out: %L2 kB/s, %L3 frames lost, %L4 CRC errors")
+                                  .arg(statistics.inDataRate() / 8000.0, 0, 'f', 1)
+                                  .arg(statistics.outDataRate() / 8000.0, 0, 'f', 1)
+                                  .arg(statistics.sequenceGaps())
+                                  .arg(statistics.crcErrors()));
+    }
+    else
+    {
+        connectButton->setToolTip(tr("Connect wireless link to MAV"));
+    }
+
     if (!changed) return;
     if (toolBarWpAction->isVisible())
         toolBarWpLabel->setText(tr("WP%1").arg(wpId));
@@ -239,9 +239,37 @@ QGCXYPlot::QGCXYPlot(QWidget *parent) :
 
 QGCXYPlot::~QGCXYPlot()
 {
+    if (decoder)
+    {
+        decoder->unsubscribe(0, -1);
+    }
     delete ui;
 }
 
+void QGCXYPlot::showEvent(QShowEvent* event)
+{
+    // Any value can be picked for the axes, take all of them
+    if (!decoder)
+    {
+        decoder = MainWindow::instance()->getMAVLinkDecoder();
+        if (decoder)
+        {
+            decoder->subscribe(0, -1);
+        }
+    }
+    QGCToolWidgetItem::showEvent(event);
+}
+
+void QGCXYPlot::hideEvent(QHideEvent* event)
+{
+    if (decoder)
+    {
+        decoder->unsubscribe(0, -1);
+        decoder = NULL;
+    }
+    QGCToolWidgetItem::hideEvent(event);
+}
+
 void QGCXYPlot::clearPlot()
 {
     xycurve->clear();
@@ -1,6 +1,8 @@
 #ifndef QGCXYPLOT_H
 #define QGCXYPLOT_H
 
+#include <QPointer>
+
 #include "QGCToolWidgetItem.h"
 #include "MainWindow.h"
 
@@ -31,6 +33,10 @@ public slots:
     void styleChanged(MainWindow::QGC_MAINWINDOW_STYLE style);
     void updateMinMaxSettings();
 
+protected:
+    /** @brief Decode the MAVLink values only while the plot is shown */
+    void showEvent(QShowEvent* event);
+    void hideEvent(QHideEvent* event);
 
 private slots:
     void on_maxDataShowSpinBox_valueChanged(int value);
@@ -51,6 +57,7 @@ private:
     quint64 y_timestamp_us; /**< Timestamp that we last recieved a value for x */
     bool y_valid; /**< Whether we have recieved an x value but so far no corresponding y value */
     quint64 max_timestamp_diff_us; /**< Only combine x and y to a data point if the timestamp for both doesn't differ by more than this */
+    QPointer<MAVLinkDecoder> decoder; /**< Decoder all values are subscribed of while the plot is shown */
 };
 
 #endif // QGCXYPLOT_H
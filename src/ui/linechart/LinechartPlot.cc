@@ -647,6 +647,8 @@ void LinechartPlot::setAverageWindow(int windowSize)
 void LinechartPlot::paintRealtime()
 {
     if (m_active) {
+        emit aboutToRepaint();
+
 #if (QGC_EVENTLOOP_DEBUG)
         static quint64 timestamp = 0;
         qDebug() << "EVENTLOOP: (" << MG::TIME::getGroundTimeNow() - timestamp << ")" << __FILE__ << __LINE__;
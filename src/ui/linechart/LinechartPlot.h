@@ -307,6 +307,10 @@ signals:
          * @param position The position of the right edge of the window, in milliseconds
          **/
     void windowPositionChanged(quint64 position);
+    /**
+         * @brief This signal is emitted right before the plot repaints, to append the data received since the last repaint
+         **/
+    void aboutToRepaint();
 };
 
 #endif // _LINECHARTPLOT_H_
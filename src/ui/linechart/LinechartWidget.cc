@@ -53,6 +53,8 @@ This file is part of the PIXHAWK project
 #include "MainWindow.h"
 #include "QGC.h"
 #include "MG.h"
+#include "TelemetryKeyRegistry.h"
+#include "TelemetryStore.h"
 
 
 LinechartWidget::LinechartWidget(int systemid, QWidget *parent) : QWidget(parent),
@@ -301,6 +303,7 @@ void LinechartWidget::createLayout()
     // Update scrollbar when plot window changes (via translator method setPlotWindowPosition()
 //    connect(activePlot, SIGNAL(windowPositionChanged(quint64)), this, SLOT(setPlotWindowPosition(quint64)));
     connect(activePlot, SIGNAL(curveRemoved(QString)), this, SLOT(removeCurve(QString)));
+    connect(activePlot, SIGNAL(aboutToRepaint()), this, SLOT(pullSamples()));
 
     // Update plot when scrollbar is moved (via translator method setPlotWindowPosition()
     connect(this, SIGNAL(plotWindowPositionUpdated(quint64)), activePlot, SLOT(setWindowPosition(quint64)));
@@ -322,32 +325,81 @@ void LinechartWidget::toggleLogarithmicScaling(bool checked)
         activePlot->setLinearScaling();
 }
 
-void LinechartWidget::appendData(int uasId, const QString& curve, const QString& unit, const QVariant &variant, quint64 usec)
+/**
+ * The UAS objects and the decoder publish every value to the telemetry store
+ * once. The plot reads what arrived since its last repaint, so it costs the
+ * same no matter how fast the values arrive.
+ */
+void LinechartWidget::pullSamples()
 {
-    QMetaType::Type type = static_cast<QMetaType::Type>(variant.type());
-    bool ok;
-    double value = variant.toDouble(&ok);
-    if(!ok || type == QMetaType::QByteArray || type == QMetaType::QString)
+    if (!isVisible())
         return;
-    bool isDouble = type == QMetaType::Float || type == QMetaType::Double;
 
+    TelemetryKeyRegistry* registry = TelemetryKeyRegistry::instance();
+    TelemetryStore* store = TelemetryStore::instance();
+
+    int keyCount = registry->count();
+    if (keyCount > sampleCurves.count())
+    {
+        int oldCount = sampleCurves.count();
+        sampleCurves.resize(keyCount);
+        for (int i = oldCount; i < sampleCurves.count(); ++i)
+        {
+            sampleCurves[i].known = false;
+            sampleCurves[i].pulledCount = 0;
+            sampleCurves[i].pulledMsecs = 0;
+        }
+    }
+
+    QVector<TelemetryStore::Sample> samples;
+    for (int key = 0; key < sampleCurves.count(); ++key)
+    {
+        SampleCurve& sample = sampleCurves[key];
+        quint32 count = store->sampleCount(key);
+        if (count == sample.pulledCount)
+            continue;
+        sample.pulledCount = count;
+
+        if (!sample.known)
+        {
+            TelemetryKeyRegistry::Key info = registry->key(key);
+            sample.known = true;
+            sample.uasId = info.uasId;
+            sample.curve = info.name;
+            sample.unit = info.unit;
+            sample.id = info.name + info.unit;
+            sample.isDouble = !info.integer;
+        }
+
+        store->window(key, sample.pulledMsecs + 1, Q_UINT64_C(0xFFFFFFFFFFFFFFFF), &samples);
+        for (int i = 0; i < samples.count(); ++i)
+        {
+            appendValue(sample.uasId, sample.curve, sample.unit, sample.id, samples[i].value, sample.isDouble, samples[i].msecs);
+        }
+        if (!samples.isEmpty())
+            sample.pulledMsecs = samples.last().msecs;
+    }
+}
+
+void LinechartWidget::appendValue(int uasId, const QString& curve, const QString& unit, const QString& id, double value, bool isDouble, quint64 usec)
+{
     if ((selectedMAV == -1 && isVisible()) || (selectedMAV == uasId && isVisible()))
     {
         // Order matters here, first append to plot, then update curve list
-        activePlot->appendData(curve+unit, usec, value);
+        activePlot->appendData(id, usec, value);
         // Store data
-        QLabel* label = curveLabels->value(curve+unit, NULL);
+        QLabel* label = curveLabels->value(id, NULL);
         // Make sure the curve will be created if it does not yet exist
         if(!label)
         {
             if(!isDouble)
-                intData.insert(curve+unit, 0);
+                intData.insert(id, 0);
             addCurve(curve, unit);
         }
 
         // Add int data
         if(!isDouble)
-            intData.insert(curve+unit, variant.toInt());
+            intData.insert(id, static_cast<int>(static_cast<qint64>(value)));
     }
 
     if (lastTimestamp == 0 && usec != 0)
@@ -365,7 +417,7 @@ void LinechartWidget::appendData(int uasId, const QString& curve, const QString&
     // Log data
     if (logging)
     {
-        if (activePlot->isVisible(curve+unit))
+        if (activePlot->isVisible(id))
         {
             if (usec == 0) usec = QGC::groundTimeMilliseconds();
             if (logStartTime == 0) logStartTime = usec;
@@ -40,6 +40,7 @@ This file is part of the PIXHAWK project
 #include <QScrollBar>
 #include <QSpinBox>
 #include <QMap>
+#include <QVector>
 #include <QString>
 #include <QAction>
 #include <QIcon>
@@ -77,8 +78,6 @@ public slots:
     void recolor();
     /** @brief Set short names for curves */
     void setShortNames(bool enable);
-    /** @brief Append data to the given curve. */
-    void appendData(int uasId, const QString& curve, const QString& unit, const QVariant& value, quint64 usec);
     /** @brief Hide curves which do not match the filter pattern */
     void filterCurves(const QString &filter);
 
@@ -116,6 +115,8 @@ private slots:
     void timeScaleChanged(int index);
     /** @brief Toggles visibility of curve based on bool match if corresponding checkbox is not checked */
     void filterCurve(const QString &key, bool match);
+    /** @brief Append the samples the telemetry store received since the last repaint of the plot */
+    void pullSamples();
 
 protected:
     void addCurveToList(QString curve);
@@ -125,6 +126,20 @@ protected:
     void createLayout();
     /** @brief Get the name for a curve key */
     QString getCurveName(const QString& key, bool shortEnabled);
+    /** @brief Append a value to a curve, id is the curve name followed by the unit */
+    void appendValue(int uasId, const QString& curve, const QString& unit, const QString& id, double value, bool isDouble, quint64 usec);
+
+    /** @brief Curve of a telemetry key */
+    struct SampleCurve {
+        bool known;                       ///< Looked up in the TelemetryKeyRegistry
+        int uasId;
+        QString curve;
+        QString unit;
+        QString id;                       ///< Curve followed by unit, the key of the curve in the plot
+        bool isDouble;
+        quint32 pulledCount;              ///< Samples of the key in the telemetry store when it was last pulled
+        quint64 pulledMsecs;              ///< Timestamp of the last sample pulled
+    };
 
     int sysid;                            ///< ID of the unmanned system this plot belongs to
     LinechartPlot* activePlot;            ///< Plot for this system
@@ -141,6 +156,7 @@ protected:
     QMap<QString, QWidget*> curveUnits;    ///< References to the curve units
     QMap<QString, QLabel*>* curveVariances; ///< References to the curve variances
     QMap<QString, int> intData;           ///< Current values for integer-valued curves
+    QVector<SampleCurve> sampleCurves;    ///< Curves of the telemetry keys seen so far, indexed by key
     QMap<QString, QWidget*> colorIcons;    ///< Reference to color icons
     QMap<QString, QCheckBox*> checkBoxes;    ///< Reference to checkboxes
 
@@ -4,11 +4,13 @@
 #include "UASManager.h"
 
 #include "MainWindow.h"
+#include "MAVLinkDecoder.h"
 
 Linecharts::Linecharts(QWidget *parent) :
     QStackedWidget(parent),
     plots(),
-    active(true)
+    active(true),
+    sourcesSubscribed(false)
 {
     this->setVisible(false);
     // Get current MAV list
@@ -38,6 +40,7 @@ void Linecharts::showEvent(QShowEvent* event)
             chart->setActive(true);
         }
     }
+    subscribeSources(true);
     QWidget::showEvent(event);
     emit visibilityChanged(true);
 }
@@ -55,6 +58,7 @@ void Linecharts::hideEvent(QHideEvent* event)
             chart->setActive(false);
         }
     }
+    subscribeSources(false);
     QWidget::hideEvent(event);
     emit visibilityChanged(false);
 }
@@ -88,6 +92,8 @@ void Linecharts::selectSystem(int systemid)
 void Linecharts::addSystem(UASInterface* uas)
 {
     // FIXME Add removeSystem() call
+    // The widget reads the values of the UAS from the telemetry store when it repaints
+    Q_UNUSED(uas);
 
     // Compatibility hack
     int uasid = 0; /*uas->getUASID()*/
@@ -96,9 +102,6 @@ void Linecharts::addSystem(UASInterface* uas)
         LinechartWidget* widget = new LinechartWidget(uasid, this);
         addWidget(widget);
         plots.insert(uasid, widget);
-		
-		// Connect valueChanged signals
-        connect(uas, SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)), widget, SLOT(appendData(int,QString,QString,QVariant,quint64)));
 
         connect(widget, SIGNAL(logfileWritten(QString)), this, SIGNAL(logfileWritten(QString)));
         // Set system active if this is the only system
@@ -106,12 +109,6 @@ void Linecharts::addSystem(UASInterface* uas)
 //        {
 //            if (plots.size() == 1)
 //            {
-                // FIXME XXX HACK
-                // Connect generic sources
-                for (int i = 0; i < genericSources.count(); ++i)
-                {
-                    connect(genericSources[i], SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,QVariant,quint64)));
-                }
                 // Select system
                 widget->setActive(true);
                 //widget->selectActiveSystem(0);
@@ -123,10 +120,39 @@ void Linecharts::addSystem(UASInterface* uas)
 void Linecharts::addSource(QObject* obj)
 {
     genericSources.append(obj);
-    // FIXME XXX HACK
-    if (plots.size() > 0)
+    MAVLinkDecoder* decoder = qobject_cast<MAVLinkDecoder*>(obj);
+    if (decoder && sourcesSubscribed)
     {
-        // Connect generic source
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,QVariant,quint64)));
+        decoder->subscribe(0, -1);
+    }
+}
+
+/**
+ * The plots list every value they receive to be picked, so all of them are
+ * decoded while the plots are shown and none while they are hidden.
+ */
+void Linecharts::subscribeSources(bool subscribe)
+{
+    if (subscribe == sourcesSubscribed)
+    {
+        return;
+    }
+    sourcesSubscribed = subscribe;
+
+    for (int i = 0; i < genericSources.count(); ++i)
+    {
+        MAVLinkDecoder* decoder = qobject_cast<MAVLinkDecoder*>(genericSources[i]);
+        if (!decoder)
+        {
+            continue;
+        }
+        if (subscribe)
+        {
+            decoder->subscribe(0, -1);
+        }
+        else
+        {
+            decoder->unsubscribe(0, -1);
+        }
     }
 }
@@ -32,6 +32,9 @@ protected:
     QMap<int, LinechartWidget*> plots;
     QVector<QObject*> genericSources;
     bool active;
+    bool sourcesSubscribed;     ///< All values of the decoder sources are subscribed
+    /** @brief Decode the values of the decoder sources only while the plots are shown */
+    void subscribeSources(bool subscribe);
     /** @brief Start updating widget */
     void showEvent(QShowEvent* event);
     /** @brief Stop updating widget */
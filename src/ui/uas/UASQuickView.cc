@@ -5,8 +5,12 @@
 #include "UASQuickViewTextItem.h"
 #include <QSettings>
 #include <QInputDialog>
+#include "TelemetryKeyRegistry.h"
+#include "TelemetryStore.h"
 UASQuickView::UASQuickView(QWidget *parent) : QWidget(parent),
-    uas(NULL)
+    uas(NULL),
+    m_telemetryKeyCount(0),
+    m_decoder(NULL)
 {
     quickViewSelectDialog=0;
     m_columnCount=2;
@@ -59,6 +63,13 @@ UASQuickView::~UASQuickView()
     {
         delete quickViewSelectDialog;
     }
+    if (m_decoder)
+    {
+        foreach (int key, m_subscribedKeys)
+        {
+            m_decoder->unsubscribeKey(key);
+        }
+    }
 }
 void UASQuickView::columnActionTriggered()
 {
@@ -237,9 +248,17 @@ void UASQuickView::selectDialogClosed()
 
 void UASQuickView::updateTimerTick()
 {
-    //uasPropertyValueMap
+    updatePropertyKeys();
+    updateSubscriptions();
+
+    // Pull the latest values of the shown properties, the view costs the same no matter how fast they arrive
     for (QMap<QString,UASQuickViewItem*>::const_iterator i = uasPropertyToLabelMap.constBegin(); i != uasPropertyToLabelMap.constEnd();i++)
     {
+        TelemetryStore::Sample sample;
+        if (uasPropertyKeyMap.contains(i.key()) && TelemetryStore::instance()->latest(uasPropertyKeyMap[i.key()], &sample))
+        {
+            uasPropertyValueMap[i.key()] = sample.value;
+        }
         if (uasPropertyValueMap.contains(i.key()))
         {
             i.value()->setValue(uasPropertyValueMap[i.key()]);
@@ -247,6 +266,81 @@ void UASQuickView::updateTimerTick()
     }
 }
 
+void UASQuickView::updatePropertyKeys()
+{
+    TelemetryKeyRegistry* registry = TelemetryKeyRegistry::instance();
+    int count = registry->count();
+    int activeId = uas ? uas->getUASID() : -1;
+    for (; m_telemetryKeyCount < count; m_telemetryKeyCount++)
+    {
+        TelemetryKeyRegistry::Key key = registry->key(m_telemetryKeyCount);
+
+        // The values the UAS objects publish have the same names for every system, show those of the active one
+        if (uasPropertyKeyMap.contains(key.name) && key.uasId != activeId)
+        {
+            continue;
+        }
+        uasPropertyKeyMap[key.name] = m_telemetryKeyCount;
+
+        if (!uasPropertyValueMap.contains(key.name))
+        {
+            if (quickViewSelectDialog)
+            {
+                quickViewSelectDialog->addItem(key.name);
+            }
+            uasPropertyValueMap[key.name] = 0;
+        }
+    }
+}
+
+void UASQuickView::updateSubscriptions()
+{
+    if (!m_decoder)
+    {
+        return;
+    }
+
+    QSet<int> shownKeys;
+    for (QMap<QString,UASQuickViewItem*>::const_iterator i = uasPropertyToLabelMap.constBegin(); i != uasPropertyToLabelMap.constEnd();i++)
+    {
+        if (uasPropertyKeyMap.contains(i.key()))
+        {
+            shownKeys.insert(uasPropertyKeyMap[i.key()]);
+        }
+    }
+
+    QSet<int>::iterator it = m_subscribedKeys.begin();
+    while (it != m_subscribedKeys.end())
+    {
+        if (!shownKeys.contains(*it))
+        {
+            m_decoder->unsubscribeKey(*it);
+            it = m_subscribedKeys.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // The properties published by the UAS objects are not the decoder's
+    foreach (int key, shownKeys)
+    {
+        if (m_subscribedKeys.contains(key) || m_foreignKeys.contains(key))
+        {
+            continue;
+        }
+        if (m_decoder->subscribeKey(key))
+        {
+            m_subscribedKeys.insert(key);
+        }
+        else
+        {
+            m_foreignKeys.insert(key);
+        }
+    }
+}
+
 void UASQuickView::addUAS(UASInterface* uas)
 {
     if (uas)
@@ -265,34 +359,14 @@ void UASQuickView::setActiveUAS(UASInterface* uas)
         return;
     }
     this->uas = uas;
-    connect(uas,SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)),this,SLOT(valueChanged(int,QString,QString,QVariant,quint64)));
-    //connect(uas,SIGNAL())
+
+    // Look at all keys again on the next update, to point the shared property names to the new active system
+    m_telemetryKeyCount = 0;
 }
 void UASQuickView::addSource(MAVLinkDecoder *decoder)
 {
-    connect(decoder,SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)),this,SLOT(valueChanged(int,QString,QString,QVariant,quint64)));
-}
-
-void UASQuickView::valueChanged(const int uasId, const QString& name, const QString& unit, const QVariant &variant, const quint64 msec)
-{
-    Q_UNUSED(uasId);
-    Q_UNUSED(unit);
-    Q_UNUSED(msec);
-    
-    bool ok;
-    double value = variant.toDouble(&ok);
-    QMetaType::Type metaType = static_cast<QMetaType::Type>(variant.type());
-    if(!ok || metaType == QMetaType::QString || metaType == QMetaType::QByteArray)
-        return;
-
-    if (!uasPropertyValueMap.contains(name))
-    {
-        if (quickViewSelectDialog)
-        {
-            quickViewSelectDialog->addItem(name);
-        }
-    }
-    uasPropertyValueMap[name] = value;
+    // The decoder appends the subscribed values to the telemetry store, which is read on every update
+    m_decoder = decoder;
 }
 
 void UASQuickView::actionTriggered(bool checked)
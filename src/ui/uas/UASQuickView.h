@@ -4,6 +4,7 @@
 #include <QWidget>
 #include <QTimer>
 #include <QLabel>
+#include <QSet>
 #include "uas/UASManager.h"
 #include "uas/UASInterface.h"
 #include "ui_UASQuickView.h"
@@ -26,6 +27,27 @@ private:
     /** Maps from the property name to the current value */
     QMap<QString,double> uasPropertyValueMap;
 
+    /** Maps from the property name to its key in the telemetry store */
+    QMap<QString,int> uasPropertyKeyMap;
+
+    /** Number of telemetry keys already looked at for new properties */
+    int m_telemetryKeyCount;
+
+    /** Adds the properties of the telemetry keys registered since the last call */
+    void updatePropertyKeys();
+
+    /** Decoder of the generic MAVLink values, only the shown ones are decoded */
+    MAVLinkDecoder *m_decoder;
+
+    /** Keys of the shown properties subscribed at the decoder */
+    QSet<int> m_subscribedKeys;
+
+    /** Keys of shown properties the decoder does not publish */
+    QSet<int> m_foreignKeys;
+
+    /** Subscribes the shown properties at the decoder and unsubscribes the hidden ones */
+    void updateSubscriptions();
+
     /** Maps from property name to the display item */
     QMap<QString,UASQuickViewItem*> uasPropertyToLabelMap;
 
@@ -59,7 +81,6 @@ protected:
 signals:
     
 public slots:
-    void valueChanged(const int uasid, const QString& name, const QString& unit, const QVariant& value,const quint64 msecs);
     void actionTriggered(bool checked);
     void actionTriggered();
     void updateTimerTick();